@@ -11,6 +11,7 @@
 #include "data\EmulatorContext.hh"
 #include "data\GameContext.hh"
 #include "data\SessionTracker.hh"
+#include "data\SubmissionQueue.hh"
 #include "data\UserContext.hh"
 
 #include "services\AchievementRuntime.hh"
@@ -21,6 +22,7 @@
 #include "services\IFileSystem.hh"
 #include "services\PerformanceCounter.hh"
 #include "services\ServiceLocator.hh"
+#include "services\Tracer.hh"
 
 #include "ui\drawing\gdi\GDISurface.hh"
 #include "ui\viewmodels\LoginViewModel.hh"
@@ -92,6 +94,9 @@ static void HandleLoginResponse(const ra::api::Login::Response& response)
         auto& pSessionTracker = ra::services::ServiceLocator::GetMutable<ra::data::SessionTracker>();
         pSessionTracker.Initialize(response.Username);
 
+        // resume sending any unlocks that couldn't be sent during the previous session
+        ra::services::ServiceLocator::GetMutable<ra::data::SubmissionQueue>().Initialize(response.Username);
+
         // show the welcome message
         ra::services::ServiceLocator::Get<ra::services::IAudioSystem>().PlayAudioFile(L"Overlay\\login.wav");
 
@@ -258,6 +263,8 @@ static void ProcessAchievements()
     if (pRuntime.IsPaused())
         return;
 
+    ra::services::TraceSpan span("ProcessAchievements");
+
 #ifndef RA_UTEST
     {
         auto* pEditingAchievement = g_AchievementEditorDialog.ActiveAchievement();
@@ -268,11 +275,13 @@ static void ProcessAchievements()
 
     const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
 
-    TALLY_PERFORMANCE(PerformanceCheckpoint::RuntimeProcess);
     std::vector<ra::services::AchievementRuntime::Change> vChanges;
-    pRuntime.Process(vChanges);
+    {
+        ra::services::PerformanceTimer tRuntime(PerformanceCheckpoint::RuntimeProcess);
+        pRuntime.Process(vChanges);
+    }
 
-    TALLY_PERFORMANCE(PerformanceCheckpoint::RuntimeEvents);
+    ra::services::PerformanceTimer tEvents(PerformanceCheckpoint::RuntimeEvents);
     for (const auto& pChange : vChanges)
     {
         switch (pChange.nType)
@@ -405,30 +414,42 @@ API void CCONV _RA_SetPaused(bool bIsPaused)
 
 static void UpdateUIForFrameChange()
 {
-    TALLY_PERFORMANCE(PerformanceCheckpoint::OverlayManagerAdvanceFrame);
-    auto& pOverlayManager = ra::services::ServiceLocator::GetMutable<ra::ui::viewmodels::OverlayManager>();
-    pOverlayManager.AdvanceFrame();
+    {
+        ra::services::PerformanceTimer tOverlay(PerformanceCheckpoint::OverlayManagerAdvanceFrame);
+        auto& pOverlayManager = ra::services::ServiceLocator::GetMutable<ra::ui::viewmodels::OverlayManager>();
+        pOverlayManager.AdvanceFrame();
+    }
 
-    TALLY_PERFORMANCE(PerformanceCheckpoint::MemoryBookmarksDoFrame);
     auto& pWindowManager = ra::services::ServiceLocator::GetMutable<ra::ui::viewmodels::WindowManager>();
-    pWindowManager.MemoryBookmarks.DoFrame();
+    {
+        ra::services::PerformanceTimer tBookmarks(PerformanceCheckpoint::MemoryBookmarksDoFrame);
+        pWindowManager.MemoryBookmarks.DoFrame();
+    }
 
-    TALLY_PERFORMANCE(PerformanceCheckpoint::MemoryInspectorDoFrame);
-    pWindowManager.MemoryInspector.DoFrame();
+    {
+        ra::services::PerformanceTimer tInspector(PerformanceCheckpoint::MemoryInspectorDoFrame);
+        pWindowManager.MemoryInspector.DoFrame();
+    }
 }
 
 #endif
 
 API void CCONV _RA_DoAchievementsFrame()
 {
-    // make sure we process the achievements _before_ the frozen bookmarks modify the memory
-    ProcessAchievements();
+    {
+        ra::services::TraceSpan span("DoAchievementsFrame");
+        ra::services::PerformanceTimer tFrame(PerformanceCheckpoint::Frame);
+
+        // make sure we process the achievements _before_ the frozen bookmarks modify the memory
+        ProcessAchievements();
 
 #ifndef RA_UTEST
-    UpdateUIForFrameChange();
+        UpdateUIForFrameChange();
 #endif
+    }
 
-    CHECK_PERFORMANCE();
+    if (ra::services::ServiceLocator::Exists<ra::services::PerformanceCounter>())
+        ra::services::ServiceLocator::GetMutable<ra::services::PerformanceCounter>().EndFrame();
 }
 
 API void CCONV _RA_OnSaveState(const char* sFilename)
@@ -13,6 +13,7 @@
 #include "data\EmulatorContext.hh"
 #include "data\GameContext.hh"
 #include "data\SessionTracker.hh"
+#include "data\SubmissionQueue.hh"
 #include "data\UserContext.hh"
 
 #include "services\AchievementRuntime.hh"
@@ -22,6 +23,7 @@
 #include "services\IThreadPool.hh"
 #include "services\Initialization.hh"
 #include "services\ServiceLocator.hh"
+#include "services\Tracer.hh"
 
 #include "ui\ImageReference.hh"
 #include "ui\viewmodels\BrokenAchievementsViewModel.hh"
@@ -121,7 +123,14 @@ API int CCONV _RA_Shutdown()
 
         ra::services::ServiceLocator::GetMutable<ra::data::SessionTracker>().EndSession();
 
+        // try to send any pending unlocks. anything that can't be sent will be sent on the next login
+        ra::services::ServiceLocator::GetMutable<ra::data::SubmissionQueue>().Flush(std::chrono::seconds(5));
+
         ra::services::ServiceLocator::GetMutable<ra::data::GameContext>().LoadGame(0U);
+
+        const auto& pTracer = ra::services::ServiceLocator::Get<ra::services::Tracer>();
+        if (pTracer.IsEnabled())
+            pTracer.Export();
     }
 
     if (g_AchievementsDialog.GetHWND() != nullptr)
@@ -292,6 +301,9 @@ API HMENU CCONV _RA_CreatePopupMenu()
 
         AppendMenu(hRA, MF_STRING, IDM_RA_REPORTBROKENACHIEVEMENTS, TEXT("&Report Achievement Problem"));
         AppendMenu(hRA, MF_STRING, IDM_RA_GETROMCHECKSUM, TEXT("Get ROM &Checksum"));
+
+        if (pConfiguration.IsFeatureEnabled(ra::services::Feature::Tracing))
+            AppendMenu(hRA, MF_STRING, IDM_RA_SAVETRACE, TEXT("Save Performance &Trace"));
         //AppendMenu(hRA, MF_STRING, IDM_RA_SCANFORGAMES, TEXT("Scan &for games"));
     }
     else
@@ -564,6 +576,15 @@ API void CCONV _RA_InvokeDialog(LPARAM nID)
         }
         break;
 
+        case IDM_RA_SAVETRACE:
+            if (ra::services::ServiceLocator::Exists<ra::services::Tracer>())
+            {
+                ra::services::ServiceLocator::Get<ra::services::Tracer>().Export();
+                ra::ui::viewmodels::MessageBoxViewModel::ShowMessage(
+                    L"Performance trace saved to the RACache directory.\nOpen it with chrome://tracing to view it.");
+            }
+            break;
+
         case IDM_RA_OVERLAYSETTINGS:
         {
             ra::ui::viewmodels::OverlaySettingsViewModel vmSettings;
@@ -46,7 +46,7 @@ bool LoadDocument(rapidjson::Document& doc, ra::services::TextReader& reader)
     return !doc.HasParseError();
 }
 
-bool SaveDocument(_In_ const rapidjson::Document& doc, ra::services::TextWriter& writer)
+bool SaveDocument(_In_ const rapidjson::Value& doc, ra::services::TextWriter& writer)
 {
     auto* pFileTextWriter = dynamic_cast<ra::services::impl::FileTextWriter*>(&writer);
     if (pFileTextWriter != nullptr)
@@ -9,6 +9,6 @@ void _WriteBufferToFile(const std::wstring& sFileName, const rapidjson::Document
 
 _Success_(return)
 _NODISCARD bool LoadDocument(_Out_ rapidjson::Document& doc, _In_ ra::services::TextReader& reader);
-bool SaveDocument(_In_ const rapidjson::Document& doc, ra::services::TextWriter& writer);
+bool SaveDocument(_In_ const rapidjson::Value& doc, ra::services::TextWriter& writer);
 
 #endif // !RA_JSON_H
@@ -162,6 +162,7 @@
 #define IDM_RA_PARSERICHPRESENCE        1716
 #define IDM_RA_TOGGLELEADERBOARDS       1717
 #define IDM_RA_NON_HARDCORE_WARNING     1718
+#define IDM_RA_SAVETRACE                1719
 #define IDM_RA_MENUEND                  1739
 
 // Next default values for new objects
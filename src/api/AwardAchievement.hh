@@ -22,6 +22,7 @@ public:
         unsigned int AchievementId{ 0U };
         bool Hardcore{ false };
         std::string GameHash;
+        std::chrono::milliseconds Timeout{ 0 }; // 0 uses the default timeouts
 
         using Callback = std::function<void(const Response& response)>;
 
@@ -34,6 +34,7 @@ public:
         unsigned int LeaderboardId{ 0U };
         unsigned int Score{ 0U };
         std::string GameHash;
+        std::chrono::milliseconds Timeout{ 0 }; // 0 uses the default timeouts
 
         using Callback = std::function<void(const Response& response)>;
 
@@ -36,9 +36,47 @@ _NODISCARD static bool HandleHttpError(_In_ const ra::services::Http::Response&
     return false;
 }
 
+/// <summary>
+/// A JSON document parsed in-situ from an API response.
+/// </summary>
+/// <remarks>
+/// Parsing in-situ avoids allocating a copy of every string in the response, which matters for the large responses
+/// (game lists, code notes, patch data). The strings in the document point into the response buffer, so the document
+/// takes ownership of the buffer.
+/// </remarks>
+class JsonResponseDocument : public rapidjson::Document
+{
+public:
+    void ParseResponse(std::string&& sContent)
+    {
+        m_sBuffer = std::move(sContent);
+        ParseInsitu(m_sBuffer.data());
+    }
+
+    const std::string& Buffer() const noexcept { return m_sBuffer; }
+
+private:
+    std::string m_sBuffer;
+};
+
+static constexpr size_t MAX_LOGGED_RESPONSE_LENGTH = 512;
+
+static void LogResponse([[maybe_unused]] _In_ const char* sApiName, [[maybe_unused]] _In_ const std::string& sContent)
+{
+    if (sContent.length() <= MAX_LOGGED_RESPONSE_LENGTH)
+    {
+        RA_LOG_INFO("-- %s Response: %s", sApiName, sContent);
+    }
+    else
+    {
+        RA_LOG_INFO("-- %s Response: %s... (%zu bytes)", sApiName,
+                    std::string(sContent, 0, MAX_LOGGED_RESPONSE_LENGTH), sContent.length());
+    }
+}
+
 _NODISCARD static bool GetJson([[maybe_unused]] _In_ const char* sApiName,
-                               _In_ const ra::services::Http::Response& httpResponse,
-                               _Inout_ ApiResponseBase& pResponse, _Out_ rapidjson::Document& pDocument)
+                               _Inout_ ra::services::Http::Response&& httpResponse,
+                               _Inout_ ApiResponseBase& pResponse, _Out_ JsonResponseDocument& pDocument)
 {
     if (httpResponse.Content().empty())
     {
@@ -54,9 +92,9 @@ _NODISCARD static bool GetJson([[maybe_unused]] _In_ const char* sApiName,
         return false;
     }
 
-    RA_LOG_INFO("-- %s Response: %s", sApiName, httpResponse.Content());
+    LogResponse(sApiName, httpResponse.Content());
 
-    pDocument.Parse(httpResponse.Content());
+    pDocument.ParseResponse(httpResponse.TakeContent());
     if (pDocument.HasParseError())
     {
         if (HandleHttpError(httpResponse, pResponse))
@@ -71,11 +109,12 @@ _NODISCARD static bool GetJson([[maybe_unused]] _In_ const char* sApiName,
 
         if (pDocument.GetParseError() == rapidjson::kParseErrorValueInvalid && pDocument.GetErrorOffset() == 0)
         {
-            // server did not return JSON, check for HTML
-            if (!ra::StringStartsWith(httpResponse.Content(), "<"))
+            // server did not return JSON, check for HTML. the parser stopped at the first character, so the buffer
+            // has not been modified.
+            if (!ra::StringStartsWith(pDocument.Buffer(), "<"))
             {
                 // not HTML, return first line of response as the error message
-                std::string sContent = httpResponse.Content();
+                std::string sContent = pDocument.Buffer();
                 const auto nIndex = sContent.find('\n');
                 if (nIndex != std::string::npos)
                 {
@@ -232,7 +271,8 @@ static void AppendUrlParam(_Inout_ std::string& sParams, _In_ const char* const
 }
 
 static bool DoRequest(const std::string& sHost, const char* restrict sApiName, const char* restrict sRequestName,
-    const std::string& sInputParams, ApiResponseBase& pResponse, rapidjson::Document& document)
+    const std::string& sInputParams, ApiResponseBase& pResponse, JsonResponseDocument& document,
+    std::chrono::milliseconds tTimeout = std::chrono::milliseconds(0))
 {
     std::string sPostData;
 
@@ -251,13 +291,13 @@ static bool DoRequest(const std::string& sHost, const char* restrict sApiName, c
 
     ra::services::Http::Request httpRequest(ra::StringPrintf("%s/dorequest.php", sHost));
     httpRequest.SetPostData(sPostData);
+    httpRequest.SetTimeout(tTimeout);
 
-    const auto httpResponse = httpRequest.Call();
-    return GetJson(sApiName, httpResponse, pResponse, document);
+    return GetJson(sApiName, httpRequest.Call(), pResponse, document);
 }
 
 static bool DoUpload(const std::string& sHost, const char* restrict sApiName, const char* restrict sRequestName,
-    const std::wstring& sFilePath, ApiResponseBase& pResponse, rapidjson::Document& document)
+    const std::wstring& sFilePath, ApiResponseBase& pResponse, JsonResponseDocument& document)
 {
     const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
     const auto nFileSize = pFileSystem.GetFileSize(sFilePath);
@@ -328,8 +368,7 @@ static bool DoUpload(const std::string& sHost, const char* restrict sApiName, co
 
     httpRequest.SetPostData(sPostData);
 
-    const auto httpResponse = httpRequest.Call();
-    return GetJson(sApiName, httpResponse, pResponse, document);
+    return GetJson(sApiName, httpRequest.Call(), pResponse, document);
 }
 
 // === APIs ===
@@ -353,11 +392,9 @@ Login::Response ConnectedServer::Login(const Login::Request& request)
     }
     httpRequest.SetPostData(sPostData);
 
-    ra::services::Http::Response httpResponse = httpRequest.Call();
-
     Login::Response response;
-    rapidjson::Document document;
-    if (GetJson(Login::Name(), httpResponse, response, document))
+    JsonResponseDocument document;
+    if (GetJson(Login::Name(), httpRequest.Call(), response, document))
     {
         response.Result = ApiResult::Success;
         GetRequiredJsonField(response.Username, document, "User", response);
@@ -382,7 +419,7 @@ Logout::Response ConnectedServer::Logout(const Logout::Request&)
 StartSession::Response ConnectedServer::StartSession(const StartSession::Request& request)
 {
     StartSession::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     // activity type enum (only 3 is used )
@@ -404,7 +441,7 @@ StartSession::Response ConnectedServer::StartSession(const StartSession::Request
 Ping::Response ConnectedServer::Ping(const Ping::Request& request)
 {
     Ping::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "g", std::to_string(request.GameId));
@@ -420,7 +457,7 @@ Ping::Response ConnectedServer::Ping(const Ping::Request& request)
 FetchUserUnlocks::Response ConnectedServer::FetchUserUnlocks(const FetchUserUnlocks::Request& request)
 {
     FetchUserUnlocks::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "g", std::to_string(request.GameId));
@@ -449,7 +486,7 @@ FetchUserUnlocks::Response ConnectedServer::FetchUserUnlocks(const FetchUserUnlo
 AwardAchievement::Response ConnectedServer::AwardAchievement(const AwardAchievement::Request& request)
 {
     AwardAchievement::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "a", std::to_string(request.AchievementId));
@@ -457,7 +494,7 @@ AwardAchievement::Response ConnectedServer::AwardAchievement(const AwardAchievem
     if (!request.GameHash.empty())
         AppendUrlParam(sPostData, "m", request.GameHash);
 
-    if (DoRequest(m_sHost, AwardAchievement::Name(), "awardachievement", sPostData, response, document))
+    if (DoRequest(m_sHost, AwardAchievement::Name(), "awardachievement", sPostData, response, document, request.Timeout))
     {
         response.Result = ApiResult::Success;
         GetRequiredJsonField(response.NewPlayerScore, document, "Score", response);
@@ -469,7 +506,7 @@ AwardAchievement::Response ConnectedServer::AwardAchievement(const AwardAchievem
 SubmitLeaderboardEntry::Response ConnectedServer::SubmitLeaderboardEntry(const SubmitLeaderboardEntry::Request& request)
 {
     SubmitLeaderboardEntry::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "i", std::to_string(request.LeaderboardId));
@@ -482,7 +519,7 @@ SubmitLeaderboardEntry::Response ConnectedServer::SubmitLeaderboardEntry(const S
     if (!request.GameHash.empty())
         AppendUrlParam(sPostData, "m", request.GameHash);
 
-    if (DoRequest(m_sHost, SubmitLeaderboardEntry::Name(), "submitlbentry", sPostData, response, document))
+    if (DoRequest(m_sHost, SubmitLeaderboardEntry::Name(), "submitlbentry", sPostData, response, document, request.Timeout))
     {
         response.Result = ApiResult::Success;
 
@@ -533,7 +570,7 @@ SubmitLeaderboardEntry::Response ConnectedServer::SubmitLeaderboardEntry(const S
 FetchUserFriends::Response ConnectedServer::FetchUserFriends(const FetchUserFriends::Request&)
 {
     FetchUserFriends::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     if (DoRequest(m_sHost, FetchUserFriends::Name(), "getfriendlist", sPostData, response, document))
@@ -573,7 +610,7 @@ FetchUserFriends::Response ConnectedServer::FetchUserFriends(const FetchUserFrie
 ResolveHash::Response ConnectedServer::ResolveHash(const ResolveHash::Request& request)
 {
     ResolveHash::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "m", request.Hash);
@@ -590,7 +627,7 @@ ResolveHash::Response ConnectedServer::ResolveHash(const ResolveHash::Request& r
 FetchGameData::Response ConnectedServer::FetchGameData(const FetchGameData::Request& request)
 {
     FetchGameData::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "g", std::to_string(request.GameId));
@@ -612,11 +649,7 @@ FetchGameData::Response ConnectedServer::FetchGameData(const FetchGameData::Requ
             auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
             auto pData = pLocalStorage.WriteText(ra::services::StorageItemType::GameData, std::to_wstring(request.GameId));
             if (pData != nullptr)
-            {
-                rapidjson::Document patchData;
-                patchData.CopyFrom(PatchData, document.GetAllocator());
-                SaveDocument(patchData, *pData.get());
-            }
+                SaveDocument(PatchData, *pData.get());
 
             // process it
             ProcessGamePatchData(response, PatchData);
@@ -681,7 +714,7 @@ void ConnectedServer::ProcessGamePatchData(ra::api::FetchGameData::Response &res
 FetchCodeNotes::Response ConnectedServer::FetchCodeNotes(const FetchCodeNotes::Request& request)
 {
     FetchCodeNotes::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "g", std::to_string(request.GameId));
@@ -703,11 +736,7 @@ FetchCodeNotes::Response ConnectedServer::FetchCodeNotes(const FetchCodeNotes::R
             auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
             auto pData = pLocalStorage.WriteText(ra::services::StorageItemType::CodeNotes, std::to_wstring(request.GameId));
             if (pData != nullptr)
-            {
-                rapidjson::Document codeNotes;
-                codeNotes.CopyFrom(CodeNotes, document.GetAllocator());
-                SaveDocument(codeNotes, *pData.get());
-            }
+                SaveDocument(CodeNotes, *pData.get());
 
             // process it
             ProcessCodeNotes(response, CodeNotes);
@@ -739,7 +768,7 @@ void ConnectedServer::ProcessCodeNotes(ra::api::FetchCodeNotes::Response &respon
 UpdateCodeNote::Response ConnectedServer::UpdateCodeNote(const UpdateCodeNote::Request& request)
 {
     UpdateCodeNote::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "g", std::to_string(request.GameId));
@@ -757,7 +786,7 @@ UpdateCodeNote::Response ConnectedServer::UpdateCodeNote(const UpdateCodeNote::R
 DeleteCodeNote::Response ConnectedServer::DeleteCodeNote(const DeleteCodeNote::Request& request)
 {
     DeleteCodeNote::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "g", std::to_string(request.GameId));
@@ -774,7 +803,7 @@ DeleteCodeNote::Response ConnectedServer::DeleteCodeNote(const DeleteCodeNote::R
 UpdateAchievement::Response ConnectedServer::UpdateAchievement(const UpdateAchievement::Request& request)
 {
     UpdateAchievement::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "a", std::to_string(request.AchievementId));
@@ -804,7 +833,7 @@ UpdateAchievement::Response ConnectedServer::UpdateAchievement(const UpdateAchie
 FetchAchievementInfo::Response ConnectedServer::FetchAchievementInfo(const FetchAchievementInfo::Request& request)
 {
     FetchAchievementInfo::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "a", std::to_string(request.AchievementId));
@@ -865,7 +894,7 @@ FetchAchievementInfo::Response ConnectedServer::FetchAchievementInfo(const Fetch
 FetchLeaderboardInfo::Response ConnectedServer::FetchLeaderboardInfo(const FetchLeaderboardInfo::Request& request)
 {
     FetchLeaderboardInfo::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "i", std::to_string(request.LeaderboardId));
@@ -926,7 +955,7 @@ FetchLeaderboardInfo::Response ConnectedServer::FetchLeaderboardInfo(const Fetch
 LatestClient::Response ConnectedServer::LatestClient(const LatestClient::Request& request)
 {
     LatestClient::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     // LatestClient doesn't require User/Password, so the next few lines are a subset of DoRequest
@@ -937,8 +966,7 @@ LatestClient::Response ConnectedServer::LatestClient(const LatestClient::Request
     ra::services::Http::Request httpRequest(ra::StringPrintf("%s/dorequest.php", m_sHost));
     httpRequest.SetPostData(sPostData);
 
-    const auto httpResponse = httpRequest.Call();
-    if (GetJson(LatestClient::Name(), httpResponse, response, document))
+    if (GetJson(LatestClient::Name(), httpRequest.Call(), response, document))
     {
         response.Result = ApiResult::Success;
         GetRequiredJsonField(response.LatestVersion, document, "LatestVersion", response);
@@ -953,7 +981,7 @@ LatestClient::Response ConnectedServer::LatestClient(const LatestClient::Request
 FetchGamesList::Response ConnectedServer::FetchGamesList(const FetchGamesList::Request& request)
 {
     FetchGamesList::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "c", std::to_string(request.ConsoleId));
@@ -1013,7 +1041,7 @@ FetchGamesList::Response ConnectedServer::FetchGamesList(const FetchGamesList::R
 SubmitNewTitle::Response ConnectedServer::SubmitNewTitle(const SubmitNewTitle::Request& request)
 {
     SubmitNewTitle::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     AppendUrlParam(sPostData, "c", std::to_string(request.ConsoleId));
@@ -1047,7 +1075,7 @@ SubmitNewTitle::Response ConnectedServer::SubmitNewTitle(const SubmitNewTitle::R
 SubmitTicket::Response ConnectedServer::SubmitTicket(const SubmitTicket::Request& request)
 {
     SubmitTicket::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     std::string sAchievementIds;
@@ -1084,7 +1112,7 @@ SubmitTicket::Response ConnectedServer::SubmitTicket(const SubmitTicket::Request
 FetchBadgeIds::Response ConnectedServer::FetchBadgeIds(const FetchBadgeIds::Request&)
 {
     FetchBadgeIds::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     if (DoRequest(m_sHost, FetchBadgeIds::Name(), "badgeiter", sPostData, response, document))
@@ -1099,7 +1127,7 @@ FetchBadgeIds::Response ConnectedServer::FetchBadgeIds(const FetchBadgeIds::Requ
 UploadBadge::Response ConnectedServer::UploadBadge(const UploadBadge::Request& request)
 {
     UploadBadge::Response response;
-    rapidjson::Document document;
+    JsonResponseDocument document;
     std::string sPostData;
 
     if (DoUpload(m_sHost, UploadBadge::Name(), "uploadbadgeimage", request.ImageFilePath, response, document))
@@ -18,6 +18,7 @@
 
 #include "data\EmulatorContext.hh"
 #include "data\SessionTracker.hh"
+#include "data\SubmissionQueue.hh"
 #include "data\UserContext.hh"
 
 #include "services\AchievementRuntime.hh"
@@ -50,8 +51,22 @@ static void CopyAchievementData(Achievement& pAchievement,
     pAchievement.SetTrigger(pAchievementData.Definition);
 }
 
+ra::services::CancellationToken GameContext::GameCancellationToken() const
+{
+    std::lock_guard<std::mutex> lock(m_mtxGameCancellation);
+    return m_pGameCancellation.Token();
+}
+
 void GameContext::LoadGame(unsigned int nGameId, Mode nMode)
 {
+    // abandon any outstanding work for the previous game
+    ra::services::CancellationTokenSource pPreviousGameCancellation;
+    {
+        std::lock_guard<std::mutex> lock(m_mtxGameCancellation);
+        std::swap(pPreviousGameCancellation, m_pGameCancellation);
+    }
+    pPreviousGameCancellation.Cancel();
+
     auto& pRuntime = ra::services::ServiceLocator::GetMutable<ra::services::AchievementRuntime>();
     pRuntime.ResetRuntime();
 
@@ -759,7 +774,9 @@ void GameContext::AwardAchievement(ra::AchievementID nAchievementId) const
     request.AchievementId = nAchievementId;
     request.Hardcore = _RA_HardcoreModeIsActive();
     request.GameHash = GameHash();
-    request.CallAsyncWithRetry([nPopupId, nAchievementId](const ra::api::AwardAchievement::Response& response)
+
+    auto& pSubmissionQueue = ra::services::ServiceLocator::GetMutable<ra::data::SubmissionQueue>();
+    pSubmissionQueue.QueueAwardAchievement(request, [nPopupId, nAchievementId](const ra::api::AwardAchievement::Response& response)
     {
         if (response.Succeeded())
         {
@@ -831,8 +848,8 @@ void GameContext::AwardAchievement(ra::AchievementID nAchievementId) const
         {
             // delay mastery notification by 500ms to avoid race conditions where the get unlocks API returns
             // before the last achievement was unlocked for the user.
-            ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>()
-                .ScheduleAsync(std::chrono::milliseconds(500), [this]() { AwardMastery(); });
+            ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().ScheduleTaskAsync(
+                std::chrono::milliseconds(500), [this]() { AwardMastery(); }, GameCancellationToken());
         }
     }
 }
@@ -979,7 +996,9 @@ void GameContext::SubmitLeaderboardEntry(ra::LeaderboardID nLeaderboardId, unsig
     request.LeaderboardId = pLeaderboard->ID();
     request.Score = nScore;
     request.GameHash = GameHash();
-    request.CallAsyncWithRetry([this, nLeaderboardId = pLeaderboard->ID()](const ra::api::SubmitLeaderboardEntry::Response& response)
+
+    auto& pSubmissionQueue = ra::services::ServiceLocator::GetMutable<ra::data::SubmissionQueue>();
+    pSubmissionQueue.QueueSubmitLeaderboardEntry(request, [this, nLeaderboardId = pLeaderboard->ID()](const ra::api::SubmitLeaderboardEntry::Response& response)
     {
         const auto* pLeaderboard = FindLeaderboard(nLeaderboardId);
 
@@ -5,6 +5,8 @@
 #include "RA_Achievement.h"
 #include "RA_Leaderboard.h"
 
+#include "services\TaskHandle.hh"
+
 #include <string>
 #include <atomic>
 
@@ -37,6 +39,15 @@ public:
     /// </summary>
     bool IsGameLoading() const noexcept { return m_nLoadCount != 0; }
 
+    /// <summary>
+    /// Gets a token that is cancelled when a different game is loaded.
+    /// </summary>
+    /// <remarks>
+    /// Pass this to <see cref="IThreadPool::RunTaskAsync" /> or <see cref="IThreadPool::ScheduleTaskAsync" /> for
+    /// work that only applies to the current game.
+    /// </remarks>
+    ra::services::CancellationToken GameCancellationToken() const;
+
     /// <summary>
     /// Gets the unique identifier of the currently loaded game.
     /// </summary>
@@ -236,6 +247,16 @@ public:
         return &pIter->second.Note;
     }
 
+    /// <summary>
+    /// Returns the number of bytes described by the note associated with the specified address.
+    /// </summary>
+    /// <returns>The number of bytes described by the note, <c>0</c> if no note is associated to the address.</returns>
+    unsigned int FindCodeNoteSize(ra::ByteAddress nAddress) const
+    {
+        const auto pIter = m_mCodeNotes.find(nAddress);
+        return (pIter != m_mCodeNotes.end()) ? pIter->second.Bytes : 0U;
+    }
+
     /// <summary>
     /// Enumerates the code notes
     /// </summary>
@@ -345,6 +366,9 @@ protected:
     };
     std::map<ra::ByteAddress, CodeNote> m_mCodeNotes;
 
+    ra::services::CancellationTokenSource m_pGameCancellation;
+    mutable std::mutex m_mtxGameCancellation; // LoadGame replaces the source while worker threads ask for tokens
+
 private:
     /// <summary>
     /// A collection of pointers to other objects. These are not allocated object and do not need to be free'd. It's
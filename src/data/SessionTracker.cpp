@@ -22,6 +22,17 @@ namespace ra {
 namespace data {
 
 constexpr int SERVER_PING_FREQUENCY = 2 * 60; // seconds between server pings
+constexpr size_t COMPACT_SESSION_THRESHOLD = 100; // number of entries beyond one per game before the file is compacted
+
+// line format: <gameid>:<sessionstart>:<sessionlength>:<checksum>
+static std::string FormatSessionLine(unsigned int nGameId, time_t tSessionStart, long long nSessionDuration)
+{
+    auto sLine = ra::StringPrintf("%u:%ll:%ll:", nGameId, tSessionStart, nSessionDuration);
+    const auto sMD5 = RAGenerateMD5(sLine);
+    sLine.push_back(sMD5.front());
+    sLine.push_back(sMD5.back());
+    return sLine;
+}
 
 void SessionTracker::Initialize(const std::string& sUsername)
 {
@@ -34,16 +45,18 @@ void SessionTracker::Initialize(const std::string& sUsername)
 void SessionTracker::LoadSessions()
 {
     m_vGameStats.clear();
+    m_mGameStatsIndex.clear();
 
     auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
     auto pStatsFile = pLocalStorage.ReadText(ra::services::StorageItemType::SessionStats, m_sUsername);
 
     if (pStatsFile != nullptr)
     {
-        // line format: <gameid>:<sessionstart>:<sessionlength>:<checksum>
+        size_t nLines = 0;
         std::string sLine;
         while (pStatsFile->GetLine(sLine))
         {
+            ++nLines;
             ra::Tokenizer pTokenizer(sLine);
 
             const auto nGameId = pTokenizer.ReadNumber();
@@ -67,24 +80,58 @@ void SessionTracker::LoadSessions()
         }
 
         m_nFileWritePosition = pStatsFile->GetPosition();
+        pStatsFile.reset();
+
+        // the file gets a new entry for every session. once there are many more entries than games,
+        // replace them with a single entry per game so future loads only have to process one line per game.
+        if (nLines > m_vGameStats.size() + COMPACT_SESSION_THRESHOLD)
+            CompactSessions();
     }
 }
 
-void SessionTracker::AddSession(unsigned int nGameId, time_t tSessionStart, std::chrono::seconds tSessionDuration)
+void SessionTracker::CompactSessions()
 {
-    auto pIter = m_vGameStats.begin();
-    while (pIter != m_vGameStats.end() && pIter->GameId != nGameId)
-        ++pIter;
+    // an aggregate entry is just a session whose length is the total playtime, so it uses the same format
+    // and remains readable by older versions.
+    std::string sContents;
+    for (const auto& pGameStats : m_vGameStats)
+    {
+        sContents.append(FormatSessionLine(pGameStats.GameId,
+                                           std::chrono::system_clock::to_time_t(pGameStats.LastSessionStart),
+                                           pGameStats.TotalPlayTime.count()));
+        sContents.push_back('\n');
+    }
 
-    if (pIter == m_vGameStats.end())
+    // if the new file can't be completely written, the uncompacted history is kept
+    auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+    if (!pLocalStorage.ReplaceText(ra::services::StorageItemType::SessionStats, m_sUsername, sContents))
+    {
+        RA_LOG_WARN("Could not compact session history");
+        return;
+    }
+
+    m_nFileWritePosition = gsl::narrow_cast<std::streamoff>(sContents.length());
+
+    RA_LOG_INFO("Compacted session history to %zu games", m_vGameStats.size());
+}
+
+void SessionTracker::AddSession(unsigned int nGameId, time_t tSessionStart, std::chrono::seconds tSessionDuration)
+{
+    GameStats* pGameStats;
+    const auto pIter = m_mGameStatsIndex.find(nGameId);
+    if (pIter == m_mGameStatsIndex.end())
+    {
+        m_mGameStatsIndex.emplace(nGameId, m_vGameStats.size());
+        pGameStats = &m_vGameStats.emplace_back();
+        pGameStats->GameId = nGameId;
+    }
+    else
     {
-        m_vGameStats.emplace_back();
-        pIter = m_vGameStats.end() - 1;
-        pIter->GameId = nGameId;
+        pGameStats = &m_vGameStats.at(pIter->second);
     }
 
-    pIter->LastSessionStart = std::chrono::system_clock::from_time_t(tSessionStart);
-    pIter->TotalPlayTime += tSessionDuration;
+    pGameStats->LastSessionStart = std::chrono::system_clock::from_time_t(tSessionStart);
+    pGameStats->TotalPlayTime += tSessionDuration;
 }
 
 void SessionTracker::SortSessions()
@@ -94,6 +141,9 @@ void SessionTracker::SortSessions()
     {
         return (right.LastSessionStart < left.LastSessionStart);
     });
+
+    for (size_t nIndex = 0; nIndex < m_vGameStats.size(); ++nIndex)
+        m_mGameStatsIndex.insert_or_assign(m_vGameStats.at(nIndex).GameId, nIndex);
 }
 
 void SessionTracker::BeginSession(unsigned int nGameId)
@@ -109,8 +159,9 @@ void SessionTracker::BeginSession(unsigned int nGameId)
     m_tpSessionStart = pClock.UpTime();
     m_tSessionStart = std::chrono::system_clock::to_time_t(pClock.Now());
 
-    auto& pThreadPool = ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>();
-    pThreadPool.ScheduleAsync(std::chrono::seconds(30), [this, tSessionStart = m_tSessionStart]() { UpdateSession(tSessionStart); });
+    // EndSession isn't called if the previous session wasn't for a game, make sure its ping is unscheduled
+    ResetPing(m_tSessionStart);
+    SchedulePing(std::chrono::seconds(30), m_tSessionStart);
 
     if (nGameId != 0)
     {
@@ -127,6 +178,8 @@ void SessionTracker::BeginSession(unsigned int nGameId)
 
 void SessionTracker::EndSession()
 {
+    ResetPing(0);
+
     if (m_nCurrentGameId != 0)
     {
         // update session duration
@@ -147,7 +200,7 @@ void SessionTracker::EndSession()
 
 void SessionTracker::UpdateSession(time_t tSessionStart)
 {
-    // make sure we're still tracking the same game
+    // make sure we're still tracking the same game (the session may have ended while the ping was starting)
     if (tSessionStart != m_tSessionStart)
         return;
 
@@ -166,8 +219,28 @@ void SessionTracker::UpdateSession(time_t tSessionStart)
         WriteSessionStats(tSessionDuration);
 
     // schedule next ping
+    SchedulePing(std::chrono::seconds(SERVER_PING_FREQUENCY), tSessionStart);
+}
+
+void SessionTracker::ResetPing(time_t tSessionStart)
+{
+    std::lock_guard<std::mutex> lock(m_mtxPing);
+    m_hPingTask.Cancel();
+    m_tPingSessionStart = tSessionStart;
+}
+
+void SessionTracker::SchedulePing(std::chrono::seconds tDelay, time_t tSessionStart)
+{
     auto& pThreadPool = ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>();
-    pThreadPool.ScheduleAsync(std::chrono::seconds(SERVER_PING_FREQUENCY), [this, tSessionStart]() { UpdateSession(tSessionStart); });
+
+    std::lock_guard<std::mutex> lock(m_mtxPing);
+
+    // the session may have ended while the previous ping was running
+    if (tSessionStart != m_tPingSessionStart)
+        return;
+
+    m_hPingTask = pThreadPool.ScheduleTaskAsync(tDelay, [this, tSessionStart]() { UpdateSession(tSessionStart); },
+                                                {}, ra::services::TaskPriority::Background);
 }
 
 std::streampos SessionTracker::WriteSessionStats(std::chrono::seconds tSessionDuration) const
@@ -175,11 +248,7 @@ std::streampos SessionTracker::WriteSessionStats(std::chrono::seconds tSessionDu
     auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
     auto pStatsFile = pLocalStorage.AppendText(ra::services::StorageItemType::SessionStats, m_sUsername);
 
-    auto nSessionDuration = tSessionDuration.count();
-    auto sLine = ra::StringPrintf("%u:%ll:%ll:", m_nCurrentGameId, m_tSessionStart, nSessionDuration);
-    const auto sMD5 = RAGenerateMD5(sLine);
-    sLine.push_back(sMD5.front());
-    sLine.push_back(sMD5.back());
+    const auto sLine = FormatSessionLine(m_nCurrentGameId, m_tSessionStart, tSessionDuration.count());
 
     pStatsFile->SetPosition(m_nFileWritePosition);
     pStatsFile->WriteLine(sLine);
@@ -201,14 +270,9 @@ std::chrono::seconds SessionTracker::GetTotalPlaytime(unsigned int nGameId) cons
     }
 
     // add any prior session durations
-    for (const auto& pGameStats : m_vGameStats)
-    {
-        if (pGameStats.GameId == nGameId)
-        {
-            tPlaytime += pGameStats.TotalPlayTime;
-            break;
-        }
-    }
+    const auto pIter = m_mGameStatsIndex.find(nGameId);
+    if (pIter != m_mGameStatsIndex.end())
+        tPlaytime += m_vGameStats.at(pIter->second).TotalPlayTime;
 
     return tPlaytime;
 }
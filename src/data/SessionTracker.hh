@@ -2,7 +2,10 @@
 #define RA_DATA_SESSIONTRACKER_HH
 #pragma once
 
+#include "services\TaskHandle.hh"
+
 #include <string>
+#include <unordered_map>
 
 namespace ra {
 namespace data {
@@ -69,11 +72,18 @@ protected:
 
 private:
     void SortSessions();
+    void CompactSessions();
+    void ResetPing(time_t tSessionStart);
+    void SchedulePing(std::chrono::seconds tDelay, time_t tSessionStart);
 
     std::chrono::steady_clock::time_point m_tpSessionStart{};
     time_t m_tSessionStart{};
+    ra::services::TaskHandle m_hPingTask;
+    time_t m_tPingSessionStart{};
+    std::mutex m_mtxPing; // UpdateSession reschedules the ping from a worker thread
 
     std::vector<GameStats> m_vGameStats;
+    std::unordered_map<unsigned int, size_t> m_mGameStatsIndex; // GameId -> index in m_vGameStats
 
     std::streamoff m_nFileWritePosition{};
 };
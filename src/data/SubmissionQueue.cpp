@@ -0,0 +1,475 @@
+#include "SubmissionQueue.hh"
+
+#include "RA_Log.h"
+#include "RA_StringUtils.h"
+
+#include "services\IClock.hh"
+#include "services\ILocalStorage.hh"
+#include "services\IThreadPool.hh"
+#include "services\ServiceLocator.hh"
+
+#include <random>
+
+namespace ra {
+namespace data {
+
+static constexpr std::chrono::milliseconds MIN_RETRY_DELAY{ 500 };
+static constexpr std::chrono::milliseconds MAX_RETRY_DELAY{ 2 * 60 * 1000 };
+
+void SubmissionQueue::Initialize(const std::string& sUsername)
+{
+    bool bSave = false;
+    bool bStart = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+
+        const auto sNewUsername = ra::Widen(sUsername);
+        if (!m_sUsername.empty() && m_sUsername != sNewUsername)
+        {
+            // items for the previous user are still persisted under their name and will be sent the next time
+            // they log in. they cannot be sent with the new user's credentials. an item that's already being
+            // sent can't be removed, but it keeps its owner so it won't be retried or persisted for the new user.
+            auto pIter = m_vQueue.begin();
+            while (pIter != m_vQueue.end())
+            {
+                if (pIter->bInFlight)
+                    ++pIter;
+                else
+                    pIter = m_vQueue.erase(pIter);
+            }
+        }
+
+        m_sUsername = sNewUsername;
+
+        // items queued before the user was known belong to the user and haven't been persisted yet
+        bool bHasUnsavedItems = false;
+        for (auto& pItem : m_vQueue)
+        {
+            if (pItem.sUsername.empty())
+            {
+                pItem.sUsername = m_sUsername;
+                bHasUnsavedItems = true;
+            }
+        }
+
+        LoadQueue();
+
+        if (bHasUnsavedItems)
+            bSave = MarkModified();
+
+        bStart = !m_vQueue.empty() && !m_bRetryScheduled;
+    }
+
+    StartTask(bSave, bStart);
+}
+
+void SubmissionQueue::LoadQueue()
+{
+    auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+    auto pFile = pLocalStorage.ReadText(ra::services::StorageItemType::PendingSubmissions, m_sUsername);
+    if (pFile == nullptr)
+        return;
+
+    const auto tNow = ra::services::ServiceLocator::Get<ra::services::IClock>().UpTime();
+
+    // line format: A:<achievementid>:<hardcore>:<hash> or L:<leaderboardid>:<score>:<hash>
+    std::string sLine;
+    while (pFile->GetLine(sLine))
+    {
+        ra::Tokenizer pTokenizer(sLine);
+
+        Item pItem;
+        switch (pTokenizer.PeekChar())
+        {
+            case 'A':
+                pItem.nType = ItemType::AwardAchievement;
+                break;
+            case 'L':
+                pItem.nType = ItemType::SubmitLeaderboardEntry;
+                break;
+            default:
+                continue;
+        }
+
+        pTokenizer.Advance();
+        if (!pTokenizer.Consume(':'))
+            continue;
+
+        pItem.nId = pTokenizer.ReadNumber();
+        if (pItem.nId == 0 || !pTokenizer.Consume(':'))
+            continue;
+
+        pItem.nValue = pTokenizer.ReadNumber();
+        if (!pTokenizer.Consume(':'))
+            continue;
+
+        pItem.sGameHash = pTokenizer.ReadTo('\n');
+        pItem.sUsername = m_sUsername;
+        pItem.tQueued = tNow;
+
+        const auto pExisting = std::find_if(m_vQueue.begin(), m_vQueue.end(), [&pItem](const Item& pQueued)
+        {
+            return pQueued.nType == pItem.nType && pQueued.nId == pItem.nId && pQueued.nValue == pItem.nValue &&
+                pQueued.sUsername == pItem.sUsername;
+        });
+
+        if (pExisting == m_vQueue.end())
+            m_vQueue.emplace_back(std::move(pItem));
+    }
+}
+
+// must be called while holding m_mtxQueue. returns true if the caller needs to start a task to save the queue.
+bool SubmissionQueue::MarkModified() noexcept
+{
+    m_bSaveNeeded = true;
+    if (m_bSaveScheduled)
+        return false;
+
+    m_bSaveScheduled = true;
+    return true;
+}
+
+void SubmissionQueue::StartTask(bool bSave, bool bProcess)
+{
+    if (!bSave && !bProcess)
+        return;
+
+    // save before processing so the item is persisted before the server sees it
+    ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().RunAsync([this, bSave, bProcess]()
+    {
+        if (bSave)
+            SaveQueue();
+        if (bProcess)
+            ProcessQueue();
+    }, ra::services::TaskPriority::Critical);
+}
+
+void SubmissionQueue::SaveQueue()
+{
+    // the snapshot is taken after acquiring the write lock, so the last write always has the newest data
+    std::lock_guard<std::mutex> lockSave(m_mtxSave);
+
+    std::wstring sUsername;
+    std::vector<std::string> vLines;
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        m_bSaveScheduled = false;
+        if (!m_bSaveNeeded)
+            return;
+
+        m_bSaveNeeded = false;
+        sUsername = m_sUsername;
+
+        vLines.reserve(m_vQueue.size());
+        for (const auto& pItem : m_vQueue)
+        {
+            // an item still being sent for a previous user is persisted in that user's file
+            if (pItem.sUsername != sUsername)
+                continue;
+
+            const char* sType = (pItem.nType == ItemType::AwardAchievement) ? "A" : "L";
+            vLines.emplace_back(ra::StringPrintf("%s:%u:%u:%s", sType, pItem.nId, pItem.nValue, pItem.sGameHash));
+        }
+    }
+
+    if (sUsername.empty())
+        return;
+
+    auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+    auto pFile = pLocalStorage.WriteText(ra::services::StorageItemType::PendingSubmissions, sUsername);
+    if (pFile == nullptr)
+    {
+        RA_LOG_WARN("Could not persist %zu pending submissions", vLines.size());
+        return;
+    }
+
+    for (const auto& sLine : vLines)
+        pFile->WriteLine(sLine);
+}
+
+void SubmissionQueue::QueueAwardAchievement(const ra::api::AwardAchievement::Request& pRequest,
+                                            ra::api::AwardAchievement::Request::Callback&& fCallback)
+{
+    Item pItem;
+    pItem.nType = ItemType::AwardAchievement;
+    pItem.nId = pRequest.AchievementId;
+    pItem.nValue = pRequest.Hardcore ? 1 : 0;
+    pItem.sGameHash = pRequest.GameHash;
+    if (fCallback)
+        pItem.vAwardCallbacks.emplace_back(std::move(fCallback));
+
+    Enqueue(std::move(pItem));
+}
+
+void SubmissionQueue::QueueSubmitLeaderboardEntry(const ra::api::SubmitLeaderboardEntry::Request& pRequest,
+                                                  ra::api::SubmitLeaderboardEntry::Request::Callback&& fCallback)
+{
+    Item pItem;
+    pItem.nType = ItemType::SubmitLeaderboardEntry;
+    pItem.nId = pRequest.LeaderboardId;
+    pItem.nValue = pRequest.Score;
+    pItem.sGameHash = pRequest.GameHash;
+    if (fCallback)
+        pItem.vSubmitCallbacks.emplace_back(std::move(fCallback));
+
+    Enqueue(std::move(pItem));
+}
+
+void SubmissionQueue::Enqueue(Item&& pItem)
+{
+    pItem.tQueued = ra::services::ServiceLocator::Get<ra::services::IClock>().UpTime();
+
+    bool bSave = false;
+    bool bStart = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        ++m_pStatistics.Queued;
+        pItem.sUsername = m_sUsername;
+
+        // the server doesn't support submitting multiple items in a single request, but an item that's already
+        // waiting to be sent doesn't need to be sent again. an achievement unlocked in hardcore supersedes the
+        // same achievement unlocked in softcore, and the same leaderboard entry only needs to be sent once.
+        auto pExisting = std::find_if(m_vQueue.begin(), m_vQueue.end(), [&pItem](const Item& pQueued)
+        {
+            if (pQueued.bInFlight || pQueued.nType != pItem.nType || pQueued.nId != pItem.nId ||
+                pQueued.sUsername != pItem.sUsername)
+            {
+                return false;
+            }
+
+            return (pItem.nType == ItemType::AwardAchievement || pQueued.nValue == pItem.nValue);
+        });
+
+        if (pExisting != m_vQueue.end())
+        {
+            ++m_pStatistics.Coalesced;
+
+            pExisting->nValue |= pItem.nValue;
+            pExisting->sGameHash = pItem.sGameHash;
+            for (auto& fCallback : pItem.vAwardCallbacks)
+                pExisting->vAwardCallbacks.emplace_back(std::move(fCallback));
+            for (auto& fCallback : pItem.vSubmitCallbacks)
+                pExisting->vSubmitCallbacks.emplace_back(std::move(fCallback));
+        }
+        else
+        {
+            m_vQueue.emplace_back(std::move(pItem));
+        }
+
+        // this is called from the emulator thread. don't write the file here
+        bSave = MarkModified();
+
+        // if waiting to retry, the new item will be sent when the retry occurs
+        bStart = !m_bRetryScheduled;
+    }
+
+    StartTask(bSave, bStart);
+}
+
+void SubmissionQueue::ProcessQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        if (m_bProcessing || m_bRetryScheduled)
+            return;
+
+        m_bProcessing = true;
+    }
+
+    ra::api::ApiResult nResult = ra::api::ApiResult::None;
+    do
+    {
+        nResult = SendNextItem(std::chrono::milliseconds(0));
+    } while (nResult != ra::api::ApiResult::None && nResult != ra::api::ApiResult::Incomplete);
+
+    std::chrono::milliseconds tRetryDelay{};
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        m_bProcessing = false;
+
+        if (nResult == ra::api::ApiResult::Incomplete &&
+            !ra::services::ServiceLocator::Get<ra::services::IThreadPool>().IsShutdownRequested())
+        {
+            if (m_tRetryDelay < MIN_RETRY_DELAY)
+                m_tRetryDelay = MIN_RETRY_DELAY;
+            else
+                m_tRetryDelay = std::min(m_tRetryDelay + m_tRetryDelay, MAX_RETRY_DELAY);
+
+            m_bRetryScheduled = true;
+            tRetryDelay = ApplyJitter(m_tRetryDelay);
+        }
+    }
+
+    m_cvProcessing.notify_all();
+
+    if (tRetryDelay.count() > 0)
+    {
+        ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().ScheduleAsync(tRetryDelay, [this]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mtxQueue);
+                m_bRetryScheduled = false;
+            }
+
+            ProcessQueue();
+        }, ra::services::TaskPriority::Critical);
+    }
+}
+
+ra::api::ApiResult SubmissionQueue::SendNextItem(std::chrono::milliseconds tTimeout)
+{
+    Item pRequestItem;
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        if (m_vQueue.empty())
+            return ra::api::ApiResult::None;
+
+        auto& pFront = m_vQueue.front();
+        pFront.bInFlight = true;
+        pRequestItem.nType = pFront.nType;
+        pRequestItem.nId = pFront.nId;
+        pRequestItem.nValue = pFront.nValue;
+        pRequestItem.sGameHash = pFront.sGameHash;
+    }
+
+    // make the server call without holding the lock so new items can be queued while waiting for the response
+    ra::api::AwardAchievement::Response pAwardResponse;
+    ra::api::SubmitLeaderboardEntry::Response pSubmitResponse;
+    ra::api::ApiResult nResult = ra::api::ApiResult::None;
+    if (pRequestItem.nType == ItemType::AwardAchievement)
+    {
+        ra::api::AwardAchievement::Request request;
+        request.AchievementId = pRequestItem.nId;
+        request.Hardcore = (pRequestItem.nValue != 0);
+        request.GameHash = pRequestItem.sGameHash;
+        request.Timeout = tTimeout;
+        pAwardResponse = request.Call();
+        nResult = pAwardResponse.Result;
+    }
+    else
+    {
+        ra::api::SubmitLeaderboardEntry::Request request;
+        request.LeaderboardId = pRequestItem.nId;
+        request.Score = pRequestItem.nValue;
+        request.GameHash = pRequestItem.sGameHash;
+        request.Timeout = tTimeout;
+        pSubmitResponse = request.Call();
+        nResult = pSubmitResponse.Result;
+    }
+
+    Item pCompletedItem;
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        ++m_pStatistics.Submitted;
+
+        if (nResult == ra::api::ApiResult::Incomplete)
+        {
+            ++m_pStatistics.Retried;
+
+            auto& pFront = m_vQueue.front();
+            if (pFront.sUsername == m_sUsername)
+            {
+                pFront.bInFlight = false;
+                return nResult;
+            }
+
+            // the user changed while the item was being sent. it can't be retried with the new user's credentials,
+            // but it was persisted for the previous user before it was sent, so it will be sent the next time they
+            // log in. move on to the new user's items.
+            RA_LOG_WARN("Could not submit %s %u for previous user, will retry when they log in",
+                        (pFront.nType == ItemType::AwardAchievement) ? "achievement" : "leaderboard entry", pFront.nId);
+            m_vQueue.pop_front();
+            return ra::api::ApiResult::Unsupported;
+        }
+
+        // items are only added to the back of the queue and the front item can't be removed while it's in flight
+        pCompletedItem = std::move(m_vQueue.front());
+        m_vQueue.pop_front();
+        m_tRetryDelay = std::chrono::milliseconds(0);
+
+        if (nResult == ra::api::ApiResult::Success)
+            ++m_pStatistics.Succeeded;
+        else
+            ++m_pStatistics.Failed;
+
+        const auto tLatency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            ra::services::ServiceLocator::Get<ra::services::IClock>().UpTime() - pCompletedItem.tQueued);
+        m_pStatistics.TotalLatency += tLatency;
+        if (tLatency > m_pStatistics.MaxLatency)
+            m_pStatistics.MaxLatency = tLatency;
+
+        m_bSaveNeeded = true;
+    }
+
+    // already on a background thread, so the file can be written directly
+    SaveQueue();
+
+    // notify the callers outside of the lock in case the callbacks queue additional items
+    for (const auto& fCallback : pCompletedItem.vAwardCallbacks)
+        fCallback(pAwardResponse);
+    for (const auto& fCallback : pCompletedItem.vSubmitCallbacks)
+        fCallback(pSubmitResponse);
+
+    return nResult;
+}
+
+std::chrono::milliseconds SubmissionQueue::ApplyJitter(std::chrono::milliseconds tDelay) const
+{
+    // +/- 20%. only called while holding the queue lock, so the generator doesn't need additional protection.
+    static std::mt19937 pRandom{ std::random_device{}() };
+    std::uniform_int_distribution<long long> pDistribution(tDelay.count() * 8 / 10, tDelay.count() * 12 / 10);
+    return std::chrono::milliseconds(pDistribution(pRandom));
+}
+
+void SubmissionQueue::Flush(std::chrono::milliseconds tTimeout)
+{
+    const auto& pClock = ra::services::ServiceLocator::Get<ra::services::IClock>();
+    const auto tDeadline = pClock.UpTime() + tTimeout;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mtxQueue);
+        if (!m_cvProcessing.wait_for(lock, tTimeout, [this]() noexcept { return !m_bProcessing; }))
+        {
+            RA_LOG_WARN("Timed out waiting to flush %zu pending submissions", m_vQueue.size());
+            lock.unlock();
+
+            // make sure everything is persisted in case a background save doesn't get a chance to run
+            SaveQueue();
+            return;
+        }
+
+        m_bProcessing = true;
+    }
+
+    do
+    {
+        // the server call blocks, so tell it how much time is left. if it times out, the item will remain queued.
+        const auto tRemaining = std::chrono::duration_cast<std::chrono::milliseconds>(tDeadline - pClock.UpTime());
+        if (tRemaining.count() <= 0)
+            break;
+
+        const auto nResult = SendNextItem(tRemaining);
+        if (nResult == ra::api::ApiResult::None || nResult == ra::api::ApiResult::Incomplete)
+            break;
+    } while (true);
+
+    // a background save may not get a chance to run if the thread pool is shutting down
+    SaveQueue();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        m_bProcessing = false;
+
+        if (!m_vQueue.empty())
+            RA_LOG_WARN("%zu submissions could not be sent and will be retried later", m_vQueue.size());
+
+        RA_LOG_INFO("Submissions: %u queued, %u coalesced, %u sent, %u succeeded, %u failed, %u retried, max latency %zums",
+                    m_pStatistics.Queued, m_pStatistics.Coalesced, m_pStatistics.Submitted, m_pStatistics.Succeeded,
+                    m_pStatistics.Failed, m_pStatistics.Retried, m_pStatistics.MaxLatency.count());
+    }
+
+    m_cvProcessing.notify_all();
+}
+
+} // namespace data
+} // namespace ra
@@ -0,0 +1,148 @@
+#ifndef RA_DATA_SUBMISSIONQUEUE_HH
+#define RA_DATA_SUBMISSIONQUEUE_HH
+#pragma once
+
+#include "api\AwardAchievement.hh"
+#include "api\SubmitLeaderboardEntry.hh"
+
+#include <condition_variable>
+#include <deque>
+
+namespace ra {
+namespace data {
+
+/// <summary>
+/// Persistent outbound queue for achievement unlocks and leaderboard submissions.
+/// </summary>
+/// <remarks>
+/// Pending items are written to local storage (from a background thread) so they survive a crash or a server
+/// outage. Items are sent in the
+/// order they were queued. If the server cannot be reached, the whole queue backs off (with jitter) before trying
+/// again so a server outage doesn't result in a flood of requests once it comes back.
+/// </remarks>
+class SubmissionQueue
+{
+public:
+    SubmissionQueue() noexcept(std::is_nothrow_default_constructible_v<std::condition_variable>) = default;
+    virtual ~SubmissionQueue() noexcept = default;
+    SubmissionQueue(const SubmissionQueue&) noexcept = delete;
+    SubmissionQueue& operator=(const SubmissionQueue&) noexcept = delete;
+    SubmissionQueue(SubmissionQueue&&) noexcept = delete;
+    SubmissionQueue& operator=(SubmissionQueue&&) noexcept = delete;
+
+    /// <summary>
+    /// Loads any pending submissions for the specified user and starts sending them.
+    /// </summary>
+    void Initialize(const std::string& sUsername);
+
+    /// <summary>
+    /// Queues an achievement unlock. <paramref name="fCallback" /> is called once the server has processed the unlock.
+    /// </summary>
+    void QueueAwardAchievement(const ra::api::AwardAchievement::Request& pRequest,
+                               ra::api::AwardAchievement::Request::Callback&& fCallback);
+
+    /// <summary>
+    /// Queues a leaderboard entry. <paramref name="fCallback" /> is called once the server has processed the entry.
+    /// </summary>
+    void QueueSubmitLeaderboardEntry(const ra::api::SubmitLeaderboardEntry::Request& pRequest,
+                                     ra::api::SubmitLeaderboardEntry::Request::Callback&& fCallback);
+
+    /// <summary>
+    /// Synchronously attempts to send all pending items, ignoring any backoff delay.
+    /// </summary>
+    /// <param name="tTimeout">Maximum amount of time to spend sending items.</param>
+    /// <remarks>Items that could not be sent remain persisted and will be sent the next time the user logs in.</remarks>
+    void Flush(std::chrono::milliseconds tTimeout);
+
+    /// <summary>
+    /// Gets the number of items waiting to be sent.
+    /// </summary>
+    size_t PendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        return m_vQueue.size();
+    }
+
+    struct Statistics
+    {
+        unsigned int Queued{};      // items added to the queue
+        unsigned int Coalesced{};   // items merged into an already pending item
+        unsigned int Submitted{};   // requests sent to the server
+        unsigned int Succeeded{};   // requests the server accepted
+        unsigned int Failed{};      // requests the server rejected
+        unsigned int Retried{};     // requests that could not be sent and were retried
+        std::chrono::milliseconds TotalLatency{}; // sum of time between queueing and completing each item
+        std::chrono::milliseconds MaxLatency{};   // longest time between queueing and completing an item
+    };
+
+    /// <summary>
+    /// Gets the throughput and latency counters for the queue.
+    /// </summary>
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        return m_pStatistics;
+    }
+
+protected:
+    enum class ItemType
+    {
+        None = 0,
+        AwardAchievement,
+        SubmitLeaderboardEntry,
+    };
+
+    struct Item
+    {
+        ItemType nType{ ItemType::None };
+        unsigned int nId{};
+        unsigned int nValue{}; // hardcore flag for achievements, score for leaderboards
+        std::string sGameHash;
+        std::wstring sUsername; // user the item was queued for. empty if queued before the user was known
+        std::chrono::steady_clock::time_point tQueued{};
+        bool bInFlight = false;
+        std::vector<ra::api::AwardAchievement::Request::Callback> vAwardCallbacks;
+        std::vector<ra::api::SubmitLeaderboardEntry::Request::Callback> vSubmitCallbacks;
+    };
+
+    virtual void LoadQueue();
+
+    /// <summary>
+    /// Writes the pending items to local storage if they've changed since the last write.
+    /// </summary>
+    /// <remarks>Must not be called while holding the queue lock.</remarks>
+    void SaveQueue();
+
+    /// <summary>
+    /// Randomizes a retry delay so multiple clients don't retry in lockstep.
+    /// </summary>
+    virtual std::chrono::milliseconds ApplyJitter(std::chrono::milliseconds tDelay) const;
+
+    std::wstring m_sUsername;
+
+private:
+    void Enqueue(Item&& pItem);
+    bool MarkModified() noexcept;
+    void StartTask(bool bSave, bool bProcess);
+    void ProcessQueue();
+    ra::api::ApiResult SendNextItem(std::chrono::milliseconds tTimeout);
+
+    std::deque<Item> m_vQueue;
+    Statistics m_pStatistics;
+
+    bool m_bProcessing = false;
+    bool m_bRetryScheduled = false;
+    std::chrono::milliseconds m_tRetryDelay{};
+
+    bool m_bSaveNeeded = false;
+    bool m_bSaveScheduled = false;
+
+    mutable std::mutex m_mtxQueue;
+    std::mutex m_mtxSave; // held while writing the file so writes are not reordered
+    std::condition_variable m_cvProcessing;
+};
+
+} // namespace data
+} // namespace ra
+
+#endif // !RA_DATA_SUBMISSIONQUEUE_HH
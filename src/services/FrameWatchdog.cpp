@@ -0,0 +1,88 @@
+#include "FrameWatchdog.hh"
+
+#include "RA_Log.h"
+#include "RA_StringUtils.h"
+
+#include "services\IClock.hh"
+#include "services\ServiceLocator.hh"
+
+namespace ra {
+namespace services {
+
+static_assert(static_cast<size_t>(PerformanceCheckpoint::RuntimeProcess) == 0, "frame phases must be first");
+
+void FrameWatchdog::RecordPhase(PerformanceCheckpoint nPhase, std::chrono::microseconds tElapsed) noexcept
+{
+    const auto nIndex = static_cast<size_t>(nPhase);
+    if (nIndex < NUM_PHASES)
+        m_vCurrentPhases.at(nIndex) += tElapsed;
+}
+
+void FrameWatchdog::EndFrame(std::chrono::microseconds tElapsed)
+{
+    ++m_nFrame;
+
+    if (tElapsed > m_tBudget)
+    {
+        auto& pFrame = m_vSlowFrames.at(m_nSlowFrames % MAX_SLOW_FRAMES);
+        ++m_nSlowFrames;
+
+        pFrame.nFrame = m_nFrame;
+        pFrame.tElapsed = tElapsed;
+        pFrame.vPhases = m_vCurrentPhases;
+
+        LogSlowFrame(pFrame);
+    }
+
+    m_vCurrentPhases.fill(std::chrono::microseconds(0));
+}
+
+std::vector<FrameWatchdog::SlowFrame> FrameWatchdog::GetSlowFrames() const
+{
+    std::vector<SlowFrame> vFrames;
+    const size_t nCount = std::min<size_t>(m_nSlowFrames, MAX_SLOW_FRAMES);
+    vFrames.reserve(nCount);
+
+    for (size_t i = m_nSlowFrames - nCount; i < m_nSlowFrames; ++i)
+        vFrames.push_back(m_vSlowFrames.at(i % MAX_SLOW_FRAMES));
+
+    return vFrames;
+}
+
+void FrameWatchdog::LogSlowFrame(const SlowFrame& pFrame)
+{
+    // a game that's consistently over budget would otherwise write a line to the log every frame
+    const auto tNow = ServiceLocator::Get<IClock>().UpTime();
+    if (m_tLastLog != std::chrono::steady_clock::time_point() && tNow - m_tLastLog < LOG_INTERVAL)
+    {
+        ++m_nUnloggedSlowFrames;
+        return;
+    }
+
+    m_tLastLog = tNow;
+
+    std::string sPhases;
+    for (size_t i = 0; i < NUM_PHASES; ++i)
+    {
+        const auto nMicroseconds = pFrame.vPhases.at(i).count();
+        if (nMicroseconds == 0)
+            continue;
+
+        sPhases.append(ra::StringPrintf(" %s=%lld.%03lldms",
+            PerformanceCounter::GetLabel(static_cast<PerformanceCheckpoint>(i)),
+            nMicroseconds / 1000, nMicroseconds % 1000));
+    }
+
+    RA_LOG_WARN("Frame %u took %lld.%03lldms (budget %lld.%03lldms):%s", pFrame.nFrame,
+                pFrame.tElapsed.count() / 1000, pFrame.tElapsed.count() % 1000,
+                m_tBudget.count() / 1000, m_tBudget.count() % 1000, sPhases);
+
+    if (m_nUnloggedSlowFrames > 0)
+    {
+        RA_LOG_WARN(" %u other slow frames since last report", m_nUnloggedSlowFrames);
+        m_nUnloggedSlowFrames = 0;
+    }
+}
+
+} // namespace services
+} // namespace ra
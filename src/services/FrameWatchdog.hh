@@ -0,0 +1,96 @@
+#ifndef RA_SERVICES_FRAMEWATCHDOG_HH
+#define RA_SERVICES_FRAMEWATCHDOG_HH
+#pragma once
+
+#include "services\PerformanceCounter.hh"
+
+namespace ra {
+namespace services {
+
+/// <summary>
+/// Compares the time spent in each call to _RA_DoAchievementsFrame against a budget and remembers which phases
+/// consumed the time for the frames that exceeded it.
+/// </summary>
+/// <remarks>
+/// Phases are reported by <see cref="PerformanceTimer" />. Only the emulator thread should call
+/// <see cref="RecordPhase" /> and <see cref="EndFrame" />.
+/// </remarks>
+class FrameWatchdog
+{
+public:
+    explicit FrameWatchdog(std::chrono::microseconds tBudget) noexcept : m_tBudget(tBudget) {}
+    ~FrameWatchdog() noexcept = default;
+    FrameWatchdog(const FrameWatchdog&) noexcept = delete;
+    FrameWatchdog& operator=(const FrameWatchdog&) noexcept = delete;
+    FrameWatchdog(FrameWatchdog&&) noexcept = delete;
+    FrameWatchdog& operator=(FrameWatchdog&&) noexcept = delete;
+
+    /// <summary>
+    /// Gets how long a frame can take before it's reported as slow.
+    /// </summary>
+    std::chrono::microseconds GetBudget() const noexcept { return m_tBudget; }
+
+    /// <summary>
+    /// Sets how long a frame can take before it's reported as slow.
+    /// </summary>
+    void SetBudget(std::chrono::microseconds tBudget) noexcept { m_tBudget = tBudget; }
+
+    /// <summary>
+    /// Determines whether a checkpoint is one of the phases of _RA_DoAchievementsFrame.
+    /// </summary>
+    static bool IsFramePhase(PerformanceCheckpoint nCheckpoint) noexcept
+    {
+        return static_cast<size_t>(nCheckpoint) < NUM_PHASES;
+    }
+
+    /// <summary>
+    /// Adds time spent in a phase of the current frame. Ignored if <paramref name="nPhase" /> is not a frame phase.
+    /// </summary>
+    void RecordPhase(PerformanceCheckpoint nPhase, std::chrono::microseconds tElapsed) noexcept;
+
+    /// <summary>
+    /// Indicates the current frame has finished. If it took longer than the budget, it's remembered and logged.
+    /// </summary>
+    void EndFrame(std::chrono::microseconds tElapsed);
+
+    // the phases of _RA_DoAchievementsFrame are the first checkpoints
+    static constexpr size_t NUM_PHASES = static_cast<size_t>(PerformanceCheckpoint::MemoryInspectorDoFrame) + 1;
+
+    struct SlowFrame
+    {
+        unsigned int nFrame = 0;
+        std::chrono::microseconds tElapsed{};
+        std::array<std::chrono::microseconds, NUM_PHASES> vPhases{};
+    };
+
+    /// <summary>
+    /// Gets the most recent frames that exceeded the budget, oldest first.
+    /// </summary>
+    std::vector<SlowFrame> GetSlowFrames() const;
+
+    /// <summary>
+    /// Gets the total number of frames that have exceeded the budget, including ones no longer remembered.
+    /// </summary>
+    unsigned int GetSlowFrameCount() const noexcept { return m_nSlowFrames; }
+
+    static constexpr size_t MAX_SLOW_FRAMES = 64;
+    static constexpr std::chrono::seconds LOG_INTERVAL{5};
+
+private:
+    void LogSlowFrame(const SlowFrame& pFrame);
+
+    std::chrono::microseconds m_tBudget;
+    std::array<std::chrono::microseconds, NUM_PHASES> m_vCurrentPhases{};
+    unsigned int m_nFrame = 0;
+
+    std::array<SlowFrame, MAX_SLOW_FRAMES> m_vSlowFrames{};
+    unsigned int m_nSlowFrames = 0;
+
+    std::chrono::steady_clock::time_point m_tLastLog{};
+    unsigned int m_nUnloggedSlowFrames = 0;
+};
+
+} // namespace services
+} // namespace ra
+
+#endif // !RA_SERVICES_FRAMEWATCHDOG_HH
@@ -3,7 +3,9 @@
 #include "services\IFileSystem.hh"
 #include "services\IHttpRequester.hh"
 #include "services\IThreadPool.hh"
+#include "services\PerformanceCounter.hh"
 #include "services\ServiceLocator.hh"
+#include "services\Tracer.hh"
 
 #include "services\impl\StringTextWriter.hh"
 
@@ -12,6 +14,9 @@ namespace services {
 
 Http::Response Http::Request::Call() const
 {
+    TraceSpan span("HttpRequest");
+    PerformanceTimer tRequest(PerformanceCheckpoint::HttpRequest);
+
     std::string sResponse;
     ra::services::impl::StringTextWriter pWriter(sResponse);
 
@@ -21,17 +26,20 @@ Http::Response Http::Request::Call() const
     return Response(nStatusCode, std::move(sResponse));
 }
 
-void Http::Request::CallAsync(Callback&& fCallback) const
+void Http::Request::CallAsync(Callback&& fCallback, TaskPriority nPriority) const
 {
     auto& pThreadPool = ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>();
     pThreadPool.RunAsync([request = *this, f = std::move(fCallback)]() {
         auto response = request.Call();
         f(response);
-    });
+    }, nPriority);
 }
 
 Http::Response Http::Request::Download(const std::wstring& sFilename) const
 {
+    TraceSpan span("HttpRequest");
+    PerformanceTimer tRequest(PerformanceCheckpoint::HttpRequest);
+
     auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
     auto pFile = pFileSystem.CreateTextFile(sFilename);
     Ensures(pFile != nullptr);
@@ -42,13 +50,13 @@ Http::Response Http::Request::Download(const std::wstring& sFilename) const
     return Response(nStatusCode, "");
 }
 
-void Http::Request::DownloadAsync(const std::wstring& sFilename, Callback&& fCallback) const
+void Http::Request::DownloadAsync(const std::wstring& sFilename, Callback&& fCallback, TaskPriority nPriority) const
 {
     auto& pThreadPool = ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>();
     pThreadPool.RunAsync([request = *this, sFilename, f = std::move(fCallback)]() {
         auto response = request.Download(sFilename);
         f(response);
-    });
+    }, nPriority);
 }
 
 std::string Http::UrlEncode(const std::string& sInput)
@@ -2,6 +2,8 @@
 #define RA_SERVICES_HTTP_H
 #pragma once
 
+#include "services\IThreadPool.hh"
+
 #include <functional>
 
 namespace ra {
@@ -42,6 +44,11 @@ public:
         /// </summary>
         const std::string& Content() const noexcept { return m_sResponse; }
 
+        /// <summary>
+        /// Transfers ownership of the content returned from the server to the caller.
+        /// </summary>
+        std::string TakeContent() noexcept { return std::move(m_sResponse); }
+
     private:
         Http::StatusCode m_nStatusCode{ 0 };
         std::string m_sResponse;
@@ -116,6 +123,17 @@ public:
         /// </summary>
         const std::string& GetContentType() const noexcept { return m_sContentType; }
 
+        /// <summary>
+        /// Sets the maximum amount of time to wait for each step of the request (connect, send, receive).
+        /// Default: 0, which uses the system timeouts.
+        /// </summary>
+        void SetTimeout(std::chrono::milliseconds tValue) noexcept { m_tTimeout = tValue; }
+
+        /// <summary>
+        /// Gets the maximum amount of time to wait for each step of the request. 0 uses the system timeouts.
+        /// </summary>
+        std::chrono::milliseconds GetTimeout() const noexcept { return m_tTimeout; }
+
         using Callback = std::function<void(const Response& response)>;
 
         /// <summary>
@@ -126,7 +144,8 @@ public:
         /// <summary>
         /// Calls the server asynchronously. The provided callback will be called when the response is received.
         /// </summary>
-        void CallAsync(Callback&& fCallback) const;
+        /// <param name="nPriority">The priority of the request relative to other background work.</param>
+        void CallAsync(Callback&& fCallback, TaskPriority nPriority = TaskPriority::Interactive) const;
 
         /// <summary>
         /// Calls this server and waits for the response.
@@ -139,14 +158,17 @@ public:
         /// Calls the server asynchronously. The provided callback will be called when the response is received.
         /// </summary>
         /// <param name="sFilename">The path to the file where the response should be written.</param>
+        /// <param name="nPriority">The priority of the download relative to other background work.</param>
         /// <remarks>Response.Content() will be empty.</remarks>
-        void DownloadAsync(const std::wstring& sFilename, Callback&& fCallback) const;
+        void DownloadAsync(const std::wstring& sFilename, Callback&& fCallback,
+                           TaskPriority nPriority = TaskPriority::Interactive) const;
 
     private:
         std::string m_sUrl;
         std::string m_sQueryString;
         std::string m_sPostData;
         std::string m_sContentType{ "application/x-www-form-urlencoded" };
+        std::chrono::milliseconds m_tTimeout{ 0 };
     };
     
     /// <summary>
@@ -22,6 +22,9 @@ enum class Feature
     AchievementTriggeredNotifications,
     MasteryNotification,
     MasteryNotificationScreenshot,
+    PerformanceCounters,
+    Tracing,
+    PackedImageCache,
 };
 
 class IConfiguration
@@ -68,6 +71,11 @@ public:
     /// </summary>
     virtual unsigned int GetNumBackgroundThreads() const = 0;
 
+    /// <summary>
+    /// Gets how long a call to _RA_DoAchievementsFrame can take before it's reported as slow.
+    /// </summary>
+    virtual std::chrono::microseconds GetFrameBudget() const = 0;
+
     virtual const std::wstring& GetRomDirectory() const = 0;
     virtual void SetRomDirectory(const std::wstring& sValue) = 0;
 
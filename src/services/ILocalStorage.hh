@@ -18,7 +18,10 @@ enum class StorageItemType
     Badge,
     UserPic,
     SessionStats,
-    Bookmarks
+    Bookmarks,
+    PendingSubmissions,
+    PerformanceCounters,
+    Trace
 };
 
 class ILocalStorage
@@ -36,6 +39,11 @@ public:
     /// <returns>Time the stored data was last modified, <c>0</c> if it doesn't exist.</returns>
     virtual std::chrono::system_clock::time_point GetLastModified(StorageItemType nType, const std::wstring& sKey) = 0;
 
+    /// <summary>
+    /// Determines if there is stored data for the specified <paramref name="nType" /> and <paramref name="sKey" />.
+    /// </summary>
+    virtual bool Exists(StorageItemType nType, const std::wstring& sKey) = 0;
+
     /// <summary>
     ///   Begins reading stored data for the specified <paramref name="nType" /> and <paramref name="sKey" />.
     /// </summary>
@@ -58,6 +66,13 @@ public:
     /// </returns>
     virtual std::unique_ptr<TextWriter> AppendText(StorageItemType nType, const std::wstring& sKey) = 0;
 
+    /// <summary>
+    ///   Replaces the stored data for the specified <paramref name="nType" /> and <paramref name="sKey" />. The
+    ///   existing data is kept if the new data cannot be completely written.
+    /// </summary>
+    /// <returns><c>true</c> if the data was replaced, <c>false</c> if not.</returns>
+    virtual bool ReplaceText(StorageItemType nType, const std::wstring& sKey, const std::string& sContents) = 0;
+
 protected:
     ILocalStorage() noexcept = default;
 };
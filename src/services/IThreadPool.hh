@@ -2,9 +2,22 @@
 #define RA_SERVICES_ITHREADPOOL_HH
 #pragma once
 
+#include "services\TaskHandle.hh"
+
 namespace ra {
 namespace services {
 
+/// <summary>
+/// Determines the order in which queued work is started.
+/// </summary>
+enum class TaskPriority
+{
+    Critical = 0,   // work that must not be delayed (achievement unlocks, leaderboard submissions)
+    Interactive,    // work the user is waiting on (default)
+    Background,     // bulk work (image downloads, pings)
+    Idle,           // work that should only happen when nothing else is going on
+};
+
 class IThreadPool
 {
 public:
@@ -17,12 +30,44 @@ public:
     /// <summary>
     /// Queues work for a background thread
     /// </summary>
-    virtual void RunAsync(std::function<void()>&& f) = 0;
+    virtual void RunAsync(std::function<void()>&& f, TaskPriority nPriority = TaskPriority::Interactive) = 0;
+
+    using ScheduledTaskId = unsigned int;
 
     /// <summary>
     /// Queues work for a background thread to be run after a period of time
     /// </summary>
-    virtual void ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f) = 0;
+    /// <returns>An identifier that can be passed to <see cref="CancelScheduledTask" />.</returns>
+    virtual ScheduledTaskId ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                                          TaskPriority nPriority = TaskPriority::Interactive) = 0;
+
+    /// <summary>
+    /// Removes work queued by <see cref="ScheduleAsync" /> before it runs.
+    /// </summary>
+    /// <returns><c>true</c> if the work was removed, <c>false</c> if it has already been started or was not found.</returns>
+    virtual bool CancelScheduledTask(ScheduledTaskId nId) = 0;
+
+    /// <summary>
+    /// Queues work for a background thread and returns a handle that can be used to cancel it or wait for it.
+    /// </summary>
+    /// <param name="pToken">Optional token that cancels the work if it hasn't started yet.</param>
+    TaskHandle RunTaskAsync(std::function<void()>&& f, const CancellationToken& pToken = {},
+                            TaskPriority nPriority = TaskPriority::Interactive)
+    {
+        return TaskHandle::Queue(*this, std::chrono::milliseconds(0), std::move(f), pToken, nPriority, false);
+    }
+
+    /// <summary>
+    /// Queues work for a background thread to be run after a period of time and returns a handle that can be used to
+    /// cancel it or wait for it.
+    /// </summary>
+    /// <param name="pToken">Optional token that cancels the work if it hasn't started yet.</param>
+    TaskHandle ScheduleTaskAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                                 const CancellationToken& pToken = {},
+                                 TaskPriority nPriority = TaskPriority::Interactive)
+    {
+        return TaskHandle::Queue(*this, nDelay, std::move(f), pToken, nPriority, true);
+    }
 
     /// <summary>
     /// Sets the <see ref="IsShutdownRequested" /> flag so threads can start winding down.
@@ -6,12 +6,15 @@
 #include "data\EmulatorContext.hh"
 #include "data\GameContext.hh"
 #include "data\SessionTracker.hh"
+#include "data\SubmissionQueue.hh"
 #include "data\UserContext.hh"
 
 #include "services\AchievementRuntime.hh"
+#include "services\FrameWatchdog.hh"
 #include "services\GameIdentifier.hh"
 #include "services\PerformanceCounter.hh"
 #include "services\ServiceLocator.hh"
+#include "services\Tracer.hh"
 #include "services\impl\Clock.hh"
 #include "services\impl\FileLocalStorage.hh"
 #include "services\impl\JsonFileConfiguration.hh"
@@ -112,19 +115,36 @@ void Initialization::RegisterServices(EmulatorID nEmulatorId)
     pConfiguration->Load(sFilename);
 
     auto pLocalStorage = std::make_unique<ra::services::impl::FileLocalStorage>(pFileSystem);
+    if (pConfiguration->IsFeatureEnabled(ra::services::Feature::PackedImageCache))
+        pLocalStorage->EnableImagePack();
     ra::services::ServiceLocator::Provide<ra::services::ILocalStorage>(std::move(pLocalStorage));
 
+    auto pTracer = std::make_unique<ra::services::Tracer>(ra::Widen(sClientName));
+    if (pConfiguration->IsFeatureEnabled(ra::services::Feature::Tracing))
+    {
+        pTracer->SetEnabled(true);
+        pTracer->SetThreadName("Emulator");
+    }
+    ra::services::ServiceLocator::Provide<ra::services::Tracer>(std::move(pTracer));
+
     auto pThreadPool = std::make_unique<ra::services::impl::ThreadPool>();
     pThreadPool->Initialize(pConfiguration->GetNumBackgroundThreads());
     ra::services::ServiceLocator::Provide<ra::services::IThreadPool>(std::move(pThreadPool));
 
+    // expired cache files are cleaned up in the background now that the thread pool is available
+    auto& pFileLocalStorage = dynamic_cast<ra::services::impl::FileLocalStorage&>(
+        ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>());
+    pFileLocalStorage.ScheduleCacheMaintenance();
+
     auto pHttpRequester = std::make_unique<ra::services::impl::WindowsHttpRequester>();
     ra::services::ServiceLocator::Provide<ra::services::IHttpRequester>(std::move(pHttpRequester));
 
-#ifdef PERFORMANCE_COUNTERS
-    auto pPerformanceCounter = std::make_unique<ra::services::PerformanceCounter>();
+    auto pFrameWatchdog = std::make_unique<ra::services::FrameWatchdog>(pConfiguration->GetFrameBudget());
+    ra::services::ServiceLocator::Provide<ra::services::FrameWatchdog>(std::move(pFrameWatchdog));
+
+    auto pPerformanceCounter = std::make_unique<ra::services::PerformanceCounter>(ra::Widen(sClientName));
+    pPerformanceCounter->SetEnabled(pConfiguration->IsFeatureEnabled(ra::services::Feature::PerformanceCounters));
     ra::services::ServiceLocator::Provide<ra::services::PerformanceCounter>(std::move(pPerformanceCounter));
-#endif
 
     auto pUserContext = std::make_unique<ra::data::UserContext>();
     ra::services::ServiceLocator::Provide<ra::data::UserContext>(std::move(pUserContext));
@@ -135,6 +155,9 @@ void Initialization::RegisterServices(EmulatorID nEmulatorId)
     auto pSessionTracker = std::make_unique<ra::data::SessionTracker>();
     ra::services::ServiceLocator::Provide<ra::data::SessionTracker>(std::move(pSessionTracker));
 
+    auto pSubmissionQueue = std::make_unique<ra::data::SubmissionQueue>();
+    ra::services::ServiceLocator::Provide<ra::data::SubmissionQueue>(std::move(pSubmissionQueue));
+
     auto pAchievementRuntime = std::make_unique<ra::services::AchievementRuntime>();
     ra::services::ServiceLocator::Provide<ra::services::AchievementRuntime>(std::move(pAchievementRuntime));
 
@@ -198,6 +221,11 @@ void Initialization::Shutdown()
 
     ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().Shutdown(true);
 
+    // write anything still queued for the log and stop its thread. anything logged after this is written immediately
+    auto* pFileLogger = dynamic_cast<ra::services::impl::FileLogger*>(&ra::services::ServiceLocator::GetMutable<ra::services::ILogger>());
+    if (pFileLogger != nullptr)
+        pFileLogger->Shutdown();
+
     // ImageReference destructors will try to use the IImageRepository if they think it still exists.
     // explicitly deregister it to prevent exceptions when closing down the application.
     ra::services::ServiceLocator::Provide<ra::ui::IImageRepository>(nullptr);
@@ -1,113 +1,242 @@
 #include "PerformanceCounter.hh"
 
-#ifdef PERFORMANCE_COUNTERS
-
+#include "RA_Json.h"
 #include "RA_Log.h"
 
-#include "IClock.hh"
+#include "services\FrameWatchdog.hh"
+#include "services\ILocalStorage.hh"
+#include "services\IThreadPool.hh"
+#include "services\ServiceLocator.hh"
 
 namespace ra {
 namespace services {
 
-static std::string GetLabel(PerformanceCheckpoint nCheckpoint)
+const char* PerformanceCounter::GetLabel(PerformanceCheckpoint nCheckpoint) noexcept
 {
-    std::string sCheckpoint;
-
     switch (nCheckpoint)
     {
-        case PerformanceCheckpoint::RuntimeProcess: sCheckpoint = "Runtime"; break;
-        case PerformanceCheckpoint::RuntimeEvents: sCheckpoint = "Events"; break;
-        case PerformanceCheckpoint::OverlayManagerAdvanceFrame: sCheckpoint = "Overlay"; break;
-        case PerformanceCheckpoint::MemoryBookmarksDoFrame: sCheckpoint = "Bookmarks"; break;
-        case PerformanceCheckpoint::MemoryInspectorDoFrame: sCheckpoint = "Inspector"; break;
-        default: sCheckpoint = std::to_string(ra::etoi(nCheckpoint)); break;
+        case PerformanceCheckpoint::RuntimeProcess: return "Runtime";
+        case PerformanceCheckpoint::RuntimeEvents: return "Events";
+        case PerformanceCheckpoint::OverlayManagerAdvanceFrame: return "Overlay";
+        case PerformanceCheckpoint::MemoryBookmarksDoFrame: return "Bookmarks";
+        case PerformanceCheckpoint::MemoryInspectorDoFrame: return "Inspector";
+        case PerformanceCheckpoint::OverlayManagerRender: return "OverlayRender";
+        case PerformanceCheckpoint::MemorySearchFilter: return "Search";
+        case PerformanceCheckpoint::HttpRequest: return "Http";
+        case PerformanceCheckpoint::ImageDecode: return "ImageDecode";
+        case PerformanceCheckpoint::Frame: return "Frame";
+        default: return "Unknown";
     }
+}
+
+size_t PerformanceCounter::GetBucket(unsigned int nMicroseconds) noexcept
+{
+    // find the power of two bucket, then use the next SUB_BUCKET_BITS bits to select the sub-bucket
+    unsigned int nShift = 0;
+    while ((nMicroseconds >> nShift) >= SUB_BUCKET_COUNT * 2)
+        ++nShift;
 
-    return sCheckpoint;
+    return gsl::narrow_cast<size_t>(nShift) * SUB_BUCKET_COUNT + (nMicroseconds >> nShift);
 }
 
-void PerformanceCounter::Tally(PerformanceCheckpoint nCheckpoint)
+unsigned int PerformanceCounter::GetBucketMaximum(size_t nBucket) noexcept
 {
-    const auto& pClock = ra::services::ServiceLocator::Get<ra::services::IClock>();
-    m_vMeasurements.emplace_back(nCheckpoint, pClock.UpTime());
+    if (nBucket < SUB_BUCKET_COUNT * 2)
+        return gsl::narrow_cast<unsigned int>(nBucket);
+
+    const auto nShift = nBucket / SUB_BUCKET_COUNT - 1;
+    const auto nSubBucket = nBucket - nShift * SUB_BUCKET_COUNT;
+    return gsl::narrow_cast<unsigned int>(((nSubBucket + 1ULL) << nShift) - 1);
 }
 
-void PerformanceCounter::Stop()
+void PerformanceCounter::Record(PerformanceCheckpoint nCheckpoint, std::chrono::microseconds tElapsed) noexcept
 {
-    Tally(PerformanceCheckpoint::NUM_CHECKPOINTS);
+    const auto nIndex = static_cast<size_t>(nCheckpoint);
+    if (nIndex >= m_vHistograms.size())
+        return;
 
-    int nLapTime = 0;
-    Lap& pLap = m_vLaps.at(m_nNextLap);
-    for (gsl::index nIndex = 1; nIndex < gsl::narrow_cast<gsl::index>(m_vMeasurements.size()); ++nIndex)
+    const auto nElapsed = tElapsed.count();
+    unsigned int nMicroseconds = 0;
+    if (nElapsed > 0)
     {
-        const auto& pMeasurement = m_vMeasurements.at(nIndex - 1);
-        const auto nElapsed = m_vMeasurements.at(nIndex).tWhen - pMeasurement.tWhen;
-        const auto nElapsedMicroseconds = gsl::narrow_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(nElapsed).count());
+        nMicroseconds = (nElapsed > std::numeric_limits<unsigned int>::max()) ?
+            std::numeric_limits<unsigned int>::max() : gsl::narrow_cast<unsigned int>(nElapsed);
+    }
 
-        const auto nCheckpointIndex = ra::etoi(pMeasurement.nCheckpoint);
-        const auto nPreviousMicroseconds = pLap.at(nCheckpointIndex);
-        m_nRollingTotals.at(nCheckpointIndex) += nElapsedMicroseconds - nPreviousMicroseconds;
-        pLap.at(nCheckpointIndex) = nElapsedMicroseconds;
+    auto& pHistogram = m_vHistograms.at(nIndex);
+    ++pHistogram.vBuckets.at(GetBucket(nMicroseconds));
+    ++pHistogram.nCount;
+    pHistogram.nTotal += nMicroseconds;
 
-        m_nLapTotal += nElapsedMicroseconds - nPreviousMicroseconds;
-        nLapTime += nElapsedMicroseconds;
+    auto nMax = pHistogram.nMax.load();
+    while (nMicroseconds > nMax && !pHistogram.nMax.compare_exchange_weak(nMax, nMicroseconds))
+    {
+        // nMax is updated by compare_exchange_weak if another thread changed it
     }
+}
+
+PerformanceCounter::Statistics PerformanceCounter::GetStatistics(PerformanceCheckpoint nCheckpoint) const noexcept
+{
+    Statistics pStatistics;
 
-    m_vMeasurements.clear();
+    const auto nIndex = static_cast<size_t>(nCheckpoint);
+    if (nIndex >= m_vHistograms.size())
+        return pStatistics;
 
-    if (++m_nNextLap == NUM_LAPS)
-        m_nNextLap = 0;
+    const auto& pHistogram = m_vHistograms.at(nIndex);
 
-    if (++m_nTotalLaps > NUM_LAPS)
+    // other threads may still be recording, so count the buckets rather than trusting nCount to match them
+    std::array<unsigned int, NUM_BUCKETS> vBuckets{};
+    unsigned long long nCount = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
     {
-        const auto nLapAverage = m_nLapTotal / NUM_LAPS;
+        vBuckets.at(i) = pHistogram.vBuckets.at(i);
+        nCount += vBuckets.at(i);
+    }
 
-        if (m_nTotalLaps % NUM_LAPS == 0) 
+    if (nCount == 0)
+        return pStatistics;
+
+    const unsigned int nMax = pHistogram.nMax;
+    pStatistics.nCount = gsl::narrow_cast<unsigned int>(nCount);
+    pStatistics.tTotal = std::chrono::microseconds(pHistogram.nTotal.load());
+    pStatistics.tMax = std::chrono::microseconds(nMax);
+
+    const auto GetPercentile = [&vBuckets, nCount, nMax](unsigned long long nPercent) {
+        const auto nTarget = (nCount * nPercent + 99) / 100;
+        unsigned long long nSeen = 0;
+        for (size_t i = 0; i < NUM_BUCKETS; ++i)
         {
-            RA_LOG("Lap averages: total: %d.%03d", nLapAverage / 1000, nLapAverage % 1000);
-            for (gsl::index i = 0; i < ra::etoi(PerformanceCheckpoint::NUM_CHECKPOINTS); ++i)
-            {
-                const auto nCheckpointTime = pLap.at(i);
-                if (nCheckpointTime != 0)
-                {
-                    const auto nCheckpointAverage = m_nRollingTotals.at(i) / NUM_LAPS;
-                    RA_LOG(" %s: %d.%03d", GetLabel(ra::itoe<PerformanceCheckpoint>(i)), nCheckpointAverage / 1000, nCheckpointAverage % 1000);
-                }
-            }
+            nSeen += vBuckets.at(i);
+            if (nSeen >= nTarget)
+                return std::chrono::microseconds(std::min(GetBucketMaximum(i), nMax));
         }
-        else if (nLapTime > 100) // ignore everything under 100us
+
+        return std::chrono::microseconds(nMax);
+    };
+
+    pStatistics.tP50 = GetPercentile(50);
+    pStatistics.tP95 = GetPercentile(95);
+    pStatistics.tP99 = GetPercentile(99);
+    return pStatistics;
+}
+
+void PerformanceCounter::Reset() noexcept
+{
+    for (auto& pHistogram : m_vHistograms)
+    {
+        for (auto& nBucket : pHistogram.vBuckets)
+            nBucket = 0;
+
+        pHistogram.nCount = 0;
+        pHistogram.nTotal = 0;
+        pHistogram.nMax = 0;
+    }
+}
+
+void PerformanceCounter::EndFrame()
+{
+    if (!m_bEnabled)
+        return;
+
+    if (++m_nFrames % EXPORT_INTERVAL_FRAMES != 0)
+        return;
+
+    // writing the file shouldn't be counted against the frame
+    if (ServiceLocator::Exists<IThreadPool>())
+        ServiceLocator::GetMutable<IThreadPool>().RunAsync([this]() { Export(); }, TaskPriority::Idle);
+    else
+        Export();
+}
+
+void PerformanceCounter::Export() const
+{
+    rapidjson::Document document;
+    document.SetObject();
+    auto& allocator = document.GetAllocator();
+
+    rapidjson::Value vCheckpoints(rapidjson::kArrayType);
+    for (size_t i = 0; i < m_vHistograms.size(); ++i)
+    {
+        const auto nCheckpoint = static_cast<PerformanceCheckpoint>(i);
+        const auto pStatistics = GetStatistics(nCheckpoint);
+        if (pStatistics.nCount == 0)
+            continue;
+
+        rapidjson::Value vCheckpoint(rapidjson::kObjectType);
+        vCheckpoint.AddMember("Name", rapidjson::StringRef(GetLabel(nCheckpoint)), allocator);
+        vCheckpoint.AddMember("Count", pStatistics.nCount, allocator);
+        vCheckpoint.AddMember("TotalUs", gsl::narrow_cast<uint64_t>(pStatistics.tTotal.count()), allocator);
+        vCheckpoint.AddMember("P50Us", gsl::narrow_cast<uint64_t>(pStatistics.tP50.count()), allocator);
+        vCheckpoint.AddMember("P95Us", gsl::narrow_cast<uint64_t>(pStatistics.tP95.count()), allocator);
+        vCheckpoint.AddMember("P99Us", gsl::narrow_cast<uint64_t>(pStatistics.tP99.count()), allocator);
+        vCheckpoint.AddMember("MaxUs", gsl::narrow_cast<uint64_t>(pStatistics.tMax.count()), allocator);
+        vCheckpoints.PushBack(vCheckpoint, allocator);
+
+        RA_LOG_INFO("%s: count=%u p50=%lldus p95=%lldus p99=%lldus max=%lldus", GetLabel(nCheckpoint),
+                    pStatistics.nCount, pStatistics.tP50.count(), pStatistics.tP95.count(),
+                    pStatistics.tP99.count(), pStatistics.tMax.count());
+    }
+
+    document.AddMember("Checkpoints", vCheckpoints, allocator);
+
+    auto& pLocalStorage = ServiceLocator::GetMutable<ILocalStorage>();
+    auto pWriter = pLocalStorage.WriteText(StorageItemType::PerformanceCounters, m_sExportKey);
+    if (pWriter != nullptr)
+        SaveDocument(document, *pWriter);
+}
+
+PerformanceTimer::PerformanceTimer(PerformanceCheckpoint nCheckpoint) noexcept
+    : m_nCheckpoint(nCheckpoint)
+{
+    if (ServiceLocator::Exists<PerformanceCounter>())
+    {
+        auto& pCounter = ServiceLocator::GetMutable<PerformanceCounter>();
+        if (pCounter.IsEnabled())
+            m_pCounter = &pCounter;
+    }
+
+    // the watchdog is always active, but only cares about the emulator thread
+    if (nCheckpoint == PerformanceCheckpoint::Frame || FrameWatchdog::IsFramePhase(nCheckpoint))
+    {
+        if (ServiceLocator::Exists<FrameWatchdog>())
+            m_pWatchdog = &ServiceLocator::GetMutable<FrameWatchdog>();
+    }
+
+    if (m_pCounter != nullptr || m_pWatchdog != nullptr)
+        m_tStart = std::chrono::steady_clock::now();
+}
+
+PerformanceTimer::~PerformanceTimer() noexcept
+{
+    if (m_pCounter == nullptr && m_pWatchdog == nullptr)
+        return;
+
+    const auto tElapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_tStart);
+
+    if (m_pCounter != nullptr)
+        m_pCounter->Record(m_nCheckpoint, tElapsed);
+
+    if (m_pWatchdog != nullptr)
+    {
+        if (m_nCheckpoint != PerformanceCheckpoint::Frame)
+        {
+            m_pWatchdog->RecordPhase(m_nCheckpoint, tElapsed);
+        }
+        else
         {
-            if (nLapTime > 2000) // to achieve 60 fps, emulator has to render ever 16ms, we don't want to use more than 2ms of that.
+            try
             {
-                RA_LOG("Outstanding lap: %d.%03d (avg: %d.%03d)", nLapTime / 1000, nLapTime % 1000, nLapAverage / 1000, nLapAverage % 1000);
-
-                for (gsl::index i = 0; i < ra::etoi(PerformanceCheckpoint::NUM_CHECKPOINTS); ++i)
-                {
-                    const auto nCheckpointTime = pLap.at(i);
-                    if (nCheckpointTime != 0)
-                        DumpCheckpoint(ra::itoe<PerformanceCheckpoint>(i), nCheckpointTime);
-                }
+                m_pWatchdog->EndFrame(tElapsed);
             }
-            else
+            catch (...)
             {
-                for (gsl::index i = 1; i < ra::etoi(PerformanceCheckpoint::NUM_CHECKPOINTS); ++i)
-                {
-                    const auto nCheckpointTime = pLap.at(i);
-                    if (nCheckpointTime > 75 && nCheckpointTime > m_nRollingTotals.at(i) * 2)
-                        DumpCheckpoint(ra::itoe<PerformanceCheckpoint>(i), nCheckpointTime);
-                }
+                // failing to report a slow frame isn't worth terminating over
             }
         }
     }
 }
 
-void PerformanceCounter::DumpCheckpoint(PerformanceCheckpoint nCheckpoint, int nCheckpointTime)
-{
-    const auto nCheckpointAverage = m_nRollingTotals.at(ra::etoi(nCheckpoint)) / NUM_LAPS;
-    RA_LOG(" %s: %d.%03d (avg: %d.%03d)", GetLabel(nCheckpoint), nCheckpointTime / 1000, nCheckpointTime % 1000, nCheckpointAverage / 1000, nCheckpointAverage % 1000);
-}
-
 } // namespace services
 } // namespace ra
-
-#endif // PERFORMANCE_COUNTERS
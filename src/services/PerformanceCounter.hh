@@ -2,10 +2,6 @@
 #define RA_SERVICES_PERFORMANCECOUNTER_H
 #pragma once
 
-#ifndef RA_UTEST
-//#define PERFORMANCE_COUNTERS
-#endif
-
 enum class PerformanceCheckpoint
 {
     RuntimeProcess = 0,
@@ -13,63 +9,134 @@ enum class PerformanceCheckpoint
     OverlayManagerAdvanceFrame,
     MemoryBookmarksDoFrame,
     MemoryInspectorDoFrame,
+    OverlayManagerRender,
+    MemorySearchFilter,
+    HttpRequest,
+    ImageDecode,
+    Frame,
 
     NUM_CHECKPOINTS
 };
 
-#ifdef PERFORMANCE_COUNTERS
-
-#include "services/ServiceLocator.hh"
-
 namespace ra {
 namespace services {
 
+/// <summary>
+/// Collects latency histograms for named checkpoints. Measurements are only collected while enabled, and
+/// <see cref="Record" /> is safe to call from any thread.
+/// </summary>
 class PerformanceCounter
 {
 public:
-    void Tally(PerformanceCheckpoint nCheckpoint);
+    explicit PerformanceCounter(const std::wstring& sExportKey) : m_sExportKey(sExportKey) {}
+    ~PerformanceCounter() noexcept = default;
+    PerformanceCounter(const PerformanceCounter&) noexcept = delete;
+    PerformanceCounter& operator=(const PerformanceCounter&) noexcept = delete;
+    PerformanceCounter(PerformanceCounter&&) noexcept = delete;
+    PerformanceCounter& operator=(PerformanceCounter&&) noexcept = delete;
+
+    /// <summary>
+    /// Determines whether measurements are being collected.
+    /// </summary>
+    bool IsEnabled() const noexcept { return m_bEnabled; }
+
+    /// <summary>
+    /// Starts or stops collecting measurements. Existing measurements are kept.
+    /// </summary>
+    void SetEnabled(bool bEnabled) noexcept { m_bEnabled = bEnabled; }
+
+    /// <summary>
+    /// Adds a measurement for a checkpoint.
+    /// </summary>
+    void Record(PerformanceCheckpoint nCheckpoint, std::chrono::microseconds tElapsed) noexcept;
+
+    /// <summary>
+    /// Indicates an emulated frame has been processed. Periodically exports the collected statistics.
+    /// </summary>
+    void EndFrame();
+
+    struct Statistics
+    {
+        unsigned int nCount = 0;
+        std::chrono::microseconds tTotal{};
+        std::chrono::microseconds tP50{};
+        std::chrono::microseconds tP95{};
+        std::chrono::microseconds tP99{};
+        std::chrono::microseconds tMax{};
+    };
 
-    void Stop();
+    /// <summary>
+    /// Gets the collected statistics for a checkpoint.
+    /// </summary>
+    /// <remarks>Percentiles are accurate to within ~3% of the actual value.</remarks>
+    Statistics GetStatistics(PerformanceCheckpoint nCheckpoint) const noexcept;
+
+    /// <summary>
+    /// Discards all collected measurements.
+    /// </summary>
+    void Reset() noexcept;
+
+    /// <summary>
+    /// Writes the collected statistics to local storage.
+    /// </summary>
+    void Export() const;
+
+    /// <summary>
+    /// Gets the name used to identify a checkpoint in the exported statistics.
+    /// </summary>
+    static const char* GetLabel(PerformanceCheckpoint nCheckpoint) noexcept;
+
+    static constexpr unsigned int EXPORT_INTERVAL_FRAMES = 3600; // about once a minute at 60fps
 
 private:
-    void DumpCheckpoint(PerformanceCheckpoint nCheckpoint, int nCheckpointTime);
+    // values below 2*SUB_BUCKET_COUNT get their own bucket. larger values are grouped by power of two, and each
+    // power of two is split into SUB_BUCKET_COUNT buckets.
+    static constexpr unsigned int SUB_BUCKET_BITS = 5;
+    static constexpr unsigned int SUB_BUCKET_COUNT = 1U << SUB_BUCKET_BITS;
+    static constexpr size_t NUM_BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static size_t GetBucket(unsigned int nMicroseconds) noexcept;
+    static unsigned int GetBucketMaximum(size_t nBucket) noexcept;
 
-    struct Measurement
+    struct Histogram
     {
-        Measurement(PerformanceCheckpoint nCheckpoint, std::chrono::steady_clock::time_point tWhen)
-        {
-            this->nCheckpoint = nCheckpoint;
-            this->tWhen = tWhen;
-        }
-
-        PerformanceCheckpoint nCheckpoint;
-        std::chrono::steady_clock::time_point tWhen;
+        std::array<std::atomic<unsigned int>, NUM_BUCKETS> vBuckets{};
+        std::atomic<unsigned int> nCount{0};
+        std::atomic<unsigned long long> nTotal{0};
+        std::atomic<unsigned int> nMax{0};
     };
 
-    std::vector<Measurement> m_vMeasurements;
+    std::array<Histogram, static_cast<size_t>(PerformanceCheckpoint::NUM_CHECKPOINTS)> m_vHistograms;
 
-    size_t m_nTotalLaps = 0;
-    
-    using Lap = std::array<int, static_cast<size_t>(PerformanceCheckpoint::NUM_CHECKPOINTS)>;
-    Lap m_nRollingTotals;
-    int m_nLapTotal;
-
-    static constexpr size_t NUM_LAPS = 3600; // once per minute, log overall averages
-    std::array<Lap, NUM_LAPS> m_vLaps;
-    gsl::index m_nNextLap = 0;
+    std::wstring m_sExportKey;
+    std::atomic_bool m_bEnabled{false};
+    unsigned int m_nFrames = 0;
 };
 
-} // namespace services
-} // namespace ra
+class FrameWatchdog;
 
-#define TALLY_PERFORMANCE(checkpoint) ra::services::ServiceLocator::GetMutable<ra::services::PerformanceCounter>().Tally(checkpoint)
-#define CHECK_PERFORMANCE() ra::services::ServiceLocator::GetMutable<ra::services::PerformanceCounter>().Stop()
-
-#else // PERFORMANCE_COUNTERS
+/// <summary>
+/// Records the time between construction and destruction against a checkpoint if the
+/// <see cref="PerformanceCounter" /> is enabled. Frame phases are also reported to the <see cref="FrameWatchdog" />.
+/// </summary>
+class PerformanceTimer
+{
+public:
+    explicit PerformanceTimer(PerformanceCheckpoint nCheckpoint) noexcept;
+    ~PerformanceTimer() noexcept;
+    PerformanceTimer(const PerformanceTimer&) noexcept = delete;
+    PerformanceTimer& operator=(const PerformanceTimer&) noexcept = delete;
+    PerformanceTimer(PerformanceTimer&&) noexcept = delete;
+    PerformanceTimer& operator=(PerformanceTimer&&) noexcept = delete;
 
-#define TALLY_PERFORMANCE(checkpoint) 
-#define CHECK_PERFORMANCE()
+private:
+    PerformanceCounter* m_pCounter = nullptr;
+    FrameWatchdog* m_pWatchdog = nullptr;
+    PerformanceCheckpoint m_nCheckpoint;
+    std::chrono::steady_clock::time_point m_tStart;
+};
 
-#endif // PERFORMANCE_COUNTERS
+} // namespace services
+} // namespace ra
 
-#endif !RA_SERVICES_PERFORMANCECOUNTER_H
+#endif // !RA_SERVICES_PERFORMANCECOUNTER_H
@@ -0,0 +1,251 @@
+#include "TaskHandle.hh"
+
+#include "services\IThreadPool.hh"
+
+namespace ra {
+namespace services {
+
+struct TaskHandle::State
+{
+    std::mutex mtxState;
+    std::condition_variable cvFinished;
+    Status nStatus = Status::Pending;
+
+    IThreadPool* pThreadPool = nullptr;
+    IThreadPool::ScheduledTaskId nScheduledTaskId = 0;
+    TaskPriority nPriority = TaskPriority::Interactive;
+    CancellationToken pToken;
+
+    // called with true when the task completes, or false if it's cancelled
+    std::vector<std::function<void(bool)>> vContinuations;
+};
+
+struct CancellationToken::State
+{
+    std::mutex mtxTasks;
+    std::atomic_bool bCancelled{false};
+    std::vector<std::weak_ptr<TaskHandle::State>> vTasks;
+};
+
+bool CancellationToken::IsCancellationRequested() const noexcept
+{
+    return m_pState != nullptr && m_pState->bCancelled;
+}
+
+CancellationTokenSource::CancellationTokenSource() : m_pState(std::make_shared<CancellationToken::State>()) {}
+
+void CancellationTokenSource::Cancel()
+{
+    if (m_pState == nullptr)
+        return;
+
+    std::vector<std::weak_ptr<TaskHandle::State>> vTasks;
+    {
+        std::lock_guard<std::mutex> lock(m_pState->mtxTasks);
+        if (m_pState->bCancelled)
+            return;
+
+        m_pState->bCancelled = true;
+        vTasks.swap(m_pState->vTasks);
+    }
+
+    for (auto& pWeakTask : vTasks)
+    {
+        auto pTask = pWeakTask.lock();
+        if (pTask != nullptr)
+            TaskHandle(pTask).Cancel();
+    }
+}
+
+std::shared_ptr<TaskHandle::State> TaskHandle::CreateState(IThreadPool& pThreadPool, const CancellationToken& pToken)
+{
+    auto pState = std::make_shared<State>();
+    pState->pThreadPool = &pThreadPool;
+    pState->pToken = pToken;
+
+    if (pToken.m_pState != nullptr)
+    {
+        auto& pTokenState = *pToken.m_pState;
+        std::lock_guard<std::mutex> lock(pTokenState.mtxTasks);
+        if (pTokenState.bCancelled)
+        {
+            pState->nStatus = Status::Cancelled;
+        }
+        else
+        {
+            // tasks that have finished (or been discarded) don't need to be tracked anymore
+            auto& vTasks = pTokenState.vTasks;
+            vTasks.erase(std::remove_if(vTasks.begin(), vTasks.end(),
+                                        [](const std::weak_ptr<State>& pTask) { return pTask.expired(); }),
+                         vTasks.end());
+
+            vTasks.emplace_back(pState);
+        }
+    }
+
+    return pState;
+}
+
+TaskHandle TaskHandle::Queue(IThreadPool& pThreadPool, std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                             const CancellationToken& pToken, TaskPriority nPriority, bool bScheduled)
+{
+    auto pState = CreateState(pThreadPool, pToken);
+    if (pState->nStatus == Status::Cancelled)
+        return TaskHandle(pState);
+
+    pState->nPriority = nPriority;
+
+    auto fRun = [pState, f = std::move(f)]() { Execute(*pState, f); };
+
+    if (!bScheduled)
+    {
+        pThreadPool.RunAsync(std::move(fRun), nPriority);
+    }
+    else
+    {
+        const auto nId = pThreadPool.ScheduleAsync(nDelay, std::move(fRun), nPriority);
+
+        // if the task was cancelled before we got the id, it won't do anything when it's executed
+        std::lock_guard<std::mutex> lock(pState->mtxState);
+        if (pState->nStatus == Status::Pending)
+            pState->nScheduledTaskId = nId;
+    }
+
+    return TaskHandle(pState);
+}
+
+bool TaskHandle::Transition(State& pState, Status nFrom, Status nTo)
+{
+    std::vector<std::function<void(bool)>> vContinuations;
+    {
+        std::lock_guard<std::mutex> lock(pState.mtxState);
+        if (pState.nStatus != nFrom)
+            return false;
+
+        pState.nStatus = nTo;
+        if (nTo == Status::Running)
+            return true;
+
+        vContinuations.swap(pState.vContinuations);
+    }
+
+    pState.cvFinished.notify_all();
+
+    for (auto& fContinuation : vContinuations)
+        fContinuation(nTo == Status::Completed);
+
+    return true;
+}
+
+void TaskHandle::Execute(State& pState, const std::function<void()>& f)
+{
+    if (!Transition(pState, Status::Pending, Status::Running))
+        return;
+
+    try
+    {
+        f();
+    }
+    catch (...)
+    {
+        Transition(pState, Status::Running, Status::Completed);
+        throw;
+    }
+
+    Transition(pState, Status::Running, Status::Completed);
+}
+
+bool TaskHandle::IsCompleted() const
+{
+    if (m_pState == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_pState->mtxState);
+    return (m_pState->nStatus == Status::Completed);
+}
+
+bool TaskHandle::IsCancelled() const
+{
+    if (m_pState == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_pState->mtxState);
+    return (m_pState->nStatus == Status::Cancelled);
+}
+
+bool TaskHandle::Cancel()
+{
+    if (m_pState == nullptr)
+        return false;
+
+    if (!Transition(*m_pState, Status::Pending, Status::Cancelled))
+        return false;
+
+    IThreadPool::ScheduledTaskId nScheduledTaskId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_pState->mtxState);
+        nScheduledTaskId = m_pState->nScheduledTaskId;
+    }
+
+    // remove the task from the schedule so it doesn't wake up a thread just to be ignored
+    if (nScheduledTaskId != 0)
+        m_pState->pThreadPool->CancelScheduledTask(nScheduledTaskId);
+
+    return true;
+}
+
+bool TaskHandle::Wait(std::chrono::milliseconds tTimeout) const
+{
+    if (m_pState == nullptr)
+        return true;
+
+    std::unique_lock<std::mutex> lock(m_pState->mtxState);
+    return m_pState->cvFinished.wait_for(lock, tTimeout, [this]() noexcept {
+        return (m_pState->nStatus == Status::Completed || m_pState->nStatus == Status::Cancelled);
+    });
+}
+
+TaskHandle TaskHandle::ContinueWith(std::function<void()>&& f)
+{
+    if (m_pState == nullptr)
+        return TaskHandle();
+
+    auto pContinuation = CreateState(*m_pState->pThreadPool, m_pState->pToken);
+    pContinuation->nPriority = m_pState->nPriority;
+    auto fContinuation = [pContinuation, f = std::move(f)](bool bCompleted)
+    {
+        if (bCompleted)
+            pContinuation->pThreadPool->RunAsync([pContinuation, f]() { Execute(*pContinuation, f); },
+                                                 pContinuation->nPriority);
+        else
+            Transition(*pContinuation, Status::Pending, Status::Cancelled);
+    };
+
+    bool bFinished = false;
+    bool bCompleted = false;
+    {
+        std::lock_guard<std::mutex> lock(m_pState->mtxState);
+        switch (m_pState->nStatus)
+        {
+            case Status::Completed:
+                bFinished = bCompleted = true;
+                break;
+
+            case Status::Cancelled:
+                bFinished = true;
+                break;
+
+            default:
+                m_pState->vContinuations.emplace_back(fContinuation);
+                break;
+        }
+    }
+
+    if (bFinished)
+        fContinuation(bCompleted);
+
+    return TaskHandle(pContinuation);
+}
+
+} // namespace services
+} // namespace ra
@@ -0,0 +1,133 @@
+#ifndef RA_SERVICES_TASKHANDLE_HH
+#define RA_SERVICES_TASKHANDLE_HH
+#pragma once
+
+namespace ra {
+namespace services {
+
+class IThreadPool;
+class TaskHandle;
+enum class TaskPriority;
+
+/// <summary>
+/// Allows work associated to a <see cref="CancellationTokenSource" /> to determine if it should be abandoned.
+/// </summary>
+/// <remarks>A default constructed token can never be cancelled.</remarks>
+class CancellationToken
+{
+public:
+    CancellationToken() noexcept = default;
+
+    /// <summary>
+    /// Determines whether the associated <see cref="CancellationTokenSource" /> has been cancelled.
+    /// </summary>
+    bool IsCancellationRequested() const noexcept;
+
+private:
+    friend class CancellationTokenSource;
+    friend class TaskHandle;
+
+    struct State;
+    explicit CancellationToken(std::shared_ptr<State> pState) noexcept : m_pState(std::move(pState)) {}
+
+    std::shared_ptr<State> m_pState;
+};
+
+/// <summary>
+/// Cancels a group of tasks with a single call.
+/// </summary>
+class CancellationTokenSource
+{
+public:
+    GSL_SUPPRESS_F6 CancellationTokenSource();
+    ~CancellationTokenSource() noexcept = default;
+    CancellationTokenSource(const CancellationTokenSource&) noexcept = delete;
+    CancellationTokenSource& operator=(const CancellationTokenSource&) noexcept = delete;
+    CancellationTokenSource(CancellationTokenSource&&) noexcept = default;
+    CancellationTokenSource& operator=(CancellationTokenSource&&) noexcept = default;
+
+    /// <summary>
+    /// Gets a token to associate work to this source.
+    /// </summary>
+    CancellationToken Token() const noexcept { return CancellationToken(m_pState); }
+
+    /// <summary>
+    /// Cancels all tasks associated to this source that have not started yet. Tasks that are already running can
+    /// check <see cref="CancellationToken::IsCancellationRequested" /> to stop early.
+    /// </summary>
+    void Cancel();
+
+    /// <summary>
+    /// Determines whether <see cref="Cancel" /> has been called.
+    /// </summary>
+    bool IsCancellationRequested() const noexcept { return Token().IsCancellationRequested(); }
+
+private:
+    std::shared_ptr<CancellationToken::State> m_pState;
+};
+
+/// <summary>
+/// Tracks work queued through <see cref="IThreadPool::RunTaskAsync" /> or <see cref="IThreadPool::ScheduleTaskAsync" />.
+/// </summary>
+/// <remarks>A default constructed handle does not refer to any work.</remarks>
+class TaskHandle
+{
+public:
+    TaskHandle() noexcept = default;
+
+    /// <summary>
+    /// Determines whether the task has finished running.
+    /// </summary>
+    bool IsCompleted() const;
+
+    /// <summary>
+    /// Determines whether the task was cancelled before it started.
+    /// </summary>
+    bool IsCancelled() const;
+
+    /// <summary>
+    /// Prevents the task from running. Scheduled tasks are removed from the thread pool.
+    /// </summary>
+    /// <returns><c>true</c> if the task was cancelled, <c>false</c> if it has already started.</returns>
+    bool Cancel();
+
+    /// <summary>
+    /// Waits for the task to complete or be cancelled.
+    /// </summary>
+    /// <returns><c>true</c> if the task finished, <c>false</c> if the timeout elapsed first.</returns>
+    bool Wait(std::chrono::milliseconds tTimeout) const;
+
+    /// <summary>
+    /// Queues work to run after this task completes. If this task is cancelled, the continuation is also cancelled.
+    /// </summary>
+    TaskHandle ContinueWith(std::function<void()>&& f);
+
+private:
+    friend class IThreadPool;
+    friend class CancellationToken;
+    friend class CancellationTokenSource;
+
+    struct State;
+    explicit TaskHandle(std::shared_ptr<State> pState) noexcept : m_pState(std::move(pState)) {}
+
+    static TaskHandle Queue(IThreadPool& pThreadPool, std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                            const CancellationToken& pToken, TaskPriority nPriority, bool bScheduled);
+    static std::shared_ptr<State> CreateState(IThreadPool& pThreadPool, const CancellationToken& pToken);
+    static void Execute(State& pState, const std::function<void()>& f);
+
+    enum class Status
+    {
+        Pending,
+        Running,
+        Completed,
+        Cancelled,
+    };
+    static bool Transition(State& pState, Status nFrom, Status nTo);
+
+    std::shared_ptr<State> m_pState;
+};
+
+} // namespace services
+} // namespace ra
+
+#endif // !RA_SERVICES_TASKHANDLE_HH
@@ -0,0 +1,200 @@
+#include "Tracer.hh"
+
+#include "services\ILocalStorage.hh"
+#include "services\ServiceLocator.hh"
+
+namespace ra {
+namespace services {
+
+static std::atomic<unsigned int> s_nNextTracerInstanceId{0};
+
+Tracer::Tracer(const std::wstring& sExportKey)
+    : m_nInstanceId(++s_nNextTracerInstanceId), m_tStart(std::chrono::steady_clock::now()), m_sExportKey(sExportKey)
+{
+}
+
+Tracer::Ring& Tracer::GetRing()
+{
+    // cache the ring for the current thread so the lock is only taken the first time a thread records an event.
+    // the instance id (rather than the pointer) is cached in case a new tracer is allocated at the same address.
+    static thread_local unsigned int s_nRingInstanceId = 0;
+    static thread_local Ring* s_pRing = nullptr;
+    if (s_nRingInstanceId == m_nInstanceId && s_pRing != nullptr)
+        return *s_pRing;
+
+    const auto nThreadId = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> lock(m_mtxRings);
+    for (auto& pRing : m_vRings)
+    {
+        if (pRing->tThreadId == nThreadId)
+        {
+            s_nRingInstanceId = m_nInstanceId;
+            s_pRing = pRing.get();
+            return *s_pRing;
+        }
+    }
+
+    auto& pRing = m_vRings.emplace_back(std::make_unique<Ring>());
+    pRing->tThreadId = nThreadId;
+    pRing->nThreadId = gsl::narrow_cast<unsigned int>(m_vRings.size());
+
+    s_nRingInstanceId = m_nInstanceId;
+    s_pRing = pRing.get();
+    return *s_pRing;
+}
+
+void Tracer::AddEvent(char cPhase, const char* sName, unsigned long long nFlowId)
+{
+    if (!m_bEnabled)
+        return;
+
+    const auto tElapsed = std::chrono::steady_clock::now() - m_tStart;
+
+    // only the owning thread writes to a ring, so the index only has to be published after the event is written.
+    // the slot is marked incomplete before it's overwritten so a concurrent Write will skip it.
+    auto& pRing = GetRing();
+    const auto nIndex = pRing.nWriteIndex.load(std::memory_order_relaxed);
+    auto& pEvent = pRing.vEvents.at(nIndex % RING_CAPACITY);
+    pEvent.nSequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    pEvent.sName.store(sName, std::memory_order_relaxed);
+    pEvent.nTimestamp.store(std::chrono::duration_cast<std::chrono::microseconds>(tElapsed).count(),
+                            std::memory_order_relaxed);
+    pEvent.nFlowId.store(nFlowId, std::memory_order_relaxed);
+    pEvent.cPhase.store(cPhase, std::memory_order_relaxed);
+    pEvent.nSequence.store(nIndex + 1, std::memory_order_release);
+    pRing.nWriteIndex.store(nIndex + 1, std::memory_order_release);
+}
+
+unsigned long long Tracer::BeginFlow(const char* sName)
+{
+    const auto nFlowId = ++m_nNextFlowId;
+    AddEvent('s', sName, nFlowId);
+    return nFlowId;
+}
+
+void Tracer::SetThreadName(const std::string& sName)
+{
+    auto& pRing = GetRing();
+
+    std::lock_guard<std::mutex> lock(m_mtxRings);
+    pRing.sThreadName = sName;
+}
+
+void Tracer::Write(TextWriter& pWriter) const
+{
+    rapidjson::StringBuffer oBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> oWriter(oBuffer);
+
+    oWriter.StartObject();
+    oWriter.Key("traceEvents");
+    oWriter.StartArray();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mtxRings);
+        for (const auto& pRing : m_vRings)
+        {
+            if (!pRing->sThreadName.empty())
+            {
+                oWriter.StartObject();
+                oWriter.Key("name"); oWriter.String("thread_name");
+                oWriter.Key("ph"); oWriter.String("M");
+                oWriter.Key("pid"); oWriter.Uint(1);
+                oWriter.Key("tid"); oWriter.Uint(pRing->nThreadId);
+                oWriter.Key("args");
+                oWriter.StartObject();
+                oWriter.Key("name"); oWriter.String(pRing->sThreadName.c_str());
+                oWriter.EndObject();
+                oWriter.EndObject();
+            }
+
+            // the owning thread may still be writing. copy each event out and skip any that were overwritten
+            // before or while they were copied.
+            const auto nWriteIndex = pRing->nWriteIndex.load(std::memory_order_acquire);
+            const auto nFirstIndex = (nWriteIndex > RING_CAPACITY) ? nWriteIndex - RING_CAPACITY : 0;
+            for (auto nIndex = nFirstIndex; nIndex < nWriteIndex; ++nIndex)
+            {
+                const auto& pEvent = pRing->vEvents.at(nIndex % RING_CAPACITY);
+                if (pEvent.nSequence.load(std::memory_order_acquire) != nIndex + 1)
+                    continue;
+
+                const char* sName = pEvent.sName.load(std::memory_order_relaxed);
+                const auto nTimestamp = pEvent.nTimestamp.load(std::memory_order_relaxed);
+                const auto nFlowId = pEvent.nFlowId.load(std::memory_order_relaxed);
+                const char cPhase = pEvent.cPhase.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (pEvent.nSequence.load(std::memory_order_relaxed) != nIndex + 1)
+                    continue;
+
+                GSL_SUPPRESS_CON4 char sEventPhase[2] = {cPhase, '\0'};
+
+                oWriter.StartObject();
+                oWriter.Key("name"); oWriter.String(sName);
+                oWriter.Key("cat"); oWriter.String("RA");
+                oWriter.Key("ph"); oWriter.String(sEventPhase);
+                oWriter.Key("ts"); oWriter.Int64(nTimestamp);
+                oWriter.Key("pid"); oWriter.Uint(1);
+                oWriter.Key("tid"); oWriter.Uint(pRing->nThreadId);
+                if (nFlowId != 0)
+                {
+                    oWriter.Key("id"); oWriter.Uint64(nFlowId);
+
+                    // bind the end of the flow to the span that encloses it
+                    if (cPhase == 'f')
+                    {
+                        oWriter.Key("bp"); oWriter.String("e");
+                    }
+                }
+                oWriter.EndObject();
+            }
+        }
+    }
+
+    oWriter.EndArray();
+    oWriter.Key("displayTimeUnit"); oWriter.String("ms");
+    oWriter.EndObject();
+
+    pWriter.Write(std::string(oBuffer.GetString(), oBuffer.GetSize()));
+}
+
+void Tracer::Export() const
+{
+    auto& pLocalStorage = ServiceLocator::GetMutable<ILocalStorage>();
+    auto pWriter = pLocalStorage.WriteText(StorageItemType::Trace, m_sExportKey);
+    if (pWriter != nullptr)
+        Write(*pWriter);
+}
+
+Tracer* TraceSpan::GetActiveTracer() noexcept
+{
+    if (!ServiceLocator::Exists<Tracer>())
+        return nullptr;
+
+    auto& pTracer = ServiceLocator::GetMutable<Tracer>();
+    return pTracer.IsEnabled() ? &pTracer : nullptr;
+}
+
+TraceSpan::TraceSpan(const char* sName) : m_pTracer(GetActiveTracer()), m_sName(sName)
+{
+    if (m_pTracer != nullptr)
+        m_pTracer->BeginSpan(m_sName);
+}
+
+TraceSpan::~TraceSpan() noexcept
+{
+    if (m_pTracer != nullptr)
+    {
+        try
+        {
+            m_pTracer->EndSpan(m_sName);
+        }
+        catch (...)
+        {
+            // a missing end event isn't worth terminating over
+        }
+    }
+}
+
+} // namespace services
+} // namespace ra
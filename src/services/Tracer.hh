@@ -0,0 +1,136 @@
+#ifndef RA_SERVICES_TRACER_HH
+#define RA_SERVICES_TRACER_HH
+#pragma once
+
+#include "services\TextWriter.hh"
+
+namespace ra {
+namespace services {
+
+/// <summary>
+/// Records spans and flows from any thread so they can be exported in the Chrome trace_event format.
+/// </summary>
+/// <remarks>
+/// Each thread writes to its own fixed-size ring, so recording never blocks and only the most recent
+/// <see cref="RING_CAPACITY" /> events for each thread are kept. Event names must be string literals.
+/// </remarks>
+class Tracer
+{
+public:
+    explicit Tracer(const std::wstring& sExportKey);
+    ~Tracer() noexcept = default;
+    Tracer(const Tracer&) noexcept = delete;
+    Tracer& operator=(const Tracer&) noexcept = delete;
+    Tracer(Tracer&&) noexcept = delete;
+    Tracer& operator=(Tracer&&) noexcept = delete;
+
+    /// <summary>
+    /// Determines whether events are being recorded.
+    /// </summary>
+    bool IsEnabled() const noexcept { return m_bEnabled; }
+
+    /// <summary>
+    /// Starts or stops recording events. Previously recorded events are kept.
+    /// </summary>
+    void SetEnabled(bool bEnabled) noexcept { m_bEnabled = bEnabled; }
+
+    /// <summary>
+    /// Records the start of a span on the current thread.
+    /// </summary>
+    void BeginSpan(const char* sName) { AddEvent('B', sName, 0); }
+
+    /// <summary>
+    /// Records the end of the most recent span on the current thread.
+    /// </summary>
+    void EndSpan(const char* sName) { AddEvent('E', sName, 0); }
+
+    /// <summary>
+    /// Records the start of work that will continue on another thread.
+    /// </summary>
+    /// <returns>Identifier to pass to <see cref="EndFlow" /> on the thread that continues the work.</returns>
+    unsigned long long BeginFlow(const char* sName);
+
+    /// <summary>
+    /// Records where work started by <see cref="BeginFlow" /> was picked up.
+    /// </summary>
+    void EndFlow(const char* sName, unsigned long long nFlowId) { AddEvent('f', sName, nFlowId); }
+
+    /// <summary>
+    /// Sets the name shown for the current thread in the exported trace.
+    /// </summary>
+    void SetThreadName(const std::string& sName);
+
+    /// <summary>
+    /// Writes the recorded events as Chrome trace_event JSON.
+    /// </summary>
+    void Write(TextWriter& pWriter) const;
+
+    /// <summary>
+    /// Writes the recorded events to local storage.
+    /// </summary>
+    void Export() const;
+
+    static constexpr size_t RING_CAPACITY = 8192;
+
+private:
+    // the owning thread may overwrite an event while Write is reading it. each field is atomic and nSequence
+    // holds the write index + 1 once the event is complete (0 while it's being written), so a reader can detect
+    // and skip an event that changed underneath it.
+    struct Event
+    {
+        std::atomic<size_t> nSequence;
+        std::atomic<const char*> sName;
+        std::atomic<long long> nTimestamp; // microseconds since the tracer was created
+        std::atomic<unsigned long long> nFlowId;
+        std::atomic<char> cPhase;
+    };
+
+    struct Ring
+    {
+        std::array<Event, RING_CAPACITY> vEvents{};
+        std::atomic<size_t> nWriteIndex{0};
+        std::thread::id tThreadId;
+        unsigned int nThreadId = 0;
+        std::string sThreadName;
+    };
+
+    void AddEvent(char cPhase, const char* sName, unsigned long long nFlowId);
+    Ring& GetRing();
+
+    const unsigned int m_nInstanceId;
+    const std::chrono::steady_clock::time_point m_tStart;
+    std::wstring m_sExportKey;
+    std::atomic_bool m_bEnabled{false};
+    std::atomic<unsigned long long> m_nNextFlowId{0};
+
+    mutable std::mutex m_mtxRings;
+    std::vector<std::unique_ptr<Ring>> m_vRings;
+};
+
+/// <summary>
+/// Records a span from construction to destruction if the <see cref="Tracer" /> is enabled.
+/// </summary>
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* sName);
+    ~TraceSpan() noexcept;
+    TraceSpan(const TraceSpan&) noexcept = delete;
+    TraceSpan& operator=(const TraceSpan&) noexcept = delete;
+    TraceSpan(TraceSpan&&) noexcept = delete;
+    TraceSpan& operator=(TraceSpan&&) noexcept = delete;
+
+    /// <summary>
+    /// Gets the <see cref="Tracer" /> if one exists and is enabled.
+    /// </summary>
+    static Tracer* GetActiveTracer() noexcept;
+
+private:
+    Tracer* m_pTracer = nullptr;
+    const char* m_sName;
+};
+
+} // namespace services
+} // namespace ra
+
+#endif // !RA_SERVICES_TRACER_HH
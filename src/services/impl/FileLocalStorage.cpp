@@ -7,7 +7,10 @@
 
 #include "services\IClock.hh"
 #include "services\IFileSystem.hh"
+#include "services\IThreadPool.hh"
 #include "services\ServiceLocator.hh"
+#include "services\impl\StringTextReader.hh"
+#include "services\impl\StringTextWriter.hh"
 
 namespace ra {
 namespace services {
@@ -19,47 +22,213 @@ _CONSTANT_VAR RA_DIR_DATA = L"RACache\\Data\\";
 _CONSTANT_VAR RA_DIR_USERPIC = L"RACache\\UserPic\\";
 _CONSTANT_VAR RA_DIR_BOOKMARKS = L"RACache\\Bookmarks\\";
 
-static void PrepareDirectory(const ra::services::IFileSystem& pFileSystem, const std::wstring& sDirectory, bool bExpireOldFiles)
+_CONSTANT_VAR RA_FILE_LAST_SWEEP = L"RACache\\LastCacheSweep.txt";
+_CONSTANT_VAR RA_FILE_IMAGE_PACK = L"RACache\\Images.pack";
+
+static void PrepareDirectory(const ra::services::IFileSystem& pFileSystem, const std::wstring& sDirectory)
 {
     if (!pFileSystem.DirectoryExists(sDirectory))
-    {
         pFileSystem.CreateDirectory(sDirectory);
-    }
-    else if (bExpireOldFiles)
+}
+
+FileLocalStorage::FileLocalStorage(IFileSystem& pFileSystem)
+    : m_pFileSystem(pFileSystem)
+{
+    // Ensure all required directories are created. Old files are cleaned up later by ScheduleCacheMaintenance.
+    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_BASE);
+    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_BADGE);
+    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_DATA);
+    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_USERPIC);
+    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_BOOKMARKS);
+}
+
+struct FileLocalStorage::CacheSweep
+{
+    struct CachedFile
+    {
+        std::wstring sPath;
+        int64_t nSize;
+        std::chrono::system_clock::time_point tLastModified;
+        std::string sPackKey; // set instead of sPath for entries in the image pack
+    };
+
+    std::chrono::system_clock::time_point tExpire;
+    size_t nDirectoryIndex = 0;
+    StorageItemType nType = StorageItemType::None;
+    std::wstring sDirectory;
+    std::vector<std::wstring> vFiles;
+    size_t nFileIndex = 0;
+
+    std::vector<CachedFile> vCachedFiles;
+    int64_t nTotalSize = 0;
+    size_t nExpiredFiles = 0;
+    size_t nPackedFiles = 0;
+};
+
+// only directories containing data that can be refetched from the server are swept
+struct CacheDirectory
+{
+    const wchar_t* sDirectory;
+    StorageItemType nType;
+};
+static const std::array<CacheDirectory, 3> CACHE_DIRECTORIES = {{
+    {RA_DIR_BADGE, StorageItemType::Badge},
+    {RA_DIR_USERPIC, StorageItemType::UserPic},
+    {RA_DIR_DATA, StorageItemType::None},
+}};
+
+void FileLocalStorage::ScheduleCacheMaintenance()
+{
+    // wait a bit so the sweep doesn't compete with loading the game
+    ServiceLocator::GetMutable<IThreadPool>().ScheduleAsync(SWEEP_DELAY, [this]() { BeginSweep(); }, TaskPriority::Idle);
+}
+
+void FileLocalStorage::BeginSweep()
+{
+    const auto tNow = ServiceLocator::Get<IClock>().Now();
+    const std::wstring sMarkerPath = m_pFileSystem.BaseDirectory() + RA_FILE_LAST_SWEEP;
+
+    auto pReader = m_pFileSystem.OpenTextFile(sMarkerPath);
+    if (pReader != nullptr)
     {
-        std::vector<std::wstring> vFiles;
-        if (pFileSystem.GetFilesInDirectory(sDirectory, vFiles) > 0)
+        std::string sLine;
+        if (pReader->GetLine(sLine))
         {
-            const auto& pClock = ServiceLocator::Get<IClock>();
-            const auto tExpire = pClock.Now() - std::chrono::hours(24 * 30); // 30 days
-            std::wstring sPath;
+            const auto tLastSweep = std::chrono::system_clock::from_time_t(
+                gsl::narrow_cast<time_t>(std::strtoll(sLine.c_str(), nullptr, 10)));
+            if (tNow - tLastSweep < SWEEP_INTERVAL)
+                return;
+        }
+    }
+
+    auto pSweep = std::make_shared<CacheSweep>();
+    pSweep->tExpire = tNow - EXPIRE_AGE;
+    ContinueSweep(pSweep);
+}
 
-            for (const auto& sFile : vFiles)
+void FileLocalStorage::ContinueSweep(std::shared_ptr<CacheSweep> pSweep)
+{
+    // only examine a few files at a time so other idle work isn't blocked for long
+    for (size_t nProcessed = 0; nProcessed < FILES_PER_TASK; ++nProcessed)
+    {
+        if (pSweep->nFileIndex == pSweep->vFiles.size())
+        {
+            if (pSweep->nDirectoryIndex == CACHE_DIRECTORIES.size())
             {
-                sPath = sDirectory;
-                sPath += sFile;
-
-                // check to see if the file is older than the threshhold
-                if (pFileSystem.GetLastModified(sPath) < tExpire)
-                {
-                    // if it's not a user file, it can be refetched from the server, delete it
-                    if (!ra::StringEndsWith(sFile, L"-User.txt"))
-                        pFileSystem.DeleteFile(sPath);
-                }
+                FinishSweep(*pSweep);
+                return;
             }
+
+            const auto& pDirectory = CACHE_DIRECTORIES.at(pSweep->nDirectoryIndex++);
+            pSweep->sDirectory = m_pFileSystem.BaseDirectory() + pDirectory.sDirectory;
+            pSweep->nType = pDirectory.nType;
+            pSweep->vFiles.clear();
+            pSweep->nFileIndex = 0;
+            m_pFileSystem.GetFilesInDirectory(pSweep->sDirectory, pSweep->vFiles);
+            continue;
+        }
+
+        const auto& sFile = pSweep->vFiles.at(pSweep->nFileIndex++);
+
+        // user files can't be refetched from the server, never delete them
+        if (ra::StringEndsWith(sFile, L"-User.txt"))
+            continue;
+
+        std::wstring sPath = pSweep->sDirectory + sFile;
+        const auto tLastModified = m_pFileSystem.GetLastModified(sPath);
+        if (tLastModified < pSweep->tExpire)
+        {
+            m_pFileSystem.DeleteFile(sPath);
+            ++pSweep->nExpiredFiles;
+            continue;
+        }
+
+        // move loose images into the pack. icons ("i" prefix) are not managed by the local storage.
+        if (m_pImagePack != nullptr && IsPackedType(pSweep->nType) && sFile.front() != L'i' &&
+            ra::StringEndsWith(sFile, L".png"))
+        {
+            const std::wstring sKey(sFile, 0, sFile.length() - 4);
+            if (m_pImagePack->Contains(GetPackKey(pSweep->nType, sKey)))
+                m_pFileSystem.DeleteFile(sPath); // pack already has a newer copy
+            else
+                MoveToPack(pSweep->nType, sKey);
+
+            ++pSweep->nPackedFiles;
+            continue;
+        }
+
+        const auto nSize = m_pFileSystem.GetFileSize(sPath);
+        if (nSize > 0)
+        {
+            pSweep->nTotalSize += nSize;
+            pSweep->vCachedFiles.push_back({std::move(sPath), nSize, tLastModified, std::string()});
         }
     }
+
+    auto& pThreadPool = ServiceLocator::GetMutable<IThreadPool>();
+    if (!pThreadPool.IsShutdownRequested())
+        pThreadPool.RunAsync([this, pSweep]() { ContinueSweep(pSweep); }, TaskPriority::Idle);
 }
 
-FileLocalStorage::FileLocalStorage(IFileSystem& pFileSystem)
-    : m_pFileSystem(pFileSystem)
+void FileLocalStorage::FinishSweep(CacheSweep& pSweep)
 {
-    // Ensure all required directories are created
-    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_BASE, false);
-    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_BADGE, true);
-    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_DATA, true);
-    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_USERPIC, true);
-    PrepareDirectory(pFileSystem, pFileSystem.BaseDirectory() + RA_DIR_BOOKMARKS, false);
+    if (m_pImagePack != nullptr)
+    {
+        for (auto& pEntry : m_pImagePack->GetEntries())
+        {
+            if (pEntry.tLastModified < pSweep.tExpire)
+            {
+                m_pImagePack->Remove(pEntry.sKey);
+                ++pSweep.nExpiredFiles;
+                continue;
+            }
+
+            pSweep.nTotalSize += pEntry.nSize;
+            pSweep.vCachedFiles.push_back({std::wstring(), pEntry.nSize, pEntry.tLastModified, std::move(pEntry.sKey)});
+        }
+    }
+
+    // if the cache is still too large, discard the least recently updated files
+    size_t nTrimmedFiles = 0;
+    if (pSweep.nTotalSize > MAX_CACHE_SIZE)
+    {
+        std::sort(pSweep.vCachedFiles.begin(), pSweep.vCachedFiles.end(),
+            [](const CacheSweep::CachedFile& pLeft, const CacheSweep::CachedFile& pRight) noexcept {
+                return pLeft.tLastModified < pRight.tLastModified;
+            });
+
+        for (const auto& pFile : pSweep.vCachedFiles)
+        {
+            if (pSweep.nTotalSize <= MAX_CACHE_SIZE)
+                break;
+
+            if (!pFile.sPackKey.empty())
+                m_pImagePack->Remove(pFile.sPackKey);
+            else if (!m_pFileSystem.DeleteFile(pFile.sPath))
+                continue;
+
+            pSweep.nTotalSize -= pFile.nSize;
+            ++nTrimmedFiles;
+        }
+    }
+
+    RA_LOG_INFO("Cache sweep removed %zu expired files and %zu files over the size limit (%lld bytes remaining)",
+                pSweep.nExpiredFiles, nTrimmedFiles, pSweep.nTotalSize);
+
+    if (m_pImagePack != nullptr)
+    {
+        if (pSweep.nPackedFiles > 0)
+            RA_LOG_INFO("Moved %zu images into the image pack", pSweep.nPackedFiles);
+
+        if (m_pImagePack->NeedsCompaction())
+            m_pImagePack->Compact();
+    }
+
+    // remember when the sweep finished so it isn't repeated on every startup
+    const auto tNow = ServiceLocator::Get<IClock>().Now();
+    auto pWriter = m_pFileSystem.CreateTextFile(m_pFileSystem.BaseDirectory() + RA_FILE_LAST_SWEEP);
+    if (pWriter != nullptr)
+        pWriter->Write(std::to_string(std::chrono::system_clock::to_time_t(tNow)));
 }
 
 std::wstring FileLocalStorage::GetPath(StorageItemType nType, const std::wstring& sKey) const
@@ -117,6 +286,24 @@ std::wstring FileLocalStorage::GetPath(StorageItemType nType, const std::wstring
             sPath.append(L"-Bookmarks.json");
             break;
 
+        case StorageItemType::PendingSubmissions:
+            sPath.append(RA_DIR_BASE);
+            sPath.append(sKey);
+            sPath.append(L"-pending.txt");
+            break;
+
+        case StorageItemType::PerformanceCounters:
+            sPath.append(RA_DIR_BASE);
+            sPath.append(sKey);
+            sPath.append(L"-performance.json");
+            break;
+
+        case StorageItemType::Trace:
+            sPath.append(RA_DIR_BASE);
+            sPath.append(sKey);
+            sPath.append(L"-trace.json");
+            break;
+
         default:
             assert(!"unhandled StorageItemType");
             sPath.append(RA_DIR_DATA);
@@ -128,13 +315,126 @@ std::wstring FileLocalStorage::GetPath(StorageItemType nType, const std::wstring
     return sPath;
 }
 
+bool FileLocalStorage::EnableImagePack()
+{
+    auto pImagePack = std::make_unique<PackedFileStore>(m_pFileSystem, m_pFileSystem.BaseDirectory() + RA_FILE_IMAGE_PACK);
+    if (!pImagePack->Open())
+    {
+        RA_LOG_ERR("Could not open image pack. Using individual files.");
+        return false;
+    }
+
+    m_pImagePack = std::move(pImagePack);
+    return true;
+}
+
+bool FileLocalStorage::IsPackedType(StorageItemType nType) noexcept
+{
+    return (nType == StorageItemType::Badge || nType == StorageItemType::UserPic);
+}
+
+std::string FileLocalStorage::GetPackKey(StorageItemType nType, const std::wstring& sKey)
+{
+    std::string sPackKey = (nType == StorageItemType::Badge) ? "Badge/" : "UserPic/";
+    sPackKey.append(ra::Narrow(sKey));
+    return sPackKey;
+}
+
+bool FileLocalStorage::MoveToPack(StorageItemType nType, const std::wstring& sKey)
+{
+    const std::wstring sPath = GetPath(nType, sKey);
+    if (m_pFileSystem.GetFileSize(sPath) <= 0)
+        return false;
+
+    std::string sData;
+    {
+        auto pReader = m_pFileSystem.OpenTextFile(sPath);
+        if (pReader == nullptr)
+            return false;
+
+        sData.resize(pReader->GetSize());
+        uint8_t* pData;
+        GSL_SUPPRESS_TYPE1 pData = reinterpret_cast<uint8_t*>(sData.data());
+        if (pReader->GetBytes(pData, sData.length()) != sData.length())
+            return false;
+    }
+
+    // keep the original timestamp so the image expires when the file would have
+    m_pImagePack->Write(GetPackKey(nType, sKey), sData, m_pFileSystem.GetLastModified(sPath));
+    m_pFileSystem.DeleteFile(sPath);
+    return true;
+}
+
+class PackedTextWriter : public StringTextWriter
+{
+public:
+    explicit PackedTextWriter(PackedFileStore& pPack, const std::string& sKey)
+        : m_pPack(pPack), m_sKey(sKey)
+    {
+    }
+
+    GSL_SUPPRESS_F6 ~PackedTextWriter() noexcept
+    {
+        // the pack only accepts complete entries, so write the data when the writer is released
+        try
+        {
+            m_pPack.Write(m_sKey, GetString(), ServiceLocator::Get<IClock>().Now());
+        }
+        catch (...)
+        {
+            // the data will be refetched the next time it's needed
+        }
+    }
+
+    PackedTextWriter(const PackedTextWriter&) noexcept = delete;
+    PackedTextWriter& operator=(const PackedTextWriter&) noexcept = delete;
+    PackedTextWriter(PackedTextWriter&&) noexcept = delete;
+    PackedTextWriter& operator=(PackedTextWriter&&) noexcept = delete;
+
+private:
+    PackedFileStore& m_pPack;
+    std::string m_sKey;
+};
+
 std::chrono::system_clock::time_point FileLocalStorage::GetLastModified(StorageItemType nType, const std::wstring& sKey)
 {
+    if (m_pImagePack != nullptr && IsPackedType(nType))
+    {
+        const auto sPackKey = GetPackKey(nType, sKey);
+        if (m_pImagePack->Contains(sPackKey))
+            return m_pImagePack->GetLastModified(sPackKey);
+    }
+
     return m_pFileSystem.GetLastModified(GetPath(nType, sKey));
 }
 
+bool FileLocalStorage::Exists(StorageItemType nType, const std::wstring& sKey)
+{
+    if (m_pImagePack != nullptr && IsPackedType(nType) && m_pImagePack->Contains(GetPackKey(nType, sKey)))
+        return true;
+
+    return (m_pFileSystem.GetFileSize(GetPath(nType, sKey)) > 0);
+}
+
 std::unique_ptr<TextReader> FileLocalStorage::ReadText(StorageItemType nType, const std::wstring& sKey)
 {
+    if (m_pImagePack != nullptr && IsPackedType(nType))
+    {
+        const auto sPackKey = GetPackKey(nType, sKey);
+        std::string sData;
+        if (!m_pImagePack->Read(sPackKey, sData))
+        {
+            // not in the pack yet. if there's a loose file, move it into the pack
+            if (!MoveToPack(nType, sKey) || !m_pImagePack->Read(sPackKey, sData))
+                return std::unique_ptr<TextReader>();
+        }
+
+        if (sData.empty())
+            return std::unique_ptr<TextReader>();
+
+        return std::make_unique<StringTextReader>(sData);
+    }
+
     std::wstring sPath = GetPath(nType, sKey);
     if (m_pFileSystem.GetFileSize(sPath) > 0)
         return m_pFileSystem.OpenTextFile(sPath);
@@ -144,14 +444,53 @@ std::unique_ptr<TextReader> FileLocalStorage::ReadText(StorageItemType nType, co
 
 std::unique_ptr<TextWriter> FileLocalStorage::WriteText(StorageItemType nType, const std::wstring& sKey)
 {
+    if (m_pImagePack != nullptr && IsPackedType(nType))
+        return std::make_unique<PackedTextWriter>(*m_pImagePack, GetPackKey(nType, sKey));
+
     return m_pFileSystem.CreateTextFile(GetPath(nType, sKey));
 }
 
 std::unique_ptr<TextWriter> FileLocalStorage::AppendText(StorageItemType nType, const std::wstring& sKey)
 {
+    if (m_pImagePack != nullptr && IsPackedType(nType))
+    {
+        const auto sPackKey = GetPackKey(nType, sKey);
+        auto pWriter = std::make_unique<PackedTextWriter>(*m_pImagePack, sPackKey);
+
+        std::string sData;
+        if (m_pImagePack->Read(sPackKey, sData))
+            pWriter->Write(sData);
+
+        return pWriter;
+    }
+
     return m_pFileSystem.AppendTextFile(GetPath(nType, sKey));
 }
 
+bool FileLocalStorage::ReplaceText(StorageItemType nType, const std::wstring& sKey, const std::string& sContents)
+{
+    if (m_pImagePack != nullptr && IsPackedType(nType))
+    {
+        PackedTextWriter pWriter(*m_pImagePack, GetPackKey(nType, sKey));
+        pWriter.Write(sContents);
+        return true;
+    }
+
+    // write to a temporary file and only replace the existing file once the new one is complete
+    const std::wstring sPath = GetPath(nType, sKey);
+    const std::wstring sTempPath = sPath + L".tmp";
+    {
+        auto pWriter = m_pFileSystem.CreateTextFile(sTempPath);
+        if (pWriter == nullptr)
+            return false;
+
+        pWriter->Write(sContents);
+    }
+
+    m_pFileSystem.DeleteFile(sPath);
+    return m_pFileSystem.MoveFile(sTempPath, sPath);
+}
+
 } // namespace impl
 } // namespace services
 } // namespace ra
@@ -4,6 +4,7 @@
 
 #include "services\IFileSystem.hh"
 #include "services\ILocalStorage.hh"
+#include "services\impl\PackedFileStore.hh"
 
 namespace ra {
 namespace services {
@@ -15,15 +16,48 @@ public:
     explicit FileLocalStorage(IFileSystem& pFileSystem);
 
     std::chrono::system_clock::time_point GetLastModified(StorageItemType nType, const std::wstring& sKey) override;
+    bool Exists(StorageItemType nType, const std::wstring& sKey) override;
 
     std::unique_ptr<TextReader> ReadText(StorageItemType nType, const std::wstring& sKey) override;
     std::unique_ptr<TextWriter> WriteText(StorageItemType nType, const std::wstring& sKey) override;
     std::unique_ptr<TextWriter> AppendText(StorageItemType nType, const std::wstring& sKey) override;
+    bool ReplaceText(StorageItemType nType, const std::wstring& sKey, const std::string& sContents) override;
 
     std::wstring GetPath(StorageItemType nType, const std::wstring& sKey) const;
 
+    /// <summary>
+    /// Queues an idle-priority job to remove expired files from the cache and trim it to
+    /// <see cref="MAX_CACHE_SIZE" />. The job does nothing if the cache was swept within
+    /// <see cref="SWEEP_INTERVAL" />.
+    /// </summary>
+    void ScheduleCacheMaintenance();
+
+    /// <summary>
+    /// Stores badges and user pictures in a single packed file instead of individual files. Existing files are
+    /// moved into the pack when they're read, or by the next cache sweep.
+    /// </summary>
+    /// <returns><c>false</c> if the pack could not be opened. Individual files will continue to be used.</returns>
+    bool EnableImagePack();
+
+    static constexpr std::chrono::hours EXPIRE_AGE{24 * 30};
+    static constexpr std::chrono::hours SWEEP_INTERVAL{24};
+    static constexpr std::chrono::seconds SWEEP_DELAY{30};
+    static constexpr size_t FILES_PER_TASK = 100;
+    static constexpr int64_t MAX_CACHE_SIZE = 128 * 1024 * 1024;
+
 private:
+    struct CacheSweep;
+
+    void BeginSweep();
+    void ContinueSweep(std::shared_ptr<CacheSweep> pSweep);
+    void FinishSweep(CacheSweep& pSweep);
+
+    static bool IsPackedType(StorageItemType nType) noexcept;
+    static std::string GetPackKey(StorageItemType nType, const std::wstring& sKey);
+    bool MoveToPack(StorageItemType nType, const std::wstring& sKey);
+
     IFileSystem& m_pFileSystem;
+    std::unique_ptr<PackedFileStore> m_pImagePack;
 };
 
 } // namespace impl
@@ -0,0 +1,345 @@
+#include "FileLogger.hh"
+
+#include "RA_StringUtils.h"
+
+#include "services\IClock.hh"
+#include "services\IThreadPool.hh"
+#include "services\ServiceLocator.hh"
+#include "services\impl\FileTextWriter.hh"
+
+namespace ra {
+namespace services {
+namespace impl {
+
+FileLogger::FileLogger(const ra::services::IFileSystem& pFileSystem) : m_pFileSystem(pFileSystem)
+{
+    for (size_t i = 0; i < QUEUE_CAPACITY; ++i)
+        m_vQueue.at(i).nSequence = i;
+
+    const std::wstring sLogFilePath = ra::BuildWString(pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog.txt");
+
+    // if the file is over 1MB, rename it and start a new one
+    const int64_t nLogSize = pFileSystem.GetFileSize(sLogFilePath);
+    if (nLogSize > MAX_FILE_SIZE)
+    {
+        const std::wstring sOldLogFilePath = ra::BuildWString(pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog-old.txt");
+        pFileSystem.DeleteFile(sOldLogFilePath);
+        pFileSystem.MoveFile(sLogFilePath, sOldLogFilePath);
+    }
+    else if (nLogSize < 0)
+    {
+        const std::wstring sCacheDirectory = ra::BuildWString(pFileSystem.BaseDirectory().c_str(), L"RACache");
+        if (!pFileSystem.DirectoryExists(sCacheDirectory))
+            pFileSystem.CreateDirectory(sCacheDirectory);
+    }
+    else
+    {
+        m_nFileSize = nLogSize;
+    }
+
+    OpenLogFile();
+    WriteRecords("\n");
+}
+
+FileLogger::~FileLogger() noexcept
+{
+    if (m_bShutdown)
+    {
+        // anything logged since Shutdown was already written synchronously
+        return;
+    }
+
+    // Shutdown should have been called by _RA_Shutdown. if it wasn't, the DLL is probably being unloaded and
+    // the loader lock is held, which prevents the writer thread from exiting. joining it would deadlock, so
+    // just wait for it to stop using this object.
+    StopWriterThread(false);
+
+    try
+    {
+        Flush();
+    }
+    catch (...)
+    {
+        // the process is probably exiting. nothing else can be done
+    }
+}
+
+void FileLogger::OpenLogFile() const
+{
+    const std::wstring sLogFilePath = ra::BuildWString(m_pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog.txt");
+    m_pWriter = m_pFileSystem.AppendTextFile(sLogFilePath);
+}
+
+std::string FileLogger::FormatRecord(LogLevel level, const std::string& sMessage)
+{
+    // write a timestamp
+    time_t tTime{};
+    unsigned int tMilliseconds{};
+    if (ServiceLocator::Exists<IClock>())
+    {
+        const auto tNow = ServiceLocator::Get<IClock>().Now();
+        tMilliseconds = gsl::narrow_cast<unsigned int>(
+            std::chrono::time_point_cast<std::chrono::milliseconds>(tNow).time_since_epoch().count() % 1000);
+        tTime = std::chrono::system_clock::to_time_t(tNow);
+    }
+    else
+    {
+        tTime = time(nullptr);
+        tMilliseconds = 0;
+    }
+
+    std::tm tTimeStruct;
+    localtime_s(&tTimeStruct, &tTime);
+
+    char sBuffer[16];
+    strftime(sBuffer, sizeof(sBuffer), "%H%M%S", &tTimeStruct);
+    sprintf_s(&sBuffer[6], sizeof(sBuffer) - 6, ".%03u|", tMilliseconds);
+
+    std::string sRecord;
+    sRecord.reserve(20 + std::min(sMessage.length(), MAX_MESSAGE_SIZE) + 32);
+    sRecord.append(sBuffer);
+
+    // mark the level
+    switch (level)
+    {
+        case LogLevel::Info:
+            sRecord.append("INFO");
+            break;
+        case LogLevel::Warn:
+            sRecord.append("WARN");
+            break;
+        case LogLevel::Error:
+            sRecord.append("ERR ");
+            break;
+    }
+    sRecord.append("| ");
+
+    // write the message. very large messages (like server responses) are truncated so they don't flood the log
+    if (sMessage.length() > MAX_MESSAGE_SIZE)
+    {
+        sRecord.append(sMessage, 0, MAX_MESSAGE_SIZE);
+        sRecord.append(ra::StringPrintf("... (%zu bytes truncated)", sMessage.length() - MAX_MESSAGE_SIZE));
+    }
+    else
+    {
+        sRecord.append(sMessage);
+    }
+
+    // newline
+    sRecord.push_back('\n');
+    return sRecord;
+}
+
+void FileLogger::LogMessage(LogLevel level, const std::string& sMessage) const
+{
+    std::string sRecord = FormatRecord(level, sMessage);
+
+    // WinXP hangs if we try to acquire a mutex while the DLL in initializing. Since DllMain writes
+    // a header block to the log file, we have to do that without using a mutex. Luckily, we're not
+    // going to have multiple threads trying to write to the file, so it'll be safe, and we can
+    // use the presence (or lack thereof) of the ThreadPool implementation to determine if we're
+    // being called from DllMain.
+    if (!ServiceLocator::Exists<IThreadPool>())
+    {
+        WriteRecords(sRecord);
+        return;
+    }
+
+    // errors are written immediately in case they're followed by a crash
+    if (level != LogLevel::Error && !m_bShutdown && StartWriterThread())
+    {
+        if (TryEnqueue(sRecord))
+        {
+            if (m_nQueuedBytes >= FLUSH_THRESHOLD && !m_bWakeRequested.exchange(true))
+            {
+                std::lock_guard<std::mutex> lock(m_oWakeMutex);
+                m_cvWake.notify_one();
+            }
+
+            return;
+        }
+    }
+
+    // an error, the queue is full, or the writer thread has stopped. write everything that's waiting (so the log
+    // stays in order), then this message
+    std::lock_guard<std::mutex> lock(m_oWriterMutex);
+    std::string sRecords = DequeueAll();
+    sRecords.append(sRecord);
+    WriteRecords(sRecords);
+}
+
+bool FileLogger::TryEnqueue(std::string& sRecord) const
+{
+    auto nPosition = m_nEnqueuePosition.load(std::memory_order_relaxed);
+    Cell* pCell = nullptr;
+    for (;;)
+    {
+        pCell = &m_vQueue.at(nPosition % QUEUE_CAPACITY);
+        const auto nSequence = pCell->nSequence.load(std::memory_order_acquire);
+        if (nSequence == nPosition)
+        {
+            // cell is available, try to claim it
+            if (m_nEnqueuePosition.compare_exchange_weak(nPosition, nPosition + 1, std::memory_order_relaxed))
+                break;
+
+            // another thread claimed it. nPosition was updated by compare_exchange_weak
+        }
+        else if (nSequence < nPosition)
+        {
+            // cell still holds a record from the previous lap - the queue is full
+            return false;
+        }
+        else
+        {
+            // another thread claimed the cell and moved on, try again at the new position
+            nPosition = m_nEnqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    // count the bytes before the record is visible so the writer can never drive the counter below zero
+    m_nQueuedBytes += sRecord.length();
+    pCell->sRecord = std::move(sRecord);
+    pCell->nSequence.store(nPosition + 1, std::memory_order_release);
+    return true;
+}
+
+std::string FileLogger::DequeueAll() const
+{
+    // caller must hold m_oWriterMutex, which makes this the only consumer
+    std::string sRecords;
+    for (;;)
+    {
+        auto& pCell = m_vQueue.at(m_nDequeuePosition % QUEUE_CAPACITY);
+        if (pCell.nSequence.load(std::memory_order_acquire) != m_nDequeuePosition + 1)
+            break;
+
+        sRecords.append(pCell.sRecord);
+        m_nQueuedBytes -= pCell.sRecord.length();
+        pCell.sRecord.clear();
+
+        // make the cell available to the producers on their next lap
+        pCell.nSequence.store(m_nDequeuePosition + QUEUE_CAPACITY, std::memory_order_release);
+        ++m_nDequeuePosition;
+    }
+
+    return sRecords;
+}
+
+void FileLogger::WriteRecords(const std::string& sRecords) const
+{
+    if (m_pWriter == nullptr || sRecords.empty())
+        return;
+
+    m_pWriter->Write(sRecords);
+
+    // if writing to a file, flush immediately
+    auto* pFileWriter = dynamic_cast<ra::services::impl::FileTextWriter*>(m_pWriter.get());
+    if (pFileWriter != nullptr)
+        pFileWriter->GetFStream().flush();
+
+    m_nFileSize += gsl::narrow_cast<int64_t>(sRecords.length());
+    if (m_nFileSize > MAX_FILE_SIZE)
+    {
+        // close the file before renaming it
+        m_pWriter.reset();
+
+        const std::wstring sLogFilePath = ra::BuildWString(m_pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog.txt");
+        const std::wstring sOldLogFilePath = ra::BuildWString(m_pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog-old.txt");
+        m_pFileSystem.DeleteFile(sOldLogFilePath);
+        m_pFileSystem.MoveFile(sLogFilePath, sOldLogFilePath);
+
+        OpenLogFile();
+        m_nFileSize = 0;
+    }
+}
+
+void FileLogger::Flush() const
+{
+    std::lock_guard<std::mutex> lock(m_oWriterMutex);
+    WriteRecords(DequeueAll());
+}
+
+bool FileLogger::StartWriterThread() const
+{
+    if (m_bWriterThreadStarted)
+        return true;
+
+    // Shutdown sets the flag while holding the same lock, so the thread can't be started after it's been stopped
+    std::lock_guard<std::mutex> lock(m_oWakeMutex);
+    if (m_bShutdown)
+        return false;
+
+    if (!m_bWriterThreadStarted)
+    {
+        m_pWriterThread = std::thread(&FileLogger::RunWriterThread, this);
+        m_bWriterThreadStarted = true;
+    }
+
+    return true;
+}
+
+void FileLogger::StopWriterThread(bool bJoin) noexcept
+{
+    try
+    {
+        std::unique_lock<std::mutex> lock(m_oWakeMutex);
+        m_bShutdown = true;
+        m_cvWake.notify_all();
+
+        if (!m_pWriterThread.joinable())
+            return;
+
+        if (bJoin)
+        {
+            lock.unlock();
+            m_pWriterThread.join();
+        }
+        else
+        {
+            m_cvWake.wait_for(lock, std::chrono::seconds(1), [this]() noexcept { return m_bWriterThreadStopped; });
+            m_pWriterThread.detach();
+        }
+    }
+    catch (...)
+    {
+        // the process is probably exiting. nothing else can be done
+    }
+}
+
+void FileLogger::RunWriterThread() const
+{
+    while (!m_bShutdown)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_oWakeMutex);
+            m_cvWake.wait_for(lock, FLUSH_INTERVAL, [this]() noexcept { return m_bWakeRequested || m_bShutdown; });
+            m_bWakeRequested = false;
+        }
+
+        Flush();
+    }
+
+    // let the destructor know this object is no longer in use
+    std::lock_guard<std::mutex> lock(m_oWakeMutex);
+    m_bWriterThreadStopped = true;
+    m_cvWake.notify_all();
+}
+
+void FileLogger::Shutdown() noexcept
+{
+    StopWriterThread(true);
+
+    try
+    {
+        // anything queued after the writer thread's last pass
+        Flush();
+    }
+    catch (...)
+    {
+        // the process is probably exiting. nothing else can be done
+    }
+}
+
+} // namespace impl
+} // namespace services
+} // namespace ra
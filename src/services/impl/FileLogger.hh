@@ -2,126 +2,91 @@
 #define RA_SERVICES_FILELOGGER_HH
 #pragma once
 
-#include "services\IClock.hh"
 #include "services\IFileSystem.hh"
 #include "services\ILogger.hh"
-#include "services\IThreadPool.hh"
-#include "services\ServiceLocator.hh"
 #include "services\TextWriter.hh"
-#include "services\impl\FileTextWriter.hh"
 
 namespace ra {
 namespace services {
 namespace impl {
 
+/// <summary>
+/// Writes log messages to RACache\RALog.txt.
+/// </summary>
+/// <remarks>
+/// Once the <see cref="IThreadPool" /> has been registered, messages are formatted on the calling thread and
+/// queued. A background thread writes them in batches. Before that, messages are written synchronously. Nothing
+/// can safely wait on a mutex or a thread while the DLL is initializing.
+/// </remarks>
 class FileLogger : public ra::services::ILogger
 {
 public:
-    explicit FileLogger(const ra::services::IFileSystem& pFileSystem)
-    {
-        const std::wstring sLogFilePath = ra::BuildWString(pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog.txt");
-
-        // if the file is over 1MB, rename it and start a new one
-        const int64_t nLogSize = pFileSystem.GetFileSize(sLogFilePath);
-        if (nLogSize > 1024 * 1024)
-        {
-            const std::wstring sOldLogFilePath = ra::BuildWString(pFileSystem.BaseDirectory().c_str(), L"RACache\\RALog-old.txt");
-            pFileSystem.DeleteFile(sOldLogFilePath);
-            pFileSystem.MoveFile(sLogFilePath, sOldLogFilePath);
-        }
-        else if (nLogSize < 0)
-        {
-            const std::wstring sCacheDirectory = ra::BuildWString(pFileSystem.BaseDirectory().c_str(), L"RACache");
-            if (!pFileSystem.DirectoryExists(sCacheDirectory))
-                pFileSystem.CreateDirectory(sCacheDirectory);
-        }
-
-        m_pWriter = pFileSystem.AppendTextFile(sLogFilePath);
-        if (m_pWriter != nullptr)
-            m_pWriter->WriteLine();
-    }
+    explicit FileLogger(const ra::services::IFileSystem& pFileSystem);
+    ~FileLogger() noexcept;
+    FileLogger(const FileLogger&) noexcept = delete;
+    FileLogger& operator=(const FileLogger&) noexcept = delete;
+    FileLogger(FileLogger&&) noexcept = delete;
+    FileLogger& operator=(FileLogger&&) noexcept = delete;
 
     bool IsEnabled([[maybe_unused]] LogLevel level) const noexcept override { return true; }
 
-    void LogMessage(LogLevel level, const std::string& sMessage) const override
-    {
-        if (m_pWriter == nullptr)
-            return;
-
-        // write a timestamp
-        time_t tTime{};
-        unsigned int tMilliseconds{};
-        if (ServiceLocator::Exists<IClock>())
-        {
-            const auto tNow = ServiceLocator::Get<IClock>().Now();
-            tMilliseconds = gsl::narrow_cast<unsigned int>(
-                std::chrono::time_point_cast<std::chrono::milliseconds>(tNow).time_since_epoch().count() % 1000);
-            tTime = std::chrono::system_clock::to_time_t(tNow);
-        }
-        else
-        {
-            tTime = time(nullptr);
-            tMilliseconds = 0;
-        }
-
-        std::tm tTimeStruct;
-        localtime_s(&tTimeStruct, &tTime);
-
-        char sBuffer[16];
-        strftime(sBuffer, sizeof(sBuffer), "%H%M%S", &tTimeStruct);
-        sprintf_s(&sBuffer[6], sizeof(sBuffer) - 6, ".%03u|", tMilliseconds);
-
-        // WinXP hangs if we try to acquire a mutex while the DLL in initializing. Since DllMain writes
-        // a header block to the log file, we have to do that without using a mutex. Luckily, we're not
-        // going to have multiple threads trying to write to the file, so it'll be safe, and we can
-        // use the presence (or lack thereof) of the ThreadPool implementation to determine if we're
-        // being called from DllMain.
-        if (ServiceLocator::Exists<IThreadPool>())
-        {
-            std::scoped_lock<std::mutex> oLock(m_oMutex);
-            LogMessage(*m_pWriter, sBuffer, level, sMessage);
-        }
-        else
-        {
-            LogMessage(*m_pWriter, sBuffer, level, sMessage);
-        }
-
-        // if writing to a file, flush immediately
-        auto* pFileWriter = dynamic_cast<ra::services::impl::FileTextWriter*>(m_pWriter.get());
-        if (pFileWriter != nullptr)
-            pFileWriter->GetFStream().flush();
-    }
+    void LogMessage(LogLevel level, const std::string& sMessage) const override;
+
+    /// <summary>
+    /// Writes any queued messages to the file.
+    /// </summary>
+    void Flush() const;
+
+    /// <summary>
+    /// Writes any queued messages and stops the background thread. Messages logged after this are written
+    /// synchronously.
+    /// </summary>
+    void Shutdown() noexcept;
+
+    static constexpr size_t MAX_MESSAGE_SIZE = 4096;
+    static constexpr int64_t MAX_FILE_SIZE = 1024 * 1024;
+    static constexpr size_t FLUSH_THRESHOLD = 16 * 1024;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{1000};
 
 private:
-    static void LogMessage(ra::services::TextWriter& pWriter, const char* const sTimestamp, LogLevel level,
-                           const std::string& sMessage)
+    static std::string FormatRecord(LogLevel level, const std::string& sMessage);
+
+    bool TryEnqueue(std::string& sRecord) const;
+    std::string DequeueAll() const;
+    void WriteRecords(const std::string& sRecords) const;
+    void OpenLogFile() const;
+    bool StartWriterThread() const;
+    void StopWriterThread(bool bJoin) noexcept;
+    void RunWriterThread() const;
+
+    const ra::services::IFileSystem& m_pFileSystem;
+    mutable std::unique_ptr<ra::services::TextWriter> m_pWriter;
+    mutable int64_t m_nFileSize = 0;
+
+    // bounded multi-producer, single-consumer queue. each cell's sequence number indicates whether it's waiting
+    // to be written (nPosition + 1) or available for the next producer (nPosition). see Dmitry Vyukov's bounded
+    // MPMC queue.
+    static constexpr size_t QUEUE_CAPACITY = 1024;
+    struct Cell
     {
-        pWriter.Write(sTimestamp);
-
-        // mark the level
-        switch (level)
-        {
-            case LogLevel::Info:
-                pWriter.Write("INFO");
-                break;
-            case LogLevel::Warn:
-                pWriter.Write("WARN");
-                break;
-            case LogLevel::Error:
-                pWriter.Write("ERR ");
-                break;
-        }
-        pWriter.Write("| ");
-
-        // write the message
-        pWriter.Write(sMessage);
-
-        // newline
-        pWriter.WriteLine();
-    }
-
-    std::unique_ptr<ra::services::TextWriter> m_pWriter;
-    mutable std::mutex m_oMutex;
+        std::atomic<size_t> nSequence{0};
+        std::string sRecord;
+    };
+    mutable std::array<Cell, QUEUE_CAPACITY> m_vQueue;
+    mutable std::atomic<size_t> m_nEnqueuePosition{0};
+    mutable size_t m_nDequeuePosition = 0;
+    mutable std::atomic<size_t> m_nQueuedBytes{0};
+
+    mutable std::mutex m_oWriterMutex;
+
+    // the writer thread is only started or stopped while holding m_oWakeMutex
+    mutable std::thread m_pWriterThread;
+    mutable std::atomic_bool m_bWriterThreadStarted{false};
+    mutable bool m_bWriterThreadStopped = false;
+    mutable std::mutex m_oWakeMutex;
+    mutable std::condition_variable m_cvWake;
+    mutable std::atomic_bool m_bWakeRequested{false};
+    std::atomic_bool m_bShutdown{false};
 };
 
 } // namespace impl
@@ -6,7 +6,9 @@
 #include "ra_utility.h"
 
 #include "services\IFileSystem.hh"
+#include "services\IThreadPool.hh"
 #include "services\ServiceLocator.hh"
+#include "services\impl\StringTextWriter.hh"
 
 namespace ra {
 namespace services {
@@ -22,6 +24,7 @@ bool JsonFileConfiguration::Load(const std::wstring& sFilename)
     m_sRomDirectory.clear();
     m_mWindowPositions.clear();
     m_nBackgroundThreads = 8;
+    m_tFrameBudget = std::chrono::microseconds(4000);
     m_vEnabledFeatures =
         (1 << static_cast<int>(Feature::Hardcore)) |
         (1 << static_cast<int>(Feature::AchievementTriggeredNotifications)) |
@@ -32,9 +35,18 @@ bool JsonFileConfiguration::Load(const std::wstring& sFilename)
         (1 << static_cast<int>(Feature::LeaderboardCounters)) |
         (1 << static_cast<int>(Feature::LeaderboardScoreboards));
 
+    // anything not read from the file should be written on the next save
+    m_bDirty = true;
+
     RA_LOG("Loading preferences...");
 
     auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
+
+    // if a save was interrupted after the old file was deleted, the new file is complete. use it.
+    const std::wstring sTempFilename = m_sFilename + L".tmp";
+    if (pFileSystem.GetFileSize(m_sFilename) < 0 && pFileSystem.GetFileSize(sTempFilename) > 0)
+        pFileSystem.MoveFile(sTempFilename, m_sFilename);
+
     auto pReader = pFileSystem.OpenTextFile(m_sFilename);
     if (pReader == nullptr)
         return false;
@@ -77,8 +89,17 @@ bool JsonFileConfiguration::Load(const std::wstring& sFilename)
     if (doc.HasMember("Prefer Decimal"))
         SetFeatureEnabled(Feature::PreferDecimal, doc["Prefer Decimal"].GetBool());
 
+    if (doc.HasMember("Performance Counters"))
+        SetFeatureEnabled(Feature::PerformanceCounters, doc["Performance Counters"].GetBool());
+    if (doc.HasMember("Performance Tracing"))
+        SetFeatureEnabled(Feature::Tracing, doc["Performance Tracing"].GetBool());
+    if (doc.HasMember("Packed Image Cache"))
+        SetFeatureEnabled(Feature::PackedImageCache, doc["Packed Image Cache"].GetBool());
+
     if (doc.HasMember("Num Background Threads"))
         m_nBackgroundThreads = doc["Num Background Threads"].GetUint();
+    if (doc.HasMember("Frame Budget Microseconds"))
+        m_tFrameBudget = std::chrono::microseconds(doc["Frame Budget Microseconds"].GetUint());
     if (doc.HasMember("ROM Directory"))
         m_sRomDirectory = ra::Widen(doc["ROM Directory"].GetString());
 
@@ -104,19 +125,107 @@ bool JsonFileConfiguration::Load(const std::wstring& sFilename)
         }
     }
 
+    m_bDirty = false;
     return true;
 }
 
 void JsonFileConfiguration::Save() const
 {
-    RA_LOG("Saving preferences...");
-
     if (m_sFilename.empty())
     {
+        RA_LOG("Saving preferences...");
         RA_LOG(" - Aborting save, we don't know where to write...");
         return;
     }
 
+    ra::services::IThreadPool* pThreadPool = nullptr;
+    if (ra::services::ServiceLocator::Exists<ra::services::IThreadPool>())
+    {
+        pThreadPool = &ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>();
+        if (pThreadPool->IsShutdownRequested())
+            pThreadPool = nullptr;
+    }
+
+    if (!m_bDirty)
+    {
+        // nothing has changed, but make sure any queued changes are written before shutting down
+        if (pThreadPool == nullptr)
+            Flush();
+
+        return;
+    }
+
+    RA_LOG("Saving preferences...");
+
+    // the configuration is only modified by the UI thread, so capture it here. the background thread
+    // only has to write the captured text.
+    std::string sContents = Serialize();
+    m_bDirty = false;
+
+    std::lock_guard<std::mutex> lock(m_oSaveMutex);
+    if (pThreadPool == nullptr)
+    {
+        // no background threads (or they're shutting down). write immediately, replacing any queued changes.
+        m_sPendingContents.clear();
+        WriteFile(sContents);
+        return;
+    }
+
+    // if a write is already queued, it will pick up the new contents
+    m_sPendingContents.swap(sContents);
+    if (!m_bSaveScheduled)
+    {
+        m_bSaveScheduled = true;
+        pThreadPool->ScheduleAsync(SAVE_DELAY, [this]() { WritePending(); }, TaskPriority::Background);
+    }
+}
+
+void JsonFileConfiguration::Flush() const
+{
+    std::lock_guard<std::mutex> lock(m_oSaveMutex);
+    if (!m_sPendingContents.empty())
+    {
+        WriteFile(m_sPendingContents);
+        m_sPendingContents.clear();
+    }
+}
+
+void JsonFileConfiguration::WritePending() const
+{
+    std::lock_guard<std::mutex> lock(m_oSaveMutex);
+    m_bSaveScheduled = false;
+
+    // if the changes were already flushed, there's nothing to do
+    if (!m_sPendingContents.empty())
+    {
+        WriteFile(m_sPendingContents);
+        m_sPendingContents.clear();
+    }
+}
+
+void JsonFileConfiguration::WriteFile(const std::string& sContents) const
+{
+    // write to a temporary file and only replace the existing file once the new one is complete
+    const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
+    const std::wstring sTempFilename = m_sFilename + L".tmp";
+    {
+        auto pWriter = pFileSystem.CreateTextFile(sTempFilename);
+        if (pWriter == nullptr)
+        {
+            RA_LOG_WARN("Could not write %s", ra::Narrow(sTempFilename));
+            return;
+        }
+
+        pWriter->Write(sContents);
+    }
+
+    pFileSystem.DeleteFile(m_sFilename);
+    if (!pFileSystem.MoveFile(sTempFilename, m_sFilename))
+        RA_LOG_WARN("Could not replace %s", ra::Narrow(m_sFilename));
+}
+
+std::string JsonFileConfiguration::Serialize() const
+{
     rapidjson::Document doc;
     doc.SetObject();
 
@@ -135,7 +244,11 @@ void JsonFileConfiguration::Save() const
     doc.AddMember("Leaderboard Counter Display", IsFeatureEnabled(Feature::LeaderboardCounters), a);
     doc.AddMember("Leaderboard Scoreboard Display", IsFeatureEnabled(Feature::LeaderboardScoreboards), a);
     doc.AddMember("Prefer Decimal", IsFeatureEnabled(Feature::PreferDecimal), a);
+    doc.AddMember("Performance Counters", IsFeatureEnabled(Feature::PerformanceCounters), a);
+    doc.AddMember("Performance Tracing", IsFeatureEnabled(Feature::Tracing), a);
+    doc.AddMember("Packed Image Cache", IsFeatureEnabled(Feature::PackedImageCache), a);
     doc.AddMember("Num Background Threads", m_nBackgroundThreads, a);
+    doc.AddMember("Frame Budget Microseconds", gsl::narrow_cast<unsigned int>(m_tFrameBudget.count()), a);
 
     if (!m_sRomDirectory.empty())
         doc.AddMember("ROM Directory", ra::Narrow(m_sRomDirectory), a);
@@ -163,10 +276,10 @@ void JsonFileConfiguration::Save() const
     if (positions.MemberCount() > 0)
         doc.AddMember("Window Positions", positions.Move(), a);
 
-    auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
-    auto pWriter = pFileSystem.CreateTextFile(m_sFilename);
-    if (pWriter != nullptr)
-        SaveDocument(doc, *pWriter);
+    std::string sContents;
+    StringTextWriter pWriter(sContents);
+    SaveDocument(doc, pWriter);
+    return sContents;
 }
 
 bool JsonFileConfiguration::IsFeatureEnabled(Feature nFeature) const noexcept
@@ -182,6 +295,8 @@ void JsonFileConfiguration::SetFeatureEnabled(Feature nFeature, bool bEnabled) n
         m_vEnabledFeatures |= bit;
     else
         m_vEnabledFeatures &= ~bit;
+
+    m_bDirty = true;
 }
 
 ra::ui::Position JsonFileConfiguration::GetWindowPosition(const std::string& sPositionKey) const
@@ -196,6 +311,7 @@ ra::ui::Position JsonFileConfiguration::GetWindowPosition(const std::string& sPo
 void JsonFileConfiguration::SetWindowPosition(const std::string& sPositionKey, const ra::ui::Position & oPosition)
 {
     m_mWindowPositions[sPositionKey].oPosition = oPosition;
+    m_bDirty = true;
 }
 
 ra::ui::Size JsonFileConfiguration::GetWindowSize(const std::string & sPositionKey) const
@@ -210,6 +326,7 @@ ra::ui::Size JsonFileConfiguration::GetWindowSize(const std::string & sPositionK
 void JsonFileConfiguration::SetWindowSize(const std::string & sPositionKey, const ra::ui::Size & oSize)
 {
     m_mWindowPositions[sPositionKey].oSize = oSize;
+    m_bDirty = true;
 }
 
 const std::string& JsonFileConfiguration::GetHostName() const
@@ -14,20 +14,22 @@ public:
     bool Load(const std::wstring& sFilename);
 
     const std::string& GetUsername() const noexcept override { return m_sUsername; }
-    void SetUsername(const std::string& sValue) override { m_sUsername = sValue; }
+    void SetUsername(const std::string& sValue) override { m_sUsername = sValue; m_bDirty = true; }
     const std::string& GetApiToken() const noexcept override { return m_sApiToken; }
-    void SetApiToken(const std::string& sValue) override { m_sApiToken = sValue; }
+    void SetApiToken(const std::string& sValue) override { m_sApiToken = sValue; m_bDirty = true; }
 
     bool IsFeatureEnabled(Feature nFeature) const noexcept override;
     void SetFeatureEnabled(Feature nFeature, bool bEnabled) noexcept override;
 
     unsigned int GetNumBackgroundThreads() const noexcept override { return m_nBackgroundThreads; }
 
+    std::chrono::microseconds GetFrameBudget() const noexcept override { return m_tFrameBudget; }
+
     const std::wstring& GetRomDirectory() const noexcept override { return m_sRomDirectory; }
-    void SetRomDirectory(const std::wstring& sValue) override { m_sRomDirectory = sValue; }
+    void SetRomDirectory(const std::wstring& sValue) override { m_sRomDirectory = sValue; m_bDirty = true; }
 
     const std::wstring& GetScreenshotDirectory() const noexcept override { return m_sScreenshotDirectory; }
-    void SetScreenshotDirectory(const std::wstring& sValue) override { m_sScreenshotDirectory = sValue; }
+    void SetScreenshotDirectory(const std::wstring& sValue) override { m_sScreenshotDirectory = sValue; m_bDirty = true; }
 
     ra::ui::Position GetWindowPosition(const std::string& sPositionKey) const override;
     void SetWindowPosition(const std::string& sPositionKey, const ra::ui::Position& oPosition) override;
@@ -40,10 +42,24 @@ public:
     const std::string& GetHostUrl() const override;
     const std::string& GetImageHostUrl() const override;
 
+    /// <summary>
+    /// Saves the current configuration if it has changed. When background threads are available, the file is
+    /// written by a background thread after <see cref="SAVE_DELAY" /> so multiple changes result in a single write.
+    /// </summary>
     void Save() const override;
 
+    /// <summary>
+    /// Immediately writes any changes that are waiting to be written by a background thread.
+    /// </summary>
+    void Flush() const;
+
+    static constexpr std::chrono::milliseconds SAVE_DELAY{2000};
+
 private:
     void UpdateHost();
+    std::string Serialize() const;
+    void WritePending() const;
+    void WriteFile(const std::string& sContents) const;
 
     std::string m_sUsername;
     std::string m_sApiToken;
@@ -51,6 +67,7 @@ private:
     int m_vEnabledFeatures = 0;
 
     unsigned int m_nBackgroundThreads = 8;
+    std::chrono::microseconds m_tFrameBudget{4000};
     std::wstring m_sRomDirectory;
     std::wstring m_sScreenshotDirectory;
 
@@ -69,6 +86,11 @@ private:
     std::string m_sImageHostUrl;
 
     std::wstring m_sFilename;
+
+    mutable bool m_bDirty = true;
+    mutable std::mutex m_oSaveMutex;
+    mutable std::string m_sPendingContents; // serialized configuration waiting to be written
+    mutable bool m_bSaveScheduled = false;
 };
 
 } // namespace impl
@@ -0,0 +1,410 @@
+#include "PackedFileStore.hh"
+
+#include "RA_Log.h"
+#include "RA_StringUtils.h"
+
+#include "services\impl\FileTextWriter.hh"
+
+namespace ra {
+namespace services {
+namespace impl {
+
+// File layout (all values are little-endian):
+//   header:  "RAPK", uint32 version
+//   records: uint32 key length, uint32 data length (REMOVED_SIZE if the key was removed), int64 time_t, key, data
+_CONSTANT_VAR PACK_SIGNATURE = "RAPK";
+_CONSTANT_VAR PACK_VERSION = 1U;
+_CONSTANT_VAR HEADER_SIZE = size_t{8};
+_CONSTANT_VAR RECORD_HEADER_SIZE = size_t{16};
+_CONSTANT_VAR REMOVED_SIZE = 0xFFFFFFFFU;
+
+static void AppendUInt32(std::string& sBuffer, uint32_t nValue)
+{
+    for (int i = 0; i < 32; i += 8)
+        sBuffer.push_back(gsl::narrow_cast<char>((nValue >> i) & 0xFF));
+}
+
+static void AppendInt64(std::string& sBuffer, int64_t nValue)
+{
+    const auto nUnsigned = static_cast<uint64_t>(nValue);
+    for (int i = 0; i < 64; i += 8)
+        sBuffer.push_back(gsl::narrow_cast<char>((nUnsigned >> i) & 0xFF));
+}
+
+static uint32_t ReadUInt32(const std::array<uint8_t, RECORD_HEADER_SIZE>& pBuffer, size_t nIndex)
+{
+    uint32_t nValue = 0;
+    for (size_t i = 0; i < 4; ++i)
+        nValue |= gsl::narrow_cast<uint32_t>(pBuffer.at(nIndex + i)) << (i * 8);
+
+    return nValue;
+}
+
+static int64_t ReadInt64(const std::array<uint8_t, RECORD_HEADER_SIZE>& pBuffer, size_t nIndex)
+{
+    uint64_t nValue = 0;
+    for (size_t i = 0; i < 8; ++i)
+        nValue |= gsl::narrow_cast<uint64_t>(pBuffer.at(nIndex + i)) << (i * 8);
+
+    return static_cast<int64_t>(nValue);
+}
+
+static std::string GetFileHeader()
+{
+    std::string sHeader(PACK_SIGNATURE);
+    AppendUInt32(sHeader, PACK_VERSION);
+    return sHeader;
+}
+
+static void FlushWriter(TextWriter& pWriter)
+{
+    // if writing to a file, flush immediately so readers can see the data
+    auto* pFileWriter = dynamic_cast<FileTextWriter*>(&pWriter);
+    if (pFileWriter != nullptr)
+        pFileWriter->GetFStream().flush();
+}
+
+PackedFileStore::PackedFileStore(const IFileSystem& pFileSystem, const std::wstring& sPath)
+    : m_pFileSystem(pFileSystem), m_sPath(sPath)
+{
+}
+
+int64_t PackedFileStore::GetRecordSize(size_t nKeyLength, uint32_t nDataSize) noexcept
+{
+    auto nSize = gsl::narrow_cast<int64_t>(RECORD_HEADER_SIZE + nKeyLength);
+    if (nDataSize != REMOVED_SIZE)
+        nSize += nDataSize;
+
+    return nSize;
+}
+
+bool PackedFileStore::Open()
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    m_mIndex.clear();
+    m_nFileSize = 0;
+    m_nWastedSize = 0;
+    m_pReader.reset();
+    m_pWriter.reset();
+
+    // if a compaction was interrupted after the old file was deleted, the new file is complete. use it.
+    const std::wstring sTempPath = m_sPath + L".tmp";
+    auto nFileSize = m_pFileSystem.GetFileSize(m_sPath);
+    if (nFileSize < 0 && m_pFileSystem.GetFileSize(sTempPath) > 0)
+    {
+        m_pFileSystem.MoveFile(sTempPath, m_sPath);
+        nFileSize = m_pFileSystem.GetFileSize(m_sPath);
+    }
+
+    if (nFileSize > 0)
+    {
+        auto pReader = m_pFileSystem.OpenTextFile(m_sPath);
+        if (pReader != nullptr)
+        {
+            if (LoadIndex(*pReader, nFileSize))
+            {
+                m_pWriter = m_pFileSystem.AppendTextFile(m_sPath);
+                return (m_pWriter != nullptr);
+            }
+
+            if (!m_mIndex.empty())
+            {
+                // the end of the file is damaged - probably a write that was interrupted. keep everything before it.
+                RA_LOG_WARN("Discarding %lld damaged bytes from %s", nFileSize - m_nFileSize, ra::Narrow(m_sPath));
+                m_pReader = std::move(pReader);
+                return CompactLocked();
+            }
+        }
+
+        RA_LOG_WARN("%s is not a valid pack file. Discarding it.", ra::Narrow(m_sPath));
+    }
+
+    m_pWriter = m_pFileSystem.CreateTextFile(m_sPath);
+    if (m_pWriter == nullptr)
+        return false;
+
+    m_pWriter->Write(GetFileHeader());
+    FlushWriter(*m_pWriter);
+
+    m_nFileSize = gsl::narrow_cast<int64_t>(HEADER_SIZE);
+    return true;
+}
+
+bool PackedFileStore::LoadIndex(TextReader& pReader, int64_t nFileSize)
+{
+    std::array<uint8_t, RECORD_HEADER_SIZE> pHeader{};
+    if (pReader.GetBytes(pHeader.data(), HEADER_SIZE) != HEADER_SIZE)
+        return false;
+
+    const std::string sHeader = GetFileHeader();
+    for (size_t i = 0; i < HEADER_SIZE; ++i)
+    {
+        if (pHeader.at(i) != ra::to_unsigned(sHeader.at(i)))
+            return false;
+    }
+
+    m_nFileSize = gsl::narrow_cast<int64_t>(HEADER_SIZE);
+
+    std::string sKey;
+    while (m_nFileSize < nFileSize)
+    {
+        // only the record headers are read. the data is skipped over.
+        pReader.SetPosition(m_nFileSize);
+        if (pReader.GetBytes(pHeader.data(), RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE)
+            return false;
+
+        const auto nKeyLength = ReadUInt32(pHeader, 0);
+        const auto nDataSize = ReadUInt32(pHeader, 4);
+        const auto nTimestamp = ReadInt64(pHeader, 8);
+        if (nKeyLength == 0 || nKeyLength > MAX_KEY_LENGTH)
+            return false;
+
+        const auto nRecordSize = GetRecordSize(nKeyLength, nDataSize);
+        if (m_nFileSize + nRecordSize > nFileSize)
+            return false;
+
+        sKey.resize(nKeyLength);
+        uint8_t* pKey;
+        GSL_SUPPRESS_TYPE1 pKey = reinterpret_cast<uint8_t*>(sKey.data());
+        if (pReader.GetBytes(pKey, nKeyLength) != nKeyLength)
+            return false;
+
+        auto pIter = m_mIndex.find(sKey);
+        if (pIter != m_mIndex.end())
+            m_nWastedSize += GetRecordSize(nKeyLength, pIter->second.nSize);
+
+        if (nDataSize == REMOVED_SIZE)
+        {
+            m_nWastedSize += nRecordSize;
+            if (pIter != m_mIndex.end())
+                m_mIndex.erase(pIter);
+        }
+        else
+        {
+            const Entry pEntry{m_nFileSize + gsl::narrow_cast<int64_t>(RECORD_HEADER_SIZE + nKeyLength), nDataSize, nTimestamp};
+            if (pIter != m_mIndex.end())
+                pIter->second = pEntry;
+            else
+                m_mIndex.emplace(sKey, pEntry);
+        }
+
+        m_nFileSize += nRecordSize;
+    }
+
+    return true;
+}
+
+void PackedFileStore::AppendRecord(TextWriter& pWriter, const std::string& sKey, const std::string* pData,
+                                   int64_t nTimestamp)
+{
+    std::string sRecord;
+    sRecord.reserve(RECORD_HEADER_SIZE + sKey.length() + (pData ? pData->length() : 0));
+    AppendUInt32(sRecord, gsl::narrow_cast<uint32_t>(sKey.length()));
+    AppendUInt32(sRecord, pData ? gsl::narrow_cast<uint32_t>(pData->length()) : REMOVED_SIZE);
+    AppendInt64(sRecord, nTimestamp);
+    sRecord.append(sKey);
+    if (pData)
+        sRecord.append(*pData);
+
+    // write the whole record at once to minimize the chance of a partial write
+    pWriter.Write(sRecord);
+}
+
+bool PackedFileStore::Contains(const std::string& sKey) const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_mIndex.find(sKey) != m_mIndex.end();
+}
+
+std::chrono::system_clock::time_point PackedFileStore::GetLastModified(const std::string& sKey) const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto pIter = m_mIndex.find(sKey);
+    if (pIter == m_mIndex.end())
+        return std::chrono::system_clock::time_point();
+
+    return std::chrono::system_clock::from_time_t(gsl::narrow_cast<time_t>(pIter->second.nTimestamp));
+}
+
+bool PackedFileStore::ReadEntry(const Entry& pEntry, std::string& sData) const
+{
+    // the reader is kept open between reads so each read doesn't have to open the file
+    if (m_pReader == nullptr)
+    {
+        m_pReader = m_pFileSystem.OpenTextFile(m_sPath);
+        if (m_pReader == nullptr)
+            return false;
+    }
+
+    sData.resize(pEntry.nSize);
+    if (pEntry.nSize == 0)
+        return true;
+
+    m_pReader->SetPosition(pEntry.nOffset);
+
+    uint8_t* pData;
+    GSL_SUPPRESS_TYPE1 pData = reinterpret_cast<uint8_t*>(sData.data());
+    return (m_pReader->GetBytes(pData, pEntry.nSize) == pEntry.nSize);
+}
+
+bool PackedFileStore::Read(const std::string& sKey, std::string& sData) const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto pIter = m_mIndex.find(sKey);
+    if (pIter == m_mIndex.end())
+        return false;
+
+    return ReadEntry(pIter->second, sData);
+}
+
+void PackedFileStore::Write(const std::string& sKey, const std::string& sData,
+                            std::chrono::system_clock::time_point tLastModified)
+{
+    Expects(!sKey.empty() && sKey.length() <= MAX_KEY_LENGTH);
+    Expects(sData.length() < REMOVED_SIZE);
+
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    if (m_pWriter == nullptr)
+        return;
+
+    const int64_t nTimestamp = std::chrono::system_clock::to_time_t(tLastModified);
+    AppendRecord(*m_pWriter, sKey, &sData, nTimestamp);
+    FlushWriter(*m_pWriter);
+
+    const Entry pEntry{m_nFileSize + gsl::narrow_cast<int64_t>(RECORD_HEADER_SIZE + sKey.length()),
+                       gsl::narrow_cast<uint32_t>(sData.length()), nTimestamp};
+    m_nFileSize += GetRecordSize(sKey.length(), pEntry.nSize);
+
+    auto pIter = m_mIndex.find(sKey);
+    if (pIter != m_mIndex.end())
+    {
+        m_nWastedSize += GetRecordSize(sKey.length(), pIter->second.nSize);
+        pIter->second = pEntry;
+    }
+    else
+    {
+        m_mIndex.emplace(sKey, pEntry);
+    }
+
+    m_pReader.reset();
+}
+
+void PackedFileStore::Remove(const std::string& sKey)
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    if (m_pWriter == nullptr)
+        return;
+
+    const auto pIter = m_mIndex.find(sKey);
+    if (pIter == m_mIndex.end())
+        return;
+
+    AppendRecord(*m_pWriter, sKey, nullptr, 0);
+    FlushWriter(*m_pWriter);
+
+    const auto nRemovedSize = GetRecordSize(sKey.length(), REMOVED_SIZE);
+    m_nFileSize += nRemovedSize;
+    m_nWastedSize += GetRecordSize(sKey.length(), pIter->second.nSize) + nRemovedSize;
+    m_mIndex.erase(pIter);
+
+    m_pReader.reset();
+}
+
+std::vector<PackedFileStore::EntryInfo> PackedFileStore::GetEntries() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+
+    std::vector<EntryInfo> vEntries;
+    vEntries.reserve(m_mIndex.size());
+    for (const auto& pPair : m_mIndex)
+    {
+        vEntries.push_back({pPair.first, gsl::narrow_cast<int64_t>(pPair.second.nSize),
+                            std::chrono::system_clock::from_time_t(gsl::narrow_cast<time_t>(pPair.second.nTimestamp))});
+    }
+
+    return vEntries;
+}
+
+int64_t PackedFileStore::GetFileSize() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_nFileSize;
+}
+
+int64_t PackedFileStore::GetWastedSize() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_nWastedSize;
+}
+
+bool PackedFileStore::NeedsCompaction() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return (m_nWastedSize >= COMPACT_MIN_WASTED_SIZE && m_nWastedSize * 2 >= m_nFileSize);
+}
+
+bool PackedFileStore::Compact()
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return CompactLocked();
+}
+
+bool PackedFileStore::CompactLocked()
+{
+    // write the live entries to a new file, then replace the old file with it
+    const std::wstring sTempPath = m_sPath + L".tmp";
+    auto pWriter = m_pFileSystem.CreateTextFile(sTempPath);
+    if (pWriter == nullptr)
+        return false;
+
+    pWriter->Write(GetFileHeader());
+    auto nFileSize = gsl::narrow_cast<int64_t>(HEADER_SIZE);
+
+    std::unordered_map<std::string, Entry> mIndex;
+    mIndex.reserve(m_mIndex.size());
+
+    std::string sData;
+    for (const auto& pPair : m_mIndex)
+    {
+        if (!ReadEntry(pPair.second, sData))
+        {
+            RA_LOG_WARN("Could not read %s from %s", pPair.first, ra::Narrow(m_sPath));
+            continue;
+        }
+
+        AppendRecord(*pWriter, pPair.first, &sData, pPair.second.nTimestamp);
+        const Entry pEntry{nFileSize + gsl::narrow_cast<int64_t>(RECORD_HEADER_SIZE + pPair.first.length()),
+                           pPair.second.nSize, pPair.second.nTimestamp};
+        mIndex.emplace(pPair.first, pEntry);
+        nFileSize += GetRecordSize(pPair.first.length(), pPair.second.nSize);
+    }
+
+    FlushWriter(*pWriter);
+
+    // close everything before replacing the file
+    pWriter.reset();
+    m_pWriter.reset();
+    m_pReader.reset();
+
+    m_pFileSystem.DeleteFile(m_sPath);
+    if (!m_pFileSystem.MoveFile(sTempPath, m_sPath))
+    {
+        RA_LOG_ERR("Could not replace %s", ra::Narrow(m_sPath));
+        m_mIndex.clear();
+        m_nFileSize = m_nWastedSize = 0;
+        return false;
+    }
+
+    m_mIndex.swap(mIndex);
+    m_nFileSize = nFileSize;
+    m_nWastedSize = 0;
+
+    RA_LOG_INFO("Compacted %s: %zu entries, %lld bytes", ra::Narrow(m_sPath), m_mIndex.size(), m_nFileSize);
+
+    m_pWriter = m_pFileSystem.AppendTextFile(m_sPath);
+    return (m_pWriter != nullptr);
+}
+
+} // namespace impl
+} // namespace services
+} // namespace ra
@@ -0,0 +1,127 @@
+#ifndef RA_SERVICES_PACKEDFILESTORE_HH
+#define RA_SERVICES_PACKEDFILESTORE_HH
+#pragma once
+
+#include "services\IFileSystem.hh"
+
+namespace ra {
+namespace services {
+namespace impl {
+
+/// <summary>
+/// Stores many small blobs in a single file.
+/// </summary>
+/// <remarks>
+/// Entries are appended to the end of the file. A newer entry for a key replaces any older entry for the same key.
+/// The index of the newest entry for each key is rebuilt from the record headers when the file is opened.
+/// Replaced and removed entries waste space until <see cref="Compact" /> rewrites the file.
+/// </remarks>
+class PackedFileStore
+{
+public:
+    explicit PackedFileStore(const IFileSystem& pFileSystem, const std::wstring& sPath);
+    ~PackedFileStore() noexcept = default;
+    PackedFileStore(const PackedFileStore&) noexcept = delete;
+    PackedFileStore& operator=(const PackedFileStore&) noexcept = delete;
+    PackedFileStore(PackedFileStore&&) noexcept = delete;
+    PackedFileStore& operator=(PackedFileStore&&) noexcept = delete;
+
+    /// <summary>
+    /// Opens the file and builds the index, creating the file if it doesn't exist.
+    /// </summary>
+    /// <returns><c>true</c> if the store can be used.</returns>
+    bool Open();
+
+    /// <summary>
+    /// Determines if the store has data for <paramref name="sKey" />.
+    /// </summary>
+    bool Contains(const std::string& sKey) const;
+
+    /// <summary>
+    /// Gets when the data for <paramref name="sKey" /> was written.
+    /// </summary>
+    /// <returns>Time the data was written, <c>0</c> if it doesn't exist.</returns>
+    std::chrono::system_clock::time_point GetLastModified(const std::string& sKey) const;
+
+    /// <summary>
+    /// Reads the data for <paramref name="sKey" />.
+    /// </summary>
+    /// <returns><c>true</c> if the data was read, <c>false</c> if it doesn't exist or could not be read.</returns>
+    bool Read(const std::string& sKey, std::string& sData) const;
+
+    /// <summary>
+    /// Writes the data for <paramref name="sKey" />, replacing any existing data.
+    /// </summary>
+    void Write(const std::string& sKey, const std::string& sData, std::chrono::system_clock::time_point tLastModified);
+
+    /// <summary>
+    /// Removes the data for <paramref name="sKey" />.
+    /// </summary>
+    void Remove(const std::string& sKey);
+
+    struct EntryInfo
+    {
+        std::string sKey;
+        int64_t nSize;
+        std::chrono::system_clock::time_point tLastModified;
+    };
+
+    /// <summary>
+    /// Gets information about every entry in the store.
+    /// </summary>
+    std::vector<EntryInfo> GetEntries() const;
+
+    /// <summary>
+    /// Gets the size of the file, including space used by replaced and removed entries.
+    /// </summary>
+    int64_t GetFileSize() const;
+
+    /// <summary>
+    /// Gets the amount of space used by replaced and removed entries.
+    /// </summary>
+    int64_t GetWastedSize() const;
+
+    /// <summary>
+    /// Determines if enough space is wasted that the file should be compacted.
+    /// </summary>
+    bool NeedsCompaction() const;
+
+    /// <summary>
+    /// Rewrites the file without the replaced and removed entries.
+    /// </summary>
+    bool Compact();
+
+    static constexpr int64_t COMPACT_MIN_WASTED_SIZE = 1024 * 1024;
+    static constexpr size_t MAX_KEY_LENGTH = 256;
+
+private:
+    struct Entry
+    {
+        int64_t nOffset;   // offset of the data (not the record header)
+        uint32_t nSize;
+        int64_t nTimestamp;
+    };
+
+    bool LoadIndex(TextReader& pReader, int64_t nFileSize);
+    static void AppendRecord(TextWriter& pWriter, const std::string& sKey, const std::string* pData, int64_t nTimestamp);
+    bool ReadEntry(const Entry& pEntry, std::string& sData) const;
+    bool CompactLocked();
+    static int64_t GetRecordSize(size_t nKeyLength, uint32_t nDataSize) noexcept;
+
+    const IFileSystem& m_pFileSystem;
+    std::wstring m_sPath;
+
+    std::unordered_map<std::string, Entry> m_mIndex;
+    int64_t m_nFileSize = 0;
+    int64_t m_nWastedSize = 0;
+
+    std::unique_ptr<TextWriter> m_pWriter;
+    mutable std::unique_ptr<TextReader> m_pReader; // released after each write so the next read sees the new data
+    mutable std::mutex m_oMutex;
+};
+
+} // namespace impl
+} // namespace services
+} // namespace ra
+
+#endif // !RA_SERVICES_PACKEDFILESTORE_HH
@@ -1,11 +1,18 @@
 #include "ThreadPool.hh"
 
 #include "RA_Log.h"
+#include "RA_StringUtils.h"
+
+#include "services\Tracer.hh"
 
 namespace ra {
 namespace services {
 namespace impl {
 
+// identifies the worker running on the current thread so work queued from a worker goes to its own queue
+static thread_local const ThreadPool* s_pCurrentPool = nullptr;
+static thread_local size_t s_nCurrentWorker = 0U;
+
 ThreadPool::~ThreadPool() noexcept
 {
     Shutdown(true);
@@ -15,33 +22,214 @@ void ThreadPool::Initialize(size_t nThreads) noexcept
 {
     assert(m_vThreads.empty());
 
-    // require at least two threads. that way if one thread is reserved for processing timed events, another is still available to execute them.
-    if (nThreads < 2)
-        nThreads = 2; 
+    // timed events are managed by a separate thread, so every worker thread is available for work
+    if (nThreads < 1)
+        nThreads = 1;
 
     RA_LOG_INFO("Initializing %zu worker threads", nThreads);
 
+    // keep at least one thread available for critical and interactive work, and only let one idle task run at a time.
+    // with a single thread, background work has to share it or it would never run.
+    SetMaxConcurrentTasks(TaskPriority::Background, (nThreads > 1) ? nThreads - 1 : 1);
+    SetMaxConcurrentTasks(TaskPriority::Idle, 1);
+
+    // create all of the queues before starting any threads so the threads can safely steal from each other
+    for (size_t i = 0; i < nThreads; ++i)
+        m_vWorkers.emplace_back(std::make_unique<Worker>());
+
     for (size_t i = 0; i < nThreads; ++i)
-        m_vThreads.emplace_back(&ThreadPool::RunThread, this);
+        m_vThreads.emplace_back(&ThreadPool::RunThread, this, i);
+
+    m_pTimerThread = std::thread(&ThreadPool::RunTimerThread, this);
 }
 
-void ThreadPool::RunThread()
+void ThreadPool::SetMaxConcurrentTasks(TaskPriority nPriority, size_t nMaxTasks) noexcept
 {
-    do
+    // always allow at least one task so the lane can't be blocked forever
+    m_vLanes.at(static_cast<size_t>(nPriority)).nMaxRunning = (nMaxTasks > 0) ? nMaxTasks : 1;
+}
+
+void ThreadPool::RunAsync(std::function<void()>&& f, TaskPriority nPriority)
+{
+    if (m_bShutdownInitiated)
+        return;
+
+    assert(!m_vWorkers.empty());
+
+    // when tracing, link the point where the task was queued to the point where it runs
+    auto* pTracer = TraceSpan::GetActiveTracer();
+    if (pTracer != nullptr)
     {
-        // check for work
-        do
+        const auto nFlowId = pTracer->BeginFlow("Task");
+        f = [f = std::move(f), nFlowId]() {
+            // the end of the flow binds to the enclosing span, so it has to be recorded inside the span
+            TraceSpan span("Task");
+
+            auto* pTaskTracer = TraceSpan::GetActiveTracer();
+            if (pTaskTracer != nullptr)
+                pTaskTracer->EndFlow("Task", nFlowId);
+
+            f();
+        };
+    }
+
+    const auto nLane = static_cast<size_t>(nPriority);
+    const size_t nWorkerIndex = (s_pCurrentPool == this) ? s_nCurrentWorker :
+        (m_nNextWorker.fetch_add(1) % m_vWorkers.size());
+
+    // count the task before it's visible so a worker that pops it can never drive the counter below zero
+    ++m_vLanes.at(nLane).nPending;
+
+    auto& pWorker = *m_vWorkers.at(nWorkerIndex);
+    {
+        std::lock_guard<std::mutex> lock(pWorker.oMutex);
+        pWorker.vQueues.at(nLane).push_back(std::move(f));
+    }
+
+    WakeWorker();
+}
+
+void ThreadPool::WakeWorker()
+{
+    // a parked worker checks for runnable tasks while holding m_oParkMutex before it waits. taking the lock here
+    // guarantees the worker is either waiting (and will get the notification) or will see the new task.
+    if (m_nParkedWorkers > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_oParkMutex);
+        m_cvWork.notify_one();
+    }
+}
+
+bool ThreadPool::HasRunnableTask() const noexcept
+{
+    for (const auto& pLane : m_vLanes)
+    {
+        if (pLane.nPending > 0 && pLane.nRunning < pLane.nMaxRunning)
+            return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::ReleaseSlot(size_t nLane)
+{
+    auto& pLane = m_vLanes.at(nLane);
+    --pLane.nRunning;
+
+    // if the lane was at capacity, a worker may have parked while tasks were still waiting
+    if (pLane.nPending > 0)
+        WakeWorker();
+}
+
+bool ThreadPool::PopTaskFromLane(size_t nWorkerIndex, size_t nLane, std::function<void()>& pTask)
+{
+    auto& pLane = m_vLanes.at(nLane);
+    if (pLane.nPending == 0)
+        return false;
+
+    // reserve a slot before looking for a task so the concurrency limit can't be exceeded
+    if (++pLane.nRunning > pLane.nMaxRunning)
+    {
+        ReleaseSlot(nLane);
+        return false;
+    }
+
+    // check our own queue first
+    {
+        auto& pWorker = *m_vWorkers.at(nWorkerIndex);
+        std::lock_guard<std::mutex> lock(pWorker.oMutex);
+        auto& vQueue = pWorker.vQueues.at(nLane);
+        if (!vQueue.empty())
         {
-            std::function<void()> pNext;
-            {
-                std::unique_lock<std::mutex> lock(m_oMutex);
-                if (m_vQueue.empty())
-                    break;
+            pTask = std::move(vQueue.front());
+            vQueue.pop_front();
+            --pLane.nPending;
+            return true;
+        }
+    }
 
-                pNext = std::move(m_vQueue.front());
-                m_vQueue.pop_front();
+    // then try to steal the oldest item from another worker's queue
+    const size_t nWorkers = m_vWorkers.size();
+    for (size_t i = 1; i < nWorkers; ++i)
+    {
+        auto& pVictim = *m_vWorkers.at((nWorkerIndex + i) % nWorkers);
+        std::lock_guard<std::mutex> lock(pVictim.oMutex);
+        auto& vQueue = pVictim.vQueues.at(nLane);
+        if (!vQueue.empty())
+        {
+            pTask = std::move(vQueue.front());
+            vQueue.pop_front();
+            --pLane.nPending;
+            return true;
+        }
+    }
+
+    ReleaseSlot(nLane);
+    return false;
+}
+
+bool ThreadPool::PopTask(size_t nWorkerIndex, std::function<void()>& pTask, size_t& nLane)
+{
+    // if a lower priority lane has been passed over too many times, give it a turn so it doesn't starve
+    constexpr size_t STARVATION_THRESHOLD = 8;
+    size_t nStarvedLane = 0;
+    for (size_t i = NUM_PRIORITIES - 1; i > 0; --i)
+    {
+        if (m_vLanes.at(i).nSkipped >= STARVATION_THRESHOLD)
+        {
+            nStarvedLane = i;
+            break;
+        }
+    }
+
+    for (size_t nAttempt = 0; nAttempt <= NUM_PRIORITIES; ++nAttempt)
+    {
+        if (nAttempt == 0)
+        {
+            if (nStarvedLane == 0)
+                continue;
+
+            nLane = nStarvedLane;
+        }
+        else
+        {
+            nLane = nAttempt - 1;
+        }
+
+        if (PopTaskFromLane(nWorkerIndex, nLane, pTask))
+        {
+            m_vLanes.at(nLane).nSkipped = 0;
+
+            for (size_t i = nLane + 1; i < NUM_PRIORITIES; ++i)
+            {
+                auto& pLane = m_vLanes.at(i);
+                if (pLane.nPending > 0)
+                    ++pLane.nSkipped;
             }
 
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::RunThread(size_t nWorkerIndex)
+{
+    s_pCurrentPool = this;
+    s_nCurrentWorker = nWorkerIndex;
+
+    auto* pTracer = TraceSpan::GetActiveTracer();
+    if (pTracer != nullptr)
+        pTracer->SetThreadName(ra::StringPrintf("Worker %zu", nWorkerIndex));
+
+    do
+    {
+        // check for work
+        std::function<void()> pNext;
+        size_t nLane = 0;
+        while (!m_bShutdownInitiated && PopTask(nWorkerIndex, pNext, nLane))
+        {
             // do work
             try
             {
@@ -51,76 +239,150 @@ void ThreadPool::RunThread()
             {
                 RA_LOG_ERR("Exception on background thread: %s", ex.what());
             }
-        } while (!m_bShutdownInitiated);
+
+            pNext = nullptr;
+            ReleaseSlot(nLane);
+        }
 
         // wait for work
         if (!m_bShutdownInitiated)
         {
-            std::unique_lock<std::mutex> lock(m_oMutex);
-            m_cvWork.wait(lock);
+            std::unique_lock<std::mutex> lock(m_oParkMutex);
+            ++m_nParkedWorkers;
+            m_cvWork.wait(lock, [this]() noexcept { return HasRunnableTask() || m_bShutdownInitiated; });
+            --m_nParkedWorkers;
         }
     } while (!m_bShutdownInitiated);
+
+    s_pCurrentPool = nullptr;
 }
 
-void ThreadPool::ProcessDelayedTasks()
+IThreadPool::ScheduledTaskId ThreadPool::ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                                                      TaskPriority nPriority)
 {
-    auto& pClock = ServiceLocator::Get<IClock>();
-    constexpr auto tZeroMilliseconds = std::chrono::milliseconds(0);
+    if (m_bShutdownInitiated)
+        return 0;
 
-    // check for work
-    while (!m_bShutdownInitiated)
+    assert(!m_vThreads.empty());
+
+    const auto tWhen = std::chrono::ceil<std::chrono::milliseconds>(ServiceLocator::Get<IClock>().UpTime() + nDelay);
+
+    ScheduledTaskId nId = 0;
+    bool bNewPriority = false;
     {
-        // move any work that needs to occur now to the work queue
-        size_t nReadyTasks = 0U;
+        std::lock_guard<std::mutex> lock(m_oDelayedMutex);
+
+        do
         {
-            std::unique_lock<std::mutex> lock(m_oMutex);
+            nId = ++m_nLastScheduledTaskId;
+        } while (nId == 0 || m_mDelayedTaskLookup.find(nId) != m_mDelayedTaskLookup.end());
 
-            const auto tNow = pClock.UpTime();
-            while (!m_vDelayedTasks.empty() && m_vDelayedTasks.front().tWhen <= tNow)
-            {
-                m_vQueue.emplace_front(std::move(m_vDelayedTasks.front().fTask));
-                m_vDelayedTasks.pop_front();
+        // sooner than the next scheduled task, we'll need to wake the timer thread to reset the wait time
+        bNewPriority = (m_mDelayedTasks.empty() || tWhen < m_mDelayedTasks.begin()->first);
 
-                ++nReadyTasks;
-            }
-        }
+        m_mDelayedTasks[tWhen].emplace_back(nId, nPriority, std::move(f));
+        m_mDelayedTaskLookup.emplace(nId, tWhen);
+    }
 
-        if (m_bShutdownInitiated)
-            break;
+    if (bNewPriority)
+        m_cvDelayedWork.notify_one();
 
-        // wake up other threads to do the work
-        if (nReadyTasks >= m_nThreads - 1) // we're using one thread
+    return nId;
+}
+
+bool ThreadPool::CancelScheduledTask(ScheduledTaskId nId)
+{
+    std::lock_guard<std::mutex> lock(m_oDelayedMutex);
+
+    const auto pLookup = m_mDelayedTaskLookup.find(nId);
+    if (pLookup == m_mDelayedTaskLookup.end())
+        return false;
+
+    const auto pIter = m_mDelayedTasks.find(pLookup->second);
+    m_mDelayedTaskLookup.erase(pLookup);
+    if (pIter == m_mDelayedTasks.end())
+        return false;
+
+    auto& vTasks = pIter->second;
+    for (auto pTask = vTasks.begin(); pTask != vTasks.end(); ++pTask)
+    {
+        if (pTask->nId == nId)
         {
-            m_cvWork.notify_all();
+            vTasks.erase(pTask);
+            break;
         }
-        else
+    }
+
+    // the timer thread may wake up for an empty node if it was the next one due. that's harmless - it will just
+    // recalculate the time until the next event.
+    if (vTasks.empty())
+        m_mDelayedTasks.erase(pIter);
+
+    return true;
+}
+
+void ThreadPool::RunTimerThread()
+{
+    constexpr auto tZeroMilliseconds = std::chrono::milliseconds(0);
+
+    auto* pTracer = TraceSpan::GetActiveTracer();
+    if (pTracer != nullptr)
+        pTracer->SetThreadName("Timer");
+
+    std::unique_lock<std::mutex> lock(m_oDelayedMutex);
+    while (!m_bShutdownInitiated)
+    {
+        if (m_mDelayedTasks.empty())
         {
-            while (nReadyTasks--)
-                m_cvWork.notify_one();
+            // nothing scheduled, wait until something is
+            m_cvDelayedWork.wait(lock);
+            continue;
         }
 
-
         // sleep until it's time to do the next work. use a wait_for instead of a sleep so we can can be woken
         // early if new work gets added that needs to occur sooner that we were expecting.
+        const auto pNext = m_mDelayedTasks.begin();
+        const auto tNext = pNext->first - ServiceLocator::Get<IClock>().UpTime();
+        if (tNext > tZeroMilliseconds)
         {
-            std::unique_lock<std::mutex> lock(m_oMutex);
+            m_cvDelayedWork.wait_for(lock, tNext);
+            continue;
+        }
 
-            // no more delayed tasks, free up the thread for other work
-            if (m_vDelayedTasks.empty())
-                break;
+        // move the work that needs to occur now to the worker queues
+        std::vector<DelayedTask> vReadyTasks = std::move(pNext->second);
+        m_mDelayedTasks.erase(pNext);
+        for (const auto& pTask : vReadyTasks)
+            m_mDelayedTaskLookup.erase(pTask.nId);
 
-            const auto tNext = m_vDelayedTasks.front().tWhen - pClock.UpTime();
-            if (tNext > tZeroMilliseconds)
-                m_cvDelayedWork.wait_for(lock, tNext);
-        }
+        lock.unlock();
+
+        for (auto& pTask : vReadyTasks)
+            RunAsync(std::move(pTask.fTask), pTask.nPriority);
+
+        lock.lock();
     }
 }
 
 void ThreadPool::Shutdown(bool bWait) noexcept
 {
     m_bShutdownInitiated = true;
-    m_cvDelayedWork.notify_all();
-    m_cvWork.notify_all();
+
+    // take the locks so a thread that has checked the flag but not started waiting yet can't miss the notification
+    {
+        std::lock_guard<std::mutex> lock(m_oDelayedMutex);
+        m_cvDelayedWork.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_oParkMutex);
+        m_cvWork.notify_all();
+    }
+
+    // the timer thread doesn't run tasks, so it stops as soon as it sees the flag. always wait for it so nothing
+    // is left running after the last Shutdown call.
+    if (m_pTimerThread.joinable() && m_pTimerThread.get_id() != std::this_thread::get_id())
+        m_pTimerThread.join();
 
     if (bWait && !m_vThreads.empty())
     {
@@ -133,7 +395,6 @@ void ThreadPool::Shutdown(bool bWait) noexcept
 
         m_vThreads.clear();
     }
-
 }
 
 } // namespace impl
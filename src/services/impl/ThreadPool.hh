@@ -29,101 +29,84 @@ public:
 
     GSL_SUPPRESS_F6 void Initialize(size_t nThreads) noexcept;
 
-    void RunAsync(std::function<void()>&& f) override
-    {
-        if (m_bShutdownInitiated)
-            return;
-
-        assert(!m_vThreads.empty());
+    void RunAsync(std::function<void()>&& f, TaskPriority nPriority = TaskPriority::Interactive) override;
 
-        {
-            std::unique_lock<std::mutex> lock(m_oMutex);
-            m_vQueue.push_back(std::move(f));
-        }
+    ScheduledTaskId ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                                  TaskPriority nPriority = TaskPriority::Interactive) override;
 
-        m_cvWork.notify_one();
-    }
-
-    void ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f) override
-    {
-        if (m_bShutdownInitiated)
-            return;
-
-        assert(!m_vThreads.empty());
-
-        const auto tWhen = ServiceLocator::Get<IClock>().UpTime() + nDelay;
-
-        bool bStartScheduler = false;
-        bool bNewPriority    = false;
-        {
-            std::unique_lock<std::mutex> lock(m_oMutex);
-
-            auto iter = m_vDelayedTasks.begin();
-
-            if (m_vDelayedTasks.empty())
-            {
-                // first scheduled task - dedicate one of the background threads to timed events
-                m_vQueue.push_front([this]() { ProcessDelayedTasks(); });
-                bStartScheduler = true;
-            }
-            else if (tWhen < iter->tWhen)
-            {
-                // sooner than the next scheduled task, we'll need to wake the timed events thread to reset the wait
-                // time
-                bNewPriority = true;
-            }
-            else
-            {
-                // after the next scheduled task, find where to insert it
-                do
-                {
-                    ++iter;
-                } while (iter != m_vDelayedTasks.end() && iter->tWhen < tWhen);
-            }
-
-            m_vDelayedTasks.emplace(iter, tWhen, std::move(f));
-        }
-
-        if (bStartScheduler)
-        {
-            // wake one of the background threads to process the timed events
-            m_cvWork.notify_one();
-        }
-
-        if (bNewPriority)
-        {
-            // wake the timed events thread to recalculate the time until the next event
-            m_cvDelayedWork.notify_one();
-        }
-    }
+    bool CancelScheduledTask(ScheduledTaskId nId) override;
 
     GSL_SUPPRESS_F6 void Shutdown(bool bWait) noexcept override;
 
     bool IsShutdownRequested() const noexcept override { return m_bShutdownInitiated; }
 
+    /// <summary>
+    /// Limits the number of tasks of the specified priority that can run at the same time.
+    /// </summary>
+    void SetMaxConcurrentTasks(TaskPriority nPriority, size_t nMaxTasks) noexcept;
+
 private:
-    void RunThread();
-    void ProcessDelayedTasks();
+    static constexpr size_t NUM_PRIORITIES = static_cast<size_t>(TaskPriority::Idle) + 1;
+
+    // each worker owns a queue per priority with its own lock, so producers and consumers only contend when they touch
+    // the same worker. a worker starts tasks from the front of its own queue, so work queued from a worker starts in
+    // the order it was queued. idle workers steal from the front of other workers' queues. there is no ordering
+    // between tasks in different queues.
+    struct Worker
+    {
+        std::array<std::deque<std::function<void()>>, NUM_PRIORITIES> vQueues;
+        std::mutex oMutex;
+    };
+
+    // counters for each priority. all updated without taking a lock.
+    struct Lane
+    {
+        std::atomic<size_t> nPending{0U};   // tasks queued but not started
+        std::atomic<size_t> nRunning{0U};   // tasks currently running (or reserved slots)
+        std::atomic<size_t> nMaxRunning{std::numeric_limits<size_t>::max()};
+        std::atomic<size_t> nSkipped{0U};   // tasks started from a higher priority while this lane had work waiting
+    };
+
+    void RunThread(size_t nWorkerIndex);
+    bool PopTask(size_t nWorkerIndex, std::function<void()>& pTask, size_t& nLane);
+    bool PopTaskFromLane(size_t nWorkerIndex, size_t nLane, std::function<void()>& pTask);
+    bool HasRunnableTask() const noexcept;
+    void ReleaseSlot(size_t nLane);
+    void WakeWorker();
+    void RunTimerThread();
 
     std::vector<std::thread> m_vThreads;
-    size_t m_nThreads{0U};
-    bool m_bShutdownInitiated{false};
+    std::vector<std::unique_ptr<Worker>> m_vWorkers;
+    std::atomic_bool m_bShutdownInitiated{false};
+
+    // round-robin distribution of work queued from threads that aren't part of the pool
+    std::atomic<size_t> m_nNextWorker{0U};
+
+    std::array<Lane, NUM_PRIORITIES> m_vLanes;
 
+    // idle workers park on m_cvWork. producers only take the lock to wake a worker if one is parked.
+    std::atomic<size_t> m_nParkedWorkers{0U};
+    std::mutex m_oParkMutex;
+    std::condition_variable m_cvWork;
+
+    // scheduled tasks are keyed by deadline, which is rounded up to the next millisecond so timers that expire
+    // together share a node and are released to the workers as a single batch. the lookup allows cancelling a
+    // task without scanning the whole schedule.
     struct DelayedTask
     {
-        DelayedTask(std::chrono::steady_clock::time_point tWhen, std::function<void()> fTask) :
-            tWhen(tWhen),
-            fTask(fTask){};
+        DelayedTask(ScheduledTaskId nId, TaskPriority nPriority, std::function<void()>&& fTask) noexcept :
+            nId(nId), nPriority(nPriority), fTask(std::move(fTask)) {}
 
-        std::chrono::steady_clock::time_point tWhen;
+        ScheduledTaskId nId;
+        TaskPriority nPriority;
         std::function<void()> fTask;
     };
-    std::deque<DelayedTask> m_vDelayedTasks;
-
-    std::deque<std::function<void()>> m_vQueue;
-    std::mutex m_oMutex;
-    std::condition_variable m_cvWork;
+    std::map<std::chrono::steady_clock::time_point, std::vector<DelayedTask>> m_mDelayedTasks;
+    std::unordered_map<ScheduledTaskId, std::chrono::steady_clock::time_point> m_mDelayedTaskLookup;
+    ScheduledTaskId m_nLastScheduledTaskId = 0;
+    std::mutex m_oDelayedMutex;
     std::condition_variable m_cvDelayedWork;
+    std::thread m_pTimerThread;
 };
 
 } // namespace impl
@@ -13,19 +13,53 @@ namespace ra {
 namespace services {
 namespace impl {
 
-static bool ReadIntoString(const HINTERNET hRequest, std::string& sBuffer, DWORD& nStatusCode)
+static bool GetContentLength(const HINTERNET hRequest, DWORD& nContentLength)
 {
     DWORD dwSize = sizeof(DWORD);
-    DWORD nContentLength = 0;
+    nContentLength = 0;
 
 #pragma warning(push)
 #pragma warning(disable: 26477)
     GSL_SUPPRESS_ES47
-    if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_LENGTH | WINHTTP_QUERY_FLAG_NUMBER,
-                             WINHTTP_HEADER_NAME_BY_INDEX, &nContentLength, &dwSize, WINHTTP_NO_HEADER_INDEX))
-        return false;
+    return WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_LENGTH | WINHTTP_QUERY_FLAG_NUMBER,
+                               WINHTTP_HEADER_NAME_BY_INDEX, &nContentLength, &dwSize, WINHTTP_NO_HEADER_INDEX) != FALSE;
+#pragma warning(pop)
+}
+
+static std::wstring GetContentEncoding(const HINTERNET hRequest)
+{
+    std::wstring sEncoding;
+    sEncoding.resize(32);
+    DWORD dwSize = gsl::narrow_cast<DWORD>(sEncoding.size() * sizeof(wchar_t));
+
+#pragma warning(push)
+#pragma warning(disable: 26477)
+    GSL_SUPPRESS_ES47
+    if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_ENCODING, WINHTTP_HEADER_NAME_BY_INDEX,
+                             sEncoding.data(), &dwSize, WINHTTP_NO_HEADER_INDEX))
+    {
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+            return std::wstring();
+
+        // dwSize now contains the required size in bytes
+        sEncoding.resize(dwSize / sizeof(wchar_t) + 1);
+        GSL_SUPPRESS_ES47
+        if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_ENCODING, WINHTTP_HEADER_NAME_BY_INDEX,
+                                 sEncoding.data(), &dwSize, WINHTTP_NO_HEADER_INDEX))
+            return std::wstring();
+    }
 #pragma warning(pop)
 
+    sEncoding.resize(dwSize / sizeof(wchar_t));
+    return sEncoding;
+}
+
+static bool ReadIntoString(const HINTERNET hRequest, std::string& sBuffer, DWORD& nStatusCode)
+{
+    DWORD nContentLength = 0;
+    if (!GetContentLength(hRequest, nContentLength))
+        return false;
+
     // allocate enough space in the string for the whole content
     sBuffer.resize(gsl::narrow_cast<size_t>(nContentLength) + 1); // reserve space for null terminator
     sBuffer.at(nContentLength) = '\0'; // set null terminator, will fill remaining portion of buffer
@@ -37,8 +71,12 @@ static bool ReadIntoString(const HINTERNET hRequest, std::string& sBuffer, DWORD
     DWORD nInsertAt = 0U;
     while (nAvailableBytes > 0)
     {
+        // Content-Length is only a hint. if more data is available than expected, make room for it.
+        if (nInsertAt + nAvailableBytes > gsl::narrow_cast<DWORD>(sBuffer.size()))
+            sBuffer.resize(gsl::narrow_cast<size_t>(nInsertAt) + nAvailableBytes);
+
         DWORD nBytesFetched = 0U;
-        const DWORD nBytesToRead = gsl::narrow_cast<DWORD>(sBuffer.capacity()) - nInsertAt;
+        const DWORD nBytesToRead = gsl::narrow_cast<DWORD>(sBuffer.size()) - nInsertAt;
         if (WinHttpReadData(hRequest, &sBuffer.at(nInsertAt), nBytesToRead, &nBytesFetched))
         {
             nInsertAt += nBytesFetched;
@@ -54,11 +92,13 @@ static bool ReadIntoString(const HINTERNET hRequest, std::string& sBuffer, DWORD
         WinHttpQueryDataAvailable(hRequest, &nAvailableBytes);
     }
 
+    sBuffer.resize(nInsertAt);
     return true;
 }
 
-static void ReadIntoWriter(const HINTERNET hRequest, ra::services::TextWriter& pContentWriter, DWORD& nStatusCode)
+static size_t ReadIntoWriter(const HINTERNET hRequest, ra::services::TextWriter& pContentWriter, DWORD& nStatusCode)
 {
+    size_t nTotalBytes = 0U;
     DWORD nAvailableBytes = 0;
     WinHttpQueryDataAvailable(hRequest, &nAvailableBytes);
 
@@ -75,6 +115,7 @@ static void ReadIntoWriter(const HINTERNET hRequest, ra::services::TextWriter& p
         {
             sBuffer.resize(nBytesFetched);
             pContentWriter.Write(sBuffer);
+            nTotalBytes += nBytesFetched;
         }
         else
         {
@@ -86,148 +127,274 @@ static void ReadIntoWriter(const HINTERNET hRequest, ra::services::TextWriter& p
 
         WinHttpQueryDataAvailable(hRequest, &nAvailableBytes);
     }
+
+    return nTotalBytes;
 }
 
-unsigned int WindowsHttpRequester::Request(const Http::Request& pRequest, TextWriter& pContentWriter) const
+WindowsHttpRequester::~WindowsHttpRequester() noexcept
 {
-    DWORD nStatusCode = 0;
+    // connection handles must be closed before the session that owns them
+    for (auto& pPair : m_mConnections)
+        WinHttpCloseHandle(pPair.second);
+    m_mConnections.clear();
+
+    if (m_hSession != nullptr)
+    {
+        WinHttpCloseHandle(m_hSession);
+        m_hSession = nullptr;
+    }
+}
+
+void WindowsHttpRequester::SetUserAgent(const std::string& sUserAgent)
+{
+    std::lock_guard<std::mutex> pLock(m_mtxHandles);
+    m_sUserAgent = ra::Widen(sUserAgent);
+
+    if (m_hSession != nullptr)
+    {
+        WinHttpSetOption(m_hSession, WINHTTP_OPTION_USER_AGENT, m_sUserAgent.data(),
+                         gsl::narrow_cast<DWORD>(m_sUserAgent.length()));
+    }
+}
+
+// must be called while holding m_mtxHandles
+void* WindowsHttpRequester::GetSession(unsigned int& nStatusCode) const
+{
+    nStatusCode = 0;
 
-    // obtain a session handle.
+    if (m_hSession == nullptr)
+    {
 #pragma warning(push)
 #pragma warning(disable: 26477)
-    GSL_SUPPRESS_ES47 HINTERNET hSession = WinHttpOpen(m_sUserAgent.c_str(), WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-                                                       WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+        GSL_SUPPRESS_ES47 m_hSession = WinHttpOpen(m_sUserAgent.c_str(), WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+                                                   WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
 #pragma warning(pop)
 
+        if (m_hSession == nullptr)
+        {
+            nStatusCode = GetLastError();
+        }
+#ifdef WINHTTP_OPTION_DECOMPRESSION
+        else
+        {
+            // ask WinHTTP to send "Accept-Encoding: gzip, deflate" and decompress the response as it's read.
+            // this option is only supported on Windows 8.1 and later. if it fails, responses will be
+            // transferred uncompressed, which is what happened before.
+            DWORD nValue = WINHTTP_DECOMPRESSION_FLAG_ALL;
+            if (!WinHttpSetOption(m_hSession, WINHTTP_OPTION_DECOMPRESSION, &nValue, sizeof(nValue)))
+                RA_LOG_INFO("HTTP decompression not supported (%u)", GetLastError());
+        }
+#endif
+    }
+
+    return m_hSession;
+}
+
+void* WindowsHttpRequester::GetConnection(const std::wstring& sHostName, unsigned short nPort, bool& bReused,
+                                          unsigned int& nStatusCode) const
+{
+    std::lock_guard<std::mutex> pLock(m_mtxHandles);
+    bReused = false;
+
+    HINTERNET hSession = GetSession(nStatusCode);
     if (hSession == nullptr)
+        return nullptr;
+
+    auto sKey = ra::StringPrintf(L"%s:%u", sHostName, nPort);
+    const auto pIter = m_mConnections.find(sKey);
+    if (pIter != m_mConnections.end())
+    {
+        bReused = true;
+        return pIter->second;
+    }
+
+    HINTERNET hConnect = WinHttpConnect(hSession, sHostName.c_str(), nPort, 0);
+    if (hConnect == nullptr)
     {
         nStatusCode = GetLastError();
+        return nullptr;
+    }
+
+    m_mConnections.emplace(std::move(sKey), hConnect);
+    return hConnect;
+}
+
+static unsigned int SendRequest(HINTERNET hConnect, const Http::Request& pRequest, const std::wstring& sPath,
+                                bool bSecure, TextWriter& pContentWriter, bool& bResponseReceived)
+{
+    DWORD nStatusCode = 0;
+    bResponseReceived = false;
+    auto sPostData = pRequest.GetPostData();
+
+    // open the connection
+    HINTERNET hRequest = WinHttpOpenRequest(hConnect,
+        sPostData.empty() ? L"GET" : L"POST",
+        sPath.c_str(),
+        nullptr,
+        WINHTTP_NO_REFERER,
+        WINHTTP_DEFAULT_ACCEPT_TYPES,
+        bSecure ? WINHTTP_FLAG_SECURE : 0);
+
+    if (hRequest == nullptr)
+        return GetLastError();
+
+    const auto tTimeout = pRequest.GetTimeout();
+    if (tTimeout.count() > 0)
+    {
+        const auto nTimeout = gsl::narrow_cast<int>(tTimeout.count());
+        WinHttpSetTimeouts(hRequest, nTimeout, nTimeout, nTimeout, nTimeout);
+    }
+
+    std::wstring sHeaders;
+    sHeaders += L"Content-Type: ";
+    sHeaders += ra::Widen(pRequest.GetContentType());
+
+    BOOL bResults{};
+
+    // send the request
+    if (sPostData.empty())
+    {
+        bResults = WinHttpSendRequest(hRequest,
+            sHeaders.c_str(), gsl::narrow_cast<int>(sHeaders.length()),
+            WINHTTP_NO_REQUEST_DATA,
+            0, 0,
+            0);
     }
     else
     {
-        INTERNET_PORT nPort = INTERNET_DEFAULT_HTTP_PORT;
+        bResults = WinHttpSendRequest(hRequest,
+            sHeaders.c_str(), gsl::narrow_cast<int>(sHeaders.length()),
+            static_cast<LPVOID>(sPostData.data()),
+            gsl::narrow_cast<int>(sPostData.length()), gsl::narrow_cast<int>(sPostData.length()),
+            0);
+    }
 
-        auto sUrl = pRequest.GetUrl();
-        if (_strnicmp(sUrl.c_str(), "http://", 7) == 0)
-        {
-            sUrl.erase(0, 7);
-        }
-        else if (_strnicmp(sUrl.c_str(), "https://", 8) == 0)
-        {
-            sUrl.erase(0, 8);
-            nPort = INTERNET_DEFAULT_HTTPS_PORT;
-        }
+    if (!bResults || !WinHttpReceiveResponse(hRequest, nullptr))
+    {
+        nStatusCode = GetLastError();
+    }
+    else
+    {
+        bResponseReceived = true;
 
-        std::string sPath;
-        const auto nIndex = sUrl.find('/');
-        if (nIndex != std::string::npos)
-        {
-            sPath.assign(sUrl, nIndex + 1, std::string::npos);
-            sUrl.resize(nIndex);
-        }
+        // get the http status code
+        DWORD dwSize = sizeof(DWORD);
 
-        // specify the server
-        auto sHostName = ra::Widen(sUrl);
-        HINTERNET hConnect = WinHttpConnect(hSession, sHostName.c_str(), nPort, 0);
+        GSL_SUPPRESS_ES47 WinHttpQueryHeaders(
+            hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX,
+            &nStatusCode, &dwSize, WINHTTP_NO_HEADER_INDEX);
 
-        if (hConnect == nullptr)
+        // if the server compressed the response, WinHTTP will decompress it as it's read. Content-Length is the
+        // compressed size, so it can't be used to presize the buffer.
+        const auto sContentEncoding = GetContentEncoding(hRequest);
+        if (!sContentEncoding.empty())
         {
-            nStatusCode = GetLastError();
+            const size_t nContentBytes = ReadIntoWriter(hRequest, pContentWriter, nStatusCode);
+
+            DWORD nTransferBytes = 0;
+            if (GetContentLength(hRequest, nTransferBytes) && nContentBytes > 0)
+            {
+                RA_LOG_INFO("Received %u bytes (%s) for %zu bytes of content (%zu%% saved)", nTransferBytes,
+                            sContentEncoding, nContentBytes,
+                            (nContentBytes > nTransferBytes) ? (nContentBytes - nTransferBytes) * 100 / nContentBytes : 0);
+            }
         }
         else
         {
-            // merge query parameters onto sPath.
-            std::string sQueryString = pRequest.GetQueryString();
-            if (!sQueryString.empty())
+            // read the response
+            auto* pStringWriter = dynamic_cast<StringTextWriter*>(&pContentWriter);
+            if (pStringWriter != nullptr)
+            {
+                // optimized path for writing to string buffer
+                if (!ReadIntoString(hRequest, pStringWriter->GetString(), nStatusCode))
+                {
+                    // could not use optimization, fall back to buffered reader
+                    ReadIntoWriter(hRequest, pContentWriter, nStatusCode);
+                }
+            }
+            else
             {
-                sPath.push_back('?');
-                sPath += sQueryString;
+                ReadIntoWriter(hRequest, pContentWriter, nStatusCode);
             }
+        }
+    }
 
-            auto sPostData = pRequest.GetPostData();
+    // closing the request handle returns the socket to the session's keep-alive pool
+    WinHttpCloseHandle(hRequest);
 
-            // open the connection
-            auto sPathWide = ra::Widen(sPath);
-            HINTERNET hRequest = WinHttpOpenRequest(hConnect,
-                sPostData.empty() ? L"GET" : L"POST",
-                sPathWide.c_str(),
-                nullptr,
-                WINHTTP_NO_REFERER,
-                WINHTTP_DEFAULT_ACCEPT_TYPES,
-                (nPort == INTERNET_DEFAULT_HTTPS_PORT) ? WINHTTP_FLAG_SECURE : 0);
+    return nStatusCode;
+}
 
-            if (hRequest == nullptr)
-            {
-                nStatusCode = GetLastError();
-            }
-            else
-            {
-                std::wstring sHeaders;
-                sHeaders += L"Content-Type: ";
-                sHeaders += ra::Widen(pRequest.GetContentType());
+unsigned int WindowsHttpRequester::Request(const Http::Request& pRequest, TextWriter& pContentWriter) const
+{
+    INTERNET_PORT nPort = INTERNET_DEFAULT_HTTP_PORT;
 
-                BOOL bResults{};
+    auto sUrl = pRequest.GetUrl();
+    if (_strnicmp(sUrl.c_str(), "http://", 7) == 0)
+    {
+        sUrl.erase(0, 7);
+    }
+    else if (_strnicmp(sUrl.c_str(), "https://", 8) == 0)
+    {
+        sUrl.erase(0, 8);
+        nPort = INTERNET_DEFAULT_HTTPS_PORT;
+    }
 
-                // send the request
-                if (sPostData.empty())
-                {
-                    bResults = WinHttpSendRequest(hRequest,
-                        sHeaders.c_str(), gsl::narrow_cast<int>(sHeaders.length()),
-                        WINHTTP_NO_REQUEST_DATA,
-                        0, 0,
-                        0);
-                }
-                else
-                {
-                    bResults = WinHttpSendRequest(hRequest,
-                        sHeaders.c_str(), gsl::narrow_cast<int>(sHeaders.length()),
-                        static_cast<LPVOID>(sPostData.data()),
-                        gsl::narrow_cast<int>(sPostData.length()), gsl::narrow_cast<int>(sPostData.length()),
-                        0);
-                }
+    std::string sPath;
+    const auto nIndex = sUrl.find('/');
+    if (nIndex != std::string::npos)
+    {
+        sPath.assign(sUrl, nIndex + 1, std::string::npos);
+        sUrl.resize(nIndex);
+    }
 
-                if (!bResults || !WinHttpReceiveResponse(hRequest, nullptr))
-                {
-                    nStatusCode = GetLastError();
-                }
-                else
-                {
-                    // get the http status code
-                    DWORD dwSize = sizeof(DWORD);
-                    
-                    GSL_SUPPRESS_ES47 WinHttpQueryHeaders(
-                        hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX,
-                        &nStatusCode, &dwSize, WINHTTP_NO_HEADER_INDEX);
-
-                    // read the response
-                    auto* pStringWriter = dynamic_cast<StringTextWriter*>(&pContentWriter);
-                    if (pStringWriter != nullptr)
-                    {
-                        // optimized path for writing to string buffer
-                        if (!ReadIntoString(hRequest, pStringWriter->GetString(), nStatusCode))
-                        {
-                            // could not use optimization, fall back to buffered reader
-                            ReadIntoWriter(hRequest, pContentWriter, nStatusCode);
-                        }
-                    }
-                    else
-                    {
-                        ReadIntoWriter(hRequest, pContentWriter, nStatusCode);
-                    }
-                }
+    // merge query parameters onto sPath.
+    const std::string& sQueryString = pRequest.GetQueryString();
+    if (!sQueryString.empty())
+    {
+        sPath.push_back('?');
+        sPath += sQueryString;
+    }
 
-                WinHttpCloseHandle(hRequest);
-            }
+    // specify the server
+    const auto sHostName = ra::Widen(sUrl);
+    const auto sPathWide = ra::Widen(sPath);
+    const bool bSecure = (nPort == INTERNET_DEFAULT_HTTPS_PORT);
 
-            WinHttpCloseHandle(hConnect);
-        }
+    unsigned int nStatusCode = 0;
+    bool bReused = false;
+    HINTERNET hConnect = GetConnection(sHostName, nPort, bReused, nStatusCode);
+    if (hConnect == nullptr)
+        return nStatusCode;
 
-        WinHttpCloseHandle(hSession);
+    bool bResponseReceived = false;
+    nStatusCode = SendRequest(hConnect, pRequest, sPathWide, bSecure, pContentWriter, bResponseReceived);
+
+    if (CanRetryOnNewConnection(pRequest, bReused, bResponseReceived, nStatusCode))
+    {
+        RA_LOG_WARN("Request on pooled connection to %s failed (%u), retrying", sUrl, nStatusCode);
+        nStatusCode = SendRequest(hConnect, pRequest, sPathWide, bSecure, pContentWriter, bResponseReceived);
     }
 
     return nStatusCode;
 }
 
+bool WindowsHttpRequester::CanRetryOnNewConnection(const Http::Request& pRequest, bool bReused,
+                                                   bool bResponseReceived, unsigned int nStatusCode) noexcept
+{
+    // if the server closed an idle keep-alive socket before the request could be sent on it, WinHTTP will discard
+    // the dead socket. trying again will either use another idle socket or establish a new connection.
+    if (!bReused || bResponseReceived)
+        return false;
+
+    if (nStatusCode != ERROR_WINHTTP_CONNECTION_ERROR && nStatusCode != ERROR_WINHTTP_INVALID_SERVER_RESPONSE)
+        return false;
+
+    // there's no way to tell if the server received the request before the socket failed. a POST may have already
+    // been processed, and sending it again could duplicate an unlock or leaderboard entry. only resend GETs.
+    return pRequest.GetPostData().empty();
+}
+
 // these defines are in <wininet.h>
 // cannot include <wininet.h> and <winhttp.h> in the same file
 #define INTERNET_ERROR_BASE                     12000
@@ -15,14 +15,40 @@ namespace impl {
 class WindowsHttpRequester : public IHttpRequester
 {
 public:
-    void SetUserAgent(const std::string& sUserAgent) override { m_sUserAgent = ra::Widen(sUserAgent); }
+    WindowsHttpRequester() noexcept = default;
+    ~WindowsHttpRequester() noexcept;
+
+    WindowsHttpRequester(const WindowsHttpRequester&) noexcept = delete;
+    WindowsHttpRequester& operator=(const WindowsHttpRequester&) noexcept = delete;
+    WindowsHttpRequester(WindowsHttpRequester&&) noexcept = delete;
+    WindowsHttpRequester& operator=(WindowsHttpRequester&&) noexcept = delete;
+
+    void SetUserAgent(const std::string& sUserAgent) override;
 
     unsigned int Request(const Http::Request& pRequest, TextWriter& pContentWriter) const override;
 
     bool IsRetryable(unsigned int nStatusCode) const noexcept override;
 
+    /// <summary>
+    /// Determines whether a request that failed on a reused keep-alive connection can be sent again.
+    /// </summary>
+    static bool CanRetryOnNewConnection(const Http::Request& pRequest, bool bReused, bool bResponseReceived,
+                                        unsigned int nStatusCode) noexcept;
+
 private:
+    // these are HINTERNET handles. <winhttp.h> can't be included here because it conflicts with <wininet.h>
+    void* GetSession(_Out_ unsigned int& nStatusCode) const;
+    void* GetConnection(const std::wstring& sHostName, unsigned short nPort, _Out_ bool& bReused,
+                        _Out_ unsigned int& nStatusCode) const;
+
     std::wstring m_sUserAgent;
+
+    // WinHTTP pools the underlying sockets per session, so keeping the session and connection handles open
+    // allows subsequent requests to the same server to reuse an idle keep-alive socket instead of paying
+    // for a new TCP/TLS handshake.
+    mutable std::mutex m_mtxHandles;
+    mutable void* m_hSession = nullptr;
+    mutable std::map<std::wstring, void*> m_mConnections;
 };
 
 } // namespace impl
@@ -142,6 +142,13 @@ public:
     /// </summary>
     virtual bool SaveImage(const ISurface& pSurface, const std::wstring& sPath) const = 0;
 
+    /// <summary>
+    /// Copies the contents of the provided surface into <paramref name="vPixels" /> as 32-bit ARGB values,
+    /// top row first.
+    /// </summary>
+    /// <returns><c>false</c> if the surface does not support reading its pixels.</returns>
+    virtual bool CopyPixels(const ISurface& pSurface, std::vector<std::uint32_t>& vPixels) const = 0;
+
 protected:
     ISurfaceFactory() noexcept = default;
 };
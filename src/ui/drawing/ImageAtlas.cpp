@@ -0,0 +1,112 @@
+#include "ImageAtlas.hh"
+
+#include "services\ServiceLocator.hh"
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+std::string ImageAtlas::GetKey(ImageType nType, const std::string& sName)
+{
+    std::string sKey;
+    sKey.reserve(sName.length() + 1);
+    sKey.push_back(gsl::narrow_cast<char>(nType));
+    sKey.append(sName);
+    return sKey;
+}
+
+void ImageAtlas::Add(ImageType nType, const std::string& sName)
+{
+    if (nType == ImageType::None || sName.empty())
+        return;
+
+    auto sKey = GetKey(nType, sName);
+    if (m_mCells.find(sKey) != m_mCells.end())
+        return;
+
+    auto& pCell = m_mCells[sKey];
+    pCell.pImage.ChangeReference(nType, sName);
+    m_vUnplaced.push_back(std::move(sKey));
+}
+
+bool ImageAtlas::Contains(ImageType nType, const std::string& sName) const
+{
+    return (m_mCells.find(GetKey(nType, sName)) != m_mCells.end());
+}
+
+void ImageAtlas::Build()
+{
+    if (m_vUnplaced.empty())
+        return;
+
+    const auto nCellsPerRow = gsl::narrow_cast<size_t>(std::max(MAX_SURFACE_SIZE / m_nCellSize, 1));
+    const auto nCellsPerSurface = nCellsPerRow * nCellsPerRow;
+    const auto& pSurfaceFactory = ra::services::ServiceLocator::Get<ra::ui::drawing::ISurfaceFactory>();
+
+    // new images always go into new surfaces. each surface is only as tall as it needs to be.
+    size_t nIndex = 0;
+    while (nIndex < m_vUnplaced.size())
+    {
+        const auto nCells = std::min(m_vUnplaced.size() - nIndex, nCellsPerSurface);
+        const auto nRows = gsl::narrow_cast<int>((nCells + nCellsPerRow - 1) / nCellsPerRow);
+        const auto nColumns = gsl::narrow_cast<int>((nRows == 1) ? nCells : nCellsPerRow);
+
+        const auto nSurface = m_vSurfaces.size();
+        m_vSurfaces.push_back(pSurfaceFactory.CreateSurface(nColumns * m_nCellSize, nRows * m_nCellSize));
+
+        for (size_t i = 0; i < nCells; ++i)
+        {
+            auto& pCell = m_mCells[m_vUnplaced.at(nIndex++)];
+            pCell.nSurface = nSurface;
+            pCell.nX = gsl::narrow_cast<int>(i % nCellsPerRow) * m_nCellSize;
+            pCell.nY = gsl::narrow_cast<int>(i / nCellsPerRow) * m_nCellSize;
+            pCell.bPlaced = true;
+        }
+    }
+
+    m_vUnplaced.clear();
+}
+
+void ImageAtlas::RenderCell(Cell& pCell)
+{
+    auto& pSurface = *m_vSurfaces.at(pCell.nSurface);
+    pSurface.FillRectangle(pCell.nX, pCell.nY, m_nCellSize, m_nCellSize, m_nBackground);
+    pSurface.DrawImage(pCell.nX, pCell.nY, m_nCellSize, m_nCellSize, pCell.pImage);
+
+    // the atlas has its own copy of the image now. don't keep the decoded image loaded.
+    pCell.pImage.Release();
+    pCell.bRendered = true;
+}
+
+bool ImageAtlas::Draw(ISurface& pSurface, int nX, int nY, const ImageReference& pImage)
+{
+    const auto pIter = m_mCells.find(GetKey(pImage.Type(), pImage.Name()));
+    if (pIter == m_mCells.end() || !pIter->second.bPlaced)
+        return false;
+
+    // cells are filled the first time they're drawn. the reference only changes once the image has been downloaded
+    // and decoded. until then, let the caller draw the placeholder (which also requests the image).
+    auto& pCell = pIter->second;
+    if (!pCell.bRendered)
+    {
+        const auto& pImageRepository = ra::services::ServiceLocator::Get<ra::ui::IImageRepository>();
+        if (!pImageRepository.HasReferencedImageChanged(pCell.pImage))
+            return false;
+
+        RenderCell(pCell);
+    }
+
+    pSurface.DrawSurface(nX, nY, *m_vSurfaces.at(pCell.nSurface), pCell.nX, pCell.nY, m_nCellSize, m_nCellSize);
+    return true;
+}
+
+void ImageAtlas::Clear() noexcept
+{
+    m_mCells.clear();
+    m_vUnplaced.clear();
+    m_vSurfaces.clear();
+}
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
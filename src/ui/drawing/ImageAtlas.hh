@@ -0,0 +1,91 @@
+#ifndef RA_UI_DRAWING_IMAGEATLAS_HH
+#define RA_UI_DRAWING_IMAGEATLAS_HH
+#pragma once
+
+#include "ui\drawing\ISurface.hh"
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+/// <summary>
+/// Packs a set of equally sized images into a few shared surfaces so they can be drawn by copying part of a
+/// surface rather than from individual bitmaps.
+/// </summary>
+class ImageAtlas
+{
+public:
+    explicit ImageAtlas(int nCellSize, Color nBackground) noexcept
+        : m_nCellSize(nCellSize), m_nBackground(nBackground)
+    {
+    }
+
+    /// <summary>
+    /// Adds an image to the atlas. It will not be available until <see cref="Build" /> is called.
+    /// </summary>
+    void Add(ImageType nType, const std::string& sName);
+
+    /// <summary>
+    /// Determines if an image has been added to the atlas.
+    /// </summary>
+    bool Contains(ImageType nType, const std::string& sName) const;
+
+    /// <summary>
+    /// Allocates space for any images added since the last call.
+    /// </summary>
+    /// <remarks>
+    /// Images are not drawn into the atlas until they're first drawn from it.
+    /// </remarks>
+    void Build();
+
+    /// <summary>
+    /// Draws an image from the atlas.
+    /// </summary>
+    /// <returns>
+    /// <c>false</c> if the image is not in the atlas, or is not available yet, and should be drawn directly.
+    /// </returns>
+    bool Draw(ISurface& pSurface, int nX, int nY, const ImageReference& pImage);
+
+    /// <summary>
+    /// Discards all images and surfaces.
+    /// </summary>
+    void Clear() noexcept;
+
+    /// <summary>
+    /// Gets the number of images in the atlas.
+    /// </summary>
+    size_t Count() const noexcept { return m_mCells.size(); }
+
+    /// <summary>
+    /// Gets the number of surfaces used to hold the images.
+    /// </summary>
+    size_t SurfaceCount() const noexcept { return m_vSurfaces.size(); }
+
+    static constexpr int MAX_SURFACE_SIZE = 1024;
+
+private:
+    struct Cell
+    {
+        ImageReference pImage;
+        size_t nSurface = 0;
+        int nX = 0;
+        int nY = 0;
+        bool bPlaced = false;
+        bool bRendered = false;
+    };
+
+    static std::string GetKey(ImageType nType, const std::string& sName);
+    void RenderCell(Cell& pCell);
+
+    std::unordered_map<std::string, Cell> m_mCells;
+    std::vector<std::string> m_vUnplaced;
+    std::vector<std::unique_ptr<ISurface>> m_vSurfaces;
+    int m_nCellSize;
+    Color m_nBackground;
+};
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
+
+#endif // !RA_UI_DRAWING_IMAGEATLAS_HH
@@ -0,0 +1,251 @@
+#include "ImageCache.hh"
+
+#include "services\IThreadPool.hh"
+#include "services\ServiceLocator.hh"
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+// rough cost of the map node, list node, and string headers for each entry
+static constexpr size_t ENTRY_OVERHEAD = 160;
+
+std::string ImageCache::GetKey(ImageType nType, const std::string& sName)
+{
+    std::string sKey;
+    sKey.reserve(sName.length() + 1);
+    sKey.push_back(gsl::narrow_cast<char>(nType));
+    sKey.append(sName);
+    return sKey;
+}
+
+size_t ImageCache::GetMemoryUsage(const std::string& sKey, const Entry& pEntry) noexcept
+{
+    // the key is stored in both the map and the usage list
+    size_t nUsage = ENTRY_OVERHEAD + sKey.length() * 2;
+    if (pEntry.pImage != nullptr)
+        nUsage += pEntry.pImage->vPixels.size() * sizeof(std::uint32_t);
+
+    return nUsage;
+}
+
+ImageCache::Entry& ImageCache::GetEntry(const std::string& sKey)
+{
+    auto pIter = m_mEntries.find(sKey);
+    if (pIter != m_mEntries.end())
+    {
+        // move to the front of the usage list
+        auto& pEntry = pIter->second;
+        if (pEntry.pUsage != m_vUsage.begin())
+            m_vUsage.splice(m_vUsage.begin(), m_vUsage, pEntry.pUsage);
+
+        return pEntry;
+    }
+
+    m_vUsage.push_front(sKey);
+    auto& pEntry = m_mEntries[sKey];
+    pEntry.pUsage = m_vUsage.begin();
+    m_nMemoryUsage += GetMemoryUsage(sKey, pEntry);
+    return pEntry;
+}
+
+std::shared_ptr<const ImageCache::Image> ImageCache::Request(ImageType nType, const std::string& sName,
+    unsigned int nWidth, unsigned int nHeight, LoadFunction&& fLoad)
+{
+    auto sKey = GetKey(nType, sName);
+    unsigned int nRequest = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_oMutex);
+        auto& pEntry = GetEntry(sKey);
+
+        const bool bSameSize = (pEntry.nWidth == nWidth && pEntry.nHeight == nHeight);
+        switch (pEntry.nState)
+        {
+            case State::Pending:
+                return nullptr;
+
+            case State::Ready:
+                if (bSameSize)
+                    return pEntry.pImage;
+                break;
+
+            case State::Failed:
+                // don't keep trying to decode a bad image. it will be retried if the data is replaced.
+                if (bSameSize)
+                    return nullptr;
+                break;
+
+            default:
+                break;
+        }
+
+        // an image decoded at another size is no longer useful
+        m_nMemoryUsage -= GetMemoryUsage(sKey, pEntry);
+        pEntry.pImage.reset();
+        m_nMemoryUsage += GetMemoryUsage(sKey, pEntry);
+
+        pEntry.nState = State::Pending;
+        pEntry.nWidth = nWidth;
+        pEntry.nHeight = nHeight;
+        pEntry.nRequest = ++m_nLastRequest;
+        nRequest = pEntry.nRequest;
+    }
+
+    auto& pThreadPool = ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>();
+    pThreadPool.RunAsync([this, sKey = std::move(sKey), nRequest, nType, sName, nWidth, nHeight, fLoad = std::move(fLoad)]()
+    {
+        Decode(sKey, nRequest, nType, sName, nWidth, nHeight, fLoad);
+    }, ra::services::TaskPriority::Background);
+
+    return nullptr;
+}
+
+void ImageCache::Decode(const std::string& sKey, unsigned int nRequest, ImageType nType, const std::string& sName,
+                        unsigned int nWidth, unsigned int nHeight, const LoadFunction& fLoad)
+{
+    auto pImage = std::make_shared<Image>();
+    const auto sData = fLoad();
+    bool bDecoded = (!sData.empty() && m_pDecoder != nullptr && m_pDecoder->Decode(sData, nWidth, nHeight, *pImage));
+    if (bDecoded && pImage->vPixels.size() != gsl::narrow_cast<size_t>(pImage->nWidth) * pImage->nHeight)
+    {
+        assert(!"Decoded image does not match its dimensions");
+        bDecoded = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_oMutex);
+
+        // if the entry was evicted or invalidated while decoding, the result is not wanted
+        const auto pIter = m_mEntries.find(sKey);
+        if (pIter == m_mEntries.end() || pIter->second.nRequest != nRequest)
+            return;
+
+        auto& pEntry = pIter->second;
+        if (!bDecoded)
+        {
+            pEntry.nState = State::Failed;
+            return;
+        }
+
+        m_nMemoryUsage -= GetMemoryUsage(sKey, pEntry);
+        pEntry.pImage = std::move(pImage);
+        pEntry.nState = State::Ready;
+        m_nMemoryUsage += GetMemoryUsage(sKey, pEntry);
+
+        // the new image is about to be requested again, so make it the most recently used
+        if (pEntry.pUsage != m_vUsage.begin())
+            m_vUsage.splice(m_vUsage.begin(), m_vUsage, pEntry.pUsage);
+
+        Trim();
+    }
+
+    if (m_fDecoded)
+        m_fDecoded(nType, sName);
+}
+
+void ImageCache::Trim() noexcept
+{
+    // discard the least recently used images until the cache fits. images that are referenced or still being
+    // decoded are kept. the most recently used image is always kept so the caller can use it, even if it's
+    // larger than the cache.
+    auto pIter = m_vUsage.end();
+    while (m_nMemoryUsage > m_nMaxMemory && pIter != m_vUsage.begin())
+    {
+        --pIter;
+        if (pIter == m_vUsage.begin())
+            break;
+
+        const auto pEntry = m_mEntries.find(*pIter);
+        Expects(pEntry != m_mEntries.end());
+        if (pEntry->second.nReferences > 0 || pEntry->second.nState == State::Pending)
+            continue;
+
+        m_nMemoryUsage -= GetMemoryUsage(pEntry->first, pEntry->second);
+        m_mEntries.erase(pEntry);
+        pIter = m_vUsage.erase(pIter);
+    }
+}
+
+ImageCache::State ImageCache::GetState(ImageType nType, const std::string& sName) const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto pIter = m_mEntries.find(GetKey(nType, sName));
+    return (pIter != m_mEntries.end()) ? pIter->second.nState : State::None;
+}
+
+void ImageCache::AddReference(ImageType nType, const std::string& sName)
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    auto& pEntry = GetEntry(GetKey(nType, sName));
+    ++pEntry.nReferences;
+}
+
+GSL_SUPPRESS_F6 void ImageCache::ReleaseReference(ImageType nType, const std::string& sName) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto pIter = m_mEntries.find(GetKey(nType, sName));
+    if (pIter != m_mEntries.end() && pIter->second.nReferences > 0)
+    {
+        if (--pIter->second.nReferences == 0)
+            Trim();
+    }
+}
+
+void ImageCache::Invalidate(ImageType nType, const std::string& sName)
+{
+    auto sKey = GetKey(nType, sName);
+
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto pIter = m_mEntries.find(sKey);
+    if (pIter == m_mEntries.end())
+        return;
+
+    auto& pEntry = pIter->second;
+    m_nMemoryUsage -= GetMemoryUsage(sKey, pEntry);
+    pEntry.pImage.reset();
+    m_nMemoryUsage += GetMemoryUsage(sKey, pEntry);
+
+    // any decode that's in progress is for the old data. ignore its result.
+    pEntry.nState = State::None;
+    pEntry.nRequest = ++m_nLastRequest;
+}
+
+void ImageCache::Clear() noexcept
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+
+    auto pIter = m_vUsage.begin();
+    while (pIter != m_vUsage.end())
+    {
+        const auto pEntry = m_mEntries.find(*pIter);
+        if (pEntry != m_mEntries.end() && pEntry->second.nReferences > 0)
+        {
+            ++pIter;
+            continue;
+        }
+
+        if (pEntry != m_mEntries.end())
+        {
+            m_nMemoryUsage -= GetMemoryUsage(pEntry->first, pEntry->second);
+            m_mEntries.erase(pEntry);
+        }
+
+        pIter = m_vUsage.erase(pIter);
+    }
+}
+
+size_t ImageCache::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_mEntries.size();
+}
+
+size_t ImageCache::GetMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_nMemoryUsage;
+}
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
@@ -0,0 +1,167 @@
+#ifndef RA_UI_DRAWING_IMAGECACHE_HH
+#define RA_UI_DRAWING_IMAGECACHE_HH
+#pragma once
+
+#include "ui\ImageReference.hh"
+
+#include <list>
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+/// <summary>
+/// Decodes images on the thread pool and keeps the most recently used ones in memory so the renderer never has
+/// to wait for a decode.
+/// </summary>
+class ImageCache
+{
+public:
+    struct Image
+    {
+        unsigned int nWidth = 0;
+        unsigned int nHeight = 0;
+        std::vector<std::uint32_t> vPixels; // premultiplied ARGB, top row first
+    };
+
+    class IDecoder
+    {
+    public:
+        virtual ~IDecoder() noexcept = default;
+        IDecoder(const IDecoder&) noexcept = delete;
+        IDecoder& operator=(const IDecoder&) noexcept = delete;
+        IDecoder(IDecoder&&) noexcept = delete;
+        IDecoder& operator=(IDecoder&&) noexcept = delete;
+
+        /// <summary>
+        /// Decodes the encoded image in <paramref name="sData" />.
+        /// </summary>
+        /// <param name="nWidth">The width to scale the image to, 0 to use the image's width.</param>
+        /// <param name="nHeight">The height to scale the image to, 0 to use the image's height.</param>
+        /// <returns><c>true</c> if <paramref name="pImage" /> was populated, <c>false</c> if decoding failed.</returns>
+        /// <remarks>Called on a background thread.</remarks>
+        virtual bool Decode(const std::string& sData, unsigned int nWidth, unsigned int nHeight, Image& pImage) = 0;
+
+    protected:
+        IDecoder() noexcept = default;
+    };
+
+    enum class State
+    {
+        None,
+        Pending,
+        Ready,
+        Failed,
+    };
+
+    /// <summary>
+    /// Provides the encoded data for an image. Called on a background thread.
+    /// </summary>
+    using LoadFunction = std::function<std::string()>;
+
+    /// <summary>
+    /// Called on the decoding thread after an image has been decoded.
+    /// </summary>
+    using DecodedFunction = std::function<void(ImageType nType, const std::string& sName)>;
+
+    explicit ImageCache(std::unique_ptr<IDecoder>&& pDecoder, size_t nMaxMemory = DEFAULT_MAX_MEMORY) noexcept
+        : m_pDecoder(std::move(pDecoder)), m_nMaxMemory(nMaxMemory)
+    {
+    }
+
+    ~ImageCache() noexcept = default;
+    ImageCache(const ImageCache&) noexcept = delete;
+    ImageCache& operator=(const ImageCache&) noexcept = delete;
+    ImageCache(ImageCache&&) noexcept = delete;
+    ImageCache& operator=(ImageCache&&) noexcept = delete;
+
+    /// <summary>
+    /// Gets the decoded image. If the image has not been decoded at the requested size, queues it for decoding.
+    /// </summary>
+    /// <param name="fLoad">Provides the encoded image data if the image has to be decoded.</param>
+    /// <returns>
+    /// The decoded image, <c>nullptr</c> if it is still being decoded or could not be decoded. The caller should
+    /// draw a placeholder until <see cref="SetDecodedHandler" /> reports the image is ready.
+    /// </returns>
+    std::shared_ptr<const Image> Request(ImageType nType, const std::string& sName, unsigned int nWidth,
+                                         unsigned int nHeight, LoadFunction&& fLoad);
+
+    /// <summary>
+    /// Gets the decoding state of an image.
+    /// </summary>
+    State GetState(ImageType nType, const std::string& sName) const;
+
+    /// <summary>
+    /// Prevents an image from being evicted until a matching call to <see cref="ReleaseReference" />.
+    /// </summary>
+    void AddReference(ImageType nType, const std::string& sName);
+
+    /// <summary>
+    /// Allows an image to be evicted once nothing else references it.
+    /// </summary>
+    void ReleaseReference(ImageType nType, const std::string& sName) noexcept;
+
+    /// <summary>
+    /// Discards the decoded image so the next <see cref="Request" /> decodes it again. Called when the encoded
+    /// data has changed.
+    /// </summary>
+    void Invalidate(ImageType nType, const std::string& sName);
+
+    /// <summary>
+    /// Sets the function to call when an image has been decoded.
+    /// </summary>
+    void SetDecodedHandler(DecodedFunction&& fHandler) { m_fDecoded = std::move(fHandler); }
+
+    /// <summary>
+    /// Discards all unreferenced images.
+    /// </summary>
+    void Clear() noexcept;
+
+    /// <summary>
+    /// Gets the number of images being tracked.
+    /// </summary>
+    size_t Count() const;
+
+    /// <summary>
+    /// Gets the approximate amount of memory used by the decoded images.
+    /// </summary>
+    size_t GetMemoryUsage() const;
+
+    static constexpr size_t DEFAULT_MAX_MEMORY = 8 * 1024 * 1024;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const Image> pImage;
+        State nState = State::None;
+        unsigned int nWidth = 0;
+        unsigned int nHeight = 0;
+        unsigned int nReferences = 0;
+        unsigned int nRequest = 0;
+        std::list<std::string>::iterator pUsage;
+    };
+
+    static std::string GetKey(ImageType nType, const std::string& sName);
+    static size_t GetMemoryUsage(const std::string& sKey, const Entry& pEntry) noexcept;
+
+    Entry& GetEntry(const std::string& sKey);
+    void Decode(const std::string& sKey, unsigned int nRequest, ImageType nType, const std::string& sName,
+                unsigned int nWidth, unsigned int nHeight, const LoadFunction& fLoad);
+    void Trim() noexcept;
+
+    std::unique_ptr<IDecoder> m_pDecoder;
+    DecodedFunction m_fDecoded;
+
+    mutable std::mutex m_oMutex;
+    std::unordered_map<std::string, Entry> m_mEntries;
+    std::list<std::string> m_vUsage; // most recently used first
+    unsigned int m_nLastRequest = 0;
+    size_t m_nMemoryUsage = 0;
+    size_t m_nMaxMemory;
+};
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
+
+#endif // !RA_UI_DRAWING_IMAGECACHE_HH
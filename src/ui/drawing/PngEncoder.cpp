@@ -0,0 +1,459 @@
+#include "PngEncoder.hh"
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+static constexpr size_t BYTES_PER_PIXEL = 3;
+
+static constexpr int WINDOW_SIZE = 32768;
+static constexpr int HASH_BITS = 15;
+static constexpr int HASH_SIZE = 1 << HASH_BITS;
+static constexpr int MIN_MATCH = 3;
+static constexpr int MAX_MATCH = 258;
+// how many earlier occurrences of a sequence to compare against. higher values compress slightly better, but
+// take longer. screenshots have a lot of repetition, so the first few candidates are usually good enough.
+static constexpr int MAX_CHAIN = 32;
+
+static constexpr std::array<std::uint16_t, 29> LENGTH_BASE = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static constexpr std::array<std::uint8_t, 29> LENGTH_EXTRA_BITS = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static constexpr std::array<std::uint16_t, 30> DISTANCE_BASE = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+static constexpr std::array<std::uint8_t, 30> DISTANCE_EXTRA_BITS = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+namespace {
+
+/// <summary>
+/// Writes values into a byte stream least significant bit first, as required by deflate.
+/// </summary>
+class BitWriter
+{
+public:
+    explicit BitWriter(std::string& sOutput) noexcept : m_sOutput(sOutput) {}
+
+    void Write(std::uint32_t nValue, int nBits)
+    {
+        m_nBuffer |= nValue << m_nBitCount;
+        m_nBitCount += nBits;
+
+        while (m_nBitCount >= 8)
+        {
+            m_sOutput.push_back(gsl::narrow_cast<char>(m_nBuffer & 0xFF));
+            m_nBuffer >>= 8;
+            m_nBitCount -= 8;
+        }
+    }
+
+    void Flush()
+    {
+        if (m_nBitCount > 0)
+        {
+            m_sOutput.push_back(gsl::narrow_cast<char>(m_nBuffer & 0xFF));
+            m_nBuffer = 0;
+            m_nBitCount = 0;
+        }
+    }
+
+private:
+    std::string& m_sOutput;
+    std::uint32_t m_nBuffer = 0;
+    int m_nBitCount = 0;
+};
+
+struct HuffmanCode
+{
+    std::uint16_t nCode; // already bit-reversed so it can be written least significant bit first
+    std::uint8_t nBits;
+};
+
+std::uint16_t ReverseBits(unsigned int nValue, int nBits) noexcept
+{
+    unsigned int nReversed = 0;
+    for (int i = 0; i < nBits; ++i)
+    {
+        nReversed = (nReversed << 1) | (nValue & 1);
+        nValue >>= 1;
+    }
+
+    return gsl::narrow_cast<std::uint16_t>(nReversed);
+}
+
+const std::array<HuffmanCode, 288>& GetFixedLiteralCodes() noexcept
+{
+    static const std::array<HuffmanCode, 288> vCodes = []() noexcept
+    {
+        std::array<HuffmanCode, 288> vTable{};
+        for (unsigned int i = 0; i < vTable.size(); ++i)
+        {
+            auto& pCode = vTable.at(i);
+            if (i < 144)
+                pCode = { ReverseBits(0x30 + i, 8), 8 };
+            else if (i < 256)
+                pCode = { ReverseBits(0x190 + i - 144, 9), 9 };
+            else if (i < 280)
+                pCode = { ReverseBits(i - 256, 7), 7 };
+            else
+                pCode = { ReverseBits(0xC0 + i - 280, 8), 8 };
+        }
+        return vTable;
+    }();
+
+    return vCodes;
+}
+
+const std::array<std::uint32_t, 256>& GetCrcTable() noexcept
+{
+    static const std::array<std::uint32_t, 256> vTable = []() noexcept
+    {
+        std::array<std::uint32_t, 256> vCrcs{};
+        for (std::uint32_t i = 0; i < vCrcs.size(); ++i)
+        {
+            std::uint32_t nCrc = i;
+            for (int j = 0; j < 8; ++j)
+                nCrc = (nCrc & 1) ? (0xEDB88320 ^ (nCrc >> 1)) : (nCrc >> 1);
+
+            vCrcs.at(i) = nCrc;
+        }
+        return vCrcs;
+    }();
+
+    return vTable;
+}
+
+void AppendUInt32(std::string& sOutput, std::uint32_t nValue)
+{
+    sOutput.push_back(gsl::narrow_cast<char>(nValue >> 24));
+    sOutput.push_back(gsl::narrow_cast<char>((nValue >> 16) & 0xFF));
+    sOutput.push_back(gsl::narrow_cast<char>((nValue >> 8) & 0xFF));
+    sOutput.push_back(gsl::narrow_cast<char>(nValue & 0xFF));
+}
+
+void AppendChunk(std::string& sOutput, const char* sType, const std::uint8_t* pData, size_t nLength)
+{
+    AppendUInt32(sOutput, gsl::narrow_cast<std::uint32_t>(nLength));
+
+    const auto nStart = sOutput.length();
+    sOutput.append(sType, 4);
+    if (nLength > 0)
+        GSL_SUPPRESS_TYPE1 sOutput.append(reinterpret_cast<const char*>(pData), nLength);
+
+    GSL_SUPPRESS_TYPE1 const auto* pChunk = reinterpret_cast<const std::uint8_t*>(sOutput.data() + nStart);
+    AppendUInt32(sOutput, PngEncoder::Crc32(0, pChunk, nLength + 4));
+}
+
+void WriteLength(BitWriter& pWriter, int nLength)
+{
+    const auto pIter = std::upper_bound(LENGTH_BASE.begin(), LENGTH_BASE.end(), nLength);
+    const auto nIndex = gsl::narrow_cast<size_t>(std::distance(LENGTH_BASE.begin(), pIter) - 1);
+
+    const auto& pCode = GetFixedLiteralCodes().at(257 + nIndex);
+    pWriter.Write(pCode.nCode, pCode.nBits);
+
+    const auto nExtraBits = LENGTH_EXTRA_BITS.at(nIndex);
+    if (nExtraBits)
+        pWriter.Write(gsl::narrow_cast<std::uint32_t>(nLength - LENGTH_BASE.at(nIndex)), nExtraBits);
+}
+
+void WriteDistance(BitWriter& pWriter, int nDistance)
+{
+    const auto pIter = std::upper_bound(DISTANCE_BASE.begin(), DISTANCE_BASE.end(), nDistance);
+    const auto nIndex = gsl::narrow_cast<size_t>(std::distance(DISTANCE_BASE.begin(), pIter) - 1);
+
+    // fixed distance codes are the five bit index
+    pWriter.Write(ReverseBits(gsl::narrow_cast<unsigned int>(nIndex), 5), 5);
+
+    const auto nExtraBits = DISTANCE_EXTRA_BITS.at(nIndex);
+    if (nExtraBits)
+        pWriter.Write(gsl::narrow_cast<std::uint32_t>(nDistance - DISTANCE_BASE.at(nIndex)), nExtraBits);
+}
+
+constexpr int Hash(const std::uint8_t* pData) noexcept
+{
+    return ((pData[0] << 10) ^ (pData[1] << 5) ^ pData[2]) & (HASH_SIZE - 1);
+}
+
+std::uint8_t PaethPredictor(std::uint8_t nLeft, std::uint8_t nUp, std::uint8_t nUpLeft) noexcept
+{
+    const int nEstimate = nLeft + nUp - nUpLeft;
+    const int nDistanceLeft = std::abs(nEstimate - nLeft);
+    const int nDistanceUp = std::abs(nEstimate - nUp);
+    const int nDistanceUpLeft = std::abs(nEstimate - nUpLeft);
+
+    if (nDistanceLeft <= nDistanceUp && nDistanceLeft <= nDistanceUpLeft)
+        return nLeft;
+    if (nDistanceUp <= nDistanceUpLeft)
+        return nUp;
+    return nUpLeft;
+}
+
+unsigned int GetFilterCost(const std::uint8_t* pRow, size_t nLength) noexcept
+{
+    // treat each byte as signed. the filter that produces the values closest to zero usually compresses best.
+    unsigned int nCost = 0;
+    for (size_t i = 0; i < nLength; ++i)
+        nCost += std::abs(static_cast<std::int8_t>(pRow[i]));
+
+    return nCost;
+}
+
+} // anonymous namespace
+
+std::uint32_t PngEncoder::Crc32(std::uint32_t nCrc, const std::uint8_t* pData, size_t nLength) noexcept
+{
+    const auto& vTable = GetCrcTable();
+
+    nCrc = ~nCrc;
+    for (size_t i = 0; i < nLength; ++i)
+        GSL_SUPPRESS_BOUNDS4 nCrc = vTable[(nCrc ^ pData[i]) & 0xFF] ^ (nCrc >> 8);
+
+    return ~nCrc;
+}
+
+std::uint32_t PngEncoder::Adler32(std::uint32_t nAdler, const std::uint8_t* pData, size_t nLength) noexcept
+{
+    // the sums can be accumulated for this many bytes before they have to be reduced to avoid overflow
+    constexpr size_t ADLER_BLOCK_SIZE = 5552;
+    constexpr std::uint32_t ADLER_MODULUS = 65521;
+
+    std::uint32_t nA = nAdler & 0xFFFF;
+    std::uint32_t nB = nAdler >> 16;
+
+    while (nLength > 0)
+    {
+        const auto nBlock = std::min(nLength, ADLER_BLOCK_SIZE);
+        for (size_t i = 0; i < nBlock; ++i)
+        {
+            nA += pData[i];
+            nB += nA;
+        }
+
+        nA %= ADLER_MODULUS;
+        nB %= ADLER_MODULUS;
+        pData += nBlock;
+        nLength -= nBlock;
+    }
+
+    return (nB << 16) | nA;
+}
+
+void PngEncoder::FilterRows(unsigned int nWidth, unsigned int nHeight, const std::vector<std::uint32_t>& vPixels)
+{
+    const size_t nRowLength = nWidth * BYTES_PER_PIXEL;
+    m_vScanlines.resize((nRowLength + 1) * nHeight);
+
+    // [previous row][current row][sub][up][paeth]
+    m_vCandidates.assign(nRowLength * 5, 0);
+    std::uint8_t* pPrevious = m_vCandidates.data();
+    std::uint8_t* pCurrent = pPrevious + nRowLength;
+    std::uint8_t* pSub = pCurrent + nRowLength;
+    std::uint8_t* pUp = pSub + nRowLength;
+    std::uint8_t* pPaeth = pUp + nRowLength;
+
+    const std::uint32_t* pPixel = vPixels.data();
+    std::uint8_t* pOutput = m_vScanlines.data();
+    for (unsigned int nY = 0; nY < nHeight; ++nY)
+    {
+        for (size_t i = 0; i < nRowLength; i += BYTES_PER_PIXEL)
+        {
+            const auto nARGB = *pPixel++;
+            pCurrent[i] = gsl::narrow_cast<std::uint8_t>((nARGB >> 16) & 0xFF);
+            pCurrent[i + 1] = gsl::narrow_cast<std::uint8_t>((nARGB >> 8) & 0xFF);
+            pCurrent[i + 2] = gsl::narrow_cast<std::uint8_t>(nARGB & 0xFF);
+        }
+
+        for (size_t i = 0; i < nRowLength; ++i)
+        {
+            const std::uint8_t nLeft = (i >= BYTES_PER_PIXEL) ? pCurrent[i - BYTES_PER_PIXEL] : 0;
+            const std::uint8_t nUpLeft = (i >= BYTES_PER_PIXEL) ? pPrevious[i - BYTES_PER_PIXEL] : 0;
+            pSub[i] = gsl::narrow_cast<std::uint8_t>(pCurrent[i] - nLeft);
+            pUp[i] = gsl::narrow_cast<std::uint8_t>(pCurrent[i] - pPrevious[i]);
+            pPaeth[i] = gsl::narrow_cast<std::uint8_t>(pCurrent[i] - PaethPredictor(nLeft, pPrevious[i], nUpLeft));
+        }
+
+        // PNG filter types: 0=None, 1=Sub, 2=Up, 4=Paeth
+        std::uint8_t nFilter = 0;
+        const std::uint8_t* pBest = pCurrent;
+        auto nBestCost = GetFilterCost(pCurrent, nRowLength);
+
+        const auto nSubCost = GetFilterCost(pSub, nRowLength);
+        if (nSubCost < nBestCost)
+        {
+            nFilter = 1;
+            pBest = pSub;
+            nBestCost = nSubCost;
+        }
+
+        const auto nUpCost = GetFilterCost(pUp, nRowLength);
+        if (nUpCost < nBestCost)
+        {
+            nFilter = 2;
+            pBest = pUp;
+            nBestCost = nUpCost;
+        }
+
+        if (GetFilterCost(pPaeth, nRowLength) < nBestCost)
+        {
+            nFilter = 4;
+            pBest = pPaeth;
+        }
+
+        *pOutput++ = nFilter;
+        memcpy(pOutput, pBest, nRowLength);
+        pOutput += nRowLength;
+
+        std::swap(pPrevious, pCurrent);
+    }
+}
+
+void PngEncoder::Deflate(const std::vector<std::uint8_t>& vData, std::string& sOutput)
+{
+    // everything goes into a single block using the fixed Huffman codes. building custom code tables would
+    // compress better, but would cost another pass over the data.
+    BitWriter pWriter(sOutput);
+    pWriter.Write(1, 1); // BFINAL
+    pWriter.Write(1, 2); // BTYPE = fixed Huffman
+
+    m_vHashHead.assign(HASH_SIZE, -1);
+    m_vHashChain.resize(WINDOW_SIZE);
+
+    const auto& vLiteralCodes = GetFixedLiteralCodes();
+    const std::uint8_t* pData = vData.data();
+    const int nLength = gsl::narrow<int>(vData.size());
+
+    const auto InsertHash = [this, pData](int nPosition) noexcept
+    {
+        const auto nHash = Hash(pData + nPosition);
+        m_vHashChain[nPosition & (WINDOW_SIZE - 1)] = m_vHashHead[nHash];
+        m_vHashHead[nHash] = nPosition;
+    };
+
+    int nPosition = 0;
+    while (nPosition < nLength)
+    {
+        int nBestLength = 0;
+        int nBestDistance = 0;
+
+        if (nPosition + MIN_MATCH <= nLength)
+        {
+            const int nMaxLength = std::min(MAX_MATCH, nLength - nPosition);
+            const auto* pCurrent = pData + nPosition;
+
+            int nCandidate = m_vHashHead[Hash(pCurrent)];
+            for (int nChain = 0; nChain < MAX_CHAIN && nCandidate >= 0; ++nChain)
+            {
+                const int nDistance = nPosition - nCandidate;
+                if (nDistance >= WINDOW_SIZE)
+                    break;
+
+                const auto* pMatch = pData + nCandidate;
+                if (pMatch[nBestLength] == pCurrent[nBestLength])
+                {
+                    int nMatchLength = 0;
+                    while (nMatchLength < nMaxLength && pMatch[nMatchLength] == pCurrent[nMatchLength])
+                        ++nMatchLength;
+
+                    if (nMatchLength > nBestLength)
+                    {
+                        nBestLength = nMatchLength;
+                        nBestDistance = nDistance;
+                        if (nMatchLength == nMaxLength)
+                            break;
+                    }
+                }
+
+                // entries older than the window may have been overwritten by newer positions
+                const int nNext = m_vHashChain[nCandidate & (WINDOW_SIZE - 1)];
+                if (nNext >= nCandidate)
+                    break;
+
+                nCandidate = nNext;
+            }
+        }
+
+        if (nBestLength >= MIN_MATCH)
+        {
+            WriteLength(pWriter, nBestLength);
+            WriteDistance(pWriter, nBestDistance);
+
+            const int nEnd = std::min(nPosition + nBestLength, nLength - MIN_MATCH + 1);
+            for (int i = nPosition; i < nEnd; ++i)
+                InsertHash(i);
+
+            nPosition += nBestLength;
+        }
+        else
+        {
+            const auto& pCode = vLiteralCodes.at(pData[nPosition]);
+            pWriter.Write(pCode.nCode, pCode.nBits);
+
+            if (nPosition + MIN_MATCH <= nLength)
+                InsertHash(nPosition);
+
+            ++nPosition;
+        }
+    }
+
+    const auto& pEndOfBlock = vLiteralCodes.at(256);
+    pWriter.Write(pEndOfBlock.nCode, pEndOfBlock.nBits);
+    pWriter.Flush();
+}
+
+void PngEncoder::Compress(const std::vector<std::uint8_t>& vData, std::string& sOutput)
+{
+    // zlib header: deflate with a 32K window, no preset dictionary, default compression level
+    sOutput.push_back(gsl::narrow_cast<char>(0x78));
+    sOutput.push_back(gsl::narrow_cast<char>(0x9C));
+
+    Deflate(vData, sOutput);
+
+    AppendUInt32(sOutput, Adler32(1, vData.data(), vData.size()));
+}
+
+std::string PngEncoder::Encode(unsigned int nWidth, unsigned int nHeight, const std::vector<std::uint32_t>& vPixels)
+{
+    if (nWidth == 0 || nHeight == 0 || vPixels.size() != gsl::narrow_cast<size_t>(nWidth) * nHeight)
+        return std::string();
+
+    FilterRows(nWidth, nHeight, vPixels);
+
+    std::string sCompressed;
+    sCompressed.reserve(m_vScanlines.size() / 4);
+    Compress(m_vScanlines, sCompressed);
+
+    std::string sPng;
+    sPng.reserve(sCompressed.length() + 64);
+
+    constexpr std::array<std::uint8_t, 8> PNG_SIGNATURE = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    sPng.append(PNG_SIGNATURE.begin(), PNG_SIGNATURE.end());
+
+    std::array<std::uint8_t, 13> vHeader{};
+    vHeader.at(0) = gsl::narrow_cast<std::uint8_t>(nWidth >> 24);
+    vHeader.at(1) = gsl::narrow_cast<std::uint8_t>((nWidth >> 16) & 0xFF);
+    vHeader.at(2) = gsl::narrow_cast<std::uint8_t>((nWidth >> 8) & 0xFF);
+    vHeader.at(3) = gsl::narrow_cast<std::uint8_t>(nWidth & 0xFF);
+    vHeader.at(4) = gsl::narrow_cast<std::uint8_t>(nHeight >> 24);
+    vHeader.at(5) = gsl::narrow_cast<std::uint8_t>((nHeight >> 16) & 0xFF);
+    vHeader.at(6) = gsl::narrow_cast<std::uint8_t>((nHeight >> 8) & 0xFF);
+    vHeader.at(7) = gsl::narrow_cast<std::uint8_t>(nHeight & 0xFF);
+    vHeader.at(8) = 8; // bit depth
+    vHeader.at(9) = 2; // color type: RGB
+    // compression, filter, and interlace methods are all 0
+    AppendChunk(sPng, "IHDR", vHeader.data(), vHeader.size());
+
+    GSL_SUPPRESS_TYPE1 AppendChunk(sPng, "IDAT", reinterpret_cast<const std::uint8_t*>(sCompressed.data()), sCompressed.length());
+    AppendChunk(sPng, "IEND", nullptr, 0);
+
+    return sPng;
+}
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
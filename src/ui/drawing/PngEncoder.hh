@@ -0,0 +1,46 @@
+#ifndef RA_UI_DRAWING_PNGENCODER_HH
+#define RA_UI_DRAWING_PNGENCODER_HH
+#pragma once
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+/// <summary>
+/// Encodes images as PNG data without relying on any platform libraries.
+/// </summary>
+/// <remarks>
+/// Scratch buffers are kept between calls, so an instance should not be shared across threads.
+/// </remarks>
+class PngEncoder
+{
+public:
+    /// <summary>
+    /// Encodes 32-bit ARGB pixels (top row first) as a 24-bit RGB PNG. The alpha channel is ignored.
+    /// </summary>
+    /// <returns>The encoded image, or an empty string if the dimensions don't match the pixel data.</returns>
+    std::string Encode(unsigned int nWidth, unsigned int nHeight, const std::vector<std::uint32_t>& vPixels);
+
+    /// <summary>
+    /// Compresses data into a zlib stream.
+    /// </summary>
+    void Compress(const std::vector<std::uint8_t>& vData, std::string& sOutput);
+
+    static std::uint32_t Crc32(std::uint32_t nCrc, const std::uint8_t* pData, size_t nLength) noexcept;
+    static std::uint32_t Adler32(std::uint32_t nAdler, const std::uint8_t* pData, size_t nLength) noexcept;
+
+private:
+    void FilterRows(unsigned int nWidth, unsigned int nHeight, const std::vector<std::uint32_t>& vPixels);
+    void Deflate(const std::vector<std::uint8_t>& vData, std::string& sOutput);
+
+    std::vector<std::uint8_t> m_vScanlines;
+    std::vector<std::uint8_t> m_vCandidates;
+    std::vector<std::int32_t> m_vHashHead;
+    std::vector<std::int32_t> m_vHashChain;
+};
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
+
+#endif // !RA_UI_DRAWING_PNGENCODER_HH
@@ -0,0 +1,167 @@
+#include "PngWriter.hh"
+
+#include "RA_Log.h"
+
+#include "services\IFileSystem.hh"
+#include "services\IThreadPool.hh"
+#include "services\ServiceLocator.hh"
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+std::vector<std::uint32_t> PngWriter::AcquireBuffer(size_t nPixels)
+{
+    std::vector<std::uint32_t> vBuffer;
+    {
+        std::lock_guard<std::mutex> lock(m_oMutex);
+        if (!m_vBuffers.empty())
+        {
+            vBuffer = std::move(m_vBuffers.back());
+            m_vBuffers.pop_back();
+        }
+    }
+
+    // resizing a recycled buffer to the same size doesn't allocate
+    vBuffer.resize(nPixels);
+    return vBuffer;
+}
+
+bool PngWriter::Enqueue(unsigned int nWidth, unsigned int nHeight, std::vector<std::uint32_t>&& vPixels, const std::wstring& sPath)
+{
+    std::unique_lock<std::mutex> lock(m_oMutex);
+
+    // each queued image holds a full copy of its pixels. if the disk can't keep up, drop new images rather
+    // than letting the memory grow.
+    if (m_vQueue.size() >= m_nMaxQueued)
+    {
+        RA_LOG_WARN("Too many images waiting to be written, discarding %s", sPath);
+        return false;
+    }
+
+    AddToQueue(lock, nWidth, nHeight, std::move(vPixels), sPath);
+    return true;
+}
+
+void PngWriter::EnqueueAndWait(unsigned int nWidth, unsigned int nHeight, std::vector<std::uint32_t>&& vPixels, const std::wstring& sPath)
+{
+    std::unique_lock<std::mutex> lock(m_oMutex);
+
+    while (m_vQueue.size() >= m_nMaxQueued)
+    {
+        if (m_bWriting)
+        {
+            m_cvQueueSpace.wait(lock);
+            continue;
+        }
+
+        // the writer task is still waiting for a thread - possibly the one we're holding. write the queue here
+        // so neither side waits on the other.
+        RA_LOG_INFO("Too many images waiting to be written, writing them before queueing %s", sPath);
+        lock.unlock();
+        ProcessQueue();
+        lock.lock();
+    }
+
+    AddToQueue(lock, nWidth, nHeight, std::move(vPixels), sPath);
+}
+
+void PngWriter::AddToQueue(std::unique_lock<std::mutex>& lock, unsigned int nWidth, unsigned int nHeight,
+                           std::vector<std::uint32_t>&& vPixels, const std::wstring& sPath)
+{
+    auto& pImage = m_vQueue.emplace_back();
+    pImage.nWidth = nWidth;
+    pImage.nHeight = nHeight;
+    pImage.vPixels = std::move(vPixels);
+    pImage.sPath = sPath;
+
+    if (m_bProcessing)
+        return;
+
+    m_bProcessing = true;
+    lock.unlock();
+
+    ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().RunAsync([this]()
+    {
+        ProcessQueue();
+    }, ra::services::TaskPriority::Background);
+}
+
+void PngWriter::ProcessQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_oMutex);
+        if (m_bWriting)
+            return;
+
+        m_bWriting = true;
+    }
+
+    const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
+
+    do
+    {
+        const QueuedImage* pImage = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_oMutex);
+            if (m_vQueue.empty())
+            {
+                // anything queued after this point will schedule a new task
+                m_bWriting = false;
+                m_bProcessing = false;
+                m_cvQueueSpace.notify_all();
+                return;
+            }
+
+            // the front item is not removed until it's been written, so it counts against the queue limit.
+            // adding items to the back of a deque does not move existing items.
+            pImage = &m_vQueue.front();
+        }
+
+        const auto sData = m_oEncoder.Encode(pImage->nWidth, pImage->nHeight, pImage->vPixels);
+        if (sData.empty())
+        {
+            RA_LOG_WARN("Could not encode %s", pImage->sPath);
+        }
+        else
+        {
+            auto pFile = pFileSystem.CreateTextFile(pImage->sPath);
+            if (pFile == nullptr)
+            {
+                RA_LOG_WARN("Could not create %s", pImage->sPath);
+            }
+            else
+            {
+                pFile->Write(sData);
+                RA_LOG_INFO("Wrote %s", pImage->sPath);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_oMutex);
+            auto vPixels = std::move(m_vQueue.front().vPixels);
+            m_vQueue.pop_front();
+
+            if (m_vBuffers.size() < MAX_POOLED_BUFFERS)
+                m_vBuffers.push_back(std::move(vPixels));
+
+            m_cvQueueSpace.notify_all();
+        }
+    } while (true);
+}
+
+size_t PngWriter::QueuedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_vQueue.size();
+}
+
+size_t PngWriter::PooledBufferCount() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_vBuffers.size();
+}
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
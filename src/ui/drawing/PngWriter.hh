@@ -0,0 +1,94 @@
+#ifndef RA_UI_DRAWING_PNGWRITER_HH
+#define RA_UI_DRAWING_PNGWRITER_HH
+#pragma once
+
+#include "ui\drawing\PngEncoder.hh"
+
+#include <condition_variable>
+#include <deque>
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+/// <summary>
+/// Encodes images as PNG files on the thread pool so the caller only has to copy the pixels.
+/// </summary>
+class PngWriter
+{
+public:
+    explicit PngWriter(size_t nMaxQueued = DEFAULT_MAX_QUEUED) noexcept : m_nMaxQueued(nMaxQueued) {}
+
+    ~PngWriter() noexcept = default;
+    PngWriter(const PngWriter&) noexcept = delete;
+    PngWriter& operator=(const PngWriter&) noexcept = delete;
+    PngWriter(PngWriter&&) noexcept = delete;
+    PngWriter& operator=(PngWriter&&) noexcept = delete;
+
+    /// <summary>
+    /// Gets a buffer that can hold <paramref name="nPixels" /> pixels. Buffers are reused after the images
+    /// they were enqueued with have been written.
+    /// </summary>
+    std::vector<std::uint32_t> AcquireBuffer(size_t nPixels);
+
+    /// <summary>
+    /// Queues 32-bit ARGB pixels (top row first) to be written to <paramref name="sPath" />.
+    /// </summary>
+    /// <returns>
+    /// <c>false</c> if too many images are already waiting to be written. The image is discarded.
+    /// </returns>
+    bool Enqueue(unsigned int nWidth, unsigned int nHeight, std::vector<std::uint32_t>&& vPixels, const std::wstring& sPath);
+
+    /// <summary>
+    /// Queues 32-bit ARGB pixels (top row first) to be written to <paramref name="sPath" />, waiting for space
+    /// in the queue if too many images are already waiting to be written.
+    /// </summary>
+    /// <remarks>
+    /// Blocks the caller, so should only be called from a background thread. If the writer task hasn't started
+    /// when the queue is full, the queued images are written on the calling thread.
+    /// </remarks>
+    void EnqueueAndWait(unsigned int nWidth, unsigned int nHeight, std::vector<std::uint32_t>&& vPixels, const std::wstring& sPath);
+
+    /// <summary>
+    /// Gets the number of images that have not been written yet.
+    /// </summary>
+    size_t QueuedCount() const;
+
+    /// <summary>
+    /// Gets the number of buffers available for reuse.
+    /// </summary>
+    size_t PooledBufferCount() const;
+
+    static constexpr size_t DEFAULT_MAX_QUEUED = 4;
+    static constexpr size_t MAX_POOLED_BUFFERS = 2;
+
+private:
+    void AddToQueue(std::unique_lock<std::mutex>& lock, unsigned int nWidth, unsigned int nHeight,
+                    std::vector<std::uint32_t>&& vPixels, const std::wstring& sPath);
+    void ProcessQueue();
+
+    struct QueuedImage
+    {
+        unsigned int nWidth = 0;
+        unsigned int nHeight = 0;
+        std::vector<std::uint32_t> vPixels;
+        std::wstring sPath;
+    };
+
+    std::deque<QueuedImage> m_vQueue;
+    std::vector<std::vector<std::uint32_t>> m_vBuffers;
+    mutable std::mutex m_oMutex;
+    std::condition_variable m_cvQueueSpace;
+    bool m_bProcessing = false; // a task has been scheduled to write the queue
+    bool m_bWriting = false;    // a thread is writing the queue
+    size_t m_nMaxQueued;
+
+    // only used by the thread writing the queue, of which there's only ever one
+    PngEncoder m_oEncoder;
+};
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
+
+#endif // !RA_UI_DRAWING_PNGWRITER_HH
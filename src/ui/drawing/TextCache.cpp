@@ -0,0 +1,150 @@
+#include "TextCache.hh"
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+// rough cost of the map node, list node, and string headers for each entry
+static constexpr size_t ENTRY_OVERHEAD = 128;
+
+std::wstring TextCache::GetKey(int nFont, const std::wstring& sText)
+{
+    std::wstring sKey;
+    sKey.reserve(sText.length() + 1);
+    sKey.push_back(gsl::narrow_cast<wchar_t>(nFont));
+    sKey.append(sText);
+    return sKey;
+}
+
+size_t TextCache::GetMemoryUsage(const std::wstring& sKey, const Entry& pEntry) noexcept
+{
+    // the key is stored in both the map and the usage list
+    return ENTRY_OVERHEAD + sKey.length() * sizeof(wchar_t) * 2 +
+           ((pEntry.pMask != nullptr) ? pEntry.pMask->vCoverage.size() : 0);
+}
+
+// Find, Store, and Trim must be called while holding m_oMutex
+TextCache::Entry* TextCache::Find(int nFont, const std::wstring& sText)
+{
+    const auto pIter = m_mEntries.find(GetKey(nFont, sText));
+    if (pIter == m_mEntries.end())
+        return nullptr;
+
+    // move to the front of the usage list
+    auto& pEntry = pIter->second;
+    if (pEntry.pUsage != m_vUsage.begin())
+        m_vUsage.splice(m_vUsage.begin(), m_vUsage, pEntry.pUsage);
+
+    return &pEntry;
+}
+
+TextCache::Entry& TextCache::Store(int nFont, const std::wstring& sText)
+{
+    auto sKey = GetKey(nFont, sText);
+    auto pIter = m_mEntries.find(sKey);
+    if (pIter != m_mEntries.end())
+    {
+        auto& pEntry = pIter->second;
+        m_nMemoryUsage -= GetMemoryUsage(sKey, pEntry);
+        if (pEntry.pUsage != m_vUsage.begin())
+            m_vUsage.splice(m_vUsage.begin(), m_vUsage, pEntry.pUsage);
+        return pEntry;
+    }
+
+    m_vUsage.push_front(sKey);
+    auto& pEntry = m_mEntries[std::move(sKey)];
+    pEntry.pUsage = m_vUsage.begin();
+    return pEntry;
+}
+
+void TextCache::Trim(const Entry& pKeep)
+{
+    // discard the least recently used entries until the cache fits. the entry that was just stored is never
+    // discarded so the caller can use it, even if it's larger than the cache.
+    while (m_nMemoryUsage > m_nMaxMemory && !m_vUsage.empty())
+    {
+        const auto pIter = m_mEntries.find(m_vUsage.back());
+        Expects(pIter != m_mEntries.end());
+        if (&pIter->second == &pKeep)
+            break;
+
+        m_nMemoryUsage -= GetMemoryUsage(pIter->first, pIter->second);
+        m_mEntries.erase(pIter);
+        m_vUsage.pop_back();
+    }
+}
+
+bool TextCache::FindSize(int nFont, const std::wstring& sText, ra::ui::Size& szText)
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto* pEntry = Find(nFont, sText);
+    if (pEntry == nullptr)
+        return false;
+
+    szText = pEntry->szText;
+    return true;
+}
+
+void TextCache::StoreSize(int nFont, const std::wstring& sText, const ra::ui::Size& szText)
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    auto& pEntry = Store(nFont, sText);
+    if (pEntry.szText.Width != szText.Width || pEntry.szText.Height != szText.Height)
+    {
+        // a mask for a different size is no longer valid
+        pEntry.szText = szText;
+        pEntry.pMask.reset();
+    }
+
+    m_nMemoryUsage += GetMemoryUsage(*pEntry.pUsage, pEntry);
+    Trim(pEntry);
+}
+
+std::shared_ptr<const TextCache::Mask> TextCache::FindMask(int nFont, const std::wstring& sText)
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    const auto* pEntry = Find(nFont, sText);
+    return (pEntry != nullptr) ? pEntry->pMask : nullptr;
+}
+
+std::shared_ptr<const TextCache::Mask> TextCache::StoreMask(int nFont, const std::wstring& sText, Mask&& pMask)
+{
+    Expects(pMask.vCoverage.size() == gsl::narrow_cast<size_t>(pMask.szText.Width) * pMask.szText.Height);
+
+    // allocate outside the lock
+    auto pNewMask = std::make_shared<const Mask>(std::move(pMask));
+
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    auto& pEntry = Store(nFont, sText);
+    pEntry.szText = pNewMask->szText;
+    pEntry.pMask = pNewMask;
+
+    m_nMemoryUsage += GetMemoryUsage(*pEntry.pUsage, pEntry);
+    Trim(pEntry);
+
+    return pNewMask;
+}
+
+GSL_SUPPRESS_F6 void TextCache::Clear() noexcept
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    m_mEntries.clear();
+    m_vUsage.clear();
+    m_nMemoryUsage = 0;
+}
+
+size_t TextCache::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_mEntries.size();
+}
+
+size_t TextCache::GetMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_oMutex);
+    return m_nMemoryUsage;
+}
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
@@ -0,0 +1,107 @@
+#ifndef RA_UI_DRAWING_TEXTCACHE_HH
+#define RA_UI_DRAWING_TEXTCACHE_HH
+#pragma once
+
+#include "ui\Types.hh"
+
+#include <list>
+
+namespace ra {
+namespace ui {
+namespace drawing {
+
+/// <summary>
+/// Caches the measurements and rasterized coverage masks of recently drawn strings so surfaces don't have to
+/// ask the platform to render the same text every frame.
+/// </summary>
+/// <remarks>
+/// The cache is shared by every surface, which are drawn from both the UI thread and the emulator thread.
+/// </remarks>
+class TextCache
+{
+public:
+    explicit TextCache(size_t nMaxMemory = DEFAULT_MAX_MEMORY) noexcept : m_nMaxMemory(nMaxMemory) {}
+
+    struct Mask
+    {
+        /// <summary>
+        /// The size of the rendered text.
+        /// </summary>
+        ra::ui::Size szText;
+
+        /// <summary>
+        /// The coverage (0-255) of each pixel of the rendered text, starting with the top row.
+        /// </summary>
+        std::vector<std::uint8_t> vCoverage;
+    };
+
+    /// <summary>
+    /// Gets the cached size of <paramref name="sText" /> when drawn with <paramref name="nFont" />.
+    /// </summary>
+    /// <returns><c>false</c> if the text has not been measured.</returns>
+    bool FindSize(int nFont, const std::wstring& sText, ra::ui::Size& szText);
+
+    /// <summary>
+    /// Caches the size of <paramref name="sText" /> when drawn with <paramref name="nFont" />.
+    /// </summary>
+    void StoreSize(int nFont, const std::wstring& sText, const ra::ui::Size& szText);
+
+    /// <summary>
+    /// Gets the cached coverage mask of <paramref name="sText" /> when drawn with <paramref name="nFont" />.
+    /// </summary>
+    /// <returns><c>nullptr</c> if the text has not been rendered.</returns>
+    /// <remarks>The mask remains valid after it has been evicted from the cache.</remarks>
+    std::shared_ptr<const Mask> FindMask(int nFont, const std::wstring& sText);
+
+    /// <summary>
+    /// Caches the coverage mask of <paramref name="sText" /> when drawn with <paramref name="nFont" />.
+    /// </summary>
+    /// <returns>The cached mask.</returns>
+    std::shared_ptr<const Mask> StoreMask(int nFont, const std::wstring& sText, Mask&& pMask);
+
+    /// <summary>
+    /// Discards all cached items.
+    /// </summary>
+    void Clear() noexcept;
+
+    /// <summary>
+    /// Gets the number of cached strings.
+    /// </summary>
+    size_t Count() const;
+
+    /// <summary>
+    /// Gets the approximate amount of memory used by the cache.
+    /// </summary>
+    size_t GetMemoryUsage() const;
+
+    static constexpr size_t DEFAULT_MAX_MEMORY = 2 * 1024 * 1024;
+
+private:
+    struct Entry
+    {
+        ra::ui::Size szText;
+        std::shared_ptr<const Mask> pMask;
+        std::list<std::wstring>::iterator pUsage;
+    };
+
+    static std::wstring GetKey(int nFont, const std::wstring& sText);
+    static size_t GetMemoryUsage(const std::wstring& sKey, const Entry& pEntry) noexcept;
+
+    Entry* Find(int nFont, const std::wstring& sText);
+    Entry& Store(int nFont, const std::wstring& sText);
+    void Trim(const Entry& pKeep);
+
+    // even a hit reorders the usage list, so every call has to hold the lock. masks are handed out as shared
+    // pointers so evicting one doesn't free it while another thread is still blending it.
+    mutable std::mutex m_oMutex;
+    std::unordered_map<std::wstring, Entry> m_mEntries;
+    std::list<std::wstring> m_vUsage; // most recently used first
+    size_t m_nMemoryUsage = 0;
+    size_t m_nMaxMemory;
+};
+
+} // namespace drawing
+} // namespace ui
+} // namespace ra
+
+#endif // !RA_UI_DRAWING_TEXTCACHE_HH
@@ -0,0 +1,476 @@
+#include "BitmapSurface.hh"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define RA_BITMAPSURFACE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace bitmap {
+
+#pragma warning(push)
+#pragma warning(disable : 5045)
+
+// ===== kernels =====
+
+static void FillPixels(std::uint32_t* pBits, size_t nCount, std::uint32_t nColor) noexcept
+{
+#ifdef RA_BITMAPSURFACE_SSE2
+    const __m128i vColor = _mm_set1_epi32(gsl::narrow_cast<int>(nColor));
+    while (nCount >= 4)
+    {
+        GSL_SUPPRESS_TYPE1 _mm_storeu_si128(reinterpret_cast<__m128i*>(pBits), vColor);
+        pBits += 4;
+        nCount -= 4;
+    }
+#endif
+
+    while (nCount--)
+        *pBits++ = nColor;
+}
+
+static constexpr std::uint8_t BlendPixel(std::uint8_t nTarget, std::uint8_t nBlend, unsigned int nAlpha) noexcept
+{
+    return gsl::narrow_cast<std::uint8_t>(((nBlend * nAlpha) + (nTarget * (256 - nAlpha))) / 256);
+}
+
+static std::uint32_t BlendPixel(std::uint32_t nTarget, std::uint32_t nBlend, unsigned int nAlpha) noexcept
+{
+    Color nTargetColor(nTarget);
+    const Color nBlendColor(nBlend);
+    nTargetColor.Channel.R = BlendPixel(nTargetColor.Channel.R, nBlendColor.Channel.R, nAlpha);
+    nTargetColor.Channel.G = BlendPixel(nTargetColor.Channel.G, nBlendColor.Channel.G, nAlpha);
+    nTargetColor.Channel.B = BlendPixel(nTargetColor.Channel.B, nBlendColor.Channel.B, nAlpha);
+    return nTargetColor.ARGB;
+}
+
+// Merges pSrcBits onto pBits using the alpha channel of pSrcBits. Fully transparent source pixels are ignored and
+// fully opaque source pixels are copied. The alpha channel of pBits is not modified.
+static void BlendPixels(std::uint32_t* pBits, const std::uint32_t* pSrcBits, size_t nCount) noexcept
+{
+#ifdef RA_BITMAPSURFACE_SSE2
+    const __m128i vZero = _mm_setzero_si128();
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i v256 = _mm_set1_epi16(256);
+    const __m128i vAlphaMask = _mm_set1_epi32(gsl::narrow_cast<int>(0xFF000000));
+
+    while (nCount >= 4)
+    {
+        __m128i vSrc;
+        GSL_SUPPRESS_TYPE1 vSrc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrcBits));
+
+        // skip the group if all four source pixels are fully transparent
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(vSrc, vAlphaMask), vZero)) != 0xFFFF)
+        {
+            __m128i vDst;
+            GSL_SUPPRESS_TYPE1 vDst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBits));
+
+            // widen to 16-bit channels, two pixels per register
+            const __m128i vSrcLo = _mm_unpacklo_epi8(vSrc, vZero);
+            const __m128i vSrcHi = _mm_unpackhi_epi8(vSrc, vZero);
+            const __m128i vDstLo = _mm_unpacklo_epi8(vDst, vZero);
+            const __m128i vDstHi = _mm_unpackhi_epi8(vDst, vZero);
+
+            // broadcast each pixel's alpha to all four of its channels
+            __m128i vAlphaLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(vSrcLo, 0xFF), 0xFF);
+            __m128i vAlphaHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(vSrcHi, 0xFF), 0xFF);
+
+            // treat 255 as 256 so opaque pixels are copied exactly, matching the scalar path
+            vAlphaLo = _mm_sub_epi16(vAlphaLo, _mm_cmpeq_epi16(vAlphaLo, v255));
+            vAlphaHi = _mm_sub_epi16(vAlphaHi, _mm_cmpeq_epi16(vAlphaHi, v255));
+
+            // (src * a + dst * (256 - a)) / 256
+            const __m128i vResultLo = _mm_srli_epi16(
+                _mm_add_epi16(_mm_mullo_epi16(vSrcLo, vAlphaLo), _mm_mullo_epi16(vDstLo, _mm_sub_epi16(v256, vAlphaLo))), 8);
+            const __m128i vResultHi = _mm_srli_epi16(
+                _mm_add_epi16(_mm_mullo_epi16(vSrcHi, vAlphaHi), _mm_mullo_epi16(vDstHi, _mm_sub_epi16(v256, vAlphaHi))), 8);
+
+            // keep the original destination alpha
+            __m128i vResult = _mm_packus_epi16(vResultLo, vResultHi);
+            vResult = _mm_or_si128(_mm_andnot_si128(vAlphaMask, vResult), _mm_and_si128(vAlphaMask, vDst));
+            GSL_SUPPRESS_TYPE1 _mm_storeu_si128(reinterpret_cast<__m128i*>(pBits), vResult);
+        }
+
+        pBits += 4;
+        pSrcBits += 4;
+        nCount -= 4;
+    }
+#endif
+
+    while (nCount--)
+    {
+        const auto nAlpha = (*pSrcBits >> 24);
+        if (nAlpha == 0)
+        {
+            // ignore fully transparent pixels
+        }
+        else if (nAlpha == 0xFF)
+        {
+            // copy fully opaque pixels
+            *pBits = (*pBits & 0xFF000000) | (*pSrcBits & 0x00FFFFFF);
+        }
+        else
+        {
+            // merge partially transparent pixels
+            *pBits = BlendPixel(*pBits, *pSrcBits, nAlpha);
+        }
+
+        ++pBits;
+        ++pSrcBits;
+    }
+}
+
+// Sets the alpha channel of every pixel that is not fully transparent.
+static void ApplyOpacity(std::uint32_t* pBits, size_t nCount, std::uint8_t nAlpha) noexcept
+{
+    const std::uint32_t nAlphaBits = gsl::narrow_cast<std::uint32_t>(nAlpha) << 24;
+
+#ifdef RA_BITMAPSURFACE_SSE2
+    const __m128i vZero = _mm_setzero_si128();
+    const __m128i vAlphaMask = _mm_set1_epi32(gsl::narrow_cast<int>(0xFF000000));
+    const __m128i vAlpha = _mm_set1_epi32(gsl::narrow_cast<int>(nAlphaBits));
+
+    while (nCount >= 4)
+    {
+        __m128i vPixels;
+        GSL_SUPPRESS_TYPE1 vPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBits));
+
+        // mask of pixels that have a non-zero alpha
+        const __m128i vVisible = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(vPixels, vAlphaMask), vZero), vAlphaMask);
+        vPixels = _mm_or_si128(_mm_andnot_si128(vVisible, vPixels), _mm_and_si128(vVisible, vAlpha));
+        GSL_SUPPRESS_TYPE1 _mm_storeu_si128(reinterpret_cast<__m128i*>(pBits), vPixels);
+
+        pBits += 4;
+        nCount -= 4;
+    }
+#endif
+
+    while (nCount--)
+    {
+        // only update the alpha for non-transparent pixels
+        if (*pBits & 0xFF000000)
+            *pBits = (*pBits & 0x00FFFFFF) | nAlphaBits;
+        ++pBits;
+    }
+}
+
+#pragma warning(pop)
+
+// Adjusts a destination rectangle and its source offset so the rectangle fits within both the destination
+// and the source. Returns false if nothing is left to draw.
+static bool ClipRectangle(int& nX, int& nY, int& nSrcX, int& nSrcY, int& nWidth, int& nHeight,
+                          int nTargetWidth, int nTargetHeight, int nSourceWidth, int nSourceHeight) noexcept
+{
+    if (nX < 0)
+    {
+        nWidth += nX;
+        nSrcX -= nX;
+        nX = 0;
+    }
+    if (nSrcX < 0)
+    {
+        nWidth += nSrcX;
+        nX -= nSrcX;
+        nSrcX = 0;
+    }
+    if (nWidth > nTargetWidth - nX)
+        nWidth = nTargetWidth - nX;
+    if (nWidth > nSourceWidth - nSrcX)
+        nWidth = nSourceWidth - nSrcX;
+    if (nWidth <= 0)
+        return false;
+
+    if (nY < 0)
+    {
+        nHeight += nY;
+        nSrcY -= nY;
+        nY = 0;
+    }
+    if (nSrcY < 0)
+    {
+        nHeight += nSrcY;
+        nY -= nSrcY;
+        nSrcY = 0;
+    }
+    if (nHeight > nTargetHeight - nY)
+        nHeight = nTargetHeight - nY;
+    if (nHeight > nSourceHeight - nSrcY)
+        nHeight = nSourceHeight - nSrcY;
+
+    return (nHeight > 0);
+}
+
+// ===== BitmapSurface =====
+
+BitmapSurface::BitmapSurface(unsigned int nWidth, unsigned int nHeight, bool bTransparent,
+                             IGlyphSource* pGlyphSource, IImageSource* pImageSource)
+    : m_nWidth(nWidth),
+      m_nHeight(nHeight),
+      m_bTransparent(bTransparent),
+      m_vPixels(gsl::narrow_cast<size_t>(nWidth) * nHeight),
+      m_pGlyphSource(pGlyphSource),
+      m_pImageSource(pImageSource)
+{
+}
+
+Color BitmapSurface::GetPixel(unsigned int nX, unsigned int nY) const
+{
+    Expects(nX < m_nWidth && nY < m_nHeight);
+    return Color(m_vPixels.at(gsl::narrow_cast<size_t>(nY) * m_nWidth + nX));
+}
+
+void BitmapSurface::FillRectangle(int nX, int nY, int nWidth, int nHeight, Color nColor) noexcept
+{
+    int nSrcX = 0, nSrcY = 0;
+    if (!ClipRectangle(nX, nY, nSrcX, nSrcY, nWidth, nHeight, ra::to_signed(m_nWidth), ra::to_signed(m_nHeight),
+                       INT_MAX, INT_MAX))
+    {
+        return;
+    }
+
+    const auto nStride = gsl::narrow_cast<size_t>(m_nWidth);
+    auto* pBits = m_vPixels.data() + nStride * nY + nX;
+
+    if (nStride == gsl::narrow_cast<size_t>(nWidth))
+    {
+        // doing full scanlines, just bulk fill
+        FillPixels(pBits, nStride * nHeight, nColor.ARGB);
+    }
+    else
+    {
+        // partial scanlines, have to fill in strips
+        while (nHeight--)
+        {
+            FillPixels(pBits, gsl::narrow_cast<size_t>(nWidth), nColor.ARGB);
+            pBits += nStride;
+        }
+    }
+}
+
+int BitmapSurface::LoadFont(const std::string& sFont, int nFontSize, FontStyles nStyle)
+{
+    if (m_pGlyphSource == nullptr)
+        return 0;
+
+    return m_pGlyphSource->LoadFont(sFont, nFontSize, nStyle);
+}
+
+ra::ui::Size BitmapSurface::MeasureText(int nFont, const std::wstring& sText) const
+{
+    if (m_pGlyphSource == nullptr)
+        return {};
+
+    int nWidth = 0;
+    for (const auto c : sText)
+    {
+        const auto* pGlyph = m_pGlyphSource->GetGlyph(nFont, c);
+        if (pGlyph != nullptr)
+            nWidth += pGlyph->nAdvance;
+    }
+
+    return {nWidth, m_pGlyphSource->GetLineHeight(nFont)};
+}
+
+void BitmapSurface::WriteText(int nX, int nY, int nFont, Color nColor, const std::wstring& sText)
+{
+    if (sText.empty() || m_pGlyphSource == nullptr)
+        return;
+
+    const auto nLineHeight = m_pGlyphSource->GetLineHeight(nFont);
+    const auto nSurfaceWidth = ra::to_signed(m_nWidth);
+    for (const auto c : sText)
+    {
+        if (nX >= nSurfaceWidth)
+            break;
+
+        const auto* pGlyph = m_pGlyphSource->GetGlyph(nFont, c);
+        if (pGlyph == nullptr)
+            continue;
+
+        DrawGlyph(nX, nY, *pGlyph, nLineHeight, nColor);
+        nX += pGlyph->nAdvance;
+    }
+}
+
+void BitmapSurface::DrawGlyph(int nX, int nY, const IGlyphSource::Glyph& pGlyph, int nLineHeight, Color nColor) noexcept
+{
+    int nGlyphX = 0, nGlyphY = 0;
+    int nWidth = pGlyph.nAdvance, nHeight = nLineHeight;
+    if (gsl::narrow_cast<size_t>(nWidth) * nHeight > pGlyph.vCoverage.size())
+        return;
+
+    if (!ClipRectangle(nX, nY, nGlyphX, nGlyphY, nWidth, nHeight, ra::to_signed(m_nWidth),
+                       ra::to_signed(m_nHeight), pGlyph.nAdvance, nLineHeight))
+    {
+        return;
+    }
+
+    const auto nStride = gsl::narrow_cast<size_t>(m_nWidth);
+    auto* pBits = m_vPixels.data() + nStride * nY + nX;
+    const auto* pCoverage = pGlyph.vCoverage.data() + gsl::narrow_cast<size_t>(pGlyph.nAdvance) * nGlyphY + nGlyphX;
+
+    // use the coverage as the alpha for antialiasing. like GDIBitmapSurface, fully covered pixels take the text
+    // color (including its alpha) and partially covered pixels keep the alpha of the surface.
+    while (nHeight--)
+    {
+        for (int i = 0; i < nWidth; ++i)
+        {
+            GSL_SUPPRESS_BOUNDS4
+            const auto nCoverage = pCoverage[i];
+            if (nCoverage == 255)
+            {
+                GSL_SUPPRESS_BOUNDS4 pBits[i] = nColor.ARGB;
+            }
+            else if (nCoverage != 0)
+            {
+                GSL_SUPPRESS_BOUNDS4 pBits[i] = BlendPixel(pBits[i], nColor.ARGB, nCoverage);
+            }
+        }
+
+        pBits += nStride;
+        pCoverage += pGlyph.nAdvance;
+    }
+}
+
+void BitmapSurface::DrawImage(int nX, int nY, int nWidth, int nHeight, const ImageReference& pImage)
+{
+    if (m_pImageSource == nullptr)
+        return;
+
+    const auto* pSource = m_pImageSource->GetImage(pImage);
+    if (pSource == nullptr)
+        return;
+
+    int nSrcX = 0, nSrcY = 0;
+    if (!ClipRectangle(nX, nY, nSrcX, nSrcY, nWidth, nHeight, ra::to_signed(m_nWidth), ra::to_signed(m_nHeight),
+                       ra::to_signed(pSource->nWidth), ra::to_signed(pSource->nHeight)))
+    {
+        return;
+    }
+
+    const auto nStride = gsl::narrow_cast<size_t>(m_nWidth);
+    const auto nSrcStride = gsl::narrow_cast<size_t>(pSource->nWidth);
+    auto* pBits = m_vPixels.data() + nStride * nY + nX;
+    const auto* pSrcBits = pSource->vPixels.data() + nSrcStride * nSrcY + nSrcX;
+    while (nHeight--)
+    {
+        memcpy(pBits, pSrcBits, gsl::narrow_cast<size_t>(nWidth) * sizeof(std::uint32_t));
+        pBits += nStride;
+        pSrcBits += nSrcStride;
+    }
+}
+
+void BitmapSurface::DrawImageStretched(int nX, int nY, int nWidth, int nHeight, const ImageReference& pImage)
+{
+    if (m_pImageSource == nullptr || nWidth <= 0 || nHeight <= 0)
+        return;
+
+    const auto* pSource = m_pImageSource->GetImage(pImage);
+    if (pSource == nullptr || pSource->nWidth == 0 || pSource->nHeight == 0)
+        return;
+
+    // nearest neighbor sampling. clip against the target only - the source is mapped onto the full rectangle
+    const auto nFullWidth = nWidth, nFullHeight = nHeight;
+    int nOffsetX = 0, nOffsetY = 0;
+    if (!ClipRectangle(nX, nY, nOffsetX, nOffsetY, nWidth, nHeight, ra::to_signed(m_nWidth),
+                       ra::to_signed(m_nHeight), nFullWidth, nFullHeight))
+    {
+        return;
+    }
+
+    std::vector<size_t> vColumns(gsl::narrow_cast<size_t>(nWidth));
+    for (int i = 0; i < nWidth; ++i)
+    {
+        vColumns.at(gsl::narrow_cast<size_t>(i)) =
+            gsl::narrow_cast<size_t>(static_cast<int64_t>(i + nOffsetX) * pSource->nWidth / nFullWidth);
+    }
+
+    const auto nStride = gsl::narrow_cast<size_t>(m_nWidth);
+    auto* pBits = m_vPixels.data() + nStride * nY + nX;
+    for (int j = 0; j < nHeight; ++j)
+    {
+        const auto nSrcY = gsl::narrow_cast<size_t>(static_cast<int64_t>(j + nOffsetY) * pSource->nHeight / nFullHeight);
+        const auto* pSrcBits = pSource->vPixels.data() + nSrcY * pSource->nWidth;
+        for (int i = 0; i < nWidth; ++i)
+        {
+            GSL_SUPPRESS_BOUNDS4
+            pBits[i] = pSrcBits[vColumns.at(gsl::narrow_cast<size_t>(i))];
+        }
+
+        pBits += nStride;
+    }
+}
+
+void BitmapSurface::DrawSurface(int nX, int nY, const ISurface& pSurface)
+{
+    const auto* pBitmapSurface = dynamic_cast<const BitmapSurface*>(&pSurface);
+    assert(pBitmapSurface != nullptr);
+    if (pBitmapSurface == nullptr)
+        return;
+
+    int nSrcX = 0, nSrcY = 0;
+    int nWidth = ra::to_signed(pSurface.GetWidth()), nHeight = ra::to_signed(pSurface.GetHeight());
+    if (!ClipRectangle(nX, nY, nSrcX, nSrcY, nWidth, nHeight, ra::to_signed(m_nWidth), ra::to_signed(m_nHeight),
+                       nWidth, nHeight))
+    {
+        return;
+    }
+
+    const auto nStride = gsl::narrow_cast<size_t>(m_nWidth);
+    const auto nSrcStride = gsl::narrow_cast<size_t>(pBitmapSurface->m_nWidth);
+    auto* pBits = m_vPixels.data() + nStride * nY + nX;
+    const auto* pSrcBits = pBitmapSurface->m_vPixels.data() + nSrcStride * nSrcY + nSrcX;
+    while (nHeight--)
+    {
+        if (pBitmapSurface->m_bTransparent)
+            BlendPixels(pBits, pSrcBits, gsl::narrow_cast<size_t>(nWidth));
+        else
+            memcpy(pBits, pSrcBits, gsl::narrow_cast<size_t>(nWidth) * sizeof(std::uint32_t));
+
+        pBits += nStride;
+        pSrcBits += nSrcStride;
+    }
+}
+
+void BitmapSurface::DrawSurface(int nX, int nY, const ISurface& pSurface, int nSurfaceX, int nSurfaceY, int nWidth, int nHeight)
+{
+    const auto* pBitmapSurface = dynamic_cast<const BitmapSurface*>(&pSurface);
+    assert(pBitmapSurface != nullptr);
+    if (pBitmapSurface == nullptr)
+        return;
+
+    assert(!pBitmapSurface->m_bTransparent); // clipped alpha blend not currently supported
+
+    if (!ClipRectangle(nX, nY, nSurfaceX, nSurfaceY, nWidth, nHeight, ra::to_signed(m_nWidth),
+                       ra::to_signed(m_nHeight), ra::to_signed(pSurface.GetWidth()), ra::to_signed(pSurface.GetHeight())))
+    {
+        return;
+    }
+
+    const auto nStride = gsl::narrow_cast<size_t>(m_nWidth);
+    const auto nSrcStride = gsl::narrow_cast<size_t>(pBitmapSurface->m_nWidth);
+    auto* pBits = m_vPixels.data() + nStride * nY + nX;
+    const auto* pSrcBits = pBitmapSurface->m_vPixels.data() + nSrcStride * nSurfaceY + nSurfaceX;
+    while (nHeight--)
+    {
+        memcpy(pBits, pSrcBits, gsl::narrow_cast<size_t>(nWidth) * sizeof(std::uint32_t));
+        pBits += nStride;
+        pSrcBits += nSrcStride;
+    }
+}
+
+void BitmapSurface::SetOpacity(double fAlpha)
+{
+    assert(fAlpha >= 0.0 && fAlpha <= 1.0);
+    const auto nAlpha = static_cast<std::uint8_t>(255 * fAlpha);
+    Expects(nAlpha > 0); // setting opacity to 0 is irreversible - caller should just not draw it
+
+    ApplyOpacity(m_vPixels.data(), m_vPixels.size(), nAlpha);
+}
+
+} // namespace bitmap
+} // namespace drawing
+} // namespace ui
+} // namespace ra
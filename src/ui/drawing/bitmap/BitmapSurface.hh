@@ -0,0 +1,189 @@
+#ifndef RA_UI_DRAWING_BITMAP_BITMAPSURFACE_HH
+#define RA_UI_DRAWING_BITMAP_BITMAPSURFACE_HH
+#pragma once
+
+#include "ui\drawing\ISurface.hh"
+
+#include <vector>
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace bitmap {
+
+/// <summary>
+/// Provides rasterized text to a <see cref="BitmapSurface" />.
+/// </summary>
+class IGlyphSource
+{
+public:
+    virtual ~IGlyphSource() noexcept = default;
+    IGlyphSource(const IGlyphSource&) noexcept = delete;
+    IGlyphSource& operator=(const IGlyphSource&) noexcept = delete;
+    IGlyphSource(IGlyphSource&&) noexcept = delete;
+    IGlyphSource& operator=(IGlyphSource&&) noexcept = delete;
+
+    struct Glyph
+    {
+        /// <summary>
+        /// The width of the glyph, and the distance to the start of the next glyph.
+        /// </summary>
+        int nAdvance = 0;
+
+        /// <summary>
+        /// The coverage (0-255) of each pixel in the glyph. The glyph is <see cref="nAdvance" /> pixels wide and
+        /// <see cref="GetLineHeight" /> pixels tall.
+        /// </summary>
+        std::vector<std::uint8_t> vCoverage;
+    };
+
+    /// <summary>
+    /// Loads a font.
+    /// </summary>
+    /// <returns>Unique identifier for the font, <c>0</c> if loading the font failed.</returns>
+    virtual int LoadFont(const std::string& sFont, int nFontSize, FontStyles nStyle) = 0;
+
+    /// <summary>
+    /// Gets the height of a line of text written with <paramref name="nFont" />.
+    /// </summary>
+    virtual int GetLineHeight(int nFont) const = 0;
+
+    /// <summary>
+    /// Gets the glyph for <paramref name="nChar" />.
+    /// </summary>
+    /// <returns>The glyph, <c>nullptr</c> if the font or character is not available.</returns>
+    virtual const Glyph* GetGlyph(int nFont, wchar_t nChar) const = 0;
+
+protected:
+    IGlyphSource() noexcept = default;
+};
+
+/// <summary>
+/// Provides decoded images to a <see cref="BitmapSurface" />.
+/// </summary>
+class IImageSource
+{
+public:
+    virtual ~IImageSource() noexcept = default;
+    IImageSource(const IImageSource&) noexcept = delete;
+    IImageSource& operator=(const IImageSource&) noexcept = delete;
+    IImageSource(IImageSource&&) noexcept = delete;
+    IImageSource& operator=(IImageSource&&) noexcept = delete;
+
+    struct Image
+    {
+        unsigned int nWidth = 0;
+        unsigned int nHeight = 0;
+        std::vector<std::uint32_t> vPixels; // ARGB, top row first
+    };
+
+    /// <summary>
+    /// Gets the pixels for <paramref name="pImage" />.
+    /// </summary>
+    /// <returns>The image, <c>nullptr</c> if it is not available.</returns>
+    virtual const Image* GetImage(const ImageReference& pImage) = 0;
+
+protected:
+    IImageSource() noexcept = default;
+};
+
+/// <summary>
+/// A platform-independent surface that draws into a 32-bit ARGB buffer.
+/// </summary>
+class BitmapSurface : public ISurface
+{
+public:
+    explicit BitmapSurface(unsigned int nWidth, unsigned int nHeight, bool bTransparent = false,
+                           IGlyphSource* pGlyphSource = nullptr, IImageSource* pImageSource = nullptr);
+
+    unsigned int GetWidth() const noexcept override { return m_nWidth; }
+    unsigned int GetHeight() const noexcept override { return m_nHeight; }
+
+    void FillRectangle(int nX, int nY, int nWidth, int nHeight, Color nColor) noexcept override;
+
+    int LoadFont(const std::string& sFont, int nFontSize, FontStyles nStyle) override;
+    ra::ui::Size MeasureText(int nFont, const std::wstring& sText) const override;
+    void WriteText(int nX, int nY, int nFont, Color nColor, const std::wstring& sText) override;
+
+    void DrawImage(int nX, int nY, int nWidth, int nHeight, const ImageReference& pImage) override;
+    void DrawImageStretched(int nX, int nY, int nWidth, int nHeight, const ImageReference& pImage) override;
+
+    void DrawSurface(int nX, int nY, const ISurface& pSurface) override;
+    void DrawSurface(int nX, int nY, const ISurface& pSurface, int nSurfaceX, int nSurfaceY, int nWidth, int nHeight) override;
+
+    void SetOpacity(double fAlpha) override;
+
+    /// <summary>
+    /// Gets whether the surface is blended onto other surfaces using its alpha channel.
+    /// </summary>
+    bool IsTransparent() const noexcept { return m_bTransparent; }
+
+    /// <summary>
+    /// Gets the color of a single pixel.
+    /// </summary>
+    Color GetPixel(unsigned int nX, unsigned int nY) const;
+
+    /// <summary>
+    /// Gets the raw pixel data. Rows are <see cref="GetWidth" /> pixels wide, starting with the top row.
+    /// </summary>
+    const std::uint32_t* GetPixels() const noexcept { return m_vPixels.data(); }
+
+private:
+    void DrawGlyph(int nX, int nY, const IGlyphSource::Glyph& pGlyph, int nLineHeight, Color nColor) noexcept;
+
+    unsigned int m_nWidth;
+    unsigned int m_nHeight;
+    bool m_bTransparent;
+    std::vector<std::uint32_t> m_vPixels;
+
+    IGlyphSource* m_pGlyphSource;
+    IImageSource* m_pImageSource;
+};
+
+class BitmapSurfaceFactory : public ISurfaceFactory
+{
+public:
+    explicit BitmapSurfaceFactory(IGlyphSource* pGlyphSource = nullptr, IImageSource* pImageSource = nullptr) noexcept
+        : m_pGlyphSource(pGlyphSource), m_pImageSource(pImageSource)
+    {
+    }
+
+    std::unique_ptr<ISurface> CreateSurface(int nWidth, int nHeight) const override
+    {
+        auto pSurface = std::make_unique<BitmapSurface>(ra::to_unsigned(nWidth), ra::to_unsigned(nHeight), false,
+                                                        m_pGlyphSource, m_pImageSource);
+        return std::unique_ptr<ISurface>(pSurface.release());
+    }
+
+    std::unique_ptr<ISurface> CreateTransparentSurface(int nWidth, int nHeight) const override
+    {
+        auto pSurface = std::make_unique<BitmapSurface>(ra::to_unsigned(nWidth), ra::to_unsigned(nHeight), true,
+                                                        m_pGlyphSource, m_pImageSource);
+        return std::unique_ptr<ISurface>(pSurface.release());
+    }
+
+    // encoding images is platform-specific
+    bool SaveImage(const ISurface&, const std::wstring&) const noexcept override { return false; }
+
+    bool CopyPixels(const ISurface& pSurface, std::vector<std::uint32_t>& vPixels) const override
+    {
+        const auto* pBitmapSurface = dynamic_cast<const BitmapSurface*>(&pSurface);
+        if (pBitmapSurface == nullptr)
+            return false;
+
+        const auto nPixels = gsl::narrow_cast<size_t>(pSurface.GetWidth()) * pSurface.GetHeight();
+        vPixels.assign(pBitmapSurface->GetPixels(), pBitmapSurface->GetPixels() + nPixels);
+        return true;
+    }
+
+private:
+    IGlyphSource* m_pGlyphSource;
+    IImageSource* m_pImageSource;
+};
+
+} // namespace bitmap
+} // namespace drawing
+} // namespace ui
+} // namespace ra
+
+#endif // !RA_UI_DRAWING_BITMAP_BITMAPSURFACE_HH
@@ -12,6 +12,28 @@ void GDIBitmapSurface::CopyFromWindow(HDC hDC, int srcX, int srcY, int srcWidth,
     ::BitBlt(m_hMemDC, dstX, dstY, srcWidth, srcHeight, hDC, srcX, srcY, SRCCOPY);
 }
 
+void GDIBitmapSurface::CopyPixels(std::vector<std::uint32_t>& vPixels) const
+{
+    // make sure any pending GDI operations have been applied to the bits
+    ::GdiFlush();
+
+    const auto nWidth = gsl::narrow_cast<size_t>(GetWidth());
+    const auto nHeight = gsl::narrow_cast<size_t>(GetHeight());
+    vPixels.resize(nWidth * nHeight);
+    if (vPixels.empty())
+        return;
+
+    // the DIB is stored bottom row first
+    const std::uint32_t* pSrc = m_pBits + nWidth * (nHeight - 1);
+    std::uint32_t* pDst = vPixels.data();
+    for (size_t nY = 0; nY < nHeight; ++nY)
+    {
+        memcpy(pDst, pSrc, nWidth * sizeof(std::uint32_t));
+        pDst += nWidth;
+        pSrc -= nWidth;
+    }
+}
+
 void GDIBitmapSurface::FillRectangle(int nX, int nY, int nWidth, int nHeight, Color nColor) noexcept
 {
     // clip to surface
@@ -82,24 +104,34 @@ void GDIBitmapSurface::WriteText(int nX, int nY, int nFont, Color nColor, const
         return;
 
     // clip to surface
-    auto nStride = ra::to_signed(GetWidth());
-    if (nX >= nStride || nY >= ra::to_signed(GetHeight()))
+    if (nX >= ra::to_signed(GetWidth()) || nY >= ra::to_signed(GetHeight()))
         return;
-    assert(nX >= 0); // TODO: support negative X starting position
 
+    // the same strings tend to be drawn every frame. only render them once.
+    auto& pTextCache = m_pResourceRepository.GetTextCache();
+    auto pMask = pTextCache.FindMask(nFont, sText);
+    if (pMask == nullptr)
+    {
+        TextCache::Mask pNewMask;
+        if (!RenderTextMask(nFont, sText, pNewMask))
+            return;
+
+        pMask = pTextCache.StoreMask(nFont, sText, std::move(pNewMask));
+    }
+
+    BlendTextMask(nX, nY, *pMask, nColor);
+}
+
+bool GDIBitmapSurface::RenderTextMask(int nFont, const std::wstring& sText, TextCache::Mask& pMask)
+{
     // measure the text to draw
     SwitchFont(nFont);
 
     SIZE szText;
     if (!GetTextExtentPoint32W(m_hDC, sText.c_str(), gsl::narrow_cast<int>(sText.length()), &szText))
-        return;
-
-    // clip to surface
-    if (szText.cx > nStride - nX)
-        szText.cx = nStride - nX;
-    const auto nMaxHeight = ra::to_signed(GetHeight()) - nY;
-    if (szText.cy > nMaxHeight)
-        szText.cy = nMaxHeight;
+        return false;
+    if (szText.cx <= 0 || szText.cy <= 0)
+        return false;
 
     // writing directly to the surface results in 0 for all alpha values - i.e. transparent text.
     // instead, draw white text on black background to get grayscale anti-alias values which will
@@ -107,7 +139,7 @@ void GDIBitmapSurface::WriteText(int nX, int nY, int nFont, Color nColor, const
     BITMAPINFO bmi{};
     bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
     bmi.bmiHeader.biWidth = szText.cx;
-    bmi.bmiHeader.biHeight = szText.cy;
+    bmi.bmiHeader.biHeight = -szText.cy; // top-down, so the scanlines are in the same order as the mask
     bmi.bmiHeader.biPlanes = 1;
     bmi.bmiHeader.biBitCount = 32;
     bmi.bmiHeader.biCompression = BI_RGB;
@@ -127,50 +159,80 @@ void GDIBitmapSurface::WriteText(int nX, int nY, int nFont, Color nColor, const
     SelectFont(hMemDC, m_pResourceRepository.GetHFont(nFont));
     SetTextColor(hMemDC, RGB(255, 255, 255));
     SetBkMode(hMemDC, TRANSPARENT);
-    RECT rcRect{0, 0, szText.cx, szText.cy};
     TextOutW(hMemDC, 0, 0, sText.c_str(), gsl::narrow_cast<int>(sText.length()));
 
-    // copy the greyscale text to the forground using the grey value as the alpha for antialiasing
-    auto nFirstScanline = (GetHeight() - nY - szText.cy); // bitmap memory starts with the bottom scanline
-    Expects(ra::to_signed(nFirstScanline) >= 0);
-    Expects(m_pBits != nullptr);
-    auto pBits = m_pBits + gsl::narrow_cast<size_t>(nStride) * nFirstScanline + nX;
-    Ensures(pBits != nullptr);
+    // keep the greyscale value of each pixel as its coverage
+    pMask.szText = ra::ui::Size{szText.cx, szText.cy};
+    pMask.vCoverage.resize(gsl::narrow_cast<size_t>(szText.cx) * szText.cy);
+    for (auto& nCoverage : pMask.vCoverage)
+        nCoverage = ra::ui::Color(*pTextBits++).Channel.R;
 
+    DeleteBitmap(hBitmap);
+    DeleteDC(hMemDC);
+    return true;
+}
+
+void GDIBitmapSurface::BlendTextMask(int nX, int nY, const TextCache::Mask& pMask, Color nColor) noexcept
+{
     // clip to surface
-    auto nLines = szText.cy;
+    const auto nStride = ra::to_signed(GetWidth());
+    int nMaskX = 0, nMaskY = 0;
+    int nWidth = pMask.szText.Width, nHeight = pMask.szText.Height;
+
+    if (nX < 0)
+    {
+        nMaskX = -nX;
+        nWidth += nX;
+        nX = 0;
+    }
+    if (nWidth > nStride - nX)
+        nWidth = nStride - nX;
+    if (nWidth <= 0)
+        return;
+
     if (nY < 0)
-        nLines += nY;
+    {
+        nMaskY = -nY;
+        nHeight += nY;
+        nY = 0;
+    }
+    const auto nMaxHeight = ra::to_signed(GetHeight()) - nY;
+    if (nHeight > nMaxHeight)
+        nHeight = nMaxHeight;
+    if (nHeight <= 0)
+        return;
 
-    // copy bits
-    while (nLines--)
+    // bitmap memory starts with the bottom scanline, so work up from the first line of text
+    const auto nFirstScanline = gsl::narrow_cast<size_t>(GetHeight()) - nY - 1;
+    GSL_SUPPRESS_F6 Expects(m_pBits != nullptr);
+    auto* pBits = m_pBits + gsl::narrow_cast<size_t>(nStride) * nFirstScanline + nX;
+    const auto* pCoverage = pMask.vCoverage.data() + gsl::narrow_cast<size_t>(pMask.szText.Width) * nMaskY + nMaskX;
+
+    // copy the text to the forground using the coverage as the alpha for antialiasing
+    while (nHeight--)
     {
-        const std::uint32_t* pEnd = pBits + szText.cx;
-        do
+        for (int i = 0; i < nWidth; ++i)
         {
-            const ra::ui::Color nTextColor(*pTextBits++);
-            if (nTextColor.Channel.R == 255)
+            GSL_SUPPRESS_BOUNDS4
+            const auto nAlpha = pCoverage[i];
+            if (nAlpha == 255)
             {
-                *pBits = nColor.ARGB;
+                GSL_SUPPRESS_BOUNDS4 pBits[i] = nColor.ARGB;
             }
-            else if (nTextColor.Channel.R != 0)
+            else if (nAlpha != 0)
             {
-                const uint8_t nAlpha = nTextColor.Channel.R;
-                ra::ui::Color nImageColor(*pBits);
+                GSL_SUPPRESS_BOUNDS4
+                ra::ui::Color nImageColor(pBits[i]);
                 nImageColor.Channel.R = BlendPixel(nImageColor.Channel.R, nColor.Channel.R, nAlpha);
                 nImageColor.Channel.G = BlendPixel(nImageColor.Channel.G, nColor.Channel.G, nAlpha);
                 nImageColor.Channel.B = BlendPixel(nImageColor.Channel.B, nColor.Channel.B, nAlpha);
-                *pBits = nImageColor.ARGB;
+                GSL_SUPPRESS_BOUNDS4 pBits[i] = nImageColor.ARGB;
             }
+        }
 
-            ++pBits;
-        } while (pBits < pEnd);
-
-        pBits += (gsl::narrow_cast<size_t>(nStride) - szText.cx);
+        pBits -= nStride;
+        pCoverage += pMask.szText.Width;
     }
-
-    DeleteBitmap(hBitmap);
-    DeleteDC(hMemDC);
 }
 
 #pragma warning(push)
@@ -45,10 +45,18 @@ public:
 
     HBITMAP GetHBitmap() const noexcept { return m_hBitmap; }
 
+    /// <summary>
+    /// Copies the bitmap into <paramref name="vPixels" />, top row first.
+    /// </summary>
+    void CopyPixels(std::vector<std::uint32_t>& vPixels) const;
+
 protected:
     std::uint32_t* m_pBits; // see note below about initializing this
 
 private:
+    bool RenderTextMask(int nFont, const std::wstring& sText, TextCache::Mask& pMask);
+    void BlendTextMask(int nX, int nY, const TextCache::Mask& pMask, Color nColor) noexcept;
+
     HDC CreateBitmapHDC(const int nWidth, const int nHeight) noexcept
     {
         BITMAPINFO bmi{};
@@ -125,6 +133,16 @@ public:
 
     bool SaveImage(const ISurface& pSurface, const std::wstring& sPath) const override;
 
+    bool CopyPixels(const ISurface& pSurface, std::vector<std::uint32_t>& vPixels) const override
+    {
+        const auto* pGDIBitmapSurface = dynamic_cast<const GDIBitmapSurface*>(&pSurface);
+        if (pGDIBitmapSurface == nullptr)
+            return false;
+
+        pGDIBitmapSurface->CopyPixels(vPixels);
+        return true;
+    }
+
 private:
     mutable ResourceRepository m_oResourceRepository;
 };
@@ -32,12 +32,20 @@ int GDISurface::LoadFont(const std::string& sFont, int nFontSize, FontStyles nSt
 
 ra::ui::Size GDISurface::MeasureText(int nFont, const std::wstring& sText) const
 {
+    auto& pTextCache = m_pResourceRepository.GetTextCache();
+    ra::ui::Size szCached;
+    if (pTextCache.FindSize(nFont, sText, szCached))
+        return szCached;
+
     SwitchFont(nFont);
 
     SIZE szText;
-    GetTextExtentPoint32W(m_hDC, sText.c_str(), gsl::narrow_cast<int>(sText.length()), &szText);
+    if (!GetTextExtentPoint32W(m_hDC, sText.c_str(), gsl::narrow_cast<int>(sText.length()), &szText))
+        return ra::ui::Size{};
 
-    return ra::ui::Size{ szText.cx, szText.cy };
+    const ra::ui::Size szResult{ szText.cx, szText.cy };
+    pTextCache.StoreSize(nFont, sText, szResult);
+    return szResult;
 }
 
 void GDISurface::WriteText(int nX, int nY, int nFont, Color nColor, const std::wstring& sText)
@@ -7,8 +7,11 @@
 #include "services\Http.hh"
 #include "services\IConfiguration.hh"
 #include "services\IFileSystem.hh"
+#include "services\ILocalStorage.hh"
 #include "services\IThreadPool.hh"
+#include "services\PerformanceCounter.hh"
 #include "services\ServiceLocator.hh"
+#include "services\Tracer.hh"
 
 namespace ra {
 namespace ui {
@@ -20,6 +23,12 @@ inline constexpr const char* DefaultUserPic{ "_User" };
 
 static CComPtr<IWICImagingFactory> g_pIWICFactory;
 
+class WICImageDecoder : public ImageCache::IDecoder
+{
+public:
+    bool Decode(const std::string& sData, unsigned int nWidth, unsigned int nHeight, ImageCache::Image& pImage) override;
+};
+
 bool ImageRepository::Initialize()
 {
     // pre-fetch the default images
@@ -56,6 +65,13 @@ bool ImageRepository::Initialize()
         );
     }
 
+    // images are decoded on the thread pool. let anything displaying a placeholder know the image is ready.
+    m_pImageCache = std::make_unique<ImageCache>(std::make_unique<WICImageDecoder>());
+    m_pImageCache->SetDecodedHandler([this](ImageType nType, const std::string& sName)
+    {
+        OnImageChanged(nType, sName);
+    });
+
     return SUCCEEDED(hr);
 }
 
@@ -70,6 +86,8 @@ ImageRepository::~ImageRepository() noexcept
         DeleteBitmap(userPic.second.m_hBitmap);
     m_mUserPics.clear();
 
+    m_pImageCache.reset();
+
     g_pIWICFactory.Release();
 
     if (m_bShutdownCOM)
@@ -102,6 +120,17 @@ std::wstring ImageRepository::GetFilename(ImageType nType, const std::string& sN
     return sFilename;
 }
 
+// badges and user pictures are managed by the local storage, which may keep them in the image pack
+bool ImageRepository::IsStoredImage(ImageType nType) noexcept
+{
+    return (nType == ImageType::Badge || nType == ImageType::UserPic);
+}
+
+ra::services::StorageItemType ImageRepository::GetStorageItemType(ImageType nType) noexcept
+{
+    return (nType == ImageType::Badge) ? ra::services::StorageItemType::Badge : ra::services::StorageItemType::UserPic;
+}
+
 bool ImageRepository::IsImageAvailable(ImageType nType, const std::string& sName) const
 {
     if (sName.empty())
@@ -124,6 +153,12 @@ bool ImageRepository::IsImageAvailable(ImageType nType, const std::string& sName
             return false;
     }
 
+    if (IsStoredImage(nType))
+    {
+        auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+        return pLocalStorage.Exists(GetStorageItemType(nType), ra::Widen(sName));
+    }
+
     const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
     return (pFileSystem.GetFileSize(sFilename) > 0);
 }
@@ -134,9 +169,18 @@ void ImageRepository::FetchImage(ImageType nType, const std::string& sName)
         return;
 
     std::wstring sFilename = GetFilename(nType, sName);
-    const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
-    if (pFileSystem.GetFileSize(sFilename) > 0)
-        return;
+    if (IsStoredImage(nType))
+    {
+        auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+        if (pLocalStorage.Exists(GetStorageItemType(nType), ra::Widen(sName)))
+            return;
+    }
+    else
+    {
+        const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
+        if (pFileSystem.GetFileSize(sFilename) > 0)
+            return;
+    }
 
     // check to see if it's already queued
     {
@@ -174,6 +218,39 @@ void ImageRepository::FetchImage(ImageType nType, const std::string& sName)
     RA_LOG_INFO("Downloading %s", sUrl.c_str());
 
     ra::services::Http::Request request(sUrl);
+    if (IsStoredImage(nType))
+    {
+        request.CallAsync([this, sFilename, sUrl, nType, sName](const ra::services::Http::Response& response)
+        {
+            if (response.StatusCode() == ra::services::Http::StatusCode::OK)
+            {
+                {
+                    auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+                    auto pWriter = pLocalStorage.WriteText(GetStorageItemType(nType), ra::Widen(sName));
+                    if (pWriter != nullptr)
+                        pWriter->Write(response.Content());
+                }
+                RA_LOG_INFO("Wrote %zu bytes for %s", response.Content().length(), sUrl.c_str());
+
+                // only remove the image from the request queue if successful. prevents repeated requests
+                {
+                    std::lock_guard<std::mutex> lock(m_oMutex);
+                    m_vRequestedImages.erase(sFilename);
+                }
+
+                if (m_pImageCache != nullptr)
+                    m_pImageCache->Invalidate(nType, sName);
+            }
+            else
+            {
+                RA_LOG_WARN("Error %u fetching %s", response.StatusCode(), sUrl.c_str());
+            }
+
+            OnImageChanged(nType, sName);
+        }, ra::services::TaskPriority::Background);
+        return;
+    }
+
     request.DownloadAsync(sFilename, [this,sFilename,sUrl,nType,sName](const ra::services::Http::Response& response)
     {
         if (response.StatusCode() == ra::services::Http::StatusCode::OK)
@@ -186,6 +263,9 @@ void ImageRepository::FetchImage(ImageType nType, const std::string& sName)
                 std::lock_guard<std::mutex> lock(m_oMutex);
                 m_vRequestedImages.erase(sFilename);
             }
+
+            if (m_pImageCache != nullptr)
+                m_pImageCache->Invalidate(nType, sName);
         }
         else
         {
@@ -194,7 +274,7 @@ void ImageRepository::FetchImage(ImageType nType, const std::string& sName)
         }
 
         OnImageChanged(nType, sName);
-    });
+    }, ra::services::TaskPriority::Background);
 }
 
 HBITMAP ImageRepository::GetDefaultImage(ImageType nType)
@@ -231,17 +311,17 @@ static HRESULT ConvertBitmapSource(_In_ RECT rcDest, _In_ IWICBitmapSource* pOri
             WICBitmapInterpolationModeFant);
     }
 
-    // Convert the bitmap into 32bppBGR, a convenient pixel format for GDI rendering 
+    // Convert the bitmap into 32bppPBGRA, which is premultiplied ARGB when read as 32-bit values
     if (SUCCEEDED(hr))
     {
         CComPtr<IWICFormatConverter> pConverter;
         hr = g_pIWICFactory->CreateFormatConverter(&pConverter);
 
-        // Format convert to 32bppBGR
+        // Format convert to 32bppPBGRA
         if (SUCCEEDED(hr))
         {
             hr = pConverter->Initialize(static_cast<IWICBitmapSource*>(pScaler), // Input bitmap to convert
-                GUID_WICPixelFormat32bppBGR,                // &GUID_WICPixelFormat32bppBGR,
+                GUID_WICPixelFormat32bppPBGRA,              // &GUID_WICPixelFormat32bppPBGRA,
                 WICBitmapDitherTypeNone,                    // Specified dither pattern
                 nullptr,                                    // Specify a particular palette 
                 0.f,                                        // Alpha threshold
@@ -260,53 +340,13 @@ static HRESULT ConvertBitmapSource(_In_ RECT rcDest, _In_ IWICBitmapSource* pOri
     return hr;
 }
 
-static HRESULT CreateDIBFromBitmapSource(_In_ IWICBitmapSource* pToRenderBitmapSource,
-                                         _Inout_ HBITMAP& hBitmapInOut)
+static HRESULT CopyPixelsFromBitmapSource(_In_ IWICBitmapSource* pToRenderBitmapSource, ImageCache::Image& pImage)
 {
     Expects(pToRenderBitmapSource != nullptr);
-    // Get BitmapSource format and size
-    WICPixelFormatGUID pixelFormat{};
+
     UINT nWidth = 0U;
     UINT nHeight = 0U;
-
-    auto hr = pToRenderBitmapSource->GetPixelFormat(&pixelFormat);
-    if (SUCCEEDED(hr))
-        hr = pToRenderBitmapSource->GetSize(&nWidth, &nHeight);
-
-    if (FAILED(hr))
-        return hr;
-
-    // Create a DIB section based on Bitmap Info
-    // BITMAPINFO Struct must first be setup before a DIB can be created.
-    // Note that the height is negative for top-down bitmaps
-    BITMAPINFOHEADER info_header{sizeof(BITMAPINFOHEADER), // biSize
-                                 to_signed(nWidth),
-                                 -to_signed(nHeight),
-                                 WORD{1},  // biPlanes
-                                 WORD{32}, // biBitCount
-                                 DWORD{BI_RGB}};
-    BITMAPINFO bminfo{info_header};
-    void *pvImageBits = nullptr;
-
-    auto hWindow = GetActiveWindow();
-    while (GetParent(hWindow) != nullptr)
-        hWindow = GetParent(hWindow);
-
-    // Get a DC for the full screen
-    auto hdcScreen = GetDC(hWindow);
-    if (hdcScreen)
-    {
-        // Release the previously allocated bitmap 
-        if (hBitmapInOut)
-            DeleteBitmap(hBitmapInOut);
-
-        //	TBD: check this. As a handle this should just be as-is, right?
-        hBitmapInOut = CreateDIBSection(hdcScreen, &bminfo, DIB_RGB_COLORS, &pvImageBits, nullptr, DWORD{});
-
-        ReleaseDC(nullptr, hdcScreen);
-
-        hr = hBitmapInOut ? S_OK : E_FAIL;
-    }
+    auto hr = pToRenderBitmapSource->GetSize(&nWidth, &nHeight);
 
     // Size of a scan line represented in bytes: 4 bytes each pixel
     UINT cbStride = 0U;
@@ -318,44 +358,30 @@ static HRESULT CreateDIBFromBitmapSource(_In_ IWICBitmapSource* pToRenderBitmapS
     if (SUCCEEDED(hr))
         hr = UIntMult(cbStride, nHeight, &cbImage);
 
-    // Extract the image into the HBITMAP    
-    if (SUCCEEDED(hr) && pvImageBits)
-    {
-        hr = pToRenderBitmapSource->CopyPixels(
-            //hr = IWICBitmapSource_CopyPixels( pToRenderBitmapSource,
-            nullptr,
-            cbStride,
-            cbImage,
-            static_cast<BYTE*>(pvImageBits));
-    }
+    if (FAILED(hr))
+        return hr;
 
-    // Image Extraction failed, clear allocated memory
-    if (FAILED(hr) && hBitmapInOut)
-    {
-        DeleteBitmap(hBitmapInOut);
-        hBitmapInOut = nullptr;
-    }
+    pImage.nWidth = nWidth;
+    pImage.nHeight = nHeight;
+    pImage.vPixels.resize(gsl::narrow_cast<size_t>(nWidth) * nHeight);
+
+    BYTE* pBuffer;
+    GSL_SUPPRESS_TYPE1 pBuffer = reinterpret_cast<BYTE*>(pImage.vPixels.data());
+    hr = pToRenderBitmapSource->CopyPixels(nullptr, cbStride, cbImage, pBuffer);
+
+    if (FAILED(hr))
+        pImage.vPixels.clear();
 
     return hr;
 }
 
-HBITMAP ImageRepository::LoadLocalPNG(const std::wstring& sFilename, unsigned int nWidth, unsigned int nHeight)
+static HRESULT DecodeFrame(_In_ IWICBitmapDecoder* pDecoder, unsigned int nWidth, unsigned int nHeight, ImageCache::Image& pImage)
 {
-    if (g_pIWICFactory == nullptr)
-        return nullptr;
-
-    // Decode the source image to IWICBitmapSource
-    CComPtr<IWICBitmapDecoder> pDecoder;
-    HRESULT hr = g_pIWICFactory->CreateDecoderFromFilename(ra::Widen(sFilename).c_str(), // Image to be decoded
-                                                           nullptr,      // Do not prefer a particular vendor
-                                                           GENERIC_READ, // Desired read access to the file
-                                                           WICDecodeMetadataCacheOnDemand, // Cache metadata when needed
-                                                           &pDecoder);                     // Pointer to the decoder
+    Expects(pDecoder != nullptr);
 
     // Retrieve the first frame of the image from the decoder
     CComPtr<IWICBitmapFrameDecode> pFrame;
-    if (SUCCEEDED(hr))
-        hr = pDecoder->GetFrame(0, &pFrame);
+    HRESULT hr = pDecoder->GetFrame(0, &pFrame);
 
     // Retrieve IWICBitmapSource from the frame
     CComPtr<IWICBitmapSource> pOriginalBitmapSource;
@@ -376,15 +402,89 @@ HBITMAP ImageRepository::LoadLocalPNG(const std::wstring& sFilename, unsigned in
         hr = ConvertBitmapSource({0, 0, to_signed(nWidth), to_signed(nHeight)}, pOriginalBitmapSource,
                                  *&pToRenderBitmapSource);
 
-    // Create a DIB from the converted IWICBitmapSource
-    HBITMAP hBitmap = nullptr;
+    // Extract the pixels from the converted IWICBitmapSource
     if (SUCCEEDED(hr))
-        hr = CreateDIBFromBitmapSource(pToRenderBitmapSource, hBitmap);
+        hr = CopyPixelsFromBitmapSource(pToRenderBitmapSource, pImage);
 
     pToRenderBitmapSource.Release();
     pOriginalBitmapSource.Release();
     pFrame.Release();
+
+    return hr;
+}
+
+bool WICImageDecoder::Decode(const std::string& sData, unsigned int nWidth, unsigned int nHeight, ImageCache::Image& pImage)
+{
+    if (g_pIWICFactory == nullptr || sData.empty())
+        return false;
+
+    ra::services::TraceSpan span("ImageDecode");
+    ra::services::PerformanceTimer tDecode(PerformanceCheckpoint::ImageDecode);
+
+    // Wrap the buffer in a stream. The stream does not copy the data, so sData must outlive the decoder.
+    CComPtr<IWICStream> pStream;
+    HRESULT hr = g_pIWICFactory->CreateStream(&pStream);
+
+    if (SUCCEEDED(hr))
+    {
+        BYTE* pBuffer;
+        GSL_SUPPRESS_TYPE3 pBuffer = reinterpret_cast<BYTE*>(const_cast<char*>(sData.data()));
+        hr = pStream->InitializeFromMemory(pBuffer, gsl::narrow<DWORD>(sData.length()));
+    }
+
+    CComPtr<IWICBitmapDecoder> pDecoder;
+    if (SUCCEEDED(hr))
+        hr = g_pIWICFactory->CreateDecoderFromStream(pStream, nullptr, WICDecodeMetadataCacheOnDemand, &pDecoder);
+
+    if (SUCCEEDED(hr))
+        hr = DecodeFrame(pDecoder, nWidth, nHeight, pImage);
+
     pDecoder.Release();
+    pStream.Release();
+    return SUCCEEDED(hr);
+}
+
+std::string ImageRepository::ReadImageData(ImageType nType, const std::string& sName)
+{
+    std::unique_ptr<ra::services::TextReader> pReader;
+    if (IsStoredImage(nType))
+    {
+        auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+        pReader = pLocalStorage.ReadText(GetStorageItemType(nType), ra::Widen(sName));
+    }
+    else
+    {
+        const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
+        pReader = pFileSystem.OpenTextFile(GetFilename(nType, sName));
+    }
+
+    std::string sData;
+    if (pReader != nullptr)
+    {
+        sData.resize(pReader->GetSize());
+        uint8_t* pData;
+        GSL_SUPPRESS_TYPE1 pData = reinterpret_cast<uint8_t*>(sData.data());
+        sData.resize(pReader->GetBytes(pData, sData.length()));
+    }
+
+    return sData;
+}
+
+HBITMAP ImageRepository::CreateHBitmap(const ImageCache::Image& pImage) noexcept
+{
+    // Note that the height is negative for top-down bitmaps
+    BITMAPINFOHEADER info_header{sizeof(BITMAPINFOHEADER), // biSize
+                                 to_signed(pImage.nWidth),
+                                 -to_signed(pImage.nHeight),
+                                 WORD{1},  // biPlanes
+                                 WORD{32}, // biBitCount
+                                 DWORD{BI_RGB}};
+    BITMAPINFO bminfo{info_header};
+    void* pvImageBits = nullptr;
+
+    HBITMAP hBitmap = CreateDIBSection(nullptr, &bminfo, DIB_RGB_COLORS, &pvImageBits, nullptr, DWORD{});
+    if (hBitmap != nullptr && pvImageBits != nullptr)
+        memcpy(pvImageBits, pImage.vPixels.data(), pImage.vPixels.size() * sizeof(std::uint32_t));
 
     return hBitmap;
 }
@@ -428,17 +528,42 @@ HBITMAP ImageRepository::GetImage(ImageType nType, const std::string& sName)
             return iter->second.m_hBitmap;
     }
 
-    std::wstring sFilename = GetFilename(nType, sName);
+    if (m_pImageCache == nullptr)
+        return nullptr;
 
-    const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
-    if (pFileSystem.GetFileSize(sFilename) <= 0)
+    // only check for the source data the first time the image is requested. after that, the cache tracks it.
+    if (m_pImageCache->GetState(nType, sName) == ImageCache::State::None)
     {
-        FetchImage(nType, sName);
-        return nullptr;
+        bool bExists;
+        if (IsStoredImage(nType))
+        {
+            auto& pLocalStorage = ra::services::ServiceLocator::GetMutable<ra::services::ILocalStorage>();
+            bExists = pLocalStorage.Exists(GetStorageItemType(nType), ra::Widen(sName));
+        }
+        else
+        {
+            const auto& pFileSystem = ra::services::ServiceLocator::Get<ra::services::IFileSystem>();
+            bExists = (pFileSystem.GetFileSize(GetFilename(nType, sName)) > 0);
+        }
+
+        if (!bExists)
+        {
+            FetchImage(nType, sName);
+            return nullptr;
+        }
     }
 
+    // decoding happens on the thread pool. until it completes, the caller will draw the default image.
     const unsigned int nSize = (nType == ImageType::Local) ? 0 : 64;
-    HBITMAP hBitmap = LoadLocalPNG(sFilename, nSize, nSize);
+    const auto pImage = m_pImageCache->Request(nType, sName, nSize, nSize, [nType, sName]()
+    {
+        return ReadImageData(nType, sName);
+    });
+    if (pImage == nullptr)
+        return nullptr;
+
+    HBITMAP hBitmap = CreateHBitmap(*pImage);
+
     if (hBitmap != nullptr)
     {
         std::lock_guard<std::mutex> lock(m_oMutex);
@@ -493,6 +618,10 @@ void ImageRepository::AddReference(const ImageReference& pImage)
         if (iter != mMap->end())
             ++iter->second.m_nReferences;
     }
+
+    // keep the decoded image around while it's on screen
+    if (m_pImageCache != nullptr)
+        m_pImageCache->AddReference(pImage.Type(), pImage.Name());
 }
 
 void ImageRepository::ReleaseReference(ImageReference& pImage) noexcept
@@ -520,6 +649,9 @@ void ImageRepository::ReleaseReference(ImageReference& pImage) noexcept
         }
     }
 
+    if (m_pImageCache != nullptr)
+        m_pImageCache->ReleaseReference(pImage.Type(), pImage.Name());
+
     pImage.m_nData = {};
 }
 
@@ -2,7 +2,10 @@
 #define RA_UI_DRAWING_GDI_IMAGEREPOSITORY_HH
 #pragma once
 
+#include "services\ILocalStorage.hh"
+
 #include "ui\ImageReference.hh"
+#include "ui\drawing\ImageCache.hh"
 
 namespace ra {
 namespace ui {
@@ -48,7 +51,10 @@ public:
 
 private:
     static std::wstring GetFilename(ImageType nType, const std::string& sName);
-    static HBITMAP LoadLocalPNG(const std::wstring& sFilename, unsigned int nWidth, unsigned int nHeight);
+    static bool IsStoredImage(ImageType nType) noexcept;
+    static ra::services::StorageItemType GetStorageItemType(ImageType nType) noexcept;
+    static std::string ReadImageData(ImageType nType, const std::string& sName);
+    static HBITMAP CreateHBitmap(const ImageCache::Image& pImage) noexcept;
 
     HBITMAP GetImage(ImageType nType, const std::string& sName);
     HBITMAP GetDefaultImage(ImageType nType);
@@ -60,6 +66,8 @@ private:
 
     HBitmapMap* GetBitmapMap(ImageType nType) noexcept;
 
+    std::unique_ptr<ImageCache> m_pImageCache;
+
     mutable std::mutex m_oMutex;
     std::set<std::wstring> m_vRequestedImages;
     bool m_bShutdownCOM = false;
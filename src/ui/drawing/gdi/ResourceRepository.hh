@@ -3,6 +3,7 @@
 #pragma once
 
 #include "ui\Types.hh"
+#include "ui\drawing\TextCache.hh"
 
 #include "ra_utility.h"
 
@@ -64,6 +65,11 @@ public:
         return nullptr;
     }
 
+    /// <summary>
+    /// Gets the cache of measured and rendered text for fonts loaded by this repository.
+    /// </summary>
+    TextCache& GetTextCache() noexcept { return m_oTextCache; }
+
 private:
     struct GDIFont
     {
@@ -78,6 +84,8 @@ private:
         HFONT hFont{};
     };
     std::vector<GDIFont> m_vFonts;
+
+    TextCache m_oTextCache;
 };
 
 } // namespace gdi
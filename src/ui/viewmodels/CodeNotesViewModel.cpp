@@ -55,54 +55,205 @@ void CodeNotesViewModel::OnActiveGameChanged()
     SetFilterValue(L"");
 
     if (!pGameContext.IsGameLoading())
+    {
+        RebuildIndex();
         ResetFilter();
+    }
 }
 
 void CodeNotesViewModel::OnEndGameLoad()
 {
+    RebuildIndex();
     ResetFilter();
 }
 
-void CodeNotesViewModel::ResetFilter()
+static std::wstring FoldCase(const std::wstring& sValue)
 {
-    m_vNotes.BeginUpdate();
+    std::wstring sLower = sValue;
+    std::transform(sLower.begin(), sLower.end(), sLower.begin(), [](wchar_t c) noexcept {
+        return gsl::narrow_cast<wchar_t>(std::tolower(c));
+    });
+    return sLower;
+}
 
-    gsl::index nIndex = 0;
+static std::wstring FormatAddressLabel(ra::ByteAddress nAddress, unsigned int nBytes)
+{
+    if (nBytes <= 4)
+        return ra::Widen(ra::ByteAddressToString(nAddress));
+
+    return ra::StringPrintf(L"%s\n- %s", ra::ByteAddressToString(nAddress), ra::ByteAddressToString(nAddress + nBytes - 1));
+}
+
+static constexpr size_t TRIGRAM_LENGTH = 3;
+
+_NODISCARD static constexpr uint64_t MakeTrigram(wchar_t c1, wchar_t c2, wchar_t c3) noexcept
+{
+    // wchar_t is 16-bits on Windows, but allow for up to 21-bit code points
+    return (gsl::narrow_cast<uint64_t>(c1) << 42) | (gsl::narrow_cast<uint64_t>(c2) << 21) | gsl::narrow_cast<uint64_t>(c3);
+}
+
+template<typename TCallback>
+static void EnumerateTrigrams(const std::wstring& sText, TCallback&& callback)
+{
+    if (sText.length() < TRIGRAM_LENGTH)
+        return;
+
+    // a note may contain the same trigram multiple times - only report each once
+    std::vector<uint64_t> vTrigrams;
+    vTrigrams.reserve(sText.length() - TRIGRAM_LENGTH + 1);
+    for (size_t i = 0; i + TRIGRAM_LENGTH <= sText.length(); ++i)
+        vTrigrams.push_back(MakeTrigram(sText.at(i), sText.at(i + 1), sText.at(i + 2)));
+
+    std::sort(vTrigrams.begin(), vTrigrams.end());
+    vTrigrams.erase(std::unique(vTrigrams.begin(), vTrigrams.end()), vTrigrams.end());
+
+    for (const auto nTrigram : vTrigrams)
+        callback(nTrigram);
+}
+
+void CodeNotesViewModel::RebuildIndex()
+{
+    m_vIndexedNotes.clear();
+    m_mTrigramIndex.clear();
 
     const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
-    pGameContext.EnumerateCodeNotes([this, &nIndex](ra::ByteAddress nAddress, unsigned int nBytes, const std::wstring& sNote)
+    m_vIndexedNotes.reserve(pGameContext.CodeNoteCount());
+    pGameContext.EnumerateCodeNotes([this](ra::ByteAddress nAddress, unsigned int nBytes, const std::wstring& sNote)
+    {
+        auto& pNote = m_vIndexedNotes.emplace_back();
+        pNote.nAddress = nAddress;
+        pNote.nBytes = nBytes;
+        pNote.sLabel = FormatAddressLabel(nAddress, nBytes);
+        pNote.sNote = sNote;
+        pNote.sNoteLower = FoldCase(sNote);
+        return true;
+    });
+
+    // notes are enumerated in address order, so each posting list can be appended to and will remain sorted
+    for (const auto& pNote : m_vIndexedNotes)
     {
-        std::wstring sAddress;
-        if (nBytes <= 4)
-            sAddress = ra::Widen(ra::ByteAddressToString(nAddress));
+        EnumerateTrigrams(pNote.sNoteLower, [this, nAddress = pNote.nAddress](uint64_t nTrigram) {
+            m_mTrigramIndex[nTrigram].push_back(nAddress);
+        });
+    }
+}
+
+void CodeNotesViewModel::IndexNote(const IndexedNote& pNote)
+{
+    EnumerateTrigrams(pNote.sNoteLower, [this, nAddress = pNote.nAddress](uint64_t nTrigram) {
+        auto& vAddresses = m_mTrigramIndex[nTrigram];
+        const auto pIter = std::lower_bound(vAddresses.begin(), vAddresses.end(), nAddress);
+        if (pIter == vAddresses.end() || *pIter != nAddress)
+            vAddresses.insert(pIter, nAddress);
+    });
+}
+
+void CodeNotesViewModel::UnindexNote(const IndexedNote& pNote)
+{
+    EnumerateTrigrams(pNote.sNoteLower, [this, nAddress = pNote.nAddress](uint64_t nTrigram) {
+        const auto pPosting = m_mTrigramIndex.find(nTrigram);
+        if (pPosting == m_mTrigramIndex.end())
+            return;
+
+        auto& vAddresses = pPosting->second;
+        const auto pIter = std::lower_bound(vAddresses.begin(), vAddresses.end(), nAddress);
+        if (pIter != vAddresses.end() && *pIter == nAddress)
+            vAddresses.erase(pIter);
+
+        if (vAddresses.empty())
+            m_mTrigramIndex.erase(pPosting);
+    });
+}
+
+std::vector<ra::ByteAddress> CodeNotesViewModel::FindCandidates(const std::wstring& sFilterLower) const
+{
+    // gather the posting list for each trigram in the filter. if any trigram is not indexed, nothing can match.
+    std::vector<const std::vector<ra::ByteAddress>*> vPostings;
+    bool bAllFound = true;
+    EnumerateTrigrams(sFilterLower, [this, &vPostings, &bAllFound](uint64_t nTrigram) {
+        const auto pPosting = m_mTrigramIndex.find(nTrigram);
+        if (pPosting == m_mTrigramIndex.end())
+            bAllFound = false;
         else
-            sAddress = ra::StringPrintf(L"%s\n- %s", ra::ByteAddressToString(nAddress), ra::ByteAddressToString(nAddress + nBytes - 1));
+            vPostings.push_back(&pPosting->second);
+    });
+
+    std::vector<ra::ByteAddress> vCandidates;
+    if (!bAllFound || vPostings.empty())
+        return vCandidates;
+
+    // intersect the lists, starting with the smallest to minimize the work
+    std::sort(vPostings.begin(), vPostings.end(), [](const auto* pLeft, const auto* pRight) noexcept {
+        return pLeft->size() < pRight->size();
+    });
+
+    vCandidates = *vPostings.front();
+    std::vector<ra::ByteAddress> vIntersection;
+    for (size_t i = 1; i < vPostings.size() && !vCandidates.empty(); ++i)
+    {
+        const auto* pPosting = vPostings.at(i);
+        vIntersection.clear();
+        std::set_intersection(vCandidates.begin(), vCandidates.end(), pPosting->begin(), pPosting->end(),
+                              std::back_inserter(vIntersection));
+        vCandidates.swap(vIntersection);
+    }
+
+    return vCandidates;
+}
+
+void CodeNotesViewModel::SyncVisibleNotes()
+{
+    m_vNotes.BeginUpdate();
+
+    // reuse the existing rows in order, then discard any extras from the end of the list. removing from the
+    // end of the list doesn't require shifting any other rows.
+    gsl::index nIndex = 0;
+    for (const auto& pIndexedNote : m_vIndexedNotes)
+    {
+        if (!pIndexedNote.bVisible)
+            continue;
 
         auto* vmNote = m_vNotes.GetItemAt(nIndex);
         if (vmNote)
         {
-            vmNote->SetLabel(sAddress);
-            vmNote->SetNote(sNote);
-            vmNote->SetSelected(false);
+            vmNote->SetLabel(pIndexedNote.sLabel);
+            vmNote->SetNote(pIndexedNote.sNote);
+            vmNote->SetSelected(pIndexedNote.bSelected);
         }
         else
         {
-            vmNote = &m_vNotes.Add(sAddress, sNote);
+            vmNote = &m_vNotes.Add(pIndexedNote.sLabel, pIndexedNote.sNote);
+            vmNote->SetSelected(pIndexedNote.bSelected);
         }
-        vmNote->nAddress = nAddress;
-        vmNote->nBytes = nBytes;
+        vmNote->nAddress = pIndexedNote.nAddress;
+        vmNote->nBytes = pIndexedNote.nBytes;
 
         ++nIndex;
-        return true;
-    });
+    }
 
     for (gsl::index i = ra::to_signed(m_vNotes.Count()) - 1; i >= nIndex; --i)
         m_vNotes.RemoveAt(i);
 
     m_vNotes.EndUpdate();
 
-    m_nUnfilteredNotesCount = m_vNotes.Count();
-    SetValue(ResultCountProperty, ra::StringPrintf(L"%u/%u", m_nUnfilteredNotesCount, m_nUnfilteredNotesCount));
+    UpdateResultCount();
+}
+
+void CodeNotesViewModel::UpdateResultCount()
+{
+    SetValue(ResultCountProperty, ra::StringPrintf(L"%u/%u", m_vNotes.Count(), m_nUnfilteredNotesCount));
+}
+
+void CodeNotesViewModel::ResetFilter()
+{
+    for (auto& pIndexedNote : m_vIndexedNotes)
+    {
+        pIndexedNote.bVisible = true;
+        pIndexedNote.bSelected = false;
+    }
+
+    m_nUnfilteredNotesCount = m_vIndexedNotes.size();
+    SyncVisibleNotes();
 }
 
 void CodeNotesViewModel::ApplyFilter()
@@ -111,23 +262,50 @@ void CodeNotesViewModel::ApplyFilter()
     if (sFilter.empty())
         return;
 
-    std::wstring sFilterLower = sFilter;
-    std::transform(sFilterLower.begin(), sFilterLower.end(), sFilterLower.begin(), [](wchar_t c) noexcept {
-        return gsl::narrow_cast<wchar_t>(std::tolower(c));
-    });
-
-    m_vNotes.BeginUpdate();
+    const std::wstring sFilterLower = FoldCase(sFilter);
 
-    for (gsl::index i = ra::to_signed(m_vNotes.Count()) - 1; i >= 0; --i)
+    // remember which visible rows are selected so the selection survives the rebuild
+    auto pIndexedNote = m_vIndexedNotes.begin();
+    for (gsl::index i = 0; i < ra::to_signed(m_vNotes.Count()); ++i)
     {
-        const auto& sNote = m_vNotes.GetItemValue(i, CodeNoteViewModel::NoteProperty);
-        if (!ra::StringContainsCaseInsensitive(sNote, sFilterLower, true))
-            m_vNotes.RemoveAt(i);
+        const auto* vmNote = m_vNotes.GetItemAt(i);
+        Ensures(vmNote != nullptr);
+
+        pIndexedNote = std::lower_bound(pIndexedNote, m_vIndexedNotes.end(), vmNote->nAddress,
+            [](const IndexedNote& pNote, ra::ByteAddress nAddress) noexcept { return pNote.nAddress < nAddress; });
+        if (pIndexedNote != m_vIndexedNotes.end() && pIndexedNote->nAddress == vmNote->nAddress)
+            pIndexedNote->bSelected = vmNote->IsSelected();
     }
 
-    m_vNotes.EndUpdate();
+    // filters are cumulative - only notes that are currently visible can remain visible. both the candidate
+    // list and the note list are sorted by address, so they can be merged in a single pass.
+    if (sFilterLower.length() >= TRIGRAM_LENGTH)
+    {
+        const auto vCandidates = FindCandidates(sFilterLower);
+        auto pCandidate = vCandidates.begin();
+        for (auto& pNote : m_vIndexedNotes)
+        {
+            while (pCandidate != vCandidates.end() && *pCandidate < pNote.nAddress)
+                ++pCandidate;
 
-    SetValue(ResultCountProperty, ra::StringPrintf(L"%u/%u", m_vNotes.Count(), m_nUnfilteredNotesCount));
+            if (pNote.bVisible)
+            {
+                // trigrams may match out of order - confirm the candidate actually contains the filter
+                pNote.bVisible = (pCandidate != vCandidates.end() && *pCandidate == pNote.nAddress &&
+                                  pNote.sNoteLower.find(sFilterLower) != std::wstring::npos);
+            }
+        }
+    }
+    else
+    {
+        for (auto& pNote : m_vIndexedNotes)
+        {
+            if (pNote.bVisible)
+                pNote.bVisible = (pNote.sNoteLower.find(sFilterLower) != std::wstring::npos);
+        }
+    }
+
+    SyncVisibleNotes();
 }
 
 void CodeNotesViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const std::wstring& sNewNote)
@@ -139,15 +317,48 @@ void CodeNotesViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const std::
     m_nUnfilteredNotesCount = pGameContext.CodeNoteCount();
 
     bool bMatchesFilter = false;
+    std::wstring sNewNoteLower;
     if (!sNewNote.empty())
     {
+        sNewNoteLower = FoldCase(sNewNote);
+
         const std::wstring& sFilter = GetFilterValue();
         if (sFilter.empty())
             bMatchesFilter = true;
-        else if (sNewNote.length() > sFilter.length())
-            bMatchesFilter = ra::StringContainsCaseInsensitive(sNewNote, sFilter);
+        else
+            bMatchesFilter = (sNewNoteLower.find(FoldCase(sFilter)) != std::wstring::npos);
     }
 
+    // update the index
+    auto pIndexedNote = std::lower_bound(m_vIndexedNotes.begin(), m_vIndexedNotes.end(), nAddress,
+        [](const IndexedNote& pNote, ra::ByteAddress nNoteAddress) noexcept { return pNote.nAddress < nNoteAddress; });
+    if (pIndexedNote != m_vIndexedNotes.end() && pIndexedNote->nAddress == nAddress)
+    {
+        UnindexNote(*pIndexedNote);
+
+        if (sNewNote.empty())
+            pIndexedNote = m_vIndexedNotes.erase(pIndexedNote);
+    }
+    else if (!sNewNote.empty())
+    {
+        pIndexedNote = m_vIndexedNotes.emplace(pIndexedNote);
+        pIndexedNote->nAddress = nAddress;
+    }
+
+    unsigned int nBytes = 1;
+    if (!sNewNote.empty())
+    {
+        nBytes = std::max(pGameContext.FindCodeNoteSize(nAddress), 1U);
+
+        pIndexedNote->nBytes = nBytes;
+        pIndexedNote->sLabel = FormatAddressLabel(nAddress, nBytes);
+        pIndexedNote->sNote = sNewNote;
+        pIndexedNote->sNoteLower = std::move(sNewNoteLower);
+        pIndexedNote->bVisible = bMatchesFilter;
+        IndexNote(*pIndexedNote);
+    }
+
+    // update the visible rows
     gsl::index nIndex = 0;
     for (; nIndex < ra::to_signed(m_vNotes.Count()); ++nIndex)
     {
@@ -158,7 +369,9 @@ void CodeNotesViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const std::
             if (bMatchesFilter)
             {
                 /* existing note was updated */
+                pNote->SetLabel(FormatAddressLabel(nAddress, nBytes));
                 pNote->SetNote(sNewNote);
+                pNote->nBytes = nBytes;
             }
             else
             {
@@ -166,7 +379,7 @@ void CodeNotesViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const std::
                 m_vNotes.RemoveAt(nIndex);
             }
 
-            SetValue(ResultCountProperty, ra::StringPrintf(L"%u/%u", m_vNotes.Count(), m_nUnfilteredNotesCount));
+            UpdateResultCount();
             return;
         }
         else if (pNote->nAddress > nAddress)
@@ -179,14 +392,14 @@ void CodeNotesViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const std::
     if (bMatchesFilter)
     {
         m_vNotes.BeginUpdate();
-        auto& pNote = m_vNotes.Add(ra::Widen(ra::ByteAddressToString(nAddress)), sNewNote);
+        auto& pNote = m_vNotes.Add(FormatAddressLabel(nAddress, nBytes), sNewNote);
         pNote.nAddress = nAddress;
-        pNote.nBytes = 1; // this will be updated when the filter is reset
+        pNote.nBytes = nBytes;
         m_vNotes.MoveItem(m_vNotes.Count() - 1, nIndex);
         m_vNotes.EndUpdate();
     }
 
-    SetValue(ResultCountProperty, ra::StringPrintf(L"%u/%u", m_vNotes.Count(), m_nUnfilteredNotesCount));
+    UpdateResultCount();
 }
 
 void CodeNotesViewModel::BookmarkSelected() const
@@ -148,9 +148,33 @@ protected:
     void OnCodeNoteChanged(ra::ByteAddress nAddress, const std::wstring& sNewNote) override;
 
 private:
+    struct IndexedNote
+    {
+        ra::ByteAddress nAddress = 0;
+        unsigned int nBytes = 1;
+        std::wstring sLabel;
+        std::wstring sNote;
+        std::wstring sNoteLower;
+        bool bVisible = true;
+        bool bSelected = false;
+    };
+
+    void RebuildIndex();
+    void IndexNote(const IndexedNote& pNote);
+    void UnindexNote(const IndexedNote& pNote);
+    std::vector<ra::ByteAddress> FindCandidates(const std::wstring& sFilterLower) const;
+    void SyncVisibleNotes();
+    void UpdateResultCount();
+
     ViewModelCollection<CodeNoteViewModel> m_vNotes;
     size_t m_nUnfilteredNotesCount = 0U;
 
+    // all notes for the current game, sorted by address. the visible subset is mirrored into m_vNotes.
+    std::vector<IndexedNote> m_vIndexedNotes;
+
+    // maps each case-folded trigram to the sorted list of addresses whose note contains it.
+    std::unordered_map<uint64_t, std::vector<ra::ByteAddress>> m_mTrigramIndex;
+
     gsl::index m_nSelectionStart = -1, m_nSelectionEnd = -1;
     unsigned int m_nGameId = 0U;
 };
@@ -8,6 +8,7 @@
 
 #include "data\EmulatorContext.hh"
 #include "data\SessionTracker.hh"
+#include "data\SubmissionQueue.hh"
 #include "data\UserContext.hh"
 
 #include "services\IConfiguration.hh"
@@ -75,6 +76,9 @@ bool LoginViewModel::Login() const
     auto& pSessionTracker = ra::services::ServiceLocator::GetMutable<ra::data::SessionTracker>();
     pSessionTracker.Initialize(response.Username);
 
+    // resume sending any unlocks that couldn't be sent during the previous session
+    ra::services::ServiceLocator::GetMutable<ra::data::SubmissionQueue>().Initialize(response.Username);
+
     ra::ui::viewmodels::MessageBoxViewModel::ShowInfoMessage(
         std::wstring(L"Successfully logged in as ") + ra::Widen(response.Username));
 
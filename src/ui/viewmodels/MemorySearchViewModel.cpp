@@ -4,6 +4,7 @@
 #include "data\EmulatorContext.hh"
 
 #include "services\IClock.hh"
+#include "services\PerformanceCounter.hh"
 #include "services\ServiceLocator.hh"
 
 #include "ui\viewmodels\MessageBoxViewModel.hh"
@@ -490,7 +491,10 @@ void MemorySearchViewModel::BeginNewSearch()
     SearchResult& pResult = m_vSearchResults.emplace_back();
     m_nSelectedSearchResult = 0;
 
-    pResult.pResults.Initialize(nStart, gsl::narrow<size_t>(nEnd) - nStart + 1, GetSearchType());
+    {
+        ra::services::PerformanceTimer tFilter(PerformanceCheckpoint::MemorySearchFilter);
+        pResult.pResults.Initialize(nStart, gsl::narrow<size_t>(nEnd) - nStart + 1, GetSearchType());
+    }
     pResult.sSummary = ra::StringPrintf(L"New %s Search", SearchTypes().GetLabelForId(ra::etoi(GetSearchType())));
 
     m_vResults.BeginUpdate();
@@ -558,15 +562,19 @@ void MemorySearchViewModel::ApplyFilter()
     SearchResult const& pPreviousResult = *(m_vSearchResults.end() - 2);
     SearchResult& pResult = m_vSearchResults.back();
 
-    if (GetValueType() == ra::services::SearchFilterType::InitialValue)
-    {
-        SearchResult const& pInitialResult = m_vSearchResults.front();
-        pResult.pResults.Initialize(pInitialResult.pResults, pPreviousResult.pResults,
-            GetComparisonType(), GetValueType(), nValue);
-    }
-    else
     {
-        pResult.pResults.Initialize(pPreviousResult.pResults, GetComparisonType(), GetValueType(), nValue);
+        ra::services::PerformanceTimer tFilter(PerformanceCheckpoint::MemorySearchFilter);
+
+        if (GetValueType() == ra::services::SearchFilterType::InitialValue)
+        {
+            SearchResult const& pInitialResult = m_vSearchResults.front();
+            pResult.pResults.Initialize(pInitialResult.pResults, pPreviousResult.pResults,
+                GetComparisonType(), GetValueType(), nValue);
+        }
+        else
+        {
+            pResult.pResults.Initialize(pPreviousResult.pResults, GetComparisonType(), GetValueType(), nValue);
+        }
     }
 
     // if this isn't the first filter being applied, and the result count hasn't changed
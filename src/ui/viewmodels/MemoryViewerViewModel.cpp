@@ -8,6 +8,11 @@
 #include "ui\EditorTheme.hh"
 #include "ui\viewmodels\WindowManager.hh"
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define RA_MEMORYVIEWER_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace ra {
 namespace ui {
 namespace viewmodels {
@@ -21,6 +26,9 @@ constexpr uint8_t STALE_COLOR = 0x80;
 constexpr uint8_t HIGHLIGHTED_COLOR = STALE_COLOR | gsl::narrow_cast<uint8_t>(ra::etoi(MemoryViewerViewModel::TextColor::Selected));
 constexpr int ADDRESS_COLUMN_WIDTH = 10;
 
+// the stale flag is the high bit so a row's worth of flags can be collected with a single movemask
+static_assert(STALE_COLOR == 0x80, "GetStaleMask requires STALE_COLOR to be the high bit");
+
 class MemoryViewerViewModel::MemoryBookmarkMonitor : protected ViewModelCollectionBase::NotifyTarget
 {
 public:
@@ -44,6 +52,7 @@ public:
 protected:
     void OnEndViewModelCollectionUpdate() override
     {
+        m_pOwner.BuildAnnotations();
         m_pOwner.UpdateColors();
     }
 
@@ -59,8 +68,12 @@ protected:
 
     void OnViewModelRemoved(gsl::index) override
     {
+        // the removed bookmark's address is no longer available, so everything has to be rebuilt
         if (!m_vBookmarks.IsUpdating())
+        {
+            m_pOwner.BuildAnnotations();
             m_pOwner.UpdateColors();
+        }
     }
 
     void OnViewModelIntValueChanged(gsl::index nIndex, const IntModelProperty::ChangeArgs& args) override
@@ -112,6 +125,8 @@ void MemoryViewerViewModel::InitializeNotifyTargets()
     m_bReadOnly = (pGameContext.GameId() == 0);
 
     m_pBookmarkMonitor.reset(new MemoryBookmarkMonitor(*this));
+
+    BuildAnnotations();
 }
 
 MemoryViewerViewModel::~MemoryViewerViewModel()
@@ -153,16 +168,64 @@ static MemoryViewerViewModel::TextColor GetColor(ra::ByteAddress nAddress,
     return MemoryViewerViewModel::TextColor::Default;
 }
 
-void MemoryViewerViewModel::UpdateColors()
+void MemoryViewerViewModel::BuildAnnotations()
 {
+    m_mAnnotations.clear();
+
     const auto& pBookmarksViewModel = ra::services::ServiceLocator::Get<ra::ui::viewmodels::WindowManager>().MemoryBookmarks;
+    const auto& vBookmarks = pBookmarksViewModel.Bookmarks();
+    for (size_t nIndex = 0; nIndex < vBookmarks.Count(); ++nIndex)
+    {
+        const auto* pBookmark = vBookmarks.GetItemAt(nIndex);
+        if (pBookmark == nullptr)
+            continue;
+
+        // if there are multiple bookmarks for an address, a frozen one takes precedence
+        auto& nColor = m_mAnnotations[pBookmark->GetAddress()];
+        if (pBookmark->GetBehavior() == ra::ui::viewmodels::MemoryBookmarksViewModel::BookmarkBehavior::Frozen)
+            nColor = TextColor::Frozen;
+        else if (nColor != TextColor::Frozen)
+            nColor = TextColor::HasBookmark;
+    }
+
+    // bookmarks take precedence over notes. emplace will not replace an existing entry
     const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
+    pGameContext.EnumerateCodeNotes([this](ra::ByteAddress nAddress)
+    {
+        m_mAnnotations.emplace(nAddress, TextColor::HasNote);
+        return true;
+    });
+}
 
+void MemoryViewerViewModel::UpdateAnnotation(ra::ByteAddress nAddress)
+{
+    const auto& pBookmarksViewModel = ra::services::ServiceLocator::Get<ra::ui::viewmodels::WindowManager>().MemoryBookmarks;
+    const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
+
+    const auto nColor = GetColor(nAddress, pBookmarksViewModel, pGameContext);
+    if (nColor == TextColor::Default)
+        m_mAnnotations.erase(nAddress);
+    else
+        m_mAnnotations.insert_or_assign(nAddress, nColor);
+}
+
+MemoryViewerViewModel::TextColor MemoryViewerViewModel::GetAnnotation(ra::ByteAddress nAddress) const
+{
+    const auto pIter = m_mAnnotations.find(nAddress);
+    return (pIter != m_mAnnotations.end()) ? pIter->second : TextColor::Default;
+}
+
+void MemoryViewerViewModel::UpdateColors()
+{
     const auto nVisibleLines = GetNumVisibleLines();
     const auto nFirstAddress = GetFirstAddress();
+    const auto nMaxAddress = nFirstAddress + nVisibleLines * 16;
+
+    memset(m_pColor, STALE_COLOR | ra::etoi(TextColor::Default), gsl::narrow_cast<size_t>(nVisibleLines) * 16);
 
-    for (int i = 0; i < nVisibleLines * 16; ++i)
-        m_pColor[i] = STALE_COLOR | gsl::narrow_cast<uint8_t>(ra::etoi(GetColor(nFirstAddress + i, pBookmarksViewModel, pGameContext)));
+    auto pIter = m_mAnnotations.lower_bound(nFirstAddress);
+    for (; pIter != m_mAnnotations.end() && pIter->first < nMaxAddress; ++pIter)
+        m_pColor[pIter->first - nFirstAddress] = STALE_COLOR | gsl::narrow_cast<uint8_t>(ra::etoi(pIter->second));
 
     UpdateHighlight(GetAddress(), NibblesPerWord() / 2, 0);
 
@@ -194,12 +257,9 @@ void MemoryViewerViewModel::UpdateHighlight(ra::ByteAddress nAddress, int nNewLe
 
     if (nOldLength > nNewLength)
     {
-        const auto& pBookmarksViewModel = ra::services::ServiceLocator::Get<ra::ui::viewmodels::WindowManager>().MemoryBookmarks;
-        const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
-
         while (nOldLength > nNewLength)
         {
-            m_pColor[nAddress - nFirstAddress] = STALE_COLOR | gsl::narrow_cast<uint8_t>(ra::etoi(GetColor(nAddress, pBookmarksViewModel, pGameContext)));
+            m_pColor[nAddress - nFirstAddress] = STALE_COLOR | gsl::narrow_cast<uint8_t>(ra::etoi(GetAnnotation(nAddress)));
             if (++nAddress == nMaxAddress)
                 return;
 
@@ -492,6 +552,7 @@ void MemoryViewerViewModel::OnActiveGameChanged()
 {
     m_nNeedsRedraw |= REDRAW_ADDRESSES;
 
+    BuildAnnotations();
     UpdateColors();
 
     const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
@@ -500,6 +561,8 @@ void MemoryViewerViewModel::OnActiveGameChanged()
 
 void MemoryViewerViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const std::wstring&)
 {
+    UpdateAnnotation(nAddress);
+
     const auto nFirstAddress = GetFirstAddress();
     if (nAddress < nFirstAddress)
         return;
@@ -509,10 +572,8 @@ void MemoryViewerViewModel::OnCodeNoteChanged(ra::ByteAddress nAddress, const st
     if (nOffset >= ra::to_unsigned(nVisibleLines * 16))
         return;
 
-    const auto& pBookmarksViewModel = ra::services::ServiceLocator::Get<ra::ui::viewmodels::WindowManager>().MemoryBookmarks;
-    const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
     const auto nNewColor = (nAddress == GetAddress()) ? ra::itoe<TextColor>(HIGHLIGHTED_COLOR & 0x0F) :
-        GetColor(nAddress, pBookmarksViewModel, pGameContext);
+        GetAnnotation(nAddress);
 
     if ((m_pColor[nOffset] & 0x0F) != ra::etoi(nNewColor))
     {
@@ -568,6 +629,8 @@ void MemoryViewerViewModel::OnByteWritten(ra::ByteAddress nAddress, uint8_t nVal
 
 void MemoryViewerViewModel::UpdateColor(ra::ByteAddress nAddress)
 {
+    UpdateAnnotation(nAddress);
+
     auto nFirstAddress = GetFirstAddress();
     if (nAddress < nFirstAddress)
         return;
@@ -583,10 +646,7 @@ void MemoryViewerViewModel::UpdateColor(ra::ByteAddress nAddress)
             return;
 
         // byte is not selected, update
-        const auto& pBookmarksViewModel = ra::services::ServiceLocator::Get<ra::ui::viewmodels::WindowManager>().MemoryBookmarks;
-        const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
-
-        const auto nNewColor = GetColor(nAddress, pBookmarksViewModel, pGameContext);
+        const auto nNewColor = GetAnnotation(nAddress);
         if (nNewColor != nColor)
         {
             m_pColor[nAddress - nFirstAddress] = STALE_COLOR | gsl::narrow_cast<uint8_t>(ra::etoi(nNewColor));
@@ -739,6 +799,47 @@ void MemoryViewerViewModel::OnLostFocus()
     UpdateHighlight(GetAddress(), NibblesPerWord() / 2, 0);
 }
 
+// each row of the viewer is 16 bytes, which fits exactly in one SSE2 register
+
+/// <summary>
+/// Gets a bit for each of the 16 bytes in the row that is different.
+/// </summary>
+static unsigned int GetChangedMask(const uint8_t* pOld, const uint8_t* pNew) noexcept
+{
+#ifdef RA_MEMORYVIEWER_SSE2
+    GSL_SUPPRESS_TYPE1 const __m128i vOld = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pOld));
+    GSL_SUPPRESS_TYPE1 const __m128i vNew = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pNew));
+    return ~gsl::narrow_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(vOld, vNew))) & 0xFFFF;
+#else
+    unsigned int nMask = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        if (pOld[i] != pNew[i])
+            nMask |= (1 << i);
+    }
+    return nMask;
+#endif
+}
+
+/// <summary>
+/// Gets a bit for each of the 16 bytes in the row that needs to be redrawn.
+/// </summary>
+static unsigned int GetStaleMask(const uint8_t* pColor) noexcept
+{
+#ifdef RA_MEMORYVIEWER_SSE2
+    GSL_SUPPRESS_TYPE1 const __m128i vColor = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pColor));
+    return gsl::narrow_cast<unsigned int>(_mm_movemask_epi8(vColor));
+#else
+    unsigned int nMask = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        if (pColor[i] & STALE_COLOR)
+            nMask |= (1 << i);
+    }
+    return nMask;
+#endif
+}
+
 #pragma warning(push)
 #pragma warning(disable : 26446) // pMemory[] is unchecked   (nVisibleLines assertion enforces range)
 #pragma warning(disable : 26494) // pMemory is uninitialized (initialized by ReadMemory)
@@ -753,13 +854,19 @@ void MemoryViewerViewModel::DoFrame()
     const auto& pEmulatorContext = ra::services::ServiceLocator::Get<ra::data::EmulatorContext>();
     pEmulatorContext.ReadMemory(nAddress, pMemory, gsl::narrow_cast<size_t>(nVisibleLines) * 16);
 
-    for (auto nIndex = 0; nIndex < nVisibleLines * 16; ++nIndex)
+    for (auto nOffset = 0; nOffset < nVisibleLines * 16; nOffset += 16)
     {
-        if (m_pMemory[nIndex] != pMemory[nIndex])
+        auto nChanged = GetChangedMask(&m_pMemory[nOffset], &pMemory[nOffset]);
+        if (nChanged == 0)
+            continue;
+
+        memcpy(&m_pMemory[nOffset], &pMemory[nOffset], 16);
+        m_nNeedsRedraw |= REDRAW_MEMORY;
+
+        for (auto nIndex = nOffset; nChanged != 0; ++nIndex, nChanged >>= 1)
         {
-            m_pMemory[nIndex] = pMemory[nIndex];
-            m_pColor[nIndex] |= STALE_COLOR;
-            m_nNeedsRedraw |= REDRAW_MEMORY;
+            if (nChanged & 1)
+                m_pColor[nIndex] |= STALE_COLOR;
         }
     }
 
@@ -789,13 +896,14 @@ void MemoryViewerViewModel::BuildFontSurface()
     m_szChar = pSurface->MeasureText(m_nFont, L"0");
     m_szChar.Height--; // don't need space for dangly bits
 
-    m_pFontSurface = pSurfaceFactory.CreateSurface(m_szChar.Width * 16, m_szChar.Height * ra::etoi(TextColor::NumColors));
+    // each row contains every byte value drawn in one color so a byte can be drawn with a single copy
+    m_pFontSurface = pSurfaceFactory.CreateSurface(m_szChar.Width * 2 * 256, m_szChar.Height * ra::etoi(TextColor::NumColors));
     m_pFontSurface->FillRectangle(0, 0, m_pFontSurface->GetWidth(), m_pFontSurface->GetHeight(), pEditorTheme.ColorBackground());
 
     m_pFontSurface->FillRectangle(0, m_szChar.Height * ra::etoi(TextColor::Cursor),
         m_pFontSurface->GetWidth(), m_szChar.Height, pEditorTheme.ColorCursor());
 
-    std::wstring sHexChar = L"0";
+    std::wstring sHexByte = L"00";
     ra::ui::Color nColor(0);
     for (int i = 0; i < ra::etoi(TextColor::NumColors); ++i)
     {
@@ -809,10 +917,11 @@ void MemoryViewerViewModel::BuildFontSurface()
             case TextColor::Frozen:       nColor = pEditorTheme.ColorFrozen(); break;
         }
 
-        for (int j = 0; j < 16; ++j)
+        for (int j = 0; j < 256; ++j)
         {
-            sHexChar.at(0) = g_sHexChars.at(j);
-            m_pFontSurface->WriteText(j * m_szChar.Width, i * m_szChar.Height - 1, m_nFont, nColor, sHexChar);
+            sHexByte.at(0) = g_sHexChars.at(j >> 4);
+            sHexByte.at(1) = g_sHexChars.at(j & 0x0F);
+            m_pFontSurface->WriteText(j * 2 * m_szChar.Width, i * m_szChar.Height - 1, m_nFont, nColor, sHexByte);
         }
     }
 }
@@ -868,48 +977,65 @@ void MemoryViewerViewModel::RenderMemory()
 
     const int nWordSpacing = NibblesPerWord() + 1;
     const int nBytesPerWord = nWordSpacing / 2;
-    for (int i = 0; i < nVisibleLines * 16; ++i)
+    for (int nOffset = 0; nOffset < nVisibleLines * 16; nOffset += 16)
     {
-        if (!(m_pColor[i] & STALE_COLOR))
+        // skip over rows that haven't changed
+        auto nStale = GetStaleMask(&m_pColor[nOffset]);
+        if (nStale == 0)
             continue;
 
-        const uint8_t nColor = m_pColor[i] & 0x0F;
-        m_pColor[i] = nColor;
+        const int nY = ((nOffset / 16) + 1) * m_szChar.Height;
+        for (int nIndex = nOffset; nStale != 0; ++nIndex, nStale >>= 1)
+        {
+            if (nStale & 1)
+                RenderByte(nIndex, nY, nBytesPerWord, nWordSpacing);
+        }
+    }
+}
 
-        TextColor nColorUpper = ra::itoe<TextColor>(nColor);
-        TextColor nColorLower = nColorUpper;
+void MemoryViewerViewModel::RenderByte(int nIndex, int nY, int nBytesPerWord, int nWordSpacing)
+{
+    const uint8_t nColor = m_pColor[nIndex] & 0x0F;
+    m_pColor[nIndex] = nColor;
 
-        const int nY = ((i / 16) + 1) * m_szChar.Height;
+    TextColor nColorUpper = ra::itoe<TextColor>(nColor);
+    TextColor nColorLower = nColorUpper;
 
-        int nX = (((i & 0x0F) / nBytesPerWord) * nWordSpacing + ADDRESS_COLUMN_WIDTH) * m_szChar.Width;
-        if (nBytesPerWord > 1)
-        {
-            const int nByteOffset = ((nBytesPerWord - 1) - (i % nBytesPerWord));
-            nX += (nByteOffset * 2) * m_szChar.Width;
+    int nX = (((nIndex & 0x0F) / nBytesPerWord) * nWordSpacing + ADDRESS_COLUMN_WIDTH) * m_szChar.Width;
+    if (nBytesPerWord > 1)
+    {
+        const int nByteOffset = ((nBytesPerWord - 1) - (nIndex % nBytesPerWord));
+        nX += (nByteOffset * 2) * m_szChar.Width;
 
-            if (nColorUpper == TextColor::Selected && m_bHasFocus && !m_bReadOnly)
-            {
-                if (m_nSelectedNibble / 2 == nByteOffset)
-                {
-                    if ((m_nSelectedNibble & 1) == 0)
-                        nColorUpper = TextColor::Cursor;
-                    else
-                        nColorLower = TextColor::Cursor;
-                }
-            }
-        }
-        else
+        if (nColorUpper == TextColor::Selected && m_bHasFocus && !m_bReadOnly)
         {
-            if (nColorUpper == TextColor::Selected && m_bHasFocus && !m_bReadOnly)
+            if (m_nSelectedNibble / 2 == nByteOffset)
             {
-                if (m_nSelectedNibble == 0)
+                if ((m_nSelectedNibble & 1) == 0)
                     nColorUpper = TextColor::Cursor;
                 else
                     nColorLower = TextColor::Cursor;
             }
         }
+    }
+    else
+    {
+        if (nColorUpper == TextColor::Selected && m_bHasFocus && !m_bReadOnly)
+        {
+            if (m_nSelectedNibble == 0)
+                nColorUpper = TextColor::Cursor;
+            else
+                nColorLower = TextColor::Cursor;
+        }
+    }
 
-        const auto nValue = m_pMemory[i];
+    const auto nValue = m_pMemory[nIndex];
+    if (nColorUpper == nColorLower)
+    {
+        WriteByte(nX, nY, nColorUpper, nValue);
+    }
+    else
+    {
         WriteChar(nX, nY, nColorUpper, nValue >> 4);
         WriteChar(nX + m_szChar.Width, nY, nColorLower, nValue & 0x0F);
     }
@@ -917,9 +1043,15 @@ void MemoryViewerViewModel::RenderMemory()
 
 #pragma warning(pop)
 
+void MemoryViewerViewModel::WriteByte(int nX, int nY, TextColor nColor, uint8_t nValue)
+{
+    m_pSurface->DrawSurface(nX, nY, *m_pFontSurface, nValue * 2 * m_szChar.Width, ra::etoi(nColor) * m_szChar.Height, m_szChar.Width * 2, m_szChar.Height);
+}
+
 void MemoryViewerViewModel::WriteChar(int nX, int nY, TextColor nColor, int hexChar)
 {
-    m_pSurface->DrawSurface(nX, nY, *m_pFontSurface, hexChar * m_szChar.Width, ra::etoi(nColor) * m_szChar.Height, m_szChar.Width, m_szChar.Height);
+    // the left half of the byte where both nibbles are hexChar (i.e. 0x33 for 3)
+    m_pSurface->DrawSurface(nX, nY, *m_pFontSurface, hexChar * 0x11 * 2 * m_szChar.Width, ra::etoi(nColor) * m_szChar.Height, m_szChar.Width, m_szChar.Height);
 }
 
 void MemoryViewerViewModel::RenderAddresses()
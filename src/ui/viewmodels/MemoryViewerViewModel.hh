@@ -204,10 +204,24 @@ private:
     void RenderAddresses();
     void RenderHeader();
     void RenderMemory();
+    void RenderByte(int nIndex, int nY, int nBytesPerWord, int nWordSpacing);
+    void WriteByte(int nX, int nY, TextColor nColor, uint8_t nValue);
     void WriteChar(int nX, int nY, TextColor nColor, int hexChar);
 
     void UpdateColor(ra::ByteAddress nAddress);
     void UpdateColors();
+
+    /// <summary>
+    /// Rebuilds the colors for every address that has a bookmark or code note.
+    /// </summary>
+    void BuildAnnotations();
+
+    /// <summary>
+    /// Updates the color for a single address after its bookmarks or code note have changed.
+    /// </summary>
+    void UpdateAnnotation(ra::ByteAddress nAddress);
+
+    TextColor GetAnnotation(ra::ByteAddress nAddress) const;
     void UpdateHighlight(ra::ByteAddress nAddress, int nNewLength, int nOldLength);
 
     int NibblesPerWord() const;
@@ -217,6 +231,9 @@ private:
     std::unique_ptr<ra::ui::drawing::ISurface> m_pFontSurface;
     std::unique_ptr<uint8_t[]> m_pBuffer;
 
+    // colors for the addresses that have bookmarks or code notes. any address not in the map is TextColor::Default.
+    std::map<ra::ByteAddress, TextColor> m_mAnnotations;
+
     int m_nFont = 0;
 
     class MemoryBookmarkMonitor;
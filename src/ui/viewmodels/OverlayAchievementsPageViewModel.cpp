@@ -32,6 +32,15 @@ void OverlayAchievementsPageViewModel::Refresh()
     const auto& pGameContext = ra::services::ServiceLocator::Get<ra::data::GameContext>();
     SetListTitle(pGameContext.GameTitle());
 
+    // the badges for the game are packed into an atlas so the list isn't drawn from hundreds of separate bitmaps.
+    // locked badges are included so the atlas doesn't have to change as achievements are earned or reset.
+    if (m_pImageAtlas == nullptr || m_nImageAtlasGameId != pGameContext.GameId())
+    {
+        const auto& pTheme = ra::services::ServiceLocator::Get<ra::ui::OverlayTheme>();
+        m_pImageAtlas = std::make_unique<ra::ui::drawing::ImageAtlas>(ItemImageSize, pTheme.ColorBackground());
+        m_nImageAtlasGameId = pGameContext.GameId();
+    }
+
     // achievement list
     unsigned int nMaxPts = 0;
     unsigned int nUserPts = 0;
@@ -54,11 +63,14 @@ void OverlayAchievementsPageViewModel::Refresh()
         pvmAchievement->SetDetail(ra::Widen(pAchievement.Description()));
         pvmAchievement->SetDisabled(false);
         pvmAchievement->Image.ChangeReference(ra::ui::ImageType::Badge, pAchievement.BadgeImageURI());
+        m_pImageAtlas->Add(ra::ui::ImageType::Badge, pAchievement.BadgeImageURI());
         ++nNumberOfAchievements;
 
         if (pAchievement.GetCategory() == Achievement::Category::Core)
         {
             ++nNumberOfCoreAchievements;
+            if (!pAchievement.BadgeImageURI().empty())
+                m_pImageAtlas->Add(ra::ui::ImageType::Badge, pAchievement.BadgeImageURI() + "_lock");
 
             nMaxPts += pAchievement.Points();
             if (pAchievement.Active())
@@ -100,6 +112,8 @@ void OverlayAchievementsPageViewModel::Refresh()
     while (m_vItems.Count() > nNumberOfAchievements)
         m_vItems.RemoveAt(m_vItems.Count() - 1);
 
+    m_pImageAtlas->Build();
+
     // summary
     if (nNumberOfAchievements == 0)
         m_sSummary = L"No achievements present";
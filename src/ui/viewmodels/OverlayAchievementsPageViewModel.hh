@@ -89,6 +89,7 @@ private:
     void RenderDetail(ra::ui::drawing::ISurface& pSurface, int nX, int nY, _UNUSED int nWidth, int nHeight) const override;
 
     std::wstring m_sSummary;
+    unsigned int m_nImageAtlasGameId = 0;
 };
 
 } // namespace viewmodels
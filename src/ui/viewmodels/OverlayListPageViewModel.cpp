@@ -93,7 +93,7 @@ void OverlayListPageViewModel::RenderList(ra::ui::drawing::ISurface& pSurface, i
     // scrollbar
     const auto nSelectedIndex = ra::to_unsigned(GetSelectedItemIndex());
     gsl::index nIndex = m_nScrollOffset;
-    constexpr auto nItemSize = 64;
+    constexpr auto nItemSize = ItemImageSize;
     constexpr auto nItemSpacing = 8;
     m_nVisibleItems = (nHeight + nItemSpacing) / (nItemSize + nItemSpacing);
 
@@ -119,7 +119,8 @@ void OverlayListPageViewModel::RenderList(ra::ui::drawing::ISurface& pSurface, i
         auto nTextX = nX;
         if (pItem->Image.Type() != ra::ui::ImageType::None)
         {
-            pSurface.DrawImage(nX, nY, nItemSize, nItemSize, pItem->Image);
+            if (m_pImageAtlas == nullptr || !m_pImageAtlas->Draw(pSurface, nX, nY, pItem->Image))
+                pSurface.DrawImage(nX, nY, nItemSize, nItemSize, pItem->Image);
             nTextX += nItemSize;
         }
 
@@ -4,6 +4,7 @@
 #include "OverlayViewModel.hh"
 
 #include "ui\ViewModelCollection.hh"
+#include "ui\drawing\ImageAtlas.hh"
 #include "ui\viewmodels\LookupItemViewModel.hh"
 
 namespace ra {
@@ -143,6 +144,13 @@ protected:
 
     ra::ui::ViewModelCollection<ItemViewModel> m_vItems;
 
+    /// <summary>
+    /// Optional pre-rendered copies of the item images. Items whose images are not in the atlas are drawn directly.
+    /// </summary>
+    std::unique_ptr<ra::ui::drawing::ImageAtlas> m_pImageAtlas;
+
+    static constexpr int ItemImageSize = 64;
+
 private:
     void RenderList(ra::ui::drawing::ISurface& pSurface, int nX, int nY, int nWidth, int nHeight) const;
     virtual void RenderDetail(_UNUSED ra::ui::drawing::ISurface& pSurface, 
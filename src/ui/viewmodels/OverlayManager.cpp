@@ -5,7 +5,9 @@
 #include "services\IClock.hh"
 #include "services\IConfiguration.hh"
 #include "services\IThreadPool.hh"
+#include "services\PerformanceCounter.hh"
 #include "services\ServiceLocator.hh"
+#include "services\Tracer.hh"
 
 #include "ui\IDesktop.hh"
 #include "ui\OverlayTheme.hh"
@@ -139,8 +141,12 @@ void OverlayManager::RequestRender()
 
 void OverlayManager::Render(ra::ui::drawing::ISurface& pSurface, bool bRedrawAll)
 {
+    ra::services::TraceSpan span("OverlayManager::Render");
+    ra::services::PerformanceTimer tRender(PerformanceCheckpoint::OverlayManagerRender);
+
     m_bRenderRequestPending = false;
     m_bRedrawAll = bRedrawAll;
+    m_vDirtyRects.clear();
 
     auto& pClock = ra::services::ServiceLocator::Get<ra::services::IClock>();
     const auto tNow = pClock.UpTime();
@@ -151,12 +157,12 @@ void OverlayManager::Render(ra::ui::drawing::ISurface& pSurface, bool bRedrawAll
 
     if (m_vmOverlay.CurrentState() == OverlayViewModel::State::Hidden)
     {
-        // update the visible popups - if any are updated, m_bRedrawAll will be set
+        // update the visible popups - if any are updated, the areas they affect will be added to m_vDirtyRects
         if (!m_vScoreboards.empty())
         {
             UpdateActiveScoreboard(pSurface, fElapsed);
 
-            // a visible scoreboard may not set m_bRedrawAll if it's in the pause portion of its animation loop
+            // a visible scoreboard may not change anything if it's in the pause portion of its animation loop
             // make sure we keep the render cycle going so it'll eventually handle when the pause ends
             bRequestRender = true;
         }
@@ -168,20 +174,21 @@ void OverlayManager::Render(ra::ui::drawing::ISurface& pSurface, bool bRedrawAll
         {
             UpdateActiveMessage(pSurface, fElapsed);
 
-            // a visible popup may not set m_bRedrawAll if it's in the pause portion of its animation loop
+            // a visible popup may not change anything if it's in the pause portion of its animation loop
             // make sure we keep the render cycle going so it'll eventually handle when the pause ends
             bRequestRender = true;
         }
 
-        // if anything changed, or caller requested a repaint, do so now
-        if (m_bRedrawAll)
+        // if anything changed, or caller requested a repaint, redraw the affected popups. if nothing
+        // changed, nothing is drawn.
+        if (m_bRedrawAll || !m_vDirtyRects.empty())
         {
             if (!m_vScoreboards.empty())
-                RenderPopup(pSurface, m_vScoreboards.front());
+                ComposePopup(pSurface, m_vScoreboards.front());
             for (const auto& pScoreTracker : m_vScoreTrackers)
-                RenderPopup(pSurface, *pScoreTracker);
+                ComposePopup(pSurface, *pScoreTracker);
             if (!m_vPopupMessages.empty())
-                RenderPopup(pSurface, *m_vPopupMessages.front());
+                ComposePopup(pSurface, *m_vPopupMessages.front());
 
             bRequestRender = true;
         }
@@ -213,6 +220,61 @@ void OverlayManager::Render(ra::ui::drawing::ISurface& pSurface, bool bRedrawAll
 
     m_tLastRender = tNow;
     m_bRedrawAll = false;
+    m_vDirtyRects.clear();
+}
+
+void OverlayManager::Invalidate(int nX, int nY, int nWidth, int nHeight)
+{
+    if (nWidth <= 0 || nHeight <= 0)
+        return;
+
+    // if the new area is already covered, there's nothing to do. if the new area covers an existing
+    // area, the existing area can be discarded
+    auto pIter = m_vDirtyRects.begin();
+    while (pIter != m_vDirtyRects.end())
+    {
+        if (pIter->Contains(nX, nY, nWidth, nHeight))
+            return;
+
+        if (DirtyRect{nX, nY, nWidth, nHeight}.Contains(pIter->nX, pIter->nY, pIter->nWidth, pIter->nHeight))
+            pIter = m_vDirtyRects.erase(pIter);
+        else
+            ++pIter;
+    }
+
+    m_vDirtyRects.push_back({nX, nY, nWidth, nHeight});
+}
+
+bool OverlayManager::IsDirty(int nX, int nY, int nWidth, int nHeight) const noexcept
+{
+    for (const auto& pRect : m_vDirtyRects)
+    {
+        if (pRect.Intersects(nX, nY, nWidth, nHeight))
+            return true;
+    }
+
+    return false;
+}
+
+void OverlayManager::ComposePopup(ra::ui::drawing::ISurface& pSurface, const PopupViewModelBase& vmPopup)
+{
+    if (!vmPopup.IsAnimationStarted())
+        return;
+
+    const int nX = GetAbsolutePosition(vmPopup.GetRenderLocationX(), vmPopup.GetRenderLocationXRelativePosition(), pSurface.GetWidth());
+    const int nY = GetAbsolutePosition(vmPopup.GetRenderLocationY(), vmPopup.GetRenderLocationYRelativePosition(), pSurface.GetHeight());
+    const auto& pImage = vmPopup.GetRenderImage();
+    const int nWidth = ra::to_signed(pImage.GetWidth());
+    const int nHeight = ra::to_signed(pImage.GetHeight());
+
+    // popups that haven't changed and weren't affected by something else changing don't need to be redrawn
+    if (!m_bRedrawAll && !IsDirty(nX, nY, nWidth, nHeight))
+        return;
+
+    pSurface.DrawSurface(nX, nY, pImage);
+
+    // popups are composed from the bottom up. anything drawn after this that overlaps it has to be redrawn too
+    Invalidate(nX, nY, nWidth, nHeight);
 }
 
 ScoreTrackerViewModel& OverlayManager::AddScoreTracker(ra::LeaderboardID nLeaderboardId)
@@ -294,12 +356,13 @@ void OverlayManager::UpdatePopup(ra::ui::drawing::ISurface& pSurface, double fEl
 
     const int nOldX = GetAbsolutePosition(vmPopup.GetRenderLocationX(), vmPopup.GetRenderLocationXRelativePosition(), pSurface.GetWidth());
     const int nOldY = GetAbsolutePosition(vmPopup.GetRenderLocationY(), vmPopup.GetRenderLocationYRelativePosition(), pSurface.GetHeight());
+    const int nOldWidth = ra::to_signed(vmPopup.GetRenderImage().GetWidth());
+    const int nOldHeight = ra::to_signed(vmPopup.GetRenderImage().GetHeight());
 
     if (vmPopup.IsDestroyPending())
     {
-        const auto& pImage = vmPopup.GetRenderImage();
-        pSurface.FillRectangle(nOldX, nOldY, pImage.GetWidth(), pImage.GetHeight(), ra::ui::Color::Transparent);
-        m_bRedrawAll = true;
+        pSurface.FillRectangle(nOldX, nOldY, nOldWidth, nOldHeight, ra::ui::Color::Transparent);
+        Invalidate(nOldX, nOldY, nOldWidth, nOldHeight);
         return;
     }
 
@@ -326,9 +389,14 @@ void OverlayManager::UpdatePopup(ra::ui::drawing::ISurface& pSurface, double fEl
                 pSurface.FillRectangle(nOldX, nOldY, nWidth, nNewY - nOldY, ra::ui::Color::Transparent);
             else if (nNewY < nOldY)
                 pSurface.FillRectangle(nOldX, nNewY + pImage.GetHeight() - 1, nWidth, nOldY - nNewY + 1, ra::ui::Color::Transparent);
+
+            // anything under the area the popup previously covered has to be redrawn
+            Invalidate(nOldX, nOldY, nOldWidth, nOldHeight);
         }
 
-        m_bRedrawAll = true;
+        // the popup itself has to be redrawn at its new location
+        const auto& pImage = vmPopup.GetRenderImage();
+        Invalidate(nNewX, nNewY, ra::to_signed(pImage.GetWidth()), ra::to_signed(pImage.GetHeight()));
     }
 }
 
@@ -395,35 +463,26 @@ void OverlayManager::UpdateScoreTrackers(ra::ui::drawing::ISurface& pSurface, do
     if (!m_vScoreboards.empty())
         nOffset += m_vScoreboards.front().GetRenderImage().GetHeight() + 10;
 
-    bool bPopupMoved = false;
     auto pIter = m_vScoreTrackers.begin();
     while (pIter != m_vScoreTrackers.end())
     {
         auto& vmTracker = **pIter;
         if (vmTracker.IsDestroyPending())
         {
-            bPopupMoved = true;
             UpdatePopup(pSurface, fElapsed, vmTracker);
             pIter = m_vScoreTrackers.erase(pIter);
         }
         else
         {
-            bPopupMoved |= vmTracker.SetOffset(nOffset);
+            vmTracker.SetOffset(nOffset);
             UpdatePopup(pSurface, fElapsed, vmTracker);
             nOffset += vmTracker.GetRenderImage().GetHeight() + 10;
             ++pIter;
         }
     }
 
-    // if one or more of the popups moved, we will have drawn a transparent square where the popup used to be. redraw all the popups to make sure we didn't erase one
-    if (bPopupMoved)
-    {
-        for (auto& vmTracker : m_vScoreTrackers)
-            RenderPopup(pSurface, *vmTracker);
-
-        if (!m_vScoreboards.empty())
-            RenderPopup(pSurface, m_vScoreboards.front());
-    }
+    // if one or more of the popups moved, we will have drawn a transparent square where the popup used to be.
+    // the area will have been marked dirty, so any popups that were erased will be redrawn by ComposePopup.
 }
 
 void OverlayManager::UpdateOverlay(ra::ui::drawing::ISurface& pSurface, double fElapsed)
@@ -454,7 +513,7 @@ void OverlayManager::UpdateOverlay(ra::ui::drawing::ISurface& pSurface, double f
     }
 
     UpdatePopup(pSurface, fElapsed, m_vmOverlay);
-    if (m_bRedrawAll)
+    if (m_bRedrawAll || !m_vDirtyRects.empty())
         RenderPopup(pSurface, m_vmOverlay);
 
     if (m_vmOverlay.CurrentState() == OverlayViewModel::State::Hidden)
@@ -575,8 +634,20 @@ void OverlayManager::ProcessScreenshots()
     const auto& pSurfaceFactory = ra::services::ServiceLocator::Get<ra::ui::drawing::ISurfaceFactory>();
     for (const auto& pFile : mReady)
     {
-        RA_LOG_INFO("Saving screenshot %s", pFile.first);
-        pSurfaceFactory.SaveImage(*pFile.second, pFile.first);
+        // hand the pixels off to be encoded in the background so a burst of unlocks isn't held up by the disk.
+        // this is already running on a worker thread, so wait for the writer to catch up rather than losing any.
+        const auto& pSurface = *pFile.second;
+        auto vPixels = m_pScreenshotWriter.AcquireBuffer(gsl::narrow_cast<size_t>(pSurface.GetWidth()) * pSurface.GetHeight());
+        if (pSurfaceFactory.CopyPixels(pSurface, vPixels))
+        {
+            RA_LOG_INFO("Queueing screenshot %s", pFile.first);
+            m_pScreenshotWriter.EnqueueAndWait(pSurface.GetWidth(), pSurface.GetHeight(), std::move(vPixels), pFile.first);
+        }
+        else
+        {
+            RA_LOG_INFO("Saving screenshot %s", pFile.first);
+            pSurfaceFactory.SaveImage(pSurface, pFile.first);
+        }
     }
 }
 
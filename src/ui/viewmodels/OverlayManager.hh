@@ -13,6 +13,8 @@
 
 #include "ui\ImageReference.hh"
 
+#include "ui\drawing\PngWriter.hh"
+
 namespace ra {
 namespace ui {
 namespace viewmodels {
@@ -276,10 +278,42 @@ private:
 
     void UpdateOverlay(ra::ui::drawing::ISurface& pSurface, double fElapsed);
 
+    /// <summary>
+    /// Marks an area of the target surface as needing to be redrawn.
+    /// </summary>
+    void Invalidate(int nX, int nY, int nWidth, int nHeight);
+    bool IsDirty(int nX, int nY, int nWidth, int nHeight) const noexcept;
+
+    /// <summary>
+    /// Draws the popup if it overlaps an area that needs to be redrawn.
+    /// </summary>
+    void ComposePopup(ra::ui::drawing::ISurface& pSurface, const PopupViewModelBase& vmPopup);
+
     void ProcessScreenshots();
     std::unique_ptr<ra::ui::drawing::ISurface> RenderScreenshot(const ra::ui::drawing::ISurface& pClientSurface, const PopupMessageViewModel& vmPopup);
 
     bool m_bRedrawAll = false;
+
+    struct DirtyRect
+    {
+        int nX;
+        int nY;
+        int nWidth;
+        int nHeight;
+
+        bool Contains(int nOtherX, int nOtherY, int nOtherWidth, int nOtherHeight) const noexcept
+        {
+            return nOtherX >= nX && nOtherY >= nY &&
+                nOtherX + nOtherWidth <= nX + nWidth && nOtherY + nOtherHeight <= nY + nHeight;
+        }
+
+        bool Intersects(int nOtherX, int nOtherY, int nOtherWidth, int nOtherHeight) const noexcept
+        {
+            return nOtherX < nX + nWidth && nX < nOtherX + nOtherWidth &&
+                nOtherY < nY + nHeight && nY < nOtherY + nOtherHeight;
+        }
+    };
+    std::vector<DirtyRect> m_vDirtyRects;
     std::chrono::steady_clock::time_point m_tLastRender{};
     std::function<void()> m_fHandleRenderRequest;
     std::function<void()> m_fHandleShowRequest;
@@ -298,6 +332,7 @@ private:
     std::vector<Screenshot> m_vScreenshotQueue;
     std::mutex m_pScreenshotQueueMutex;
     bool m_bProcessingScreenshots = false;
+    ra::ui::drawing::PngWriter m_pScreenshotWriter;
 };
 
 } // namespace viewmodels
@@ -49,11 +49,6 @@ void RichPresenceMonitorViewModel::StartMonitoring()
             ScheduleUpdateDisplayString();
             break;
 
-        case MonitorState::Deactivated:
-            // asked to stop, but haven't called callback yet, resurrect.
-            m_nState = MonitorState::Active;
-            break;
-
         case MonitorState::Static:
             // monitoring, but message is static, update it.
             UpdateDisplayString();
@@ -65,19 +60,19 @@ void RichPresenceMonitorViewModel::StartMonitoring()
     }
 }
 
-void RichPresenceMonitorViewModel::StopMonitoring() noexcept
+void RichPresenceMonitorViewModel::StopMonitoring()
 {
     switch (m_nState)
     {
         default:
         case MonitorState::Active:
-            // monitoring, notify callback to stop rescheduling.
-            m_nState = MonitorState::Deactivated;
-            break;
-
-        case MonitorState::Deactivated:
-            // already asked to stop, but haven't processed it yet.
+        {
+            // monitoring, unschedule the callback.
+            std::lock_guard<std::mutex> lock(m_mtxUpdateTask);
+            m_hUpdateTask.Cancel();
+            m_nState = MonitorState::None;
             break;
+        }
 
         case MonitorState::Static:
             // monitoring, but not updating the message, immediately transition to not monitoring
@@ -92,29 +87,32 @@ void RichPresenceMonitorViewModel::StopMonitoring() noexcept
 
 void RichPresenceMonitorViewModel::ScheduleUpdateDisplayString()
 {
+    // StopMonitoring changes the state while holding the lock, so checking it here ensures a callback that's
+    // finishing up doesn't queue another one after monitoring was stopped.
+    std::lock_guard<std::mutex> lock(m_mtxUpdateTask);
     if (m_nState != MonitorState::Active)
         return;
 
-    ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().ScheduleAsync(std::chrono::seconds(1), [this]()
+    // if monitoring was restarted while the callback was running, there may already be another callback scheduled.
+    m_hUpdateTask.Cancel();
+
+    m_hUpdateTask = ra::services::ServiceLocator::GetMutable<ra::services::IThreadPool>().ScheduleTaskAsync(
+        std::chrono::seconds(1), [this]()
     {
-        if (m_nState == MonitorState::Deactivated)
+        // monitoring was stopped while the callback was waiting to run
+        if (m_nState != MonitorState::Active)
+            return;
+
+        // check to see if the script was updated
+        const time_t tRichPresenceFileTime = GetRichPresenceModified();
+        if (tRichPresenceFileTime != m_tRichPresenceFileTime)
         {
-            // asked to stop, do so now
-            m_nState = MonitorState::None;
+            ra::services::ServiceLocator::GetMutable<ra::data::GameContext>().ReloadRichPresenceScript();
+            m_tRichPresenceFileTime = tRichPresenceFileTime;
         }
-        else
-        {
-            // check to see if the script was updated
-            const time_t tRichPresenceFileTime = GetRichPresenceModified();
-            if (tRichPresenceFileTime != m_tRichPresenceFileTime)
-            {
-                ra::services::ServiceLocator::GetMutable<ra::data::GameContext>().ReloadRichPresenceScript();
-                m_tRichPresenceFileTime = tRichPresenceFileTime;
-            }
 
-            UpdateDisplayString();
-            ScheduleUpdateDisplayString();
-        }
+        UpdateDisplayString();
+        ScheduleUpdateDisplayString();
     });
 }
 
@@ -6,6 +6,8 @@
 
 #include "data/GameContext.hh"
 
+#include "services/TaskHandle.hh"
+
 namespace ra {
 namespace ui {
 namespace viewmodels {
@@ -48,7 +50,7 @@ protected:
     /// <summary>
     /// Stops periodically updating the display string.
     /// </summary>
-    void StopMonitoring() noexcept;
+    void StopMonitoring();
 
     // ViewModelBase::NotifyTarget
     void OnViewModelBoolValueChanged(const BoolModelProperty::ChangeArgs& args) override;
@@ -63,11 +65,12 @@ private:
     {
         None,
         Active,
-        Deactivated,
         Static,
     };
 
-    MonitorState m_nState{ MonitorState::None };
+    std::atomic<MonitorState> m_nState{ MonitorState::None };
+    ra::services::TaskHandle m_hUpdateTask;
+    std::mutex m_mtxUpdateTask; // the update callback reschedules itself from a worker thread
 
     time_t m_tRichPresenceFileTime{ 0 };
 };
@@ -13,6 +13,7 @@
 #include "tests\mocks\MockOverlayTheme.hh"
 #include "tests\mocks\MockServer.hh"
 #include "tests\mocks\MockSessionTracker.hh"
+#include "tests\mocks\MockSubmissionQueue.hh"
 #include "tests\mocks\MockSurface.hh"
 #include "tests\mocks\MockThreadPool.hh"
 #include "tests\mocks\MockUserContext.hh"
@@ -31,6 +32,7 @@ using ra::api::mocks::MockServer;
 using ra::data::mocks::MockEmulatorContext;
 using ra::data::mocks::MockGameContext;
 using ra::data::mocks::MockSessionTracker;
+using ra::data::mocks::MockSubmissionQueue;
 using ra::data::mocks::MockUserContext;
 using ra::services::mocks::MockAudioSystem;
 using ra::services::mocks::MockConfiguration;
@@ -92,6 +94,7 @@ private:
     public:
         MockUserContext mockUserContext;
         MockSessionTracker mockSessionTracker;
+        MockSubmissionQueue mockSubmissionQueue;
         MockConfiguration mockConfiguration;
         MockAudioSystem mockAudioSystem;
         MockServer mockServer;
@@ -168,6 +171,7 @@ public:
 
         // session context
         Assert::AreEqual(std::wstring(L"User"), harness.mockSessionTracker.GetUsername());
+        Assert::AreEqual(std::wstring(L"User"), harness.mockSubmissionQueue.GetUsername());
 
         // popup notification and sound
         Assert::IsTrue(harness.mockAudioSystem.WasAudioFilePlayed(L"Overlay\\login.wav"));
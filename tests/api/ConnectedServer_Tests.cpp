@@ -6,6 +6,7 @@
 
 #include "tests\RA_UnitTestHelpers.h"
 #include "tests\mocks\MockHttpRequester.hh"
+#include "tests\mocks\MockLocalStorage.hh"
 #include "tests\mocks\MockServer.hh"
 #include "tests\mocks\MockThreadPool.hh"
 #include "tests\mocks\MockUserContext.hh"
@@ -16,6 +17,7 @@ using ra::api::impl::ConnectedServer;
 using ra::api::mocks::MockServer;
 using ra::data::mocks::MockUserContext;
 using ra::services::mocks::MockHttpRequester;
+using ra::services::mocks::MockLocalStorage;
 using ra::services::mocks::MockThreadPool;
 using ra::services::Http;
 
@@ -506,6 +508,62 @@ public:
         Assert::AreEqual(std::string("host.com"), pDisconnectedServer->Host());
     }
 
+    // ====================================================
+    // Large responses are parsed in-situ - make sure escaped strings are still decoded correctly
+
+    TEST_METHOD(TestFetchGamesListEscapedNames)
+    {
+        MockUserContext mockUserContext;
+        MockHttpRequester mockHttp([]([[maybe_unused]] const Http::Request& /*request*/)
+        {
+            return Http::Response(Http::StatusCode::OK,
+                "{\"Success\":true,\"Response\":{\"1\":\"Game \\\"One\\\"\",\"22\":\"Pok\\u00e9mon\",\"333\":\"Three\"}}");
+        });
+
+        ConnectedServer server("host.com");
+
+        FetchGamesList::Request request;
+        request.ConsoleId = 1;
+        auto response = server.FetchGamesList(request);
+
+        Assert::AreEqual(ApiResult::Success, response.Result);
+        Assert::AreEqual({ 3U }, response.Games.size());
+        Assert::AreEqual(1U, response.Games.at(0).Id);
+        Assert::AreEqual(std::wstring(L"Game \"One\""), response.Games.at(0).Name);
+        Assert::AreEqual(22U, response.Games.at(1).Id);
+        Assert::AreEqual(std::wstring(L"Pok\u00e9mon"), response.Games.at(1).Name);
+        Assert::AreEqual(333U, response.Games.at(2).Id);
+        Assert::AreEqual(std::wstring(L"Three"), response.Games.at(2).Name);
+    }
+
+    TEST_METHOD(TestFetchCodeNotesCachesResponse)
+    {
+        MockUserContext mockUserContext;
+        MockLocalStorage mockLocalStorage;
+        MockHttpRequester mockHttp([]([[maybe_unused]] const Http::Request& /*request*/)
+        {
+            return Http::Response(Http::StatusCode::OK,
+                "{\"Success\":true,\"CodeNotes\":[{\"User\":\"Me\",\"Address\":\"0x001234\",\"Note\":\"Line 1\\nLine \\\"2\\\"\"},"
+                "{\"User\":\"Me\",\"Address\":\"0x002345\",\"Note\":\"\"}]}");
+        });
+
+        ConnectedServer server("host.com");
+
+        FetchCodeNotes::Request request;
+        request.GameId = 12;
+        auto response = server.FetchCodeNotes(request);
+
+        Assert::AreEqual(ApiResult::Success, response.Result);
+        Assert::AreEqual({ 1U }, response.Notes.size());
+        Assert::AreEqual(0x1234U, response.Notes.at(0).Address);
+        Assert::AreEqual(std::string("Me"), response.Notes.at(0).Author);
+        Assert::AreEqual(std::wstring(L"Line 1\nLine \"2\""), response.Notes.at(0).Note);
+
+        // the cached copy should contain the unmodified notes array
+        Assert::AreEqual(std::string("[{\"User\":\"Me\",\"Address\":\"0x001234\",\"Note\":\"Line 1\\nLine \\\"2\\\"\"},"
+                                     "{\"User\":\"Me\",\"Address\":\"0x002345\",\"Note\":\"\"}]"),
+                         mockLocalStorage.GetStoredData(ra::services::StorageItemType::CodeNotes, L"12"));
+    }
 };
 
 } // namespace tests
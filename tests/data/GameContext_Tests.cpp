@@ -14,6 +14,7 @@
 #include "tests\mocks\MockOverlayManager.hh"
 #include "tests\mocks\MockServer.hh"
 #include "tests\mocks\MockSessionTracker.hh"
+#include "tests\mocks\MockSubmissionQueue.hh"
 #include "tests\mocks\MockThreadPool.hh"
 #include "tests\mocks\MockUserContext.hh"
 
@@ -52,6 +53,7 @@ public:
         ra::ui::viewmodels::mocks::MockOverlayManager mockOverlayManager;
         ra::data::mocks::MockEmulatorContext mockEmulator;
         ra::data::mocks::MockSessionTracker mockSessionTracker;
+        ra::data::mocks::MockSubmissionQueue mockSubmissionQueue;
         ra::data::mocks::MockUserContext mockUser;
         ra::services::AchievementRuntime runtime;
 
@@ -1363,6 +1365,35 @@ public:
         Assert::AreEqual(std::wstring(L"Username | Play time: 1h18m"), pPopup->GetDetail());
     }
 
+    TEST_METHOD(TestAwardAchievementMasteryCancelledByGameChange)
+    {
+        GameContextHarness game;
+        game.mockConfiguration.SetFeatureEnabled(ra::services::Feature::AchievementTriggeredNotifications, true);
+        game.mockConfiguration.SetFeatureEnabled(ra::services::Feature::MasteryNotification, true);
+        game.mockConfiguration.SetFeatureEnabled(ra::services::Feature::Hardcore, true);
+        game.SetGameId(1U);
+        game.SetGameHash("hash");
+        game.SetGameTitle(L"GameName");
+        game.mockServer.HandleRequest<ra::api::AwardAchievement>([](const ra::api::AwardAchievement::Request&, ra::api::AwardAchievement::Response& response)
+        {
+            response.Result = ra::api::ApiResult::Success;
+            return true;
+        });
+
+        game.MockAchievement();
+        game.AwardAchievement(1U);
+
+        game.mockThreadPool.ExecuteNextTask(); // award achievement 1
+        const auto nPendingTasks = game.mockThreadPool.PendingTasks(); // includes delayed mastery unlock check
+
+        // unloading the game should unschedule the mastery check
+        game.LoadGame(0U);
+        Assert::AreEqual(nPendingTasks - 1, game.mockThreadPool.PendingTasks());
+
+        game.mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::IsNull(game.mockOverlayManager.GetMessage(2));
+    }
+
     TEST_METHOD(TestAwardAchievementMasteryNonHardcore)
     {
         GameContextHarness game;
@@ -2,6 +2,8 @@
 
 #include "data\SessionTracker.hh"
 
+#include "RA_md5factory.h"
+
 #include "tests\RA_UnitTestHelpers.h"
 
 #include "tests\mocks\MockClock.hh"
@@ -241,6 +243,54 @@ public:
         Assert::AreEqual(std::string("1234:1534000000:1732:f5\n1234:1534889323:173:bb\n9999:1534889496:169:14\n"), tracker.GetStoredData());
     }
 
+    static std::string MakeSessionLine(unsigned int nGameId, long long nSessionStart, long long nSessionLength)
+    {
+        auto sLine = ra::StringPrintf("%u:%ll:%ll:", nGameId, nSessionStart, nSessionLength);
+        const auto sMD5 = RAGenerateMD5(sLine);
+        sLine.push_back(sMD5.front());
+        sLine.push_back(sMD5.back());
+        sLine.push_back('\n');
+        return sLine;
+    }
+
+    TEST_METHOD(TestCompaction)
+    {
+        // 150 sessions across two games, plus a line with a bad checksum
+        std::string sInitialValue;
+        for (unsigned int i = 0; i < 150; ++i)
+            sInitialValue.append(MakeSessionLine((i % 3 == 0) ? 9999U : 1234U, 1534000000LL + i * 1000, 60));
+        sInitialValue.append("1234:1534200000:591:00\n");
+
+        SessionTrackerHarness tracker;
+        tracker.MockStoredData(sInitialValue);
+        tracker.Initialize("User");
+
+        Assert::AreEqual(100U * 60U, static_cast<unsigned int>(tracker.GetTotalPlaytime(1234U).count()));
+        Assert::AreEqual(50U * 60U, static_cast<unsigned int>(tracker.GetTotalPlaytime(9999U).count()));
+
+        // file should be replaced with one entry per game
+        const std::string sCompacted = MakeSessionLine(9999U, 1534000000LL + 147 * 1000, 50 * 60) +
+                                       MakeSessionLine(1234U, 1534000000LL + 149 * 1000, 100 * 60);
+        Assert::AreEqual(sCompacted, tracker.GetStoredData());
+
+        // most recently played game should be first
+        Assert::AreEqual({ 2U }, tracker.SessionData().size());
+        Assert::AreEqual(1234U, tracker.SessionData().front().GameId);
+
+        // new sessions should be appended to the compacted file
+        tracker.mockGameContext.SetGameId(1234U);
+        tracker.BeginSession(1234U);
+        tracker.mockClock.AdvanceTime(std::chrono::seconds(150));
+        tracker.mockThreadPool.AdvanceTime(std::chrono::seconds(150));
+        Assert::AreEqual(sCompacted + "1234:1534889323:150:5d\n", tracker.GetStoredData());
+
+        // reloading the compacted file should produce the same totals
+        tracker.EndSession();
+        tracker.Initialize("User");
+        Assert::AreEqual(100U * 60U + 150U, static_cast<unsigned int>(tracker.GetTotalPlaytime(1234U).count()));
+        Assert::AreEqual(50U * 60U, static_cast<unsigned int>(tracker.GetTotalPlaytime(9999U).count()));
+    }
+
     TEST_METHOD(TestPing)
     {
         SessionTrackerHarness tracker;
@@ -284,6 +334,7 @@ public:
 
         // once the session is ended, pinging should stop
         tracker.EndSession();
+        Assert::AreEqual({ 0U }, tracker.mockThreadPool.PendingTasks());
         tracker.mockClock.AdvanceTime(std::chrono::seconds(120));
         tracker.mockThreadPool.AdvanceTime(std::chrono::seconds(120));
         tracker.mockThreadPool.ExecuteNextTask(); // execute async server call
@@ -0,0 +1,452 @@
+#include "CppUnitTest.h"
+
+#include "data\SubmissionQueue.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+#include "tests\mocks\MockClock.hh"
+#include "tests\mocks\MockLocalStorage.hh"
+#include "tests\mocks\MockServer.hh"
+#include "tests\mocks\MockThreadPool.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using ra::api::ApiResult;
+using ra::services::StorageItemType;
+
+namespace ra {
+namespace data {
+namespace tests {
+
+TEST_CLASS(SubmissionQueue_Tests)
+{
+private:
+    class SubmissionQueueHarness : public SubmissionQueue
+    {
+    public:
+        ra::api::mocks::MockServer mockServer;
+        ra::services::mocks::MockClock mockClock;
+        ra::services::mocks::MockLocalStorage mockStorage;
+        ra::services::mocks::MockThreadPool mockThreadPool;
+
+        /// <summary>
+        /// Sets up the server to respond to requests with the provided results (in order). Once the results
+        /// are exhausted, all requests will succeed.
+        /// </summary>
+        void MockResults(std::vector<ApiResult>&& vResults)
+        {
+            m_vResults = std::move(vResults);
+            m_nResultIndex = 0;
+
+            mockServer.HandleRequest<ra::api::AwardAchievement>([this](const ra::api::AwardAchievement::Request& request, ra::api::AwardAchievement::Response& response)
+            {
+                vRequests.push_back(ra::StringPrintf("A:%u:%u:%s", request.AchievementId, request.Hardcore ? 1 : 0, request.GameHash));
+                vTimeouts.push_back(request.Timeout);
+                sStoredDataWhenSent = GetStoredData();
+                mockClock.AdvanceTime(tRequestDuration);
+                if (!sSwitchUserDuringRequest.empty())
+                {
+                    const auto sNewUser = sSwitchUserDuringRequest;
+                    sSwitchUserDuringRequest.clear();
+                    Initialize(sNewUser);
+                }
+                response.Result = NextResult();
+                if (response.Result == ApiResult::Success)
+                    response.NewPlayerScore = 100U;
+                else if (response.Result == ApiResult::Error)
+                    response.ErrorMessage = "Unknown achievement";
+                return true;
+            });
+
+            mockServer.HandleRequest<ra::api::SubmitLeaderboardEntry>([this](const ra::api::SubmitLeaderboardEntry::Request& request, ra::api::SubmitLeaderboardEntry::Response& response)
+            {
+                vRequests.push_back(ra::StringPrintf("L:%u:%u:%s", request.LeaderboardId, request.Score, request.GameHash));
+                vTimeouts.push_back(request.Timeout);
+                sStoredDataWhenSent = GetStoredData();
+                mockClock.AdvanceTime(tRequestDuration);
+                response.Result = NextResult();
+                return true;
+            });
+        }
+
+        void QueueAward(unsigned int nAchievementId, bool bHardcore, std::vector<ApiResult>* pCallbackResults = nullptr)
+        {
+            ra::api::AwardAchievement::Request request;
+            request.AchievementId = nAchievementId;
+            request.Hardcore = bHardcore;
+            request.GameHash = "HASH";
+            QueueAwardAchievement(request, [pCallbackResults](const ra::api::AwardAchievement::Response& response)
+            {
+                if (pCallbackResults)
+                    pCallbackResults->push_back(response.Result);
+            });
+        }
+
+        void QueueEntry(unsigned int nLeaderboardId, unsigned int nScore)
+        {
+            ra::api::SubmitLeaderboardEntry::Request request;
+            request.LeaderboardId = nLeaderboardId;
+            request.Score = nScore;
+            request.GameHash = "HASH";
+            QueueSubmitLeaderboardEntry(request, [](const ra::api::SubmitLeaderboardEntry::Response&) {});
+        }
+
+        const std::string& GetStoredData() const
+        {
+            return mockStorage.GetStoredData(StorageItemType::PendingSubmissions, L"User");
+        }
+
+        void MockStoredData(const std::string& sContents)
+        {
+            mockStorage.MockStoredData(StorageItemType::PendingSubmissions, L"User", sContents);
+        }
+
+        std::chrono::milliseconds ApplyJitter(std::chrono::milliseconds tDelay) const noexcept override
+        {
+            return tDelay;
+        }
+
+        std::vector<std::string> vRequests;
+        std::vector<std::chrono::milliseconds> vTimeouts;
+        std::string sStoredDataWhenSent;
+        std::chrono::milliseconds tRequestDuration{ 0 };
+        std::string sSwitchUserDuringRequest;
+
+    private:
+        ApiResult NextResult() noexcept
+        {
+            if (m_nResultIndex < m_vResults.size())
+                return m_vResults.at(m_nResultIndex++);
+
+            return ApiResult::Success;
+        }
+
+        std::vector<ApiResult> m_vResults;
+        size_t m_nResultIndex = 0;
+    };
+
+public:
+    TEST_METHOD(TestQueueAwardAchievement)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({});
+        queue.Initialize("User");
+
+        std::vector<ApiResult> vCallbackResults;
+        queue.QueueAward(1234U, true, &vCallbackResults);
+
+        // request should not be written or sent on the calling thread
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+        Assert::AreEqual({ 1U }, queue.PendingCount());
+        Assert::AreEqual({ 0U }, queue.vRequests.size());
+        Assert::AreEqual({ 1U }, queue.mockThreadPool.PendingTasks());
+
+        queue.mockClock.AdvanceTime(std::chrono::milliseconds(200));
+        queue.mockThreadPool.ExecuteNextTask();
+
+        // request should be persisted before it's sent
+        Assert::AreEqual(std::string("A:1234:1:HASH\n"), queue.sStoredDataWhenSent);
+        Assert::AreEqual({ 1U }, queue.vRequests.size());
+        Assert::AreEqual(std::string("A:1234:1:HASH"), queue.vRequests.at(0));
+        Assert::AreEqual(std::chrono::milliseconds(0), queue.vTimeouts.at(0));
+        Assert::AreEqual({ 1U }, vCallbackResults.size());
+        Assert::AreEqual(ApiResult::Success, vCallbackResults.at(0));
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+
+        const auto pStatistics = queue.GetStatistics();
+        Assert::AreEqual(1U, pStatistics.Queued);
+        Assert::AreEqual(1U, pStatistics.Submitted);
+        Assert::AreEqual(1U, pStatistics.Succeeded);
+        Assert::AreEqual(0U, pStatistics.Failed);
+        Assert::AreEqual(0U, pStatistics.Retried);
+        Assert::AreEqual(200LL, static_cast<long long>(pStatistics.MaxLatency.count()));
+    }
+
+    TEST_METHOD(TestQueueAwardAchievementError)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Error });
+        queue.Initialize("User");
+
+        std::vector<ApiResult> vCallbackResults;
+        queue.QueueAward(1234U, false, &vCallbackResults);
+        queue.mockThreadPool.ExecuteNextTask();
+
+        // errors are reported to the caller and not retried
+        Assert::AreEqual({ 1U }, vCallbackResults.size());
+        Assert::AreEqual(ApiResult::Error, vCallbackResults.at(0));
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual({ 0U }, queue.mockThreadPool.PendingTasks());
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+        Assert::AreEqual(1U, queue.GetStatistics().Failed);
+    }
+
+    TEST_METHOD(TestRetryWithBackoff)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete, ApiResult::Incomplete });
+        queue.Initialize("User");
+
+        std::vector<ApiResult> vCallbackResults;
+        queue.QueueAward(1234U, true, &vCallbackResults);
+
+        // first attempt fails, retry in 500ms
+        queue.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 1U }, queue.vRequests.size());
+        Assert::AreEqual({ 0U }, vCallbackResults.size());
+        Assert::AreEqual({ 1U }, queue.mockThreadPool.PendingTasks());
+        Assert::AreEqual(std::chrono::milliseconds(500), queue.mockThreadPool.NextTaskDelay());
+        Assert::AreEqual(std::string("A:1234:1:HASH\n"), queue.GetStoredData());
+
+        // second attempt fails, retry in 1000ms
+        queue.mockClock.AdvanceTime(std::chrono::milliseconds(500));
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::AreEqual({ 2U }, queue.vRequests.size());
+        Assert::AreEqual({ 0U }, vCallbackResults.size());
+        Assert::AreEqual(std::chrono::milliseconds(1000), queue.mockThreadPool.NextTaskDelay());
+
+        // third attempt succeeds
+        queue.mockClock.AdvanceTime(std::chrono::milliseconds(1000));
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(1000));
+        Assert::AreEqual({ 3U }, queue.vRequests.size());
+        Assert::AreEqual({ 1U }, vCallbackResults.size());
+        Assert::AreEqual(ApiResult::Success, vCallbackResults.at(0));
+        Assert::AreEqual({ 0U }, queue.mockThreadPool.PendingTasks());
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+
+        const auto pStatistics = queue.GetStatistics();
+        Assert::AreEqual(3U, pStatistics.Submitted);
+        Assert::AreEqual(1U, pStatistics.Succeeded);
+        Assert::AreEqual(2U, pStatistics.Retried);
+        Assert::AreEqual(1500LL, static_cast<long long>(pStatistics.MaxLatency.count()));
+    }
+
+    TEST_METHOD(TestRetryMaxDelay)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults(std::vector<ApiResult>(100, ApiResult::Incomplete));
+
+        queue.QueueAward(1234U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+        for (int i = 0; i < 50; i++)
+            queue.mockThreadPool.AdvanceTime(queue.mockThreadPool.NextTaskDelay());
+
+        Assert::AreEqual(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::minutes(2)),
+                         queue.mockThreadPool.NextTaskDelay());
+    }
+
+    TEST_METHOD(TestBackoffResetAfterSuccess)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete, ApiResult::Incomplete, ApiResult::Success, ApiResult::Incomplete });
+
+        queue.QueueAward(1U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(1000));
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+
+        queue.QueueAward(2U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(std::chrono::milliseconds(500), queue.mockThreadPool.NextTaskDelay());
+    }
+
+    TEST_METHOD(TestQueueWhileWaitingForRetry)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete });
+        queue.Initialize("User");
+
+        queue.QueueAward(1U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 1U }, queue.vRequests.size());
+
+        // new items should wait for the retry instead of immediately hitting the server, but should still be persisted
+        queue.QueueAward(2U, true);
+        queue.QueueEntry(3U, 500U);
+        Assert::AreEqual({ 2U }, queue.mockThreadPool.PendingTasks());
+        queue.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 1U }, queue.vRequests.size());
+        Assert::AreEqual({ 1U }, queue.mockThreadPool.PendingTasks());
+        Assert::AreEqual(std::string("A:1:1:HASH\nA:2:1:HASH\nL:3:500:HASH\n"), queue.GetStoredData());
+
+        // retry should send everything in order
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::AreEqual({ 4U }, queue.vRequests.size());
+        Assert::AreEqual(std::string("A:1:1:HASH"), queue.vRequests.at(1));
+        Assert::AreEqual(std::string("A:2:1:HASH"), queue.vRequests.at(2));
+        Assert::AreEqual(std::string("L:3:500:HASH"), queue.vRequests.at(3));
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+    }
+
+    TEST_METHOD(TestCoalesceAwards)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete });
+
+        std::vector<ApiResult> vCallbackResults;
+        queue.QueueAward(1U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+
+        // achievement 2 unlocked in softcore, then hardcore. only the hardcore unlock should be sent
+        queue.QueueAward(2U, false, &vCallbackResults);
+        queue.QueueAward(2U, true, &vCallbackResults);
+        Assert::AreEqual({ 2U }, queue.PendingCount());
+
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::AreEqual({ 3U }, queue.vRequests.size());
+        Assert::AreEqual(std::string("A:2:1:HASH"), queue.vRequests.at(2));
+
+        // both callers should be notified
+        Assert::AreEqual({ 2U }, vCallbackResults.size());
+        Assert::AreEqual(ApiResult::Success, vCallbackResults.at(0));
+        Assert::AreEqual(ApiResult::Success, vCallbackResults.at(1));
+
+        const auto pStatistics = queue.GetStatistics();
+        Assert::AreEqual(3U, pStatistics.Queued);
+        Assert::AreEqual(1U, pStatistics.Coalesced);
+        Assert::AreEqual(3U, pStatistics.Submitted);
+    }
+
+    TEST_METHOD(TestCoalesceLeaderboardEntries)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete });
+
+        queue.QueueAward(1U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+
+        // identical entries are merged, different scores are not
+        queue.QueueEntry(3U, 500U);
+        queue.QueueEntry(3U, 500U);
+        queue.QueueEntry(3U, 700U);
+        Assert::AreEqual({ 3U }, queue.PendingCount());
+
+        queue.mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::AreEqual({ 4U }, queue.vRequests.size());
+        Assert::AreEqual(std::string("L:3:500:HASH"), queue.vRequests.at(2));
+        Assert::AreEqual(std::string("L:3:700:HASH"), queue.vRequests.at(3));
+    }
+
+    TEST_METHOD(TestInitializeRestoresPendingItems)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({});
+        queue.MockStoredData("A:1234:1:HASH\nL:55:1000:HASH2\nX:1:1:HASH\nA:abc:1:HASH\nA:4321:0:HASH\n");
+
+        queue.Initialize("User");
+        Assert::AreEqual({ 3U }, queue.PendingCount());
+        Assert::AreEqual({ 1U }, queue.mockThreadPool.PendingTasks());
+
+        queue.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 3U }, queue.vRequests.size());
+        Assert::AreEqual(std::string("A:1234:1:HASH"), queue.vRequests.at(0));
+        Assert::AreEqual(std::string("L:55:1000:HASH2"), queue.vRequests.at(1));
+        Assert::AreEqual(std::string("A:4321:0:HASH"), queue.vRequests.at(2));
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+    }
+
+    TEST_METHOD(TestInitializeNoPendingItems)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({});
+
+        queue.Initialize("User");
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual({ 0U }, queue.mockThreadPool.PendingTasks());
+    }
+
+    TEST_METHOD(TestSwitchUserWhileItemInFlight)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete });
+        queue.Initialize("User");
+        queue.QueueAward(1234U, true);
+
+        // another user logs in while the unlock is being sent, and the unlock could not be sent
+        queue.sSwitchUserDuringRequest = "User2";
+        queue.mockThreadPool.ExecuteNextTask();
+
+        // logging in started another task to process the queue. it has nothing to do.
+        queue.mockThreadPool.ExecuteNextTask();
+
+        // the unlock should not be retried with the new user's credentials or written to their file
+        Assert::AreEqual({ 0U }, queue.mockThreadPool.PendingTasks());
+        Assert::AreEqual({ 1U }, queue.vRequests.size());
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual(std::string(), queue.mockStorage.GetStoredData(StorageItemType::PendingSubmissions, L"User2"));
+
+        // it's still persisted for the previous user
+        Assert::AreEqual(std::string("A:1234:1:HASH\n"), queue.GetStoredData());
+
+        // items for the new user are sent normally
+        queue.QueueAward(5678U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 2U }, queue.vRequests.size());
+        Assert::AreEqual(std::string("A:5678:1:HASH"), queue.vRequests.at(1));
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual(std::string("A:1234:1:HASH\n"), queue.GetStoredData());
+    }
+
+    TEST_METHOD(TestFlush)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({ ApiResult::Incomplete });
+        queue.Initialize("User");
+
+        queue.QueueAward(1U, true);
+        queue.mockThreadPool.ExecuteNextTask();
+        queue.QueueAward(2U, true);
+        Assert::AreEqual({ 2U }, queue.PendingCount());
+
+        // flush should ignore the backoff delay
+        queue.Flush(std::chrono::seconds(5));
+        Assert::AreEqual({ 3U }, queue.vRequests.size());
+        Assert::AreEqual({ 0U }, queue.PendingCount());
+        Assert::AreEqual(std::string(), queue.GetStoredData());
+    }
+
+    TEST_METHOD(TestFlushServerUnavailable)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults(std::vector<ApiResult>(10, ApiResult::Incomplete));
+        queue.Initialize("User");
+
+        queue.QueueAward(1U, true);
+        queue.QueueAward(2U, true);
+
+        // flush should stop at the first failure and leave everything persisted for the next session
+        queue.Flush(std::chrono::seconds(5));
+        Assert::AreEqual({ 1U }, queue.vRequests.size());
+        Assert::AreEqual({ 2U }, queue.PendingCount());
+        Assert::AreEqual(std::string("A:1:1:HASH\nA:2:1:HASH\n"), queue.GetStoredData());
+    }
+
+    TEST_METHOD(TestFlushDeadline)
+    {
+        SubmissionQueueHarness queue;
+        queue.MockResults({});
+        queue.Initialize("User");
+        queue.tRequestDuration = std::chrono::seconds(3);
+
+        queue.QueueAward(1U, true);
+        queue.QueueAward(2U, true);
+        queue.QueueAward(3U, true);
+
+        // each request should only be allowed the time remaining before the deadline
+        queue.Flush(std::chrono::seconds(5));
+        Assert::AreEqual({ 2U }, queue.vTimeouts.size());
+        Assert::AreEqual(std::chrono::milliseconds(5000), queue.vTimeouts.at(0));
+        Assert::AreEqual(std::chrono::milliseconds(2000), queue.vTimeouts.at(1));
+
+        // the deadline passed before the third item could be sent
+        Assert::AreEqual({ 1U }, queue.PendingCount());
+        Assert::AreEqual(std::string("A:3:1:HASH\n"), queue.GetStoredData());
+    }
+};
+
+} // namespace tests
+} // namespace data
+} // namespace ra
@@ -38,6 +38,8 @@ public:
 
     unsigned int GetNumBackgroundThreads() const noexcept override { return m_nBackgroundThreads; }
 
+    std::chrono::microseconds GetFrameBudget() const noexcept override { return m_tFrameBudget; }
+
     const std::wstring& GetRomDirectory() const noexcept override { return m_sRomDirectory; }
     void SetRomDirectory(const std::wstring& sValue) override { m_sRomDirectory = sValue; }
 
@@ -99,6 +101,7 @@ private:
     std::string m_sImageHostUrl;
 
     unsigned int m_nBackgroundThreads = 0;
+    std::chrono::microseconds m_tFrameBudget{4000};
 
     std::set<Feature> m_vEnabledFeatures;
 };
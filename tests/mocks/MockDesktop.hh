@@ -6,6 +6,8 @@
 
 #include "ui\IDesktop.hh"
 
+#include "tests\mocks\MockSurface.hh"
+
 namespace ra {
 namespace ui {
 namespace mocks {
@@ -60,9 +62,9 @@ public:
         m_sLastOpenedUrl = sUrl;
     }
 
-    std::unique_ptr<ra::ui::drawing::ISurface> CaptureClientArea(const WindowViewModelBase&) const noexcept override
+    std::unique_ptr<ra::ui::drawing::ISurface> CaptureClientArea(const WindowViewModelBase&) const override
     {
-        return {};
+        return std::make_unique<ra::ui::drawing::mocks::MockSurface>(800, 600);
     }
 
     const std::string& LastOpenedUrl() const noexcept { return m_sLastOpenedUrl; }
@@ -37,6 +37,18 @@ public:
         pIter->second.insert(sName);
     }
 
+    /// <summary>
+    /// Simulates an available image that hasn't been decoded yet. References to it won't be updated until
+    /// the decode completes.
+    /// </summary>
+    void SetDecodePending(ImageType nType, const std::string& sName, bool bPending)
+    {
+        if (bPending)
+            m_vPendingDecodes[nType].insert(sName);
+        else
+            m_vPendingDecodes[nType].erase(sName);
+    }
+
     void FetchImage(_UNUSED ImageType nType, _UNUSED const std::string& sName) noexcept override
     {
 
@@ -47,18 +59,32 @@ public:
 
     }
 
-    void ReleaseReference(_UNUSED ImageReference& pImage) noexcept override
+    void ReleaseReference(ImageReference& pImage) noexcept override
     {
-
+        GSL_SUPPRESS_F6 m_vLoadedReferences.erase(&pImage);
     }
 
-    bool HasReferencedImageChanged(_UNUSED ImageReference& pImage) const noexcept override
+    bool HasReferencedImageChanged(ImageReference& pImage) const override
     {
-        return false;
+        // like the real repository, a reference only changes once: when the decoded image becomes available
+        if (m_vLoadedReferences.find(&pImage) != m_vLoadedReferences.end())
+            return false;
+
+        if (!IsImageAvailable(pImage.Type(), pImage.Name()))
+            return false;
+
+        const auto pPending = m_vPendingDecodes.find(pImage.Type());
+        if (pPending != m_vPendingDecodes.end() && pPending->second.find(pImage.Name()) != pPending->second.end())
+            return false;
+
+        m_vLoadedReferences.insert(&pImage);
+        return true;
     }
 
 private:
     std::map<ImageType, std::set<std::string>> m_vAvailableImages;
+    std::map<ImageType, std::set<std::string>> m_vPendingDecodes;
+    mutable std::set<const ImageReference*> m_vLoadedReferences;
 
     ra::services::ServiceLocator::ServiceOverride<ra::ui::IImageRepository> m_Override;
 };
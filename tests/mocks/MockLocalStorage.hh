@@ -50,6 +50,11 @@ public:
         return std::chrono::system_clock::time_point();
     }
 
+    bool Exists(StorageItemType nType, const std::wstring& sKey) override
+    {
+        return HasStoredData(nType, sKey);
+    }
+
     std::unique_ptr<TextReader> ReadText(StorageItemType nType, const std::wstring& sKey) override
     {
         const auto pText = GetText(nType, sKey, false);
@@ -76,6 +81,12 @@ public:
         return std::unique_ptr<TextWriter>(pWriter.release());
     }
 
+    bool ReplaceText(StorageItemType nType, const std::wstring& sKey, const std::string& sContents) override
+    {
+        MockStoredData(nType, sKey, sContents);
+        return true;
+    }
+
 private:
     std::string* GetText(StorageItemType nType, const std::wstring& sKey, bool bCreateIfMissing) const
     {
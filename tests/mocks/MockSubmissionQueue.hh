@@ -0,0 +1,40 @@
+#ifndef RA_DATA_MOCK_SUBMISSION_QUEUE_HH
+#define RA_DATA_MOCK_SUBMISSION_QUEUE_HH
+#pragma once
+
+#include "data\SubmissionQueue.hh"
+
+#include "services\ServiceLocator.hh"
+
+namespace ra {
+namespace data {
+namespace mocks {
+
+class MockSubmissionQueue : public SubmissionQueue
+{
+public:
+    MockSubmissionQueue() noexcept
+        : m_Override(this)
+    {
+    }
+
+    void LoadQueue() noexcept override
+    {
+    }
+
+    std::chrono::milliseconds ApplyJitter(std::chrono::milliseconds tDelay) const noexcept override
+    {
+        return tDelay;
+    }
+
+    const std::wstring& GetUsername() const noexcept { return m_sUsername; }
+
+private:
+    ra::services::ServiceLocator::ServiceOverride<ra::data::SubmissionQueue> m_Override;
+};
+
+} // namespace mocks
+} // namespace data
+} // namespace ra
+
+#endif // !RA_DATA_MOCK_SUBMISSION_QUEUE_HH
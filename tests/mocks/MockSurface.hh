@@ -33,13 +33,20 @@ public:
     void WriteText(int, int, int, Color, const std::wstring&) noexcept override {}
     void DrawImage(int, int, int, int, const ImageReference&) noexcept override {}
     void DrawImageStretched(int, int, int, int, const ImageReference&) noexcept override {}
-    void DrawSurface(int, int, const ISurface&) noexcept override {}
-    void DrawSurface(int, int, const ISurface&, int, int, int, int) noexcept override {}
+    void DrawSurface(int, int, const ISurface&) noexcept override { ++m_nDrawSurfaceCount; }
+    void DrawSurface(int, int, const ISurface&, int, int, int, int) noexcept override { ++m_nDrawSurfaceCount; }
     void SetOpacity(double) noexcept override {}
 
+    /// <summary>
+    /// Gets the number of times another surface has been drawn onto this one.
+    /// </summary>
+    int GetDrawSurfaceCount() const noexcept { return m_nDrawSurfaceCount; }
+    void ResetDrawSurfaceCount() noexcept { m_nDrawSurfaceCount = 0; }
+
 private:
     unsigned int m_nWidth;
     unsigned int m_nHeight;
+    int m_nDrawSurfaceCount = 0;
 };
 
 class MockSurfaceFactory : public ISurfaceFactory
@@ -62,8 +69,24 @@ public:
         return false;
     }
 
+    bool CopyPixels(const ISurface& pSurface, std::vector<std::uint32_t>& vPixels) const noexcept override
+    {
+        if (!m_bCanCopyPixels)
+            return false;
+
+        if (vPixels.size() != gsl::narrow_cast<size_t>(pSurface.GetWidth()) * pSurface.GetHeight())
+            return false;
+
+        // mock surfaces don't hold pixels. report them as opaque black.
+        std::fill(vPixels.begin(), vPixels.end(), 0xFF000000);
+        return true;
+    }
+
+    void SetCanCopyPixels(bool bValue) noexcept { m_bCanCopyPixels = bValue; }
+
 private:
     ra::services::ServiceLocator::ServiceOverride<ISurfaceFactory> m_Override;
+    bool m_bCanCopyPixels = false;
 };
 
 } // namespace mocks
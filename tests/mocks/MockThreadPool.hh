@@ -19,14 +19,31 @@ public:
     {
     }
 
-    void RunAsync(std::function<void()>&& f) override
+    void RunAsync(std::function<void()>&& f,
+                  [[maybe_unused]] TaskPriority /*nPriority*/ = TaskPriority::Interactive) override
     {
         m_vTasks.emplace(f);
     }
 
-    void ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f) override
+    ScheduledTaskId ScheduleAsync(std::chrono::milliseconds nDelay, std::function<void()>&& f,
+                                  [[maybe_unused]] TaskPriority /*nPriority*/ = TaskPriority::Interactive) override
     {
-        m_vDelayedTasks.emplace_back(nDelay, f);
+        m_vDelayedTasks.emplace_back(++m_nLastScheduledTaskId, nDelay, f);
+        return m_nLastScheduledTaskId;
+    }
+
+    bool CancelScheduledTask(ScheduledTaskId nId) override
+    {
+        for (auto pIter = m_vDelayedTasks.begin(); pIter != m_vDelayedTasks.end(); ++pIter)
+        {
+            if (pIter->nId == nId)
+            {
+                m_vDelayedTasks.erase(pIter);
+                return true;
+            }
+        }
+
+        return false;
     }
 
     void AdvanceTime(std::chrono::milliseconds nDuration)
@@ -84,23 +101,27 @@ public:
         fTask();
     }
 
-    void Shutdown([[maybe_unused]] bool /*bWait*/) noexcept override {}
+    void Shutdown([[maybe_unused]] bool /*bWait*/) noexcept override { m_bShutdownRequested = true; }
 
-    bool IsShutdownRequested() const noexcept override { return false; }
+    bool IsShutdownRequested() const noexcept override { return m_bShutdownRequested; }
 
 private:
     ra::services::ServiceLocator::ServiceOverride<ra::services::IThreadPool> m_Override;
 
     std::queue<std::function<void()>> m_vTasks;
+    bool m_bShutdownRequested = false;
 
     struct DelayedTask
     {
-        DelayedTask(std::chrono::milliseconds nDelay, std::function<void()> fTask) : nDelay(nDelay), fTask(fTask) {};
+        DelayedTask(ScheduledTaskId nId, std::chrono::milliseconds nDelay, std::function<void()> fTask) :
+            nId(nId), nDelay(nDelay), fTask(fTask) {};
 
+        ScheduledTaskId nId;
         std::chrono::milliseconds nDelay;
         std::function<void()> fTask;
     };
     std::vector<DelayedTask> m_vDelayedTasks;
+    ScheduledTaskId m_nLastScheduledTaskId = 0;
 };
 
 } // namespace mocks
@@ -2,12 +2,14 @@
 
 #include "tests\mocks\MockClock.hh"
 #include "tests\mocks\MockFileSystem.hh"
+#include "tests\mocks\MockThreadPool.hh"
 #include "tests\RA_UnitTestHelpers.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 using ra::services::mocks::MockClock;
 using ra::services::mocks::MockFileSystem;
+using ra::services::mocks::MockThreadPool;
 
 namespace ra {
 namespace services {
@@ -35,10 +37,26 @@ private:
         mockFileSystem.MockLastModified(sFile, tExpire);
     }
 
+    static void RunCacheMaintenance(FileLocalStorage& storage, MockThreadPool& mockThreadPool)
+    {
+        storage.ScheduleCacheMaintenance();
+        mockThreadPool.AdvanceTime(FileLocalStorage::SWEEP_DELAY);
+        while (mockThreadPool.PendingTasks() > 0)
+            mockThreadPool.ExecuteNextTask();
+    }
+
+    static std::string GetSweepMarker(std::chrono::system_clock::time_point tWhen)
+    {
+        return std::to_string(std::chrono::system_clock::to_time_t(tWhen));
+    }
+
+    const std::wstring mockSweepMarkerFileName = L".\\RACache\\LastCacheSweep.txt";
+
 public:
     TEST_METHOD(TestExpiration)
     {
         MockClock mockClock;
+        MockThreadPool mockThreadPool;
         const auto tNotExpire = mockClock.Now() - std::chrono::hours(24 * 30 - 1);
         const auto tExpire = mockClock.Now() - std::chrono::hours(24 * 30 + 1);
 
@@ -75,7 +93,14 @@ public:
 
         FileLocalStorage storage(mockFileSystem);
 
+        // files should not be expired during startup
         std::vector<std::wstring> vFiles;
+        Assert::AreEqual({ 4U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
+        Assert::AreEqual({ 0U }, mockThreadPool.PendingTasks());
+
+        RunCacheMaintenance(storage, mockThreadPool);
+
+        vFiles.clear();
         Assert::AreEqual({ 2U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
         Assert::IsTrue(std::find(vFiles.begin(), vFiles.end(), L"00002.png") != vFiles.end());
         Assert::IsTrue(std::find(vFiles.begin(), vFiles.end(), L"00003.png") != vFiles.end());
@@ -101,9 +126,93 @@ public:
 
         // files in the cache root should never be deleted
         vFiles.clear();
-        Assert::AreEqual({ 2U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\", vFiles));
+        Assert::AreEqual({ 3U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\", vFiles));
         Assert::IsTrue(std::find(vFiles.begin(), vFiles.end(), L"User-history.txt") != vFiles.end());
         Assert::IsTrue(std::find(vFiles.begin(), vFiles.end(), L"User2-history.txt") != vFiles.end());
+
+        // the time of the sweep should be recorded
+        Assert::AreEqual(GetSweepMarker(mockClock.Now()), mockFileSystem.GetFileContents(mockSweepMarkerFileName));
+    }
+
+    TEST_METHOD(TestExpirationRecentlySwept)
+    {
+        MockClock mockClock;
+        MockThreadPool mockThreadPool;
+        MockFileSystem mockFileSystem;
+        mockFileSystem.CreateDirectory(L".\\RACache\\Badge\\");
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\00000.png", mockClock.Now() - std::chrono::hours(24 * 31));
+        mockFileSystem.MockFile(mockSweepMarkerFileName, GetSweepMarker(mockClock.Now() - std::chrono::hours(23)));
+
+        FileLocalStorage storage(mockFileSystem);
+        RunCacheMaintenance(storage, mockThreadPool);
+
+        // swept less than a day ago, file should not have been expired
+        std::vector<std::wstring> vFiles;
+        Assert::AreEqual({ 1U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
+
+        mockFileSystem.MockFile(mockSweepMarkerFileName, GetSweepMarker(mockClock.Now() - std::chrono::hours(25)));
+        RunCacheMaintenance(storage, mockThreadPool);
+
+        vFiles.clear();
+        Assert::AreEqual({ 0U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
+        Assert::AreEqual(GetSweepMarker(mockClock.Now()), mockFileSystem.GetFileContents(mockSweepMarkerFileName));
+    }
+
+    TEST_METHOD(TestExpirationIncremental)
+    {
+        MockClock mockClock;
+        MockThreadPool mockThreadPool;
+        MockFileSystem mockFileSystem;
+        mockFileSystem.CreateDirectory(L".\\RACache\\Badge\\");
+        const auto tExpire = mockClock.Now() - std::chrono::hours(24 * 31);
+        for (size_t i = 0; i < FileLocalStorage::FILES_PER_TASK + 10; ++i)
+            SetupExpiration(mockFileSystem, ra::StringPrintf(L".\\RACache\\Badge\\%zu.png", i), tExpire);
+
+        FileLocalStorage storage(mockFileSystem);
+        storage.ScheduleCacheMaintenance();
+        mockThreadPool.AdvanceTime(FileLocalStorage::SWEEP_DELAY);
+
+        // first pass should only process part of the directory, and queue another pass
+        std::vector<std::wstring> vFiles;
+        Assert::IsTrue(mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles) > 0);
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+
+        while (mockThreadPool.PendingTasks() > 0)
+            mockThreadPool.ExecuteNextTask();
+
+        vFiles.clear();
+        Assert::AreEqual({ 0U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
+    }
+
+    TEST_METHOD(TestSizeLimit)
+    {
+        MockClock mockClock;
+        MockThreadPool mockThreadPool;
+        MockFileSystem mockFileSystem;
+        mockFileSystem.CreateDirectory(L".\\RACache\\Badge\\");
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\00000.png", mockClock.Now() - std::chrono::hours(2));
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\00001.png", mockClock.Now() - std::chrono::hours(3));
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\00002.png", mockClock.Now() - std::chrono::hours(1));
+        mockFileSystem.MockFileSize(L".\\RACache\\Badge\\00000.png", FileLocalStorage::MAX_CACHE_SIZE / 2);
+        mockFileSystem.MockFileSize(L".\\RACache\\Badge\\00001.png", FileLocalStorage::MAX_CACHE_SIZE / 2);
+        mockFileSystem.MockFileSize(L".\\RACache\\Badge\\00002.png", FileLocalStorage::MAX_CACHE_SIZE / 2);
+
+        mockFileSystem.CreateDirectory(L".\\RACache\\Data\\");
+        SetupExpiration(mockFileSystem, L".\\RACache\\Data\\123-User.txt", mockClock.Now() - std::chrono::hours(4));
+        mockFileSystem.MockFileSize(L".\\RACache\\Data\\123-User.txt", FileLocalStorage::MAX_CACHE_SIZE);
+
+        FileLocalStorage storage(mockFileSystem);
+        RunCacheMaintenance(storage, mockThreadPool);
+
+        // least recently updated badge should be discarded to get back under the limit
+        std::vector<std::wstring> vFiles;
+        Assert::AreEqual({ 2U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
+        Assert::IsTrue(std::find(vFiles.begin(), vFiles.end(), L"00000.png") != vFiles.end());
+        Assert::IsTrue(std::find(vFiles.begin(), vFiles.end(), L"00002.png") != vFiles.end());
+
+        // user files are not counted against the limit and never deleted
+        vFiles.clear();
+        Assert::AreEqual({ 1U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Data\\", vFiles));
     }
 
     TEST_METHOD(TestFileNames)
@@ -117,6 +226,9 @@ public:
         Assert::AreEqual(storage.GetPath(ra::services::StorageItemType::Badge, L"12345"), std::wstring(L".\\RACache\\Badge\\12345.png"));
         Assert::AreEqual(storage.GetPath(ra::services::StorageItemType::UserPic, L"12345"), std::wstring(L".\\RACache\\UserPic\\12345.png"));
         Assert::AreEqual(storage.GetPath(ra::services::StorageItemType::Bookmarks, L"12345"), std::wstring(L".\\RACache\\Bookmarks\\12345-Bookmarks.json"));
+        Assert::AreEqual(storage.GetPath(ra::services::StorageItemType::PendingSubmissions, L"User"), std::wstring(L".\\RACache\\User-pending.txt"));
+        Assert::AreEqual(storage.GetPath(ra::services::StorageItemType::PerformanceCounters, L"RATest"), std::wstring(L".\\RACache\\RATest-performance.json"));
+        Assert::AreEqual(storage.GetPath(ra::services::StorageItemType::Trace, L"RATest"), std::wstring(L".\\RACache\\RATest-trace.json"));
     }
 
     TEST_METHOD(TestReadTextNonExistant)
@@ -156,6 +268,139 @@ public:
         pData->Write("{\"Key\": 1}");
         Assert::AreEqual(std::string("{\"Key\": 1}"), mockFileSystem.GetFileContents(L".\\RACache\\Data\\12345.json"));
     }
+
+    TEST_METHOD(TestReplaceText)
+    {
+        MockFileSystem mockFileSystem;
+        FileLocalStorage storage(mockFileSystem);
+
+        mockFileSystem.MockFile(L".\\RACache\\User-history.txt", "1:2:3:ab\n4:5:6:cd\n");
+
+        Assert::IsTrue(storage.ReplaceText(ra::services::StorageItemType::SessionStats, L"User", "1:2:9:ef\n"));
+        Assert::AreEqual(std::string("1:2:9:ef\n"), mockFileSystem.GetFileContents(L".\\RACache\\User-history.txt"));
+
+        // the temporary file should have been renamed
+        Assert::AreEqual(static_cast<int>(mockFileSystem.GetFileSize(L".\\RACache\\User-history.txt.tmp")), -1);
+    }
+
+    TEST_METHOD(TestExists)
+    {
+        MockFileSystem mockFileSystem;
+        FileLocalStorage storage(mockFileSystem);
+
+        Assert::IsFalse(storage.Exists(ra::services::StorageItemType::Badge, L"12345"));
+
+        mockFileSystem.MockFile(L".\\RACache\\Badge\\12345.png", "PNG");
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::Badge, L"12345"));
+    }
+
+private:
+    static std::string ReadAll(TextReader& pReader)
+    {
+        std::string sData;
+        sData.resize(pReader.GetSize());
+        uint8_t* pData;
+        GSL_SUPPRESS_TYPE1 pData = reinterpret_cast<uint8_t*>(sData.data());
+        sData.resize(pReader.GetBytes(pData, sData.length()));
+        return sData;
+    }
+
+    const std::wstring mockImagePackFileName = L".\\RACache\\Images.pack";
+
+public:
+    TEST_METHOD(TestImagePackWriteRead)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        FileLocalStorage storage(mockFileSystem);
+        Assert::IsTrue(storage.EnableImagePack());
+
+        const std::string sPNG("\x89PNG\0\x1A\n", 7);
+        {
+            auto pWriter = storage.WriteText(ra::services::StorageItemType::Badge, L"12345");
+            Assert::IsFalse(pWriter == nullptr);
+            pWriter->Write(sPNG);
+        }
+
+        // data is written to the pack, not an individual file
+        Assert::AreEqual({ -1 }, mockFileSystem.GetFileSize(L".\\RACache\\Badge\\12345.png"));
+        Assert::IsTrue(mockFileSystem.GetFileSize(mockImagePackFileName) > 0);
+
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::Badge, L"12345"));
+        Assert::IsFalse(storage.Exists(ra::services::StorageItemType::UserPic, L"12345"));
+        Assert::AreEqual(std::chrono::system_clock::to_time_t(mockClock.Now()),
+            std::chrono::system_clock::to_time_t(storage.GetLastModified(ra::services::StorageItemType::Badge, L"12345")));
+
+        auto pReader = storage.ReadText(ra::services::StorageItemType::Badge, L"12345");
+        Assert::IsFalse(pReader == nullptr);
+        Assert::AreEqual(sPNG, ReadAll(*pReader));
+
+        Assert::IsTrue(storage.ReadText(ra::services::StorageItemType::UserPic, L"12345") == nullptr);
+
+        // other types are still stored as individual files
+        storage.WriteText(ra::services::StorageItemType::GameData, L"12345")->Write("{}");
+        Assert::AreEqual(std::string("{}"), mockFileSystem.GetFileContents(L".\\RACache\\Data\\12345.json"));
+    }
+
+    TEST_METHOD(TestImagePackMigratesOnRead)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        const auto tModified = mockClock.Now() - std::chrono::hours(48);
+        mockFileSystem.MockFile(L".\\RACache\\UserPic\\User.png", "PNG");
+        mockFileSystem.MockLastModified(L".\\RACache\\UserPic\\User.png", tModified);
+
+        FileLocalStorage storage(mockFileSystem);
+        Assert::IsTrue(storage.EnableImagePack());
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::UserPic, L"User"));
+
+        auto pReader = storage.ReadText(ra::services::StorageItemType::UserPic, L"User");
+        Assert::IsFalse(pReader == nullptr);
+        Assert::AreEqual(std::string("PNG"), ReadAll(*pReader));
+
+        // file is moved into the pack, keeping its timestamp
+        Assert::AreEqual({ -1 }, mockFileSystem.GetFileSize(L".\\RACache\\UserPic\\User.png"));
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::UserPic, L"User"));
+        Assert::AreEqual(std::chrono::system_clock::to_time_t(tModified),
+            std::chrono::system_clock::to_time_t(storage.GetLastModified(ra::services::StorageItemType::UserPic, L"User")));
+    }
+
+    TEST_METHOD(TestImagePackSweep)
+    {
+        MockClock mockClock;
+        MockThreadPool mockThreadPool;
+        MockFileSystem mockFileSystem;
+        FileLocalStorage storage(mockFileSystem);
+        Assert::IsTrue(storage.EnableImagePack());
+
+        storage.WriteText(ra::services::StorageItemType::Badge, L"00003")->Write("old");
+        mockClock.AdvanceTime(std::chrono::hours(24 * 30 + 1));
+        storage.WriteText(ra::services::StorageItemType::Badge, L"00004")->Write("new");
+
+        const auto tNotExpire = mockClock.Now() - std::chrono::hours(24 * 30 - 1);
+        const auto tExpire = mockClock.Now() - std::chrono::hours(24 * 30 + 1);
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\00001.png", tExpire);
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\00002.png", tNotExpire);
+        SetupExpiration(mockFileSystem, L".\\RACache\\Badge\\iGame.png", tNotExpire);
+        SetupExpiration(mockFileSystem, L".\\RACache\\UserPic\\User.png", tNotExpire);
+
+        RunCacheMaintenance(storage, mockThreadPool);
+
+        // expired file is deleted, unexpired images are moved into the pack, icons are left alone
+        std::vector<std::wstring> vFiles;
+        Assert::AreEqual({ 1U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\Badge\\", vFiles));
+        Assert::AreEqual(std::wstring(L"iGame.png"), vFiles.front());
+        vFiles.clear();
+        Assert::AreEqual({ 0U }, mockFileSystem.GetFilesInDirectory(L".\\RACache\\UserPic\\", vFiles));
+
+        Assert::IsFalse(storage.Exists(ra::services::StorageItemType::Badge, L"00001"));
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::Badge, L"00002"));
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::UserPic, L"User"));
+
+        // expired pack entry is removed
+        Assert::IsFalse(storage.Exists(ra::services::StorageItemType::Badge, L"00003"));
+        Assert::IsTrue(storage.Exists(ra::services::StorageItemType::Badge, L"00004"));
+    }
 };
 
 } // namespace tests
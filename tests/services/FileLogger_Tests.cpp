@@ -2,12 +2,14 @@
 
 #include "tests\mocks\MockClock.hh"
 #include "tests\mocks\MockFileSystem.hh"
+#include "tests\mocks\MockThreadPool.hh"
 #include "tests\RA_UnitTestHelpers.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 using ra::services::mocks::MockClock;
 using ra::services::mocks::MockFileSystem;
+using ra::services::mocks::MockThreadPool;
 
 namespace ra {
 namespace services {
@@ -77,6 +79,117 @@ public:
         Assert::AreEqual(static_cast<int>(mockFileSystem.GetFileSize(mockLogFileName)), 37);
         Assert::AreEqual(static_cast<int>(mockFileSystem.GetFileSize(mockOldLogFileName)), 1100000);
     }
+
+    TEST_METHOD(TestLogMessageQueued)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        FileLogger logger(mockFileSystem);
+        MockThreadPool mockThreadPool;
+
+        logger.LogMessage(LogLevel::Info, "This is a message.");
+        logger.LogMessage(LogLevel::Warn, "This is another message.");
+        mockClock.AdvanceTime(std::chrono::milliseconds(375));
+        logger.LogMessage(LogLevel::Error, "This is the third message.");
+        logger.Flush();
+
+        Assert::AreEqual(std::string("\n"
+            "220843.000|INFO| This is a message.\n"
+            "220843.000|WARN| This is another message.\n"
+            "220843.375|ERR | This is the third message.\n"), mockFileSystem.GetFileContents(mockLogFileName));
+    }
+
+    TEST_METHOD(TestLogErrorWrittenImmediately)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        FileLogger logger(mockFileSystem);
+        MockThreadPool mockThreadPool;
+
+        logger.LogMessage(LogLevel::Info, "This is a message.");
+        mockClock.AdvanceTime(std::chrono::milliseconds(375));
+        logger.LogMessage(LogLevel::Error, "This is an error.");
+
+        // errors (and anything queued before them) are written without waiting for the writer thread
+        Assert::AreEqual(std::string("\n"
+            "220843.000|INFO| This is a message.\n"
+            "220843.375|ERR | This is an error.\n"), mockFileSystem.GetFileContents(mockLogFileName));
+
+        logger.Shutdown();
+    }
+
+    TEST_METHOD(TestLogMessageAfterShutdown)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        FileLogger logger(mockFileSystem);
+        MockThreadPool mockThreadPool;
+
+        logger.LogMessage(LogLevel::Info, "This is a message.");
+        logger.Shutdown();
+        Assert::AreEqual(std::string("\n"
+            "220843.000|INFO| This is a message.\n"), mockFileSystem.GetFileContents(mockLogFileName));
+
+        // after shutdown, messages should be written immediately
+        logger.LogMessage(LogLevel::Info, "This is another message.");
+        Assert::AreEqual(std::string("\n"
+            "220843.000|INFO| This is a message.\n"
+            "220843.000|INFO| This is another message.\n"), mockFileSystem.GetFileContents(mockLogFileName));
+    }
+
+    TEST_METHOD(TestDestroyWithoutShutdown)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        MockThreadPool mockThreadPool;
+
+        {
+            FileLogger logger(mockFileSystem);
+            logger.LogMessage(LogLevel::Info, "This is a message.");
+        }
+
+        // the writer thread isn't joined, but anything queued should still be written
+        Assert::AreEqual(std::string("\n"
+            "220843.000|INFO| This is a message.\n"), mockFileSystem.GetFileContents(mockLogFileName));
+    }
+
+    TEST_METHOD(TestLogMessageTruncated)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        FileLogger logger(mockFileSystem);
+
+        logger.LogMessage(LogLevel::Info, std::string(FileLogger::MAX_MESSAGE_SIZE + 904, 'A'));
+
+        Assert::AreEqual(std::string("\n220843.000|INFO| ") + std::string(FileLogger::MAX_MESSAGE_SIZE, 'A') +
+            "... (904 bytes truncated)\n", mockFileSystem.GetFileContents(mockLogFileName));
+    }
+
+    TEST_METHOD(TestRotateWhileRunning)
+    {
+        MockClock mockClock;
+        MockFileSystem mockFileSystem;
+        mockFileSystem.MockFile(mockLogFileName, "Test");
+        mockFileSystem.MockFileSize(mockLogFileName, FileLogger::MAX_FILE_SIZE - 40);
+
+        FileLogger logger(mockFileSystem);
+        Assert::AreEqual(static_cast<int>(mockFileSystem.GetFileSize(mockOldLogFileName)), -1);
+
+        // 3 bytes under the limit
+        logger.LogMessage(LogLevel::Info, "This is a message.");
+        Assert::AreEqual(static_cast<int>(mockFileSystem.GetFileSize(mockOldLogFileName)), -1);
+
+        // over the limit - file should be rotated
+        logger.LogMessage(LogLevel::Info, "This is another message.");
+        Assert::AreEqual(std::string("Test\n"
+            "220843.000|INFO| This is a message.\n"
+            "220843.000|INFO| This is another message.\n"), mockFileSystem.GetFileContents(mockOldLogFileName));
+        Assert::AreEqual(std::string(), mockFileSystem.GetFileContents(mockLogFileName));
+
+        logger.LogMessage(LogLevel::Info, "This is the third message.");
+        Assert::AreEqual(std::string("220843.000|INFO| This is the third message.\n"),
+                         mockFileSystem.GetFileContents(mockLogFileName));
+    }
 };
 
 } // namespace tests
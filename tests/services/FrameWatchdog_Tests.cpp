@@ -0,0 +1,132 @@
+#include "CppUnitTest.h"
+
+#include "services\FrameWatchdog.hh"
+
+#include "tests\mocks\MockClock.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using ra::services::mocks::MockClock;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(FrameWatchdog_Tests)
+{
+public:
+    TEST_METHOD(TestUnderBudget)
+    {
+        MockClock mockClock;
+        FrameWatchdog watchdog(std::chrono::microseconds(4000));
+        watchdog.RecordPhase(PerformanceCheckpoint::RuntimeProcess, std::chrono::microseconds(3000));
+        watchdog.EndFrame(std::chrono::microseconds(4000));
+
+        Assert::AreEqual(0U, watchdog.GetSlowFrameCount());
+        Assert::AreEqual({ 0U }, watchdog.GetSlowFrames().size());
+    }
+
+    TEST_METHOD(TestOverBudget)
+    {
+        MockClock mockClock;
+        FrameWatchdog watchdog(std::chrono::microseconds(4000));
+        watchdog.RecordPhase(PerformanceCheckpoint::RuntimeProcess, std::chrono::microseconds(1000));
+        watchdog.EndFrame(std::chrono::microseconds(1100));
+
+        watchdog.RecordPhase(PerformanceCheckpoint::RuntimeProcess, std::chrono::microseconds(3000));
+        watchdog.RecordPhase(PerformanceCheckpoint::RuntimeEvents, std::chrono::microseconds(200));
+        watchdog.RecordPhase(PerformanceCheckpoint::MemoryInspectorDoFrame, std::chrono::microseconds(1500));
+        watchdog.EndFrame(std::chrono::microseconds(4800));
+
+        Assert::AreEqual(1U, watchdog.GetSlowFrameCount());
+        const auto vFrames = watchdog.GetSlowFrames();
+        Assert::AreEqual({ 1U }, vFrames.size());
+
+        const auto& pFrame = vFrames.front();
+        Assert::AreEqual(2U, pFrame.nFrame);
+        Assert::AreEqual(4800LL, pFrame.tElapsed.count());
+        Assert::AreEqual(3000LL, pFrame.vPhases.at(static_cast<size_t>(PerformanceCheckpoint::RuntimeProcess)).count());
+        Assert::AreEqual(200LL, pFrame.vPhases.at(static_cast<size_t>(PerformanceCheckpoint::RuntimeEvents)).count());
+        Assert::AreEqual(0LL, pFrame.vPhases.at(static_cast<size_t>(PerformanceCheckpoint::OverlayManagerAdvanceFrame)).count());
+        Assert::AreEqual(0LL, pFrame.vPhases.at(static_cast<size_t>(PerformanceCheckpoint::MemoryBookmarksDoFrame)).count());
+        Assert::AreEqual(1500LL, pFrame.vPhases.at(static_cast<size_t>(PerformanceCheckpoint::MemoryInspectorDoFrame)).count());
+    }
+
+    TEST_METHOD(TestPhasesResetEachFrame)
+    {
+        MockClock mockClock;
+        FrameWatchdog watchdog(std::chrono::microseconds(4000));
+        watchdog.RecordPhase(PerformanceCheckpoint::RuntimeProcess, std::chrono::microseconds(3000));
+        watchdog.EndFrame(std::chrono::microseconds(3500));
+
+        // phase time from the previous frame should not be attributed to this frame
+        watchdog.RecordPhase(PerformanceCheckpoint::RuntimeEvents, std::chrono::microseconds(4500));
+        watchdog.EndFrame(std::chrono::microseconds(4600));
+
+        const auto vFrames = watchdog.GetSlowFrames();
+        Assert::AreEqual({ 1U }, vFrames.size());
+        Assert::AreEqual(0LL, vFrames.front().vPhases.at(static_cast<size_t>(PerformanceCheckpoint::RuntimeProcess)).count());
+        Assert::AreEqual(4500LL, vFrames.front().vPhases.at(static_cast<size_t>(PerformanceCheckpoint::RuntimeEvents)).count());
+    }
+
+    TEST_METHOD(TestNonFramePhaseIgnored)
+    {
+        MockClock mockClock;
+        FrameWatchdog watchdog(std::chrono::microseconds(4000));
+        Assert::IsFalse(FrameWatchdog::IsFramePhase(PerformanceCheckpoint::HttpRequest));
+        Assert::IsFalse(FrameWatchdog::IsFramePhase(PerformanceCheckpoint::Frame));
+        Assert::IsTrue(FrameWatchdog::IsFramePhase(PerformanceCheckpoint::RuntimeProcess));
+
+        watchdog.RecordPhase(PerformanceCheckpoint::HttpRequest, std::chrono::microseconds(5000));
+        watchdog.EndFrame(std::chrono::microseconds(5000));
+
+        const auto vFrames = watchdog.GetSlowFrames();
+        Assert::AreEqual({ 1U }, vFrames.size());
+        for (const auto tPhase : vFrames.front().vPhases)
+            Assert::AreEqual(0LL, tPhase.count());
+    }
+
+    TEST_METHOD(TestRingBufferKeepsMostRecent)
+    {
+        MockClock mockClock;
+        FrameWatchdog watchdog(std::chrono::microseconds(4000));
+
+        const auto nFrames = gsl::narrow_cast<unsigned int>(FrameWatchdog::MAX_SLOW_FRAMES + 6);
+        for (unsigned int i = 0; i < nFrames; ++i)
+        {
+            watchdog.EndFrame(std::chrono::microseconds(5000 + i));
+            mockClock.AdvanceTime(std::chrono::milliseconds(16));
+        }
+
+        Assert::AreEqual(nFrames, watchdog.GetSlowFrameCount());
+        const auto vFrames = watchdog.GetSlowFrames();
+        Assert::AreEqual(FrameWatchdog::MAX_SLOW_FRAMES, vFrames.size());
+        Assert::AreEqual(7U, vFrames.front().nFrame);
+        Assert::AreEqual(nFrames, vFrames.back().nFrame);
+        Assert::AreEqual(5000LL + nFrames - 1, vFrames.back().tElapsed.count());
+    }
+
+    TEST_METHOD(TestPerformanceTimer)
+    {
+        MockClock mockClock;
+        FrameWatchdog watchdog(std::chrono::microseconds(1));
+        ServiceLocator::ServiceOverride<FrameWatchdog> svcOverride(&watchdog);
+
+        {
+            PerformanceTimer tFrame(PerformanceCheckpoint::Frame);
+            {
+                PerformanceTimer tRuntime(PerformanceCheckpoint::RuntimeProcess);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+
+        const auto vFrames = watchdog.GetSlowFrames();
+        Assert::AreEqual({ 1U }, vFrames.size());
+        Assert::IsTrue(vFrames.front().tElapsed.count() >= 2000);
+        Assert::IsTrue(vFrames.front().vPhases.at(static_cast<size_t>(PerformanceCheckpoint::RuntimeProcess)).count() >= 2000);
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
@@ -42,6 +42,7 @@ public:
         Assert::AreEqual(std::string(""), request.GetQueryString());
         Assert::AreEqual(std::string(""), request.GetPostData());
         Assert::AreEqual(std::string("application/x-www-form-urlencoded"), request.GetContentType());
+        Assert::AreEqual(std::chrono::milliseconds(0), request.GetTimeout());
     }
 
     TEST_METHOD(TestRequestInitializationQueryString)
@@ -2,10 +2,12 @@
 
 #include "tests\RA_UnitTestHelpers.h"
 #include "tests\mocks\MockFileSystem.hh"
+#include "tests\mocks\MockThreadPool.hh"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 using ra::services::mocks::MockFileSystem;
+using ra::services::mocks::MockThreadPool;
 
 namespace ra {
 namespace services {
@@ -143,6 +145,107 @@ public:
         TestFeature(ra::services::Feature::PreferDecimal, "Prefer Decimal", false);
     }
 
+    TEST_METHOD(TestPerformanceCounters)
+    {
+        TestFeature(ra::services::Feature::PerformanceCounters, "Performance Counters", false);
+    }
+
+    TEST_METHOD(TestTracing)
+    {
+        TestFeature(ra::services::Feature::Tracing, "Performance Tracing", false);
+    }
+
+    TEST_METHOD(TestPackedImageCache)
+    {
+        TestFeature(ra::services::Feature::PackedImageCache, "Packed Image Cache", false);
+    }
+
+    TEST_METHOD(TestFrameBudget)
+    {
+        MockFileSystem fileSystem;
+
+        // default
+        JsonFileConfiguration config;
+        Assert::AreEqual(4000LL, config.GetFrameBudget().count());
+
+        // no value provided
+        fileSystem.MockFile(sFilename, "{}");
+        Assert::IsTrue(config.Load(sFilename));
+        Assert::AreEqual(4000LL, config.GetFrameBudget().count());
+
+        // value provided
+        fileSystem.MockFile(sFilename, "{\"Frame Budget Microseconds\":2500}");
+        Assert::IsTrue(config.Load(sFilename));
+        Assert::AreEqual(2500LL, config.GetFrameBudget().count());
+
+        // persist value
+        config.Save();
+        AssertContains(fileSystem.GetFileContents(sFilename), "\"Frame Budget Microseconds\":2500");
+    }
+
+    TEST_METHOD(TestSaveDeferred)
+    {
+        MockFileSystem fileSystem;
+        MockThreadPool threadPool;
+        fileSystem.MockFile(sFilename, "{}");
+
+        JsonFileConfiguration config;
+        Assert::IsTrue(config.Load(sFilename));
+
+        // nothing changed, nothing to write
+        config.Save();
+        Assert::AreEqual({ 0U }, threadPool.PendingTasks());
+
+        // multiple saves should be combined into a single background write
+        config.SetUsername("User");
+        config.Save();
+        config.SetApiToken("TOKEN");
+        config.Save();
+        Assert::AreEqual(std::string("{}"), fileSystem.GetFileContents(sFilename));
+        Assert::AreEqual({ 1U }, threadPool.PendingTasks());
+
+        threadPool.AdvanceTime(JsonFileConfiguration::SAVE_DELAY);
+        Assert::AreEqual({ 0U }, threadPool.PendingTasks());
+        AssertContains(fileSystem.GetFileContents(sFilename), "\"Username\":\"User\"");
+        AssertContains(fileSystem.GetFileContents(sFilename), "\"Token\":\"TOKEN\"");
+        Assert::AreEqual({ -1 }, fileSystem.GetFileSize(sFilename + L".tmp"));
+    }
+
+    TEST_METHOD(TestSaveDuringShutdown)
+    {
+        MockFileSystem fileSystem;
+        MockThreadPool threadPool;
+        fileSystem.MockFile(sFilename, "{}");
+
+        JsonFileConfiguration config;
+        Assert::IsTrue(config.Load(sFilename));
+
+        config.SetUsername("User");
+        config.Save();
+        Assert::AreEqual(std::string("{}"), fileSystem.GetFileContents(sFilename));
+
+        // once shutdown starts, queued changes should be written immediately
+        threadPool.Shutdown(false);
+        config.Save();
+        AssertContains(fileSystem.GetFileContents(sFilename), "\"Username\":\"User\"");
+
+        // the queued write should not overwrite anything
+        fileSystem.MockFile(sFilename, "{}");
+        threadPool.AdvanceTime(JsonFileConfiguration::SAVE_DELAY);
+        Assert::AreEqual(std::string("{}"), fileSystem.GetFileContents(sFilename));
+    }
+
+    TEST_METHOD(TestLoadInterruptedSave)
+    {
+        MockFileSystem fileSystem;
+        fileSystem.MockFile(sFilename + L".tmp", "{\"Username\":\"User\"}");
+
+        JsonFileConfiguration config;
+        Assert::IsTrue(config.Load(sFilename));
+        Assert::AreEqual(std::string("User"), config.GetUsername());
+        Assert::AreEqual({ -1 }, fileSystem.GetFileSize(sFilename + L".tmp"));
+    }
+
     TEST_METHOD(TestHostNameNoFile)
     {
         MockFileSystem mockFileSystem;
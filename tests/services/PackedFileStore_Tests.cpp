@@ -0,0 +1,248 @@
+#include "services\impl\PackedFileStore.hh"
+
+#include "tests\mocks\MockFileSystem.hh"
+#include "tests\RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using ra::services::mocks::MockFileSystem;
+
+namespace ra {
+namespace services {
+namespace impl {
+namespace tests {
+
+TEST_CLASS(PackedFileStore_Tests)
+{
+private:
+    const std::wstring sPackFile = L".\\RACache\\Images.pack";
+    const std::chrono::system_clock::time_point tWritten = std::chrono::system_clock::from_time_t(1600000000);
+
+    static constexpr int64_t HEADER_SIZE = 8;
+
+    static int64_t RecordSize(const std::string& sKey, const std::string& sData) noexcept
+    {
+        return 16 + gsl::narrow_cast<int64_t>(sKey.length() + sData.length());
+    }
+
+    static std::string ReadEntry(const PackedFileStore& store, const std::string& sKey)
+    {
+        std::string sData;
+        Assert::IsTrue(store.Read(sKey, sData));
+        return sData;
+    }
+
+public:
+    TEST_METHOD(TestOpenCreatesFile)
+    {
+        MockFileSystem mockFileSystem;
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        Assert::AreEqual(std::string("RAPK\x01\0\0\0", 8), mockFileSystem.GetFileContents(sPackFile));
+        Assert::AreEqual(HEADER_SIZE, store.GetFileSize());
+        Assert::AreEqual({ 0 }, store.GetWastedSize());
+        Assert::IsFalse(store.Contains("Badge/12345"));
+    }
+
+    TEST_METHOD(TestWriteRead)
+    {
+        MockFileSystem mockFileSystem;
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        const std::string sData("\x89PNG\0\x1A\n", 7);
+        store.Write("Badge/12345", sData, tWritten);
+
+        Assert::IsTrue(store.Contains("Badge/12345"));
+        Assert::IsFalse(store.Contains("Badge/12346"));
+        Assert::AreEqual(sData, ReadEntry(store, "Badge/12345"));
+        Assert::IsTrue(tWritten == store.GetLastModified("Badge/12345"));
+
+        const auto nExpectedSize = HEADER_SIZE + RecordSize("Badge/12345", sData);
+        Assert::AreEqual(nExpectedSize, store.GetFileSize());
+        Assert::AreEqual(nExpectedSize, mockFileSystem.GetFileSize(sPackFile));
+
+        std::string sMissing;
+        Assert::IsFalse(store.Read("Badge/12346", sMissing));
+    }
+
+    TEST_METHOD(TestReplace)
+    {
+        MockFileSystem mockFileSystem;
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        store.Write("Badge/12345", "first", tWritten);
+        store.Write("Badge/12345", "second", tWritten + std::chrono::hours(1));
+
+        Assert::AreEqual(std::string("second"), ReadEntry(store, "Badge/12345"));
+        Assert::IsTrue(tWritten + std::chrono::hours(1) == store.GetLastModified("Badge/12345"));
+        Assert::AreEqual(RecordSize("Badge/12345", "first"), store.GetWastedSize());
+        Assert::AreEqual({ 1U }, store.GetEntries().size());
+    }
+
+    TEST_METHOD(TestRemove)
+    {
+        MockFileSystem mockFileSystem;
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        store.Write("Badge/12345", "data", tWritten);
+        store.Remove("Badge/12345");
+
+        Assert::IsFalse(store.Contains("Badge/12345"));
+        std::string sData;
+        Assert::IsFalse(store.Read("Badge/12345", sData));
+
+        // both the original record and the removal record are wasted
+        Assert::AreEqual(RecordSize("Badge/12345", "data") + RecordSize("Badge/12345", ""), store.GetWastedSize());
+        Assert::AreEqual(HEADER_SIZE + store.GetWastedSize(), store.GetFileSize());
+    }
+
+    TEST_METHOD(TestReopen)
+    {
+        MockFileSystem mockFileSystem;
+        int64_t nWastedSize = 0;
+        {
+            PackedFileStore store(mockFileSystem, sPackFile);
+            Assert::IsTrue(store.Open());
+            store.Write("Badge/1", "one", tWritten);
+            store.Write("Badge/2", "two", tWritten);
+            store.Write("UserPic/User", "user", tWritten);
+            store.Write("Badge/1", "uno", tWritten + std::chrono::hours(2));
+            store.Remove("Badge/2");
+            nWastedSize = store.GetWastedSize();
+        }
+
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        Assert::AreEqual(std::string("uno"), ReadEntry(store, "Badge/1"));
+        Assert::IsTrue(tWritten + std::chrono::hours(2) == store.GetLastModified("Badge/1"));
+        Assert::IsFalse(store.Contains("Badge/2"));
+        Assert::AreEqual(std::string("user"), ReadEntry(store, "UserPic/User"));
+        Assert::AreEqual(nWastedSize, store.GetWastedSize());
+        Assert::AreEqual(mockFileSystem.GetFileSize(sPackFile), store.GetFileSize());
+
+        // new entries are appended to the existing file
+        store.Write("Badge/3", "three", tWritten);
+        Assert::AreEqual(std::string("three"), ReadEntry(store, "Badge/3"));
+        Assert::AreEqual(std::string("uno"), ReadEntry(store, "Badge/1"));
+    }
+
+    TEST_METHOD(TestDamagedTail)
+    {
+        MockFileSystem mockFileSystem;
+        {
+            PackedFileStore store(mockFileSystem, sPackFile);
+            Assert::IsTrue(store.Open());
+            store.Write("Badge/1", "one", tWritten);
+            store.Write("Badge/2", "two", tWritten);
+        }
+
+        // simulate a write that was interrupted partway through the second record
+        std::string sContents = mockFileSystem.GetFileContents(sPackFile);
+        sContents.resize(sContents.length() - 2);
+        mockFileSystem.MockFile(sPackFile, sContents);
+
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        Assert::AreEqual(std::string("one"), ReadEntry(store, "Badge/1"));
+        Assert::IsFalse(store.Contains("Badge/2"));
+        Assert::AreEqual(HEADER_SIZE + RecordSize("Badge/1", "one"), mockFileSystem.GetFileSize(sPackFile));
+        Assert::AreEqual({ -1 }, mockFileSystem.GetFileSize(sPackFile + L".tmp"));
+    }
+
+    TEST_METHOD(TestInvalidFile)
+    {
+        MockFileSystem mockFileSystem;
+        mockFileSystem.MockFile(sPackFile, "This is not a pack file");
+
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        Assert::AreEqual({ 0U }, store.GetEntries().size());
+        Assert::AreEqual(HEADER_SIZE, mockFileSystem.GetFileSize(sPackFile));
+    }
+
+    TEST_METHOD(TestCompact)
+    {
+        MockFileSystem mockFileSystem;
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        store.Write("Badge/1", "one", tWritten);
+        store.Write("Badge/2", "two", tWritten);
+        store.Write("Badge/1", "uno", tWritten + std::chrono::hours(1));
+        store.Write("Badge/3", "three", tWritten);
+        store.Remove("Badge/3");
+        Assert::AreNotEqual({ 0 }, store.GetWastedSize());
+
+        Assert::IsTrue(store.Compact());
+
+        const auto nExpectedSize = HEADER_SIZE + RecordSize("Badge/1", "uno") + RecordSize("Badge/2", "two");
+        Assert::AreEqual({ 0 }, store.GetWastedSize());
+        Assert::AreEqual(nExpectedSize, store.GetFileSize());
+        Assert::AreEqual(nExpectedSize, mockFileSystem.GetFileSize(sPackFile));
+        Assert::AreEqual({ -1 }, mockFileSystem.GetFileSize(sPackFile + L".tmp"));
+
+        Assert::AreEqual(std::string("uno"), ReadEntry(store, "Badge/1"));
+        Assert::IsTrue(tWritten + std::chrono::hours(1) == store.GetLastModified("Badge/1"));
+        Assert::AreEqual(std::string("two"), ReadEntry(store, "Badge/2"));
+        Assert::IsFalse(store.Contains("Badge/3"));
+
+        // the store can still be written to after compacting
+        store.Write("Badge/4", "four", tWritten);
+        Assert::AreEqual(std::string("four"), ReadEntry(store, "Badge/4"));
+
+        PackedFileStore store2(mockFileSystem, sPackFile);
+        Assert::IsTrue(store2.Open());
+        Assert::AreEqual({ 3U }, store2.GetEntries().size());
+        Assert::AreEqual(std::string("uno"), ReadEntry(store2, "Badge/1"));
+        Assert::AreEqual(std::string("four"), ReadEntry(store2, "Badge/4"));
+    }
+
+    TEST_METHOD(TestNeedsCompaction)
+    {
+        MockFileSystem mockFileSystem;
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        const std::string sData(600 * 1024, 'x');
+        store.Write("Badge/1", sData, tWritten);
+        store.Write("Badge/1", sData, tWritten);
+        Assert::IsFalse(store.NeedsCompaction()); // less than COMPACT_MIN_WASTED_SIZE wasted
+
+        store.Write("Badge/1", sData, tWritten);
+        Assert::IsTrue(store.NeedsCompaction());
+
+        Assert::IsTrue(store.Compact());
+        Assert::IsFalse(store.NeedsCompaction());
+    }
+
+    TEST_METHOD(TestRecoverInterruptedCompaction)
+    {
+        MockFileSystem mockFileSystem;
+        {
+            PackedFileStore store(mockFileSystem, sPackFile);
+            Assert::IsTrue(store.Open());
+            store.Write("Badge/1", "one", tWritten);
+        }
+
+        // simulate the compaction being interrupted after the original file was deleted
+        mockFileSystem.MoveFile(sPackFile, sPackFile + L".tmp");
+
+        PackedFileStore store(mockFileSystem, sPackFile);
+        Assert::IsTrue(store.Open());
+
+        Assert::AreEqual(std::string("one"), ReadEntry(store, "Badge/1"));
+        Assert::AreEqual({ -1 }, mockFileSystem.GetFileSize(sPackFile + L".tmp"));
+    }
+};
+
+} // namespace tests
+} // namespace impl
+} // namespace services
+} // namespace ra
@@ -0,0 +1,149 @@
+#include "CppUnitTest.h"
+
+#include "services\PerformanceCounter.hh"
+
+#include "tests\mocks\MockLocalStorage.hh"
+#include "tests\mocks\MockThreadPool.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using ra::services::mocks::MockLocalStorage;
+using ra::services::mocks::MockThreadPool;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(PerformanceCounter_Tests)
+{
+public:
+    TEST_METHOD(TestInitialState)
+    {
+        PerformanceCounter counter(L"RATest");
+        Assert::IsFalse(counter.IsEnabled());
+
+        const auto pStatistics = counter.GetStatistics(PerformanceCheckpoint::RuntimeProcess);
+        Assert::AreEqual(0U, pStatistics.nCount);
+        Assert::AreEqual(0LL, pStatistics.tMax.count());
+    }
+
+    TEST_METHOD(TestTimerDisabled)
+    {
+        PerformanceCounter counter(L"RATest");
+        ServiceLocator::ServiceOverride<PerformanceCounter> svcOverride(&counter);
+
+        {
+            PerformanceTimer tTimer(PerformanceCheckpoint::RuntimeProcess);
+        }
+
+        Assert::AreEqual(0U, counter.GetStatistics(PerformanceCheckpoint::RuntimeProcess).nCount);
+    }
+
+    TEST_METHOD(TestTimerEnabled)
+    {
+        PerformanceCounter counter(L"RATest");
+        counter.SetEnabled(true);
+        ServiceLocator::ServiceOverride<PerformanceCounter> svcOverride(&counter);
+
+        {
+            PerformanceTimer tTimer(PerformanceCheckpoint::RuntimeProcess);
+        }
+
+        Assert::AreEqual(1U, counter.GetStatistics(PerformanceCheckpoint::RuntimeProcess).nCount);
+        Assert::AreEqual(0U, counter.GetStatistics(PerformanceCheckpoint::RuntimeEvents).nCount);
+    }
+
+    TEST_METHOD(TestPercentiles)
+    {
+        PerformanceCounter counter(L"RATest");
+        for (int i = 1; i <= 100; ++i)
+            counter.Record(PerformanceCheckpoint::RuntimeProcess, std::chrono::microseconds(i));
+
+        const auto pStatistics = counter.GetStatistics(PerformanceCheckpoint::RuntimeProcess);
+        Assert::AreEqual(100U, pStatistics.nCount);
+        Assert::AreEqual(5050LL, pStatistics.tTotal.count());
+        Assert::AreEqual(50LL, pStatistics.tP50.count());
+        Assert::AreEqual(95LL, pStatistics.tP95.count());
+        Assert::AreEqual(99LL, pStatistics.tP99.count());
+        Assert::AreEqual(100LL, pStatistics.tMax.count());
+    }
+
+    TEST_METHOD(TestPercentilesLargeValues)
+    {
+        PerformanceCounter counter(L"RATest");
+        for (int i = 0; i < 99; ++i)
+            counter.Record(PerformanceCheckpoint::Frame, std::chrono::microseconds(1000));
+        counter.Record(PerformanceCheckpoint::Frame, std::chrono::milliseconds(250));
+
+        const auto pStatistics = counter.GetStatistics(PerformanceCheckpoint::Frame);
+        Assert::AreEqual(100U, pStatistics.nCount);
+
+        // 1000us is grouped with nearby values - the reported value should be within 1/32nd of the actual value
+        Assert::IsTrue(pStatistics.tP50.count() >= 1000 && pStatistics.tP50.count() < 1032);
+        Assert::IsTrue(pStatistics.tP99.count() >= 1000 && pStatistics.tP99.count() < 1032);
+        Assert::AreEqual(250000LL, pStatistics.tMax.count());
+    }
+
+    TEST_METHOD(TestReset)
+    {
+        PerformanceCounter counter(L"RATest");
+        counter.Record(PerformanceCheckpoint::HttpRequest, std::chrono::microseconds(1234));
+        Assert::AreEqual(1U, counter.GetStatistics(PerformanceCheckpoint::HttpRequest).nCount);
+
+        counter.Reset();
+        const auto pStatistics = counter.GetStatistics(PerformanceCheckpoint::HttpRequest);
+        Assert::AreEqual(0U, pStatistics.nCount);
+        Assert::AreEqual(0LL, pStatistics.tMax.count());
+    }
+
+    TEST_METHOD(TestExport)
+    {
+        MockLocalStorage mockLocalStorage;
+        PerformanceCounter counter(L"RATest");
+        counter.Record(PerformanceCheckpoint::RuntimeProcess, std::chrono::microseconds(12));
+        counter.Record(PerformanceCheckpoint::ImageDecode, std::chrono::microseconds(40));
+
+        counter.Export();
+
+        const auto& sExported = mockLocalStorage.GetStoredData(StorageItemType::PerformanceCounters, L"RATest");
+        Assert::AreEqual(std::string("{\"Checkpoints\":["
+            "{\"Name\":\"Runtime\",\"Count\":1,\"TotalUs\":12,\"P50Us\":12,\"P95Us\":12,\"P99Us\":12,\"MaxUs\":12},"
+            "{\"Name\":\"ImageDecode\",\"Count\":1,\"TotalUs\":40,\"P50Us\":40,\"P95Us\":40,\"P99Us\":40,\"MaxUs\":40}"
+            "]}"), sExported);
+    }
+
+    TEST_METHOD(TestEndFrameExportsPeriodically)
+    {
+        MockLocalStorage mockLocalStorage;
+        MockThreadPool mockThreadPool;
+        PerformanceCounter counter(L"RATest");
+        counter.SetEnabled(true);
+        counter.Record(PerformanceCheckpoint::Frame, std::chrono::microseconds(10));
+
+        for (unsigned int i = 1; i < PerformanceCounter::EXPORT_INTERVAL_FRAMES; ++i)
+            counter.EndFrame();
+        Assert::AreEqual({ 0U }, mockThreadPool.PendingTasks());
+
+        counter.EndFrame();
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+        Assert::IsTrue(mockLocalStorage.GetStoredData(StorageItemType::PerformanceCounters, L"RATest").empty());
+
+        mockThreadPool.ExecuteNextTask();
+        Assert::IsFalse(mockLocalStorage.GetStoredData(StorageItemType::PerformanceCounters, L"RATest").empty());
+    }
+
+    TEST_METHOD(TestEndFrameDisabled)
+    {
+        MockThreadPool mockThreadPool;
+        PerformanceCounter counter(L"RATest");
+
+        for (unsigned int i = 0; i < PerformanceCounter::EXPORT_INTERVAL_FRAMES; ++i)
+            counter.EndFrame();
+
+        Assert::AreEqual({ 0U }, mockThreadPool.PendingTasks());
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
@@ -0,0 +1,192 @@
+#include "CppUnitTest.h"
+
+#include "services\IThreadPool.hh"
+
+#include "tests\mocks\MockThreadPool.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using ra::services::mocks::MockThreadPool;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(TaskHandle_Tests)
+{
+public:
+    TEST_METHOD(TestEmptyHandle)
+    {
+        TaskHandle hTask;
+        Assert::IsFalse(hTask.IsCompleted());
+        Assert::IsFalse(hTask.IsCancelled());
+        Assert::IsFalse(hTask.Cancel());
+        Assert::IsTrue(hTask.Wait(std::chrono::milliseconds(0)));
+    }
+
+    TEST_METHOD(TestRunTaskAsync)
+    {
+        MockThreadPool mockThreadPool;
+        int nCalls = 0;
+
+        auto hTask = mockThreadPool.RunTaskAsync([&nCalls]() { ++nCalls; });
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+        Assert::IsFalse(hTask.IsCompleted());
+        Assert::IsFalse(hTask.Wait(std::chrono::milliseconds(0)));
+
+        mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(1, nCalls);
+        Assert::IsTrue(hTask.IsCompleted());
+        Assert::IsFalse(hTask.IsCancelled());
+        Assert::IsTrue(hTask.Wait(std::chrono::milliseconds(0)));
+
+        // can't cancel a task that has already run
+        Assert::IsFalse(hTask.Cancel());
+        Assert::IsTrue(hTask.IsCompleted());
+    }
+
+    TEST_METHOD(TestCancelBeforeRun)
+    {
+        MockThreadPool mockThreadPool;
+        int nCalls = 0;
+
+        auto hTask = mockThreadPool.RunTaskAsync([&nCalls]() { ++nCalls; });
+        Assert::IsTrue(hTask.Cancel());
+        Assert::IsTrue(hTask.IsCancelled());
+        Assert::IsTrue(hTask.Wait(std::chrono::milliseconds(0)));
+
+        // unscheduled tasks can't be removed from the queue, but they won't do anything
+        mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(0, nCalls);
+        Assert::IsFalse(hTask.IsCompleted());
+        Assert::IsFalse(hTask.Cancel());
+    }
+
+    TEST_METHOD(TestCancelScheduledTask)
+    {
+        MockThreadPool mockThreadPool;
+        int nCalls = 0;
+
+        auto hTask = mockThreadPool.ScheduleTaskAsync(std::chrono::seconds(1), [&nCalls]() { ++nCalls; });
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+
+        // scheduled tasks should be removed from the queue
+        Assert::IsTrue(hTask.Cancel());
+        Assert::AreEqual({ 0U }, mockThreadPool.PendingTasks());
+
+        mockThreadPool.AdvanceTime(std::chrono::seconds(1));
+        Assert::AreEqual(0, nCalls);
+    }
+
+    TEST_METHOD(TestScheduleTaskAsync)
+    {
+        MockThreadPool mockThreadPool;
+        int nCalls = 0;
+
+        auto hTask = mockThreadPool.ScheduleTaskAsync(std::chrono::seconds(1), [&nCalls]() { ++nCalls; });
+        mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::AreEqual(0, nCalls);
+        Assert::IsFalse(hTask.IsCompleted());
+
+        mockThreadPool.AdvanceTime(std::chrono::milliseconds(500));
+        Assert::AreEqual(1, nCalls);
+        Assert::IsTrue(hTask.IsCompleted());
+        Assert::AreEqual({ 0U }, mockThreadPool.PendingTasks());
+    }
+
+    TEST_METHOD(TestContinueWith)
+    {
+        MockThreadPool mockThreadPool;
+        std::string sOrder;
+
+        auto hTask = mockThreadPool.RunTaskAsync([&sOrder]() { sOrder.push_back('A'); });
+        auto hContinuation = hTask.ContinueWith([&sOrder]() { sOrder.push_back('B'); });
+
+        // continuation isn't queued until the first task completes
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+
+        mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(std::string("A"), sOrder);
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+        Assert::IsFalse(hContinuation.IsCompleted());
+
+        mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(std::string("AB"), sOrder);
+        Assert::IsTrue(hContinuation.IsCompleted());
+    }
+
+    TEST_METHOD(TestContinueWithCompletedTask)
+    {
+        MockThreadPool mockThreadPool;
+        int nCalls = 0;
+
+        auto hTask = mockThreadPool.RunTaskAsync([]() {});
+        mockThreadPool.ExecuteNextTask();
+
+        // continuation should be queued immediately
+        auto hContinuation = hTask.ContinueWith([&nCalls]() { ++nCalls; });
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+
+        mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(1, nCalls);
+        Assert::IsTrue(hContinuation.IsCompleted());
+    }
+
+    TEST_METHOD(TestContinueWithCancelledTask)
+    {
+        MockThreadPool mockThreadPool;
+        int nCalls = 0;
+
+        auto hTask = mockThreadPool.ScheduleTaskAsync(std::chrono::seconds(1), []() {});
+        auto hContinuation = hTask.ContinueWith([&nCalls]() { ++nCalls; });
+        Assert::IsTrue(hTask.Cancel());
+        Assert::IsTrue(hContinuation.IsCancelled());
+
+        auto hContinuation2 = hTask.ContinueWith([&nCalls]() { ++nCalls; });
+        Assert::IsTrue(hContinuation2.IsCancelled());
+
+        mockThreadPool.AdvanceTime(std::chrono::seconds(1));
+        Assert::AreEqual({ 0U }, mockThreadPool.PendingTasks());
+        Assert::AreEqual(0, nCalls);
+    }
+
+    TEST_METHOD(TestCancellationTokenSource)
+    {
+        MockThreadPool mockThreadPool;
+        CancellationTokenSource pSource;
+        int nCalls = 0;
+
+        auto hTask1 = mockThreadPool.ScheduleTaskAsync(std::chrono::seconds(1), [&nCalls]() { ++nCalls; }, pSource.Token());
+        auto hTask2 = mockThreadPool.ScheduleTaskAsync(std::chrono::seconds(2), [&nCalls]() { ++nCalls; }, pSource.Token());
+        auto hTask3 = mockThreadPool.ScheduleTaskAsync(std::chrono::seconds(2), [&nCalls]() { ++nCalls; });
+        Assert::AreEqual({ 3U }, mockThreadPool.PendingTasks());
+        Assert::IsFalse(pSource.IsCancellationRequested());
+
+        pSource.Cancel();
+        Assert::IsTrue(pSource.IsCancellationRequested());
+        Assert::IsTrue(pSource.Token().IsCancellationRequested());
+        Assert::IsTrue(hTask1.IsCancelled());
+        Assert::IsTrue(hTask2.IsCancelled());
+        Assert::IsFalse(hTask3.IsCancelled());
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+
+        // work queued with a cancelled token should never be queued
+        auto hTask4 = mockThreadPool.RunTaskAsync([&nCalls]() { ++nCalls; }, pSource.Token());
+        Assert::IsTrue(hTask4.IsCancelled());
+        Assert::AreEqual({ 1U }, mockThreadPool.PendingTasks());
+
+        mockThreadPool.AdvanceTime(std::chrono::seconds(2));
+        Assert::AreEqual(1, nCalls);
+        Assert::IsTrue(hTask3.IsCompleted());
+    }
+
+    TEST_METHOD(TestDefaultCancellationToken)
+    {
+        CancellationToken pToken;
+        Assert::IsFalse(pToken.IsCancellationRequested());
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
@@ -0,0 +1,323 @@
+#include "CppUnitTest.h"
+
+#include "services\Tracer.hh"
+#include "services\impl\Clock.hh"
+#include "services\impl\StringTextWriter.hh"
+#include "services\impl\ThreadPool.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace services {
+namespace impl {
+namespace tests {
+
+TEST_CLASS(ThreadPool_Tests)
+{
+private:
+    class ThreadPoolHarness : public ThreadPool
+    {
+    public:
+        GSL_SUPPRESS_F6 explicit ThreadPoolHarness(size_t nThreads) : m_overrideClock(&m_pClock)
+        {
+            Initialize(nThreads);
+        }
+
+        // the threads have to be stopped before the clock override goes away
+        GSL_SUPPRESS_F6 ~ThreadPoolHarness() noexcept { Shutdown(true); }
+
+        ThreadPoolHarness(const ThreadPoolHarness&) noexcept = delete;
+        ThreadPoolHarness& operator=(const ThreadPoolHarness&) noexcept = delete;
+        ThreadPoolHarness(ThreadPoolHarness&&) noexcept = delete;
+        ThreadPoolHarness& operator=(ThreadPoolHarness&&) noexcept = delete;
+
+    private:
+        Clock m_pClock;
+        ServiceLocator::ServiceOverride<IClock> m_overrideClock;
+    };
+
+    // records the order tasks ran in
+    class TaskRecorder
+    {
+    public:
+        void Record(int nValue)
+        {
+            std::lock_guard<std::mutex> lock(m_oMutex);
+            if (!m_sOrder.empty())
+                m_sOrder.push_back(',');
+            m_sOrder += std::to_string(nValue);
+            ++m_nCount;
+            m_cvRecorded.notify_all();
+        }
+
+        bool WaitFor(size_t nCount)
+        {
+            std::unique_lock<std::mutex> lock(m_oMutex);
+            return m_cvRecorded.wait_for(lock, std::chrono::seconds(5), [this, nCount]() noexcept { return m_nCount >= nCount; });
+        }
+
+        std::string GetOrder()
+        {
+            std::lock_guard<std::mutex> lock(m_oMutex);
+            return m_sOrder;
+        }
+
+    private:
+        std::mutex m_oMutex;
+        std::condition_variable m_cvRecorded;
+        std::string m_sOrder;
+        size_t m_nCount = 0;
+    };
+
+    // holds a worker until opened
+    class Gate
+    {
+    public:
+        void Open()
+        {
+            std::lock_guard<std::mutex> lock(m_oMutex);
+            m_bOpen = true;
+            m_cvOpen.notify_all();
+        }
+
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(m_oMutex);
+            m_cvOpen.wait_for(lock, std::chrono::seconds(5), [this]() noexcept { return m_bOpen; });
+        }
+
+    private:
+        std::mutex m_oMutex;
+        std::condition_variable m_cvOpen;
+        bool m_bOpen = false;
+    };
+
+public:
+    TEST_METHOD(TestRunAsync)
+    {
+        ThreadPoolHarness pool(4);
+        std::atomic<int> nCalls{ 0 };
+        TaskRecorder recorder;
+
+        for (int i = 0; i < 20; ++i)
+            pool.RunAsync([&nCalls, &recorder]() { recorder.Record(++nCalls); });
+
+        Assert::IsTrue(recorder.WaitFor(20));
+        Assert::AreEqual(20, nCalls.load());
+    }
+
+    TEST_METHOD(TestRunAsyncFromOutsidePool)
+    {
+        ThreadPoolHarness pool(4);
+        pool.SetMaxConcurrentTasks(TaskPriority::Interactive, 1);
+
+        Gate gate;
+        TaskRecorder recorder;
+        pool.RunAsync([&gate]() { gate.Wait(); });
+
+        // tasks are distributed across the workers. they all run, but not necessarily in the order they were queued
+        std::atomic<int> nCalls{ 0 };
+        for (int i = 0; i < 10; ++i)
+            pool.RunAsync([&recorder, &nCalls, i]() { ++nCalls; recorder.Record(i); });
+
+        gate.Open();
+        Assert::IsTrue(recorder.WaitFor(10));
+        Assert::AreEqual(10, nCalls.load());
+    }
+
+    TEST_METHOD(TestRunAsyncOrderFromWorker)
+    {
+        ThreadPoolHarness pool(4);
+        pool.SetMaxConcurrentTasks(TaskPriority::Interactive, 1);
+
+        TaskRecorder recorder;
+
+        // tasks queued from a worker go to that worker's queue. they should still run first in, first out
+        pool.RunAsync([&pool, &recorder]()
+        {
+            for (int i = 0; i < 10; ++i)
+                pool.RunAsync([&recorder, i]() { recorder.Record(i); });
+        });
+
+        Assert::IsTrue(recorder.WaitFor(10));
+        Assert::AreEqual(std::string("0,1,2,3,4,5,6,7,8,9"), recorder.GetOrder());
+    }
+
+    TEST_METHOD(TestRunAsyncTracesFlow)
+    {
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+        ServiceLocator::ServiceOverride<Tracer> svcOverride(&tracer);
+
+        {
+            ThreadPoolHarness pool(1);
+            TaskRecorder recorder;
+            pool.RunAsync([&recorder]() { recorder.Record(1); });
+            Assert::IsTrue(recorder.WaitFor(1));
+
+            // wait for the worker to close the span
+            pool.Shutdown(true);
+        }
+
+        std::string sOutput;
+        ra::services::impl::StringTextWriter pWriter(sOutput);
+        tracer.Write(pWriter);
+
+        rapidjson::Document document;
+        document.Parse(sOutput.c_str());
+        Assert::IsFalse(document.HasParseError());
+
+        // each thread's events are written in the order they were recorded. the end of the flow binds to the
+        // enclosing span, so it has to be recorded inside the task's span on the worker thread.
+        const auto& vEvents = document["traceEvents"];
+        unsigned int nFlowThreadId = 0;
+        for (const auto& pEvent : vEvents.GetArray())
+        {
+            if (std::string(pEvent["ph"].GetString()) == "f")
+                nFlowThreadId = pEvent["tid"].GetUint();
+        }
+        Assert::AreNotEqual(0U, nFlowThreadId);
+
+        std::string sPhases;
+        for (const auto& pEvent : vEvents.GetArray())
+        {
+            if (pEvent["tid"].GetUint() == nFlowThreadId && std::string(pEvent["name"].GetString()) == "Task")
+                sPhases += pEvent["ph"].GetString();
+        }
+        Assert::AreEqual(std::string("BfE"), sPhases);
+    }
+
+    TEST_METHOD(TestRunAsyncAfterShutdown)
+    {
+        ThreadPoolHarness pool(2);
+        TaskRecorder recorder;
+
+        pool.Shutdown(true);
+        Assert::IsTrue(pool.IsShutdownRequested());
+
+        pool.RunAsync([&recorder]() { recorder.Record(1); });
+        Assert::AreEqual(std::string(), recorder.GetOrder());
+    }
+
+    TEST_METHOD(TestScheduleAsync)
+    {
+        ThreadPoolHarness pool(2);
+        TaskRecorder recorder;
+
+        pool.ScheduleAsync(std::chrono::milliseconds(100), [&recorder]() { recorder.Record(2); });
+        pool.ScheduleAsync(std::chrono::milliseconds(20), [&recorder]() { recorder.Record(1); });
+
+        Assert::IsTrue(recorder.WaitFor(2));
+        Assert::AreEqual(std::string("1,2"), recorder.GetOrder());
+    }
+
+    TEST_METHOD(TestCancelScheduledTask)
+    {
+        ThreadPoolHarness pool(2);
+        TaskRecorder recorder;
+
+        const auto nId = pool.ScheduleAsync(std::chrono::milliseconds(20), [&recorder]() { recorder.Record(1); });
+        pool.ScheduleAsync(std::chrono::milliseconds(50), [&recorder]() { recorder.Record(2); });
+        Assert::IsTrue(pool.CancelScheduledTask(nId));
+
+        Assert::IsTrue(recorder.WaitFor(1));
+        Assert::AreEqual(std::string("2"), recorder.GetOrder());
+
+        // already cancelled
+        Assert::IsFalse(pool.CancelScheduledTask(nId));
+    }
+
+    TEST_METHOD(TestShutdownWithoutWaitStopsTimer)
+    {
+        ThreadPoolHarness pool(2);
+        TaskRecorder recorder;
+
+        pool.ScheduleAsync(std::chrono::milliseconds(20), [&recorder]() { recorder.Record(1); });
+        pool.Shutdown(false);
+
+        // the timer thread has been stopped, so the task should never be released to the workers
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        Assert::AreEqual(std::string(), recorder.GetOrder());
+        Assert::AreEqual(0U, pool.ScheduleAsync(std::chrono::milliseconds(0), [&recorder]() { recorder.Record(2); }));
+    }
+
+    TEST_METHOD(TestPriorityOrder)
+    {
+        ThreadPoolHarness pool(1);
+
+        Gate started, gate;
+        TaskRecorder recorder;
+        pool.RunAsync([&started, &gate]() { started.Open(); gate.Wait(); }, TaskPriority::Critical);
+        started.Wait();
+
+        pool.RunAsync([&recorder]() { recorder.Record(1); }, TaskPriority::Idle);
+        pool.RunAsync([&recorder]() { recorder.Record(2); }, TaskPriority::Background);
+        pool.RunAsync([&recorder]() { recorder.Record(3); }, TaskPriority::Interactive);
+        pool.RunAsync([&recorder]() { recorder.Record(4); }, TaskPriority::Critical);
+
+        gate.Open();
+        Assert::IsTrue(recorder.WaitFor(4));
+        Assert::AreEqual(std::string("4,3,2,1"), recorder.GetOrder());
+    }
+
+    TEST_METHOD(TestStarvedLaneGetsATurn)
+    {
+        ThreadPoolHarness pool(1);
+
+        Gate started, gate;
+        TaskRecorder recorder;
+        pool.RunAsync([&started, &gate]() { started.Open(); gate.Wait(); }, TaskPriority::Critical);
+        started.Wait();
+
+        pool.RunAsync([&recorder]() { recorder.Record(100); }, TaskPriority::Background);
+        for (int i = 0; i < 10; ++i)
+            pool.RunAsync([&recorder, i]() { recorder.Record(i); }, TaskPriority::Interactive);
+
+        // after eight interactive tasks have been started ahead of it, the background task gets a turn
+        gate.Open();
+        Assert::IsTrue(recorder.WaitFor(11));
+        Assert::AreEqual(std::string("0,1,2,3,4,5,6,7,100,8,9"), recorder.GetOrder());
+    }
+
+    TEST_METHOD(TestMaxConcurrentTasks)
+    {
+        ThreadPoolHarness pool(4);
+        pool.SetMaxConcurrentTasks(TaskPriority::Background, 2);
+
+        Gate gate;
+        TaskRecorder started, recorder;
+        pool.RunAsync([&gate, &started]() { started.Record(0); gate.Wait(); }, TaskPriority::Background);
+        pool.RunAsync([&gate, &started]() { started.Record(0); gate.Wait(); }, TaskPriority::Background);
+        Assert::IsTrue(started.WaitFor(2));
+        pool.RunAsync([&recorder]() { recorder.Record(2); }, TaskPriority::Background);
+
+        // the background lane is full, but that shouldn't hold up work in other lanes
+        pool.RunAsync([&recorder]() { recorder.Record(1); }, TaskPriority::Interactive);
+        Assert::IsTrue(recorder.WaitFor(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Assert::AreEqual(std::string("1"), recorder.GetOrder());
+
+        gate.Open();
+        Assert::IsTrue(recorder.WaitFor(2));
+        Assert::AreEqual(std::string("1,2"), recorder.GetOrder());
+    }
+
+    TEST_METHOD(TestBackgroundTasksRunWithOneThread)
+    {
+        ThreadPoolHarness pool(1);
+        TaskRecorder recorder;
+
+        pool.RunAsync([&recorder]() { recorder.Record(1); }, TaskPriority::Background);
+        pool.RunAsync([&recorder]() { recorder.Record(2); }, TaskPriority::Idle);
+
+        Assert::IsTrue(recorder.WaitFor(2));
+        Assert::AreEqual(std::string("1,2"), recorder.GetOrder());
+    }
+};
+
+} // namespace tests
+} // namespace impl
+} // namespace services
+} // namespace ra
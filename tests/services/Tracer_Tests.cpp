@@ -0,0 +1,233 @@
+#include "CppUnitTest.h"
+
+#include "services\Tracer.hh"
+#include "services\impl\StringTextWriter.hh"
+
+#include "tests\mocks\MockLocalStorage.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using ra::services::mocks::MockLocalStorage;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(Tracer_Tests)
+{
+private:
+    static void GetEvents(const Tracer& tracer, rapidjson::Document& document)
+    {
+        std::string sOutput;
+        ra::services::impl::StringTextWriter pWriter(sOutput);
+        tracer.Write(pWriter);
+
+        document.Parse(sOutput.c_str());
+        Assert::IsFalse(document.HasParseError());
+        Assert::IsTrue(document.HasMember("traceEvents"));
+    }
+
+    static void AssertEvent(const rapidjson::Value& pEvent, const char* sName, const char* sPhase)
+    {
+        Assert::AreEqual(std::string(sName), std::string(pEvent["name"].GetString()));
+        Assert::AreEqual(std::string(sPhase), std::string(pEvent["ph"].GetString()));
+    }
+
+    static void AssertInsideSpan(const rapidjson::Value& vEvents, const rapidjson::Value& pEvent)
+    {
+        const auto nThreadId = pEvent["tid"].GetUint();
+        const auto nTimestamp = pEvent["ts"].GetInt64();
+
+        int nDepth = 0;
+        for (const auto& pOther : vEvents.GetArray())
+        {
+            if (&pOther == &pEvent)
+            {
+                Assert::IsTrue(nDepth > 0, L"Event is not inside a span");
+                return;
+            }
+
+            if (pOther["tid"].GetUint() != nThreadId)
+                continue;
+
+            const std::string sPhase = pOther["ph"].GetString();
+            if (sPhase == "B")
+            {
+                Assert::IsTrue(pOther["ts"].GetInt64() <= nTimestamp);
+                ++nDepth;
+            }
+            else if (sPhase == "E")
+            {
+                --nDepth;
+            }
+        }
+
+        Assert::Fail(L"Event not found");
+    }
+
+public:
+    TEST_METHOD(TestDisabled)
+    {
+        Tracer tracer(L"RATest");
+        Assert::IsFalse(tracer.IsEnabled());
+
+        tracer.BeginSpan("Test");
+        tracer.EndSpan("Test");
+
+        rapidjson::Document document;
+        GetEvents(tracer, document);
+        Assert::AreEqual(0U, document["traceEvents"].Size());
+    }
+
+    TEST_METHOD(TestSpan)
+    {
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+        ServiceLocator::ServiceOverride<Tracer> svcOverride(&tracer);
+
+        {
+            TraceSpan span("Outer");
+            TraceSpan span2("Inner");
+        }
+
+        rapidjson::Document document;
+        GetEvents(tracer, document);
+        const auto& vEvents = document["traceEvents"];
+        Assert::AreEqual(4U, vEvents.Size());
+        AssertEvent(vEvents[0], "Outer", "B");
+        AssertEvent(vEvents[1], "Inner", "B");
+        AssertEvent(vEvents[2], "Inner", "E");
+        AssertEvent(vEvents[3], "Outer", "E");
+
+        Assert::IsTrue(vEvents[0]["ts"].GetInt64() <= vEvents[3]["ts"].GetInt64());
+        Assert::AreEqual(vEvents[0]["tid"].GetUint(), vEvents[3]["tid"].GetUint());
+    }
+
+    TEST_METHOD(TestSpanNoTracer)
+    {
+        // should not throw if no tracer has been registered
+        TraceSpan span("Test");
+        Assert::IsNull(TraceSpan::GetActiveTracer());
+    }
+
+    TEST_METHOD(TestFlow)
+    {
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+
+        const auto nFlowId = tracer.BeginFlow("Task");
+        Assert::AreNotEqual(0ULL, nFlowId);
+
+        std::thread pThread([&tracer, nFlowId]() {
+            tracer.BeginSpan("Task");
+            tracer.EndFlow("Task", nFlowId);
+            tracer.EndSpan("Task");
+        });
+        pThread.join();
+
+        rapidjson::Document document;
+        GetEvents(tracer, document);
+        const auto& vEvents = document["traceEvents"];
+        Assert::AreEqual(4U, vEvents.Size());
+        AssertEvent(vEvents[0], "Task", "s");
+        Assert::AreEqual(nFlowId, vEvents[0]["id"].GetUint64());
+        AssertEvent(vEvents[1], "Task", "B");
+        Assert::IsFalse(vEvents[1].HasMember("id"));
+        AssertEvent(vEvents[2], "Task", "f");
+        Assert::AreEqual(nFlowId, vEvents[2]["id"].GetUint64());
+        Assert::AreEqual(std::string("e"), std::string(vEvents[2]["bp"].GetString()));
+        AssertEvent(vEvents[3], "Task", "E");
+
+        // flow should cross threads
+        Assert::AreNotEqual(vEvents[0]["tid"].GetUint(), vEvents[2]["tid"].GetUint());
+
+        // the end of the flow binds to the enclosing span, so it has to be inside a span on the same thread
+        AssertInsideSpan(vEvents, vEvents[2]);
+    }
+
+    TEST_METHOD(TestThreadName)
+    {
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+        tracer.SetThreadName("Emulator");
+        tracer.BeginSpan("Test");
+
+        rapidjson::Document document;
+        GetEvents(tracer, document);
+        const auto& vEvents = document["traceEvents"];
+        Assert::AreEqual(2U, vEvents.Size());
+        AssertEvent(vEvents[0], "thread_name", "M");
+        Assert::AreEqual(std::string("Emulator"), std::string(vEvents[0]["args"]["name"].GetString()));
+        Assert::AreEqual(vEvents[0]["tid"].GetUint(), vEvents[1]["tid"].GetUint());
+    }
+
+    TEST_METHOD(TestRingKeepsMostRecentEvents)
+    {
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+
+        tracer.BeginSpan("First");
+        for (size_t i = 0; i < Tracer::RING_CAPACITY; ++i)
+            tracer.BeginSpan("Test");
+
+        rapidjson::Document document;
+        GetEvents(tracer, document);
+        const auto& vEvents = document["traceEvents"];
+        Assert::AreEqual(gsl::narrow_cast<unsigned int>(Tracer::RING_CAPACITY), vEvents.Size());
+        AssertEvent(vEvents[0], "Test", "B");
+    }
+
+    TEST_METHOD(TestWriteWhileRecording)
+    {
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+
+        std::atomic_bool bStop{ false };
+        std::thread pThread([&tracer, &bStop]() {
+            while (!bStop)
+            {
+                tracer.BeginSpan("Test");
+                tracer.EndSpan("Test");
+            }
+        });
+
+        // the ring wraps many times while it's being written. events that were overwritten while being read
+        // should be skipped rather than written with fields from two different events.
+        for (int i = 0; i < 20; ++i)
+        {
+            rapidjson::Document document;
+            GetEvents(tracer, document);
+            const auto& vEvents = document["traceEvents"];
+
+            long long nLastTimestamp = 0;
+            for (const auto& pEvent : vEvents.GetArray())
+            {
+                Assert::AreEqual(std::string("Test"), std::string(pEvent["name"].GetString()));
+                Assert::IsFalse(pEvent.HasMember("id"));
+                Assert::IsTrue(pEvent["ts"].GetInt64() >= nLastTimestamp);
+                nLastTimestamp = pEvent["ts"].GetInt64();
+            }
+        }
+
+        bStop = true;
+        pThread.join();
+    }
+
+    TEST_METHOD(TestExport)
+    {
+        MockLocalStorage mockLocalStorage;
+        Tracer tracer(L"RATest");
+        tracer.SetEnabled(true);
+        tracer.BeginSpan("Test");
+
+        tracer.Export();
+
+        const auto& sExported = mockLocalStorage.GetStoredData(StorageItemType::Trace, L"RATest");
+        Assert::IsTrue(sExported.find("\"name\":\"Test\"") != std::string::npos);
+        Assert::IsTrue(sExported.find("\"displayTimeUnit\":\"ms\"") != std::string::npos);
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
@@ -0,0 +1,54 @@
+#include "CppUnitTest.h"
+
+#include "services\impl\WindowsHttpRequester.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace services {
+namespace impl {
+namespace tests {
+
+// these defines are in <winhttp.h>
+constexpr unsigned int WINHTTP_CONNECTION_ERROR = 12030;
+constexpr unsigned int WINHTTP_INVALID_SERVER_RESPONSE = 12152;
+constexpr unsigned int WINHTTP_TIMEOUT = 12002;
+
+TEST_CLASS(WindowsHttpRequester_Tests)
+{
+public:
+    TEST_METHOD(TestCanRetryOnNewConnectionGet)
+    {
+        const Http::Request request("http://host/dorequest.php");
+
+        Assert::IsTrue(WindowsHttpRequester::CanRetryOnNewConnection(request, true, false, WINHTTP_CONNECTION_ERROR));
+        Assert::IsTrue(WindowsHttpRequester::CanRetryOnNewConnection(request, true, false, WINHTTP_INVALID_SERVER_RESPONSE));
+
+        // other errors are not caused by a stale keep-alive socket
+        Assert::IsFalse(WindowsHttpRequester::CanRetryOnNewConnection(request, true, false, WINHTTP_TIMEOUT));
+        Assert::IsFalse(WindowsHttpRequester::CanRetryOnNewConnection(request, true, false, 500));
+
+        // a new connection failing is a real failure
+        Assert::IsFalse(WindowsHttpRequester::CanRetryOnNewConnection(request, false, false, WINHTTP_CONNECTION_ERROR));
+
+        // the server responded, so the connection was good
+        Assert::IsFalse(WindowsHttpRequester::CanRetryOnNewConnection(request, true, true, WINHTTP_CONNECTION_ERROR));
+    }
+
+    TEST_METHOD(TestCanRetryOnNewConnectionPost)
+    {
+        Http::Request request("http://host/dorequest.php");
+        request.SetPostData("r=awardachievement&a=1234");
+
+        // the server may have processed the request before the connection failed. don't send it again
+        Assert::IsFalse(WindowsHttpRequester::CanRetryOnNewConnection(request, true, false, WINHTTP_CONNECTION_ERROR));
+        Assert::IsFalse(WindowsHttpRequester::CanRetryOnNewConnection(request, true, false, WINHTTP_INVALID_SERVER_RESPONSE));
+    }
+};
+
+} // namespace tests
+} // namespace impl
+} // namespace services
+} // namespace ra
@@ -0,0 +1,429 @@
+#include "ui\drawing\bitmap\BitmapSurface.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace bitmap {
+namespace tests {
+
+TEST_CLASS(BitmapSurface_Tests)
+{
+private:
+    // every glyph is a block with a solid left half, a half-covered column, and an empty right side
+    class GlyphSourceHarness : public IGlyphSource
+    {
+    public:
+        GlyphSourceHarness()
+        {
+            m_pGlyph.nAdvance = 4;
+            m_pGlyph.vCoverage = {
+                255, 255, 128, 0,
+                255, 255, 128, 0,
+                255, 255, 128, 0,
+            };
+        }
+
+        int LoadFont(const std::string&, int, FontStyles) noexcept override { return 1; }
+        int GetLineHeight(int) const noexcept override { return 3; }
+
+        const Glyph* GetGlyph(int nFont, wchar_t nChar) const noexcept override
+        {
+            return (nFont == 1 && nChar != L'?') ? &m_pGlyph : nullptr;
+        }
+
+    private:
+        Glyph m_pGlyph;
+    };
+
+    class ImageSourceHarness : public IImageSource
+    {
+    public:
+        ImageSourceHarness()
+        {
+            // 2x2 image: red, green / blue, white
+            m_pImage.nWidth = 2;
+            m_pImage.nHeight = 2;
+            m_pImage.vPixels = {0xFFFF0000, 0xFF00FF00, 0xFF0000FF, 0xFFFFFFFF};
+        }
+
+        const Image* GetImage(const ImageReference& pImage) noexcept override
+        {
+            return (pImage.Name() == "2x2") ? &m_pImage : nullptr;
+        }
+
+    private:
+        Image m_pImage;
+    };
+
+    static void AssertPixel(const BitmapSurface& pSurface, unsigned int nX, unsigned int nY, unsigned int nExpected)
+    {
+        const auto nActual = pSurface.GetPixel(nX, nY).ARGB;
+        if (nActual != nExpected)
+        {
+            Assert::Fail(ra::StringPrintf(L"Pixel %u,%u: expected %08X, got %08X", nX, nY, nExpected, nActual).c_str());
+        }
+    }
+
+    static void AssertRectangle(const BitmapSurface& pSurface, unsigned int nX, unsigned int nY,
+                                unsigned int nWidth, unsigned int nHeight, unsigned int nExpected)
+    {
+        for (unsigned int j = nY; j < nY + nHeight; ++j)
+        {
+            for (unsigned int i = nX; i < nX + nWidth; ++i)
+                AssertPixel(pSurface, i, j, nExpected);
+        }
+    }
+
+public:
+    TEST_METHOD(TestConstructor)
+    {
+        BitmapSurface pSurface(7, 5);
+        Assert::AreEqual(7U, pSurface.GetWidth());
+        Assert::AreEqual(5U, pSurface.GetHeight());
+        Assert::IsFalse(pSurface.IsTransparent());
+        AssertRectangle(pSurface, 0, 0, 7, 5, 0U);
+
+        BitmapSurface pTransparentSurface(3, 3, true);
+        Assert::IsTrue(pTransparentSurface.IsTransparent());
+    }
+
+    TEST_METHOD(TestFillRectangle)
+    {
+        BitmapSurface pSurface(11, 7);
+        pSurface.FillRectangle(0, 0, 11, 7, Color(0xFF101010));
+        pSurface.FillRectangle(2, 1, 7, 3, Color(0xFF202020));
+
+        AssertRectangle(pSurface, 2, 1, 7, 3, 0xFF202020);
+        AssertRectangle(pSurface, 0, 0, 11, 1, 0xFF101010);
+        AssertRectangle(pSurface, 0, 4, 11, 3, 0xFF101010);
+        AssertRectangle(pSurface, 0, 1, 2, 3, 0xFF101010);
+        AssertRectangle(pSurface, 9, 1, 2, 3, 0xFF101010);
+    }
+
+    TEST_METHOD(TestFillRectangleClipped)
+    {
+        BitmapSurface pSurface(6, 6);
+        pSurface.FillRectangle(-2, -3, 5, 5, Color(0xFF202020));
+        pSurface.FillRectangle(4, 4, 10, 10, Color(0xFF303030));
+        pSurface.FillRectangle(6, 0, 2, 2, Color(0xFF404040)); // completely off surface
+        pSurface.FillRectangle(0, 0, 0, 2, Color(0xFF404040)); // empty
+
+        AssertRectangle(pSurface, 0, 0, 3, 2, 0xFF202020);
+        AssertRectangle(pSurface, 3, 0, 3, 2, 0U);
+        AssertRectangle(pSurface, 0, 2, 6, 2, 0U);
+        AssertRectangle(pSurface, 4, 4, 2, 2, 0xFF303030);
+    }
+
+    TEST_METHOD(TestDrawSurfaceOpaque)
+    {
+        BitmapSurface pSurface(10, 10);
+        BitmapSurface pSource(5, 3);
+        pSource.FillRectangle(0, 0, 5, 3, Color(0x80123456));
+
+        pSurface.DrawSurface(8, 2, pSource);
+
+        // alpha channel is ignored and copied for opaque surfaces
+        AssertRectangle(pSurface, 8, 2, 2, 3, 0x80123456);
+        AssertRectangle(pSurface, 0, 2, 8, 3, 0U);
+    }
+
+    TEST_METHOD(TestDrawSurfacePartial)
+    {
+        BitmapSurface pSurface(10, 10);
+        BitmapSurface pSource(5, 5);
+        pSource.FillRectangle(0, 0, 5, 5, Color(0xFF111111));
+        pSource.FillRectangle(1, 1, 2, 2, Color(0xFF222222));
+
+        pSurface.DrawSurface(4, 4, pSource, 1, 1, 3, 3);
+
+        AssertRectangle(pSurface, 4, 4, 2, 2, 0xFF222222);
+        AssertPixel(pSurface, 6, 4, 0xFF111111);
+        AssertPixel(pSurface, 4, 6, 0xFF111111);
+        AssertPixel(pSurface, 7, 7, 0U);
+    }
+
+    TEST_METHOD(TestDrawSurfaceTransparent)
+    {
+        // use widths that aren't a multiple of four to exercise both the vector and scalar code paths
+        BitmapSurface pSurface(13, 3);
+        pSurface.FillRectangle(0, 0, 13, 3, Color(0xFF204060));
+
+        BitmapSurface pSource(11, 3, true);
+        pSource.FillRectangle(0, 0, 3, 3, Color(0xFFFF0000));  // opaque
+        pSource.FillRectangle(3, 0, 4, 3, Color(0x80FFFFFF));  // half transparent
+        pSource.FillRectangle(7, 0, 2, 3, Color(0x00FFFFFF));  // fully transparent
+        pSource.FillRectangle(9, 0, 2, 3, Color(0x40000000));  // quarter opaque black
+
+        pSurface.DrawSurface(1, 0, pSource);
+
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            AssertPixel(pSurface, 0, j, 0xFF204060);
+            AssertPixel(pSurface, 1, j, 0xFFFF0000);
+            AssertPixel(pSurface, 3, j, 0xFFFF0000);
+            // (0xFF * 0x80 + 0x20 * 0x80) / 256 = 0x8F
+            // (0xFF * 0x80 + 0x40 * 0x80) / 256 = 0x9F
+            // (0xFF * 0x80 + 0x60 * 0x80) / 256 = 0xAF
+            AssertPixel(pSurface, 4, j, 0xFF8F9FAF);
+            AssertPixel(pSurface, 7, j, 0xFF8F9FAF);
+            AssertPixel(pSurface, 8, j, 0xFF204060);
+            AssertPixel(pSurface, 9, j, 0xFF204060);
+            // (0x20 * 0xC0) / 256 = 0x18, (0x40 * 0xC0) / 256 = 0x30, (0x60 * 0xC0) / 256 = 0x48
+            AssertPixel(pSurface, 10, j, 0xFF183048);
+            AssertPixel(pSurface, 11, j, 0xFF183048);
+            AssertPixel(pSurface, 12, j, 0xFF204060);
+        }
+    }
+
+    TEST_METHOD(TestDrawSurfaceTransparentClipped)
+    {
+        BitmapSurface pSurface(4, 4);
+        pSurface.FillRectangle(0, 0, 4, 4, Color(0xFF000000));
+
+        BitmapSurface pSource(3, 3, true);
+        pSource.FillRectangle(0, 0, 3, 3, Color(0xFFFFFFFF));
+
+        pSurface.DrawSurface(-1, 2, pSource);
+
+        AssertRectangle(pSurface, 0, 2, 2, 2, 0xFFFFFFFF);
+        AssertRectangle(pSurface, 0, 0, 4, 2, 0xFF000000);
+        AssertRectangle(pSurface, 2, 2, 2, 2, 0xFF000000);
+    }
+
+    TEST_METHOD(TestSetOpacity)
+    {
+        BitmapSurface pSurface(7, 2, true);
+        pSurface.FillRectangle(0, 0, 5, 2, Color(0xFF123456));
+        pSurface.FillRectangle(5, 0, 2, 1, Color(0x40654321));
+
+        pSurface.SetOpacity(0.5);
+
+        AssertRectangle(pSurface, 0, 0, 5, 2, 0x7F123456);
+        AssertPixel(pSurface, 5, 0, 0x7F654321);
+        AssertPixel(pSurface, 6, 0, 0x7F654321);
+        AssertRectangle(pSurface, 5, 1, 2, 1, 0U); // transparent pixels remain transparent
+    }
+
+    TEST_METHOD(TestMeasureText)
+    {
+        GlyphSourceHarness pGlyphs;
+        BitmapSurface pSurface(20, 10, false, &pGlyphs);
+        const auto nFont = pSurface.LoadFont("Tahoma", 12, FontStyles::Normal);
+        Assert::AreEqual(1, nFont);
+
+        const auto szText = pSurface.MeasureText(nFont, L"abc");
+        Assert::AreEqual(12, szText.Width);
+        Assert::AreEqual(3, szText.Height);
+
+        // unknown glyphs are ignored
+        Assert::AreEqual(8, pSurface.MeasureText(nFont, L"a?b").Width);
+    }
+
+    TEST_METHOD(TestMeasureTextNoGlyphSource)
+    {
+        BitmapSurface pSurface(20, 10);
+        Assert::AreEqual(0, pSurface.LoadFont("Tahoma", 12, FontStyles::Normal));
+
+        const auto szText = pSurface.MeasureText(1, L"abc");
+        Assert::AreEqual(0, szText.Width);
+        Assert::AreEqual(0, szText.Height);
+    }
+
+    TEST_METHOD(TestWriteText)
+    {
+        GlyphSourceHarness pGlyphs;
+        BitmapSurface pSurface(10, 5, false, &pGlyphs);
+        pSurface.FillRectangle(0, 0, 10, 5, Color(0x80000000));
+
+        pSurface.WriteText(1, 1, 1, Color(0xFFFFFFFF), L"ab");
+
+        for (unsigned int j = 1; j < 4; ++j)
+        {
+            AssertPixel(pSurface, 0, j, 0x80000000);
+            AssertPixel(pSurface, 1, j, 0xFFFFFFFF);
+            AssertPixel(pSurface, 2, j, 0xFFFFFFFF);
+            AssertPixel(pSurface, 3, j, 0x807F7F7F); // partial coverage keeps the surface alpha
+            AssertPixel(pSurface, 4, j, 0x80000000);
+            AssertPixel(pSurface, 5, j, 0xFFFFFFFF);
+            AssertPixel(pSurface, 6, j, 0xFFFFFFFF);
+            AssertPixel(pSurface, 7, j, 0x807F7F7F);
+            AssertPixel(pSurface, 8, j, 0x80000000);
+        }
+        AssertRectangle(pSurface, 0, 0, 10, 1, 0x80000000);
+        AssertRectangle(pSurface, 0, 4, 10, 1, 0x80000000);
+    }
+
+    TEST_METHOD(TestWriteTextClipped)
+    {
+        GlyphSourceHarness pGlyphs;
+        BitmapSurface pSurface(6, 2, false, &pGlyphs);
+
+        pSurface.WriteText(-1, -1, 1, Color(0xFFFFFFFF), L"ab");
+
+        AssertPixel(pSurface, 0, 0, 0xFFFFFFFF);
+        AssertPixel(pSurface, 1, 0, 0x007F7F7F);
+        AssertPixel(pSurface, 2, 0, 0U);
+        AssertPixel(pSurface, 3, 0, 0xFFFFFFFF);
+        AssertPixel(pSurface, 4, 0, 0xFFFFFFFF);
+        AssertPixel(pSurface, 5, 0, 0x007F7F7F);
+        AssertPixel(pSurface, 0, 1, 0xFFFFFFFF);
+        AssertPixel(pSurface, 5, 1, 0x007F7F7F);
+    }
+
+    TEST_METHOD(TestDrawImage)
+    {
+        ImageSourceHarness pImages;
+        BitmapSurface pSurface(4, 4, false, nullptr, &pImages);
+
+        pSurface.DrawImage(1, 1, 3, 3, ImageReference(ImageType::Local, "2x2"));
+        pSurface.DrawImage(0, 0, 2, 2, ImageReference(ImageType::Local, "unknown"));
+
+        // image is not stretched and is clipped to its own size
+        AssertPixel(pSurface, 1, 1, 0xFFFF0000);
+        AssertPixel(pSurface, 2, 1, 0xFF00FF00);
+        AssertPixel(pSurface, 1, 2, 0xFF0000FF);
+        AssertPixel(pSurface, 2, 2, 0xFFFFFFFF);
+        AssertPixel(pSurface, 3, 3, 0U);
+        AssertPixel(pSurface, 0, 0, 0U);
+    }
+
+    TEST_METHOD(TestDrawImageStretched)
+    {
+        ImageSourceHarness pImages;
+        BitmapSurface pSurface(5, 5, false, nullptr, &pImages);
+
+        pSurface.DrawImageStretched(1, 1, 4, 4, ImageReference(ImageType::Local, "2x2"));
+
+        AssertRectangle(pSurface, 1, 1, 2, 2, 0xFFFF0000);
+        AssertRectangle(pSurface, 3, 1, 2, 2, 0xFF00FF00);
+        AssertRectangle(pSurface, 1, 3, 2, 2, 0xFF0000FF);
+        AssertRectangle(pSurface, 3, 3, 2, 2, 0xFFFFFFFF);
+        AssertRectangle(pSurface, 0, 0, 5, 1, 0U);
+    }
+
+    TEST_METHOD(TestDrawImageStretchedClipped)
+    {
+        ImageSourceHarness pImages;
+        BitmapSurface pSurface(3, 3, false, nullptr, &pImages);
+
+        // the visible portion should still be sampled as if the whole image were drawn
+        pSurface.DrawImageStretched(-1, -1, 4, 4, ImageReference(ImageType::Local, "2x2"));
+
+        AssertPixel(pSurface, 0, 0, 0xFFFF0000);
+        AssertPixel(pSurface, 1, 0, 0xFF00FF00);
+        AssertPixel(pSurface, 2, 0, 0xFF00FF00);
+        AssertPixel(pSurface, 0, 1, 0xFF0000FF);
+        AssertPixel(pSurface, 2, 2, 0xFFFFFFFF);
+    }
+
+    TEST_METHOD(TestFactory)
+    {
+        GlyphSourceHarness pGlyphs;
+        BitmapSurfaceFactory pFactory(&pGlyphs);
+
+        auto pSurface = pFactory.CreateSurface(8, 6);
+        Assert::AreEqual(8U, pSurface->GetWidth());
+        Assert::AreEqual(6U, pSurface->GetHeight());
+        Assert::IsFalse(dynamic_cast<BitmapSurface&>(*pSurface).IsTransparent());
+        Assert::AreEqual(1, pSurface->LoadFont("Tahoma", 12, FontStyles::Normal));
+
+        auto pTransparentSurface = pFactory.CreateTransparentSurface(4, 2);
+        Assert::IsTrue(dynamic_cast<BitmapSurface&>(*pTransparentSurface).IsTransparent());
+
+        Assert::IsFalse(pFactory.SaveImage(*pSurface, L"test.png"));
+    }
+
+    // ===== benchmarks =====
+
+    // composes a frame the way the overlay does: a full screen background, a dimmed page with a list of
+    // achievements, and a couple of popups blended over the top
+    static void ComposeOverlayFrame(ISurface& pSurface, const ISurface& pPopup, int nFont)
+    {
+        const auto nWidth = ra::to_signed(pSurface.GetWidth());
+        const auto nHeight = ra::to_signed(pSurface.GetHeight());
+
+        pSurface.FillRectangle(0, 0, nWidth, nHeight, Color(0xFF202020));
+        for (int i = 0; i < 12; ++i)
+        {
+            const int nY = 40 + i * 48;
+            pSurface.FillRectangle(20, nY, nWidth - 40, 44, Color(0xFF404040));
+            pSurface.WriteText(90, nY + 4, nFont, Color(0xFFFFFFFF), L"Achievement Title Goes Here");
+            pSurface.WriteText(90, nY + 24, nFont, Color(0xFFC0C0C0), L"Description of what needs to be done");
+        }
+
+        pSurface.DrawSurface(10, nHeight - ra::to_signed(pPopup.GetHeight()) - 10, pPopup);
+        pSurface.DrawSurface(nWidth - ra::to_signed(pPopup.GetWidth()) - 10, 10, pPopup);
+    }
+
+    static void RunBenchmark(const wchar_t* sName, unsigned int nWidth, unsigned int nHeight, int nFrames)
+    {
+        GlyphSourceHarness pGlyphs;
+        BitmapSurface pSurface(nWidth, nHeight, false, &pGlyphs);
+        const auto nFont = pSurface.LoadFont("Tahoma", 12, FontStyles::Normal);
+
+        BitmapSurface pPopup(400, 64, true, &pGlyphs);
+        pPopup.FillRectangle(0, 0, 400, 64, Color(0xFF303060));
+        pPopup.WriteText(70, 8, nFont, Color(0xFFFFFFFF), L"Achievement Unlocked");
+        pPopup.SetOpacity(0.85);
+
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nFrames; ++i)
+            ComposeOverlayFrame(pSurface, pPopup, nFont);
+        const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        const auto nMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(tElapsed).count();
+        Logger::WriteMessage(ra::StringPrintf(L"%s: %ux%u, %d frames, %lld us/frame\n", sName, nWidth, nHeight,
+                                              nFrames, static_cast<long long>(nMicroseconds / nFrames)).c_str());
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkOverlayFrame640x480)
+        TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkOverlayFrame640x480)
+    {
+        RunBenchmark(L"BenchmarkOverlayFrame640x480", 640, 480, 100);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkOverlayFrame1920x1080)
+        TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkOverlayFrame1920x1080)
+    {
+        RunBenchmark(L"BenchmarkOverlayFrame1920x1080", 1920, 1080, 20);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkTransparentBlend)
+        TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkTransparentBlend)
+    {
+        BitmapSurface pSurface(1920, 1080);
+        BitmapSurface pLayer(1920, 1080, true);
+        pLayer.FillRectangle(0, 0, 1920, 1080, Color(0xFF8090A0));
+        pLayer.SetOpacity(0.75);
+
+        constexpr int nFrames = 20;
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nFrames; ++i)
+            pSurface.DrawSurface(0, 0, pLayer);
+        const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        const auto nMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(tElapsed).count();
+        Logger::WriteMessage(ra::StringPrintf(L"BenchmarkTransparentBlend: 1920x1080, %lld us/blend\n",
+                                              static_cast<long long>(nMicroseconds / nFrames)).c_str());
+
+        // every pixel should have been blended the same way, and the destination alpha should be untouched
+        Assert::AreEqual(pSurface.GetPixel(0, 0).ARGB, pSurface.GetPixel(1919, 1079).ARGB);
+        Assert::AreEqual(0U, pSurface.GetPixel(0, 0).ARGB >> 24);
+    }
+};
+
+} // namespace tests
+} // namespace bitmap
+} // namespace drawing
+} // namespace ui
+} // namespace ra
@@ -0,0 +1,160 @@
+#include "ui\drawing\ImageAtlas.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+#include "tests\mocks\MockImageRepository.hh"
+#include "tests\mocks\MockSurface.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace tests {
+
+TEST_CLASS(ImageAtlas_Tests)
+{
+private:
+    class ImageAtlasHarness : public ImageAtlas
+    {
+    public:
+        ImageAtlasHarness() noexcept : ImageAtlas(64, Color(0xFF000000)) {}
+
+        ra::ui::mocks::MockImageRepository mockImageRepository;
+        ra::ui::drawing::mocks::MockSurfaceFactory mockSurfaceFactory;
+    };
+
+public:
+    TEST_METHOD(TestAdd)
+    {
+        ImageAtlasHarness atlas;
+        atlas.Add(ImageType::Badge, "12345");
+        atlas.Add(ImageType::Badge, "12345_lock");
+        atlas.Add(ImageType::Badge, "12345"); // duplicate is ignored
+        atlas.Add(ImageType::Badge, "");
+        atlas.Add(ImageType::None, "12345");
+
+        Assert::AreEqual({ 2U }, atlas.Count());
+        Assert::IsTrue(atlas.Contains(ImageType::Badge, "12345"));
+        Assert::IsTrue(atlas.Contains(ImageType::Badge, "12345_lock"));
+        Assert::IsFalse(atlas.Contains(ImageType::Icon, "12345"));
+
+        // surfaces aren't allocated until the atlas is built
+        Assert::AreEqual({ 0U }, atlas.SurfaceCount());
+    }
+
+    TEST_METHOD(TestDraw)
+    {
+        ImageAtlasHarness atlas;
+        atlas.Add(ImageType::Badge, "12345");
+        atlas.mockImageRepository.SetImageAvailable(ImageType::Badge, "12345");
+
+        ra::ui::drawing::mocks::MockSurface mockSurface(800, 600);
+        const ImageReference pImage(ImageType::Badge, "12345");
+
+        // not available until built
+        Assert::IsFalse(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(0, mockSurface.GetDrawSurfaceCount());
+
+        atlas.Build();
+        Assert::AreEqual({ 1U }, atlas.SurfaceCount());
+        Assert::IsTrue(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(1, mockSurface.GetDrawSurfaceCount());
+
+        // second draw uses the already rendered cell
+        Assert::IsTrue(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(2, mockSurface.GetDrawSurfaceCount());
+
+        // images not in the atlas have to be drawn directly
+        const ImageReference pOther(ImageType::Badge, "54321");
+        Assert::IsFalse(atlas.Draw(mockSurface, 10, 20, pOther));
+        Assert::AreEqual(2, mockSurface.GetDrawSurfaceCount());
+    }
+
+    TEST_METHOD(TestDrawImageNotAvailable)
+    {
+        ImageAtlasHarness atlas;
+        atlas.Add(ImageType::Badge, "12345");
+        atlas.Build();
+
+        ra::ui::drawing::mocks::MockSurface mockSurface(800, 600);
+        const ImageReference pImage(ImageType::Badge, "12345");
+
+        // image hasn't been downloaded. caller has to draw the placeholder
+        Assert::IsFalse(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(0, mockSurface.GetDrawSurfaceCount());
+
+        // once the image is available, it's drawn from the atlas
+        atlas.mockImageRepository.SetImageAvailable(ImageType::Badge, "12345");
+        Assert::IsTrue(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(1, mockSurface.GetDrawSurfaceCount());
+    }
+
+    TEST_METHOD(TestDrawImageDecodePending)
+    {
+        ImageAtlasHarness atlas;
+        atlas.Add(ImageType::Badge, "12345");
+        atlas.Build();
+
+        ra::ui::drawing::mocks::MockSurface mockSurface(800, 600);
+        const ImageReference pImage(ImageType::Badge, "12345");
+
+        // image has been downloaded, but not decoded. the cell shouldn't be filled with the placeholder.
+        atlas.mockImageRepository.SetImageAvailable(ImageType::Badge, "12345");
+        atlas.mockImageRepository.SetDecodePending(ImageType::Badge, "12345", true);
+        Assert::IsFalse(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::IsFalse(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(0, mockSurface.GetDrawSurfaceCount());
+
+        // once the image is decoded, it's drawn from the atlas
+        atlas.mockImageRepository.SetDecodePending(ImageType::Badge, "12345", false);
+        Assert::IsTrue(atlas.Draw(mockSurface, 10, 20, pImage));
+        Assert::AreEqual(1, mockSurface.GetDrawSurfaceCount());
+    }
+
+    TEST_METHOD(TestBuildMultipleSurfaces)
+    {
+        // 64x64 images in 1024x1024 surfaces allows 256 images per surface
+        ImageAtlasHarness atlas;
+        for (int i = 0; i < 300; ++i)
+            atlas.Add(ImageType::Badge, std::to_string(i));
+
+        atlas.Build();
+        Assert::AreEqual({ 300U }, atlas.Count());
+        Assert::AreEqual({ 2U }, atlas.SurfaceCount());
+
+        // building again without adding anything doesn't allocate anything
+        atlas.Build();
+        Assert::AreEqual({ 2U }, atlas.SurfaceCount());
+
+        // new images are put in a new surface
+        atlas.Add(ImageType::Badge, "new");
+        atlas.Build();
+        Assert::AreEqual({ 301U }, atlas.Count());
+        Assert::AreEqual({ 3U }, atlas.SurfaceCount());
+
+        atlas.mockImageRepository.SetImageAvailable(ImageType::Badge, "new");
+        atlas.mockImageRepository.SetImageAvailable(ImageType::Badge, "299");
+
+        ra::ui::drawing::mocks::MockSurface mockSurface(800, 600);
+        Assert::IsTrue(atlas.Draw(mockSurface, 0, 0, ImageReference(ImageType::Badge, "new")));
+        Assert::IsTrue(atlas.Draw(mockSurface, 0, 0, ImageReference(ImageType::Badge, "299")));
+    }
+
+    TEST_METHOD(TestClear)
+    {
+        ImageAtlasHarness atlas;
+        atlas.Add(ImageType::Badge, "12345");
+        atlas.Build();
+
+        atlas.Clear();
+        Assert::AreEqual({ 0U }, atlas.Count());
+        Assert::AreEqual({ 0U }, atlas.SurfaceCount());
+        Assert::IsFalse(atlas.Contains(ImageType::Badge, "12345"));
+    }
+};
+
+} // namespace tests
+} // namespace drawing
+} // namespace ui
+} // namespace ra
@@ -0,0 +1,312 @@
+#include "ui\drawing\ImageCache.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+#include "tests\mocks\MockThreadPool.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace tests {
+
+TEST_CLASS(ImageCache_Tests)
+{
+private:
+    class MockDecoder : public ImageCache::IDecoder
+    {
+    public:
+        bool Decode(const std::string& sData, unsigned int nWidth, unsigned int nHeight, ImageCache::Image& pImage) override
+        {
+            ++nDecodeCount;
+            sLastData = sData;
+
+            if (sData == "bad")
+                return false;
+
+            // natural size of all test images is 16x16
+            pImage.nWidth = (nWidth == 0) ? 16 : nWidth;
+            pImage.nHeight = (nHeight == 0) ? 16 : nHeight;
+            pImage.vPixels.resize(gsl::narrow_cast<size_t>(pImage.nWidth) * pImage.nHeight, 0xFF0000FF);
+            return true;
+        }
+
+        int nDecodeCount = 0;
+        std::string sLastData;
+    };
+
+    class ImageCacheHarness : public ImageCache
+    {
+    public:
+        static std::unique_ptr<ImageCacheHarness> Create(size_t nMaxMemory = ImageCache::DEFAULT_MAX_MEMORY)
+        {
+            auto pDecoder = std::make_unique<MockDecoder>();
+            auto* pDecoderPtr = pDecoder.get();
+            auto pHarness = std::unique_ptr<ImageCacheHarness>(new ImageCacheHarness(std::move(pDecoder), nMaxMemory));
+            pHarness->mockDecoder = pDecoderPtr;
+            pHarness->SetDecodedHandler([pHarness = pHarness.get()](ImageType, const std::string& sName)
+            {
+                pHarness->vDecoded.push_back(sName);
+            });
+            return pHarness;
+        }
+
+        std::shared_ptr<const ImageCache::Image> Request(const std::string& sName, unsigned int nSize = 16)
+        {
+            return ImageCache::Request(ImageType::Badge, sName, nSize, nSize, [sName]() { return sName; });
+        }
+
+        ra::services::mocks::MockThreadPool mockThreadPool;
+        MockDecoder* mockDecoder = nullptr;
+        std::vector<std::string> vDecoded;
+
+    private:
+        ImageCacheHarness(std::unique_ptr<MockDecoder>&& pDecoder, size_t nMaxMemory)
+            : ImageCache(std::move(pDecoder), nMaxMemory)
+        {
+        }
+    };
+
+public:
+    TEST_METHOD(TestRequestDecodesInBackground)
+    {
+        auto cache = ImageCacheHarness::Create();
+
+        // first request returns a placeholder and queues the decode
+        Assert::IsNull(cache->Request("12345").get());
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "12345") == ImageCache::State::Pending);
+        Assert::AreEqual({ 1U }, cache->mockThreadPool.PendingTasks());
+        Assert::AreEqual(0, cache->mockDecoder->nDecodeCount);
+
+        // a second request while pending does not queue another decode
+        Assert::IsNull(cache->Request("12345").get());
+        Assert::AreEqual({ 1U }, cache->mockThreadPool.PendingTasks());
+
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(1, cache->mockDecoder->nDecodeCount);
+        Assert::AreEqual(std::string("12345"), cache->mockDecoder->sLastData);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "12345") == ImageCache::State::Ready);
+        Assert::AreEqual({ 1U }, cache->vDecoded.size());
+        Assert::AreEqual(std::string("12345"), cache->vDecoded.front());
+
+        // image is now available without decoding again
+        const auto pImage = cache->Request("12345");
+        Assert::IsNotNull(pImage.get());
+        Assert::AreEqual(16U, pImage->nWidth);
+        Assert::AreEqual(16U, pImage->nHeight);
+        Assert::AreEqual({ 256U }, pImage->vPixels.size());
+        Assert::AreEqual({ 0U }, cache->mockThreadPool.PendingTasks());
+        Assert::AreEqual(1, cache->mockDecoder->nDecodeCount);
+    }
+
+    TEST_METHOD(TestRequestSeparatesImageTypes)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("12345");
+        cache->mockThreadPool.ExecuteNextTask();
+
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "12345") == ImageCache::State::Ready);
+        Assert::IsTrue(cache->GetState(ImageType::Icon, "12345") == ImageCache::State::None);
+    }
+
+    TEST_METHOD(TestRequestDifferentSize)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("12345", 16);
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::IsNotNull(cache->Request("12345", 16).get());
+
+        // different size has to be decoded again
+        Assert::IsNull(cache->Request("12345", 32).get());
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(2, cache->mockDecoder->nDecodeCount);
+
+        const auto pImage = cache->Request("12345", 32);
+        Assert::IsNotNull(pImage.get());
+        Assert::AreEqual(32U, pImage->nWidth);
+    }
+
+    TEST_METHOD(TestRequestNaturalSize)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("12345", 0);
+        cache->mockThreadPool.ExecuteNextTask();
+
+        const auto pImage = cache->Request("12345", 0);
+        Assert::IsNotNull(pImage.get());
+        Assert::AreEqual(16U, pImage->nWidth);
+        Assert::AreEqual(16U, pImage->nHeight);
+    }
+
+    TEST_METHOD(TestDecodeFailure)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("bad");
+        cache->mockThreadPool.ExecuteNextTask();
+
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "bad") == ImageCache::State::Failed);
+        Assert::AreEqual({ 0U }, cache->vDecoded.size());
+
+        // failed images are not retried
+        Assert::IsNull(cache->Request("bad").get());
+        Assert::AreEqual({ 0U }, cache->mockThreadPool.PendingTasks());
+
+        // until the data changes
+        cache->Invalidate(ImageType::Badge, "bad");
+        Assert::IsNull(cache->Request("bad").get());
+        Assert::AreEqual({ 1U }, cache->mockThreadPool.PendingTasks());
+    }
+
+    TEST_METHOD(TestNoData)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->ImageCache::Request(ImageType::Badge, "12345", 16, 16, []() { return std::string(); });
+        cache->mockThreadPool.ExecuteNextTask();
+
+        // decoder isn't called if there's nothing to decode
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "12345") == ImageCache::State::Failed);
+        Assert::AreEqual(0, cache->mockDecoder->nDecodeCount);
+    }
+
+    TEST_METHOD(TestInvalidateWhileDecoding)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("12345");
+        cache->Invalidate(ImageType::Badge, "12345");
+
+        // the outstanding decode is for the old data and should be ignored
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "12345") == ImageCache::State::None);
+        Assert::AreEqual({ 0U }, cache->vDecoded.size());
+
+        Assert::IsNull(cache->Request("12345").get());
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::IsNotNull(cache->Request("12345").get());
+    }
+
+    TEST_METHOD(TestInvalidateReleasesMemory)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("12345");
+        const auto nUsage = cache->GetMemoryUsage();
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(nUsage + 1024, cache->GetMemoryUsage());
+
+        cache->Invalidate(ImageType::Badge, "12345");
+        Assert::AreEqual(nUsage, cache->GetMemoryUsage());
+    }
+
+    TEST_METHOD(TestEvictLeastRecentlyUsed)
+    {
+        // each image is 1024 bytes plus overhead, so only two will fit
+        auto cache = ImageCacheHarness::Create(2600);
+        cache->Request("1");
+        cache->mockThreadPool.ExecuteNextTask();
+        cache->Request("2");
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 2U }, cache->Count());
+
+        // using "1" makes "2" the oldest entry
+        Assert::IsNotNull(cache->Request("1").get());
+
+        cache->Request("3");
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 2U }, cache->Count());
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "1") == ImageCache::State::Ready);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "2") == ImageCache::State::None);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "3") == ImageCache::State::Ready);
+        Assert::IsTrue(cache->GetMemoryUsage() <= 2600U);
+    }
+
+    TEST_METHOD(TestReferencedImagesNotEvicted)
+    {
+        auto cache = ImageCacheHarness::Create(2600);
+        cache->Request("1");
+        cache->mockThreadPool.ExecuteNextTask();
+        cache->AddReference(ImageType::Badge, "1");
+        cache->Request("2");
+        cache->mockThreadPool.ExecuteNextTask();
+
+        // "1" is the oldest, but it's referenced, so "2" is evicted instead
+        cache->Request("3");
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "1") == ImageCache::State::Ready);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "2") == ImageCache::State::None);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "3") == ImageCache::State::Ready);
+
+        // once released, "1" can be evicted
+        cache->ReleaseReference(ImageType::Badge, "1");
+        cache->Request("4");
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "1") == ImageCache::State::None);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "3") == ImageCache::State::Ready);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "4") == ImageCache::State::Ready);
+    }
+
+    TEST_METHOD(TestPendingImagesNotEvicted)
+    {
+        // only one image will fit
+        auto cache = ImageCacheHarness::Create(1300);
+        cache->Request("1");
+        cache->Request("2");
+
+        // "2" is older than "1" after "1" is decoded, but is still pending, so it's kept
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 2U }, cache->Count());
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "1") == ImageCache::State::Ready);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "2") == ImageCache::State::Pending);
+
+        // once "2" is decoded, "1" is evicted
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 1U }, cache->Count());
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "1") == ImageCache::State::None);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "2") == ImageCache::State::Ready);
+    }
+
+    TEST_METHOD(TestOversizedImage)
+    {
+        auto cache = ImageCacheHarness::Create(2600);
+        cache->Request("1");
+        cache->mockThreadPool.ExecuteNextTask();
+
+        // an image larger than the cache pushes everything else out, but is still available
+        cache->Request("huge", 64);
+        cache->mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 1U }, cache->Count());
+        Assert::IsNotNull(cache->Request("huge", 64).get());
+    }
+
+    TEST_METHOD(TestReleaseUnreferencedImage)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->ReleaseReference(ImageType::Badge, "12345");
+        Assert::AreEqual({ 0U }, cache->Count());
+
+        cache->Request("12345");
+        cache->mockThreadPool.ExecuteNextTask();
+        cache->ReleaseReference(ImageType::Badge, "12345");
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "12345") == ImageCache::State::Ready);
+    }
+
+    TEST_METHOD(TestClear)
+    {
+        auto cache = ImageCacheHarness::Create();
+        cache->Request("1");
+        cache->mockThreadPool.ExecuteNextTask();
+        cache->Request("2");
+        cache->mockThreadPool.ExecuteNextTask();
+        cache->AddReference(ImageType::Badge, "2");
+
+        // referenced images are kept
+        cache->Clear();
+        Assert::AreEqual({ 1U }, cache->Count());
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "1") == ImageCache::State::None);
+        Assert::IsTrue(cache->GetState(ImageType::Badge, "2") == ImageCache::State::Ready);
+    }
+};
+
+} // namespace tests
+} // namespace drawing
+} // namespace ui
+} // namespace ra
@@ -0,0 +1,168 @@
+#include "ui\drawing\PngEncoder.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace tests {
+
+TEST_CLASS(PngEncoder_Tests)
+{
+private:
+    static std::uint32_t ReadUInt32(const std::string& sData, size_t nOffset)
+    {
+        return (gsl::narrow_cast<std::uint32_t>(gsl::narrow_cast<std::uint8_t>(sData.at(nOffset))) << 24) |
+               (gsl::narrow_cast<std::uint32_t>(gsl::narrow_cast<std::uint8_t>(sData.at(nOffset + 1))) << 16) |
+               (gsl::narrow_cast<std::uint32_t>(gsl::narrow_cast<std::uint8_t>(sData.at(nOffset + 2))) << 8) |
+               gsl::narrow_cast<std::uint32_t>(gsl::narrow_cast<std::uint8_t>(sData.at(nOffset + 3)));
+    }
+
+    static std::string Compress(const std::string& sInput)
+    {
+        PngEncoder pEncoder;
+        const std::vector<std::uint8_t> vData(sInput.begin(), sInput.end());
+        std::string sOutput;
+        pEncoder.Compress(vData, sOutput);
+        return sOutput;
+    }
+
+    static std::string Bytes(std::initializer_list<std::uint8_t> vBytes)
+    {
+        return std::string(vBytes.begin(), vBytes.end());
+    }
+
+public:
+    TEST_METHOD(TestCrc32)
+    {
+        const std::string sData = "123456789";
+        GSL_SUPPRESS_TYPE1 const auto* pData = reinterpret_cast<const std::uint8_t*>(sData.data());
+        Assert::AreEqual(0xCBF43926U, PngEncoder::Crc32(0, pData, sData.length()));
+
+        // can be calculated in pieces
+        Assert::AreEqual(0xCBF43926U, PngEncoder::Crc32(PngEncoder::Crc32(0, pData, 4), pData + 4, 5));
+    }
+
+    TEST_METHOD(TestAdler32)
+    {
+        const std::string sData = "Wikipedia";
+        GSL_SUPPRESS_TYPE1 const auto* pData = reinterpret_cast<const std::uint8_t*>(sData.data());
+        Assert::AreEqual(0x11E60398U, PngEncoder::Adler32(1, pData, sData.length()));
+
+        // large enough to require the sums to be reduced
+        const std::vector<std::uint8_t> vData(100000, 0xFF);
+        Assert::AreEqual(0x149A302CU, PngEncoder::Adler32(1, vData.data(), vData.size()));
+    }
+
+    TEST_METHOD(TestCompress)
+    {
+        // expected values have been verified by decompressing them with zlib
+        Assert::AreEqual(Bytes({ 0x78, 0x9C, 0x03, 0x00, 0x00, 0x00, 0x00, 0x01 }), Compress(""));
+        Assert::AreEqual(Bytes({ 0x78, 0x9C, 0x4B, 0x04, 0x00, 0x00, 0x62, 0x00, 0x62 }), Compress("a"));
+        Assert::AreEqual(Bytes({ 0x78, 0x9C, 0x4B, 0x84, 0x03, 0x00, 0x14, 0xE1, 0x03, 0xCB }), Compress("aaaaaaaaaa"));
+        Assert::AreEqual(Bytes({ 0x78, 0x9C, 0x4B, 0x4C, 0x4A, 0x86, 0x23, 0x00, 0x1D, 0xE0, 0x04, 0x99 }), Compress("abcabcabcabc"));
+    }
+
+    TEST_METHOD(TestEncodeInvalid)
+    {
+        PngEncoder pEncoder;
+        Assert::AreEqual(std::string(), pEncoder.Encode(0, 0, {}));
+        Assert::AreEqual(std::string(), pEncoder.Encode(2, 2, { 0xFF000000, 0xFF000000, 0xFF000000 }));
+    }
+
+    TEST_METHOD(TestEncode)
+    {
+        PngEncoder pEncoder;
+        const std::vector<std::uint32_t> vPixels = { 0xFFFF0000, 0xFF00FF00, 0x000000FF, 0xFF808080, 0xFFFFFFFF, 0xFF000000 };
+        const auto sPng = pEncoder.Encode(3, 2, vPixels);
+
+        Assert::AreEqual(Bytes({ 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A }), sPng.substr(0, 8));
+
+        // IHDR
+        Assert::AreEqual(13U, ReadUInt32(sPng, 8));
+        Assert::AreEqual(std::string("IHDR"), sPng.substr(12, 4));
+        Assert::AreEqual(3U, ReadUInt32(sPng, 16));
+        Assert::AreEqual(2U, ReadUInt32(sPng, 20));
+        Assert::AreEqual(Bytes({ 8, 2, 0, 0, 0 }), sPng.substr(24, 5));
+
+        // every chunk should have a valid CRC, and the image should end with IEND
+        std::vector<std::string> vChunks;
+        size_t nOffset = 8;
+        while (nOffset < sPng.length())
+        {
+            const auto nLength = ReadUInt32(sPng, nOffset);
+            vChunks.push_back(sPng.substr(nOffset + 4, 4));
+
+            GSL_SUPPRESS_TYPE1 const auto* pChunk = reinterpret_cast<const std::uint8_t*>(sPng.data() + nOffset + 4);
+            Assert::AreEqual(PngEncoder::Crc32(0, pChunk, nLength + 4), ReadUInt32(sPng, nOffset + 8 + nLength));
+
+            nOffset += nLength + 12;
+        }
+
+        Assert::AreEqual(sPng.length(), nOffset);
+        Assert::AreEqual({ 3U }, vChunks.size());
+        Assert::AreEqual(std::string("IDAT"), vChunks.at(1));
+        Assert::AreEqual(std::string("IEND"), vChunks.at(2));
+    }
+
+    TEST_METHOD(TestEncodeReusesEncoder)
+    {
+        PngEncoder pEncoder;
+        const std::vector<std::uint32_t> vSmall(4, 0xFF336699);
+        const auto sFirst = pEncoder.Encode(2, 2, vSmall);
+
+        const std::vector<std::uint32_t> vLarge(100 * 100, 0xFF996633);
+        pEncoder.Encode(100, 100, vLarge);
+
+        // scratch buffers from the larger image should not affect the smaller one
+        Assert::AreEqual(sFirst, pEncoder.Encode(2, 2, vSmall));
+    }
+
+    TEST_METHOD(TestEncodeSolidColor)
+    {
+        // a solid color should compress to almost nothing
+        PngEncoder pEncoder;
+        const std::vector<std::uint32_t> vPixels(640 * 480, 0xFF336699);
+        const auto sPng = pEncoder.Encode(640, 480, vPixels);
+        Assert::IsTrue(sPng.length() < 640 * 480 * 3 / 100);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkEncode1920x1080)
+        TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkEncode1920x1080)
+    {
+        // gradients with some noise to approximate a game screen
+        std::vector<std::uint32_t> vPixels(1920 * 1080);
+        unsigned int nSeed = 12345;
+        for (unsigned int nY = 0; nY < 1080; ++nY)
+        {
+            for (unsigned int nX = 0; nX < 1920; ++nX)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                const auto nNoise = (nSeed >> 16) & 0x07;
+                vPixels.at(gsl::narrow_cast<size_t>(nY) * 1920 + nX) = 0xFF000000 | (((nX / 8) & 0xFF) << 16) |
+                                                                     (((nY / 4) & 0xFF) << 8) | ((nX ^ nY) & 0xF8) | nNoise;
+            }
+        }
+
+        PngEncoder pEncoder;
+        constexpr int nIterations = 5;
+        size_t nSize = 0;
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nIterations; ++i)
+            nSize = pEncoder.Encode(1920, 1080, vPixels).length();
+        const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        const auto nMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(tElapsed).count();
+        Logger::WriteMessage(ra::StringPrintf(L"BenchmarkEncode1920x1080: %zu bytes, %lld ms/image\n", nSize,
+                                              static_cast<long long>(nMilliseconds / nIterations)).c_str());
+    }
+};
+
+} // namespace tests
+} // namespace drawing
+} // namespace ui
+} // namespace ra
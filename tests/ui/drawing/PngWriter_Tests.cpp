@@ -0,0 +1,167 @@
+#include "ui\drawing\PngWriter.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+#include "tests\mocks\MockFileSystem.hh"
+#include "tests\mocks\MockThreadPool.hh"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace tests {
+
+TEST_CLASS(PngWriter_Tests)
+{
+private:
+    class PngWriterHarness : public PngWriter
+    {
+    public:
+        explicit PngWriterHarness(size_t nMaxQueued = PngWriter::DEFAULT_MAX_QUEUED) noexcept
+            : PngWriter(nMaxQueued)
+        {
+        }
+
+        bool Enqueue(const std::wstring& sPath, unsigned int nSize = 2)
+        {
+            auto vPixels = AcquireBuffer(gsl::narrow_cast<size_t>(nSize) * nSize);
+            std::fill(vPixels.begin(), vPixels.end(), 0xFF336699);
+            return PngWriter::Enqueue(nSize, nSize, std::move(vPixels), sPath);
+        }
+
+        void EnqueueAndWait(const std::wstring& sPath, unsigned int nSize = 2)
+        {
+            auto vPixels = AcquireBuffer(gsl::narrow_cast<size_t>(nSize) * nSize);
+            std::fill(vPixels.begin(), vPixels.end(), 0xFF336699);
+            PngWriter::EnqueueAndWait(nSize, nSize, std::move(vPixels), sPath);
+        }
+
+        bool IsPng(const std::wstring& sPath)
+        {
+            const auto& sContents = mockFileSystem.GetFileContents(sPath);
+            return (sContents.length() > 8 && sContents.compare(1, 3, "PNG") == 0);
+        }
+
+        ra::services::mocks::MockThreadPool mockThreadPool;
+        ra::services::mocks::MockFileSystem mockFileSystem;
+    };
+
+public:
+    TEST_METHOD(TestEnqueue)
+    {
+        PngWriterHarness writer;
+        Assert::IsTrue(writer.Enqueue(L"1.png"));
+        Assert::AreEqual({ 1U }, writer.QueuedCount());
+
+        // not written until the background task runs
+        Assert::IsFalse(writer.IsPng(L"1.png"));
+        Assert::AreEqual({ 1U }, writer.mockThreadPool.PendingTasks());
+
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(writer.IsPng(L"1.png"));
+        Assert::AreEqual({ 0U }, writer.QueuedCount());
+    }
+
+    TEST_METHOD(TestEnqueueMultiple)
+    {
+        PngWriterHarness writer;
+        Assert::IsTrue(writer.Enqueue(L"1.png"));
+        Assert::IsTrue(writer.Enqueue(L"2.png"));
+
+        // one task processes everything in the queue
+        Assert::AreEqual({ 1U }, writer.mockThreadPool.PendingTasks());
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(writer.IsPng(L"1.png"));
+        Assert::IsTrue(writer.IsPng(L"2.png"));
+
+        // a new task is started for anything queued after the task finishes
+        Assert::IsTrue(writer.Enqueue(L"3.png"));
+        Assert::AreEqual({ 1U }, writer.mockThreadPool.PendingTasks());
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(writer.IsPng(L"3.png"));
+    }
+
+    TEST_METHOD(TestQueueIsBounded)
+    {
+        PngWriterHarness writer(2);
+        Assert::IsTrue(writer.Enqueue(L"1.png"));
+        Assert::IsTrue(writer.Enqueue(L"2.png"));
+        Assert::IsFalse(writer.Enqueue(L"3.png"));
+        Assert::AreEqual({ 2U }, writer.QueuedCount());
+
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(writer.IsPng(L"1.png"));
+        Assert::IsTrue(writer.IsPng(L"2.png"));
+        Assert::IsFalse(writer.IsPng(L"3.png"));
+
+        // space is available again once the queue has been written
+        Assert::IsTrue(writer.Enqueue(L"3.png"));
+    }
+
+    TEST_METHOD(TestEnqueueAndWait)
+    {
+        PngWriterHarness writer(2);
+        writer.EnqueueAndWait(L"1.png");
+        writer.EnqueueAndWait(L"2.png");
+        Assert::AreEqual({ 2U }, writer.QueuedCount());
+        Assert::AreEqual({ 1U }, writer.mockThreadPool.PendingTasks());
+
+        // queue is full and the writer task hasn't started. the queue is written by the caller to make room.
+        writer.EnqueueAndWait(L"3.png");
+        Assert::IsTrue(writer.IsPng(L"1.png"));
+        Assert::IsTrue(writer.IsPng(L"2.png"));
+        Assert::IsFalse(writer.IsPng(L"3.png"));
+        Assert::AreEqual({ 1U }, writer.QueuedCount());
+
+        // the writer task picks up the remaining image
+        while (writer.mockThreadPool.PendingTasks() > 0)
+            writer.mockThreadPool.ExecuteNextTask();
+
+        Assert::IsTrue(writer.IsPng(L"3.png"));
+        Assert::AreEqual({ 0U }, writer.QueuedCount());
+    }
+
+    TEST_METHOD(TestBuffersAreReused)
+    {
+        PngWriterHarness writer;
+        auto vPixels = writer.AcquireBuffer(16);
+        const auto* pData = vPixels.data();
+        Assert::IsTrue(writer.PngWriter::Enqueue(4, 4, std::move(vPixels), L"1.png"));
+        Assert::AreEqual({ 0U }, writer.PooledBufferCount());
+
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual({ 1U }, writer.PooledBufferCount());
+
+        const auto vReused = writer.AcquireBuffer(16);
+        Assert::IsTrue(pData == vReused.data());
+        Assert::AreEqual({ 16U }, vReused.size());
+        Assert::AreEqual({ 0U }, writer.PooledBufferCount());
+    }
+
+    TEST_METHOD(TestPooledBuffersAreLimited)
+    {
+        PngWriterHarness writer;
+        for (int i = 0; i < 4; ++i)
+            Assert::IsTrue(writer.Enqueue(ra::StringPrintf(L"%d.png", i)));
+
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::AreEqual(PngWriter::MAX_POOLED_BUFFERS, writer.PooledBufferCount());
+    }
+
+    TEST_METHOD(TestInvalidImageNotWritten)
+    {
+        PngWriterHarness writer;
+        std::vector<std::uint32_t> vPixels(3, 0xFF000000);
+        Assert::IsTrue(writer.PngWriter::Enqueue(2, 2, std::move(vPixels), L"1.png"));
+
+        writer.mockThreadPool.ExecuteNextTask();
+        Assert::IsFalse(writer.IsPng(L"1.png"));
+        Assert::AreEqual({ 0U }, writer.QueuedCount());
+    }
+};
+
+} // namespace tests
+} // namespace drawing
+} // namespace ui
+} // namespace ra
@@ -0,0 +1,181 @@
+#include "ui\drawing\TextCache.hh"
+
+#include "tests\RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace ui {
+namespace drawing {
+namespace tests {
+
+TEST_CLASS(TextCache_Tests)
+{
+private:
+    static TextCache::Mask CreateMask(int nWidth, int nHeight, std::uint8_t nCoverage = 255)
+    {
+        TextCache::Mask pMask;
+        pMask.szText = ra::ui::Size{nWidth, nHeight};
+        pMask.vCoverage.resize(gsl::narrow_cast<size_t>(nWidth) * nHeight, nCoverage);
+        return pMask;
+    }
+
+public:
+    TEST_METHOD(TestStoreSize)
+    {
+        TextCache pCache;
+        ra::ui::Size szText;
+        Assert::IsFalse(pCache.FindSize(1, L"Hello", szText));
+
+        pCache.StoreSize(1, L"Hello", ra::ui::Size{30, 12});
+
+        Assert::IsTrue(pCache.FindSize(1, L"Hello", szText));
+        Assert::AreEqual(30, szText.Width);
+        Assert::AreEqual(12, szText.Height);
+
+        // measuring doesn't provide a mask
+        Assert::IsTrue(pCache.FindMask(1, L"Hello") == nullptr);
+
+        // different font
+        Assert::IsFalse(pCache.FindSize(2, L"Hello", szText));
+        Assert::AreEqual({ 1U }, pCache.Count());
+    }
+
+    TEST_METHOD(TestStoreMask)
+    {
+        TextCache pCache;
+        const auto pStored = pCache.StoreMask(1, L"Hello", CreateMask(30, 12, 128));
+        Assert::IsFalse(pStored == nullptr);
+        Ensures(pStored != nullptr);
+        Assert::AreEqual(30, pStored->szText.Width);
+        Assert::AreEqual({ 360U }, pStored->vCoverage.size());
+
+        const auto pMask = pCache.FindMask(1, L"Hello");
+        Assert::IsTrue(pMask == pStored);
+
+        // storing a mask also provides the size
+        ra::ui::Size szText;
+        Assert::IsTrue(pCache.FindSize(1, L"Hello", szText));
+        Assert::AreEqual(30, szText.Width);
+        Assert::AreEqual(12, szText.Height);
+
+        Assert::IsTrue(pCache.FindMask(2, L"Hello") == nullptr);
+        Assert::IsTrue(pCache.FindMask(1, L"Hello!") == nullptr);
+    }
+
+    TEST_METHOD(TestStoreSizeAfterMask)
+    {
+        TextCache pCache;
+        pCache.StoreMask(1, L"Hello", CreateMask(30, 12));
+
+        // same size keeps the mask
+        pCache.StoreSize(1, L"Hello", ra::ui::Size{30, 12});
+        Assert::IsFalse(pCache.FindMask(1, L"Hello") == nullptr);
+
+        // different size discards it
+        pCache.StoreSize(1, L"Hello", ra::ui::Size{31, 12});
+        Assert::IsTrue(pCache.FindMask(1, L"Hello") == nullptr);
+        ra::ui::Size szText;
+        Assert::IsTrue(pCache.FindSize(1, L"Hello", szText));
+        Assert::AreEqual(31, szText.Width);
+        Assert::AreEqual({ 1U }, pCache.Count());
+    }
+
+    TEST_METHOD(TestEvictLeastRecentlyUsed)
+    {
+        // each mask is 1000 bytes plus overhead, so only two will fit
+        TextCache pCache(2500);
+        pCache.StoreMask(1, L"One", CreateMask(100, 10));
+        pCache.StoreMask(1, L"Two", CreateMask(100, 10));
+        Assert::AreEqual({ 2U }, pCache.Count());
+
+        // using "One" makes "Two" the oldest entry
+        Assert::IsFalse(pCache.FindMask(1, L"One") == nullptr);
+
+        pCache.StoreMask(1, L"Three", CreateMask(100, 10));
+        Assert::AreEqual({ 2U }, pCache.Count());
+        Assert::IsFalse(pCache.FindMask(1, L"One") == nullptr);
+        Assert::IsTrue(pCache.FindMask(1, L"Two") == nullptr);
+        Assert::IsFalse(pCache.FindMask(1, L"Three") == nullptr);
+        Assert::IsTrue(pCache.GetMemoryUsage() <= 2500U);
+    }
+
+    TEST_METHOD(TestOversizedMask)
+    {
+        TextCache pCache(2500);
+        pCache.StoreMask(1, L"One", CreateMask(100, 10));
+
+        // a mask larger than the cache pushes everything else out, but is still returned
+        const auto pMask = pCache.StoreMask(1, L"Huge", CreateMask(100, 100));
+        Ensures(pMask != nullptr);
+        Assert::AreEqual({ 10000U }, pMask->vCoverage.size());
+        Assert::AreEqual({ 1U }, pCache.Count());
+        Assert::IsTrue(pCache.FindMask(1, L"One") == nullptr);
+
+        // and is discarded when the next item is stored
+        pCache.StoreMask(1, L"Two", CreateMask(100, 10));
+        Assert::AreEqual({ 1U }, pCache.Count());
+        Assert::IsTrue(pCache.FindMask(1, L"Huge") == nullptr);
+
+        // the caller's reference is still valid
+        Assert::AreEqual({ 10000U }, pMask->vCoverage.size());
+    }
+
+    TEST_METHOD(TestReplaceMaskUpdatesMemoryUsage)
+    {
+        TextCache pCache;
+        pCache.StoreMask(1, L"One", CreateMask(100, 10));
+        const auto nUsage = pCache.GetMemoryUsage();
+
+        pCache.StoreMask(1, L"One", CreateMask(100, 20));
+        Assert::AreEqual(nUsage + 1000, pCache.GetMemoryUsage());
+        Assert::AreEqual({ 1U }, pCache.Count());
+    }
+
+    TEST_METHOD(TestClear)
+    {
+        TextCache pCache;
+        pCache.StoreMask(1, L"One", CreateMask(10, 10));
+        pCache.StoreSize(1, L"Two", ra::ui::Size{10, 10});
+
+        pCache.Clear();
+        Assert::AreEqual({ 0U }, pCache.Count());
+        Assert::AreEqual({ 0U }, pCache.GetMemoryUsage());
+        ra::ui::Size szText;
+        Assert::IsFalse(pCache.FindSize(1, L"One", szText));
+        Assert::IsFalse(pCache.FindSize(1, L"Two", szText));
+    }
+
+    TEST_METHOD(TestMultipleThreads)
+    {
+        // small enough that entries are constantly evicted while the other thread is using them
+        TextCache pCache(5000);
+        std::atomic<int> nMismatches{ 0 };
+
+        auto fDraw = [&pCache, &nMismatches](int nFont) {
+            for (int i = 0; i < 2000; ++i)
+            {
+                const auto nCoverage = gsl::narrow_cast<std::uint8_t>(i % 20);
+                const std::wstring sText = std::to_wstring(nCoverage);
+                auto pMask = pCache.FindMask(nFont, sText);
+                if (pMask == nullptr)
+                    pMask = pCache.StoreMask(nFont, sText, CreateMask(20, 10, nCoverage));
+
+                if (pMask->vCoverage.size() != 200 || pMask->vCoverage.back() != nCoverage)
+                    ++nMismatches;
+            }
+        };
+
+        std::thread pThread(fDraw, 1);
+        fDraw(2);
+        pThread.join();
+
+        Assert::AreEqual(0, nMismatches.load());
+        Assert::IsTrue(pCache.GetMemoryUsage() <= 5000U);
+    }
+};
+
+} // namespace tests
+} // namespace drawing
+} // namespace ui
+} // namespace ra
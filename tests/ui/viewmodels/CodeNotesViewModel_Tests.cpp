@@ -147,6 +147,95 @@ public:
         AssertRow(notes, 2, 0x0040, L"0x0040\n- 0x0049", L"[10 bytes] Inventory");
     }
 
+    TEST_METHOD(TestApplyFilterIndexed)
+    {
+        CodeNotesViewModelHarness notes;
+        notes.PopulateNotes();
+        notes.SetIsVisible(true);
+        Assert::AreEqual({ 14U }, notes.Notes().Count());
+
+        notes.SetFilterValue(L"QUANTity");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 5U }, notes.Notes().Count());
+        Assert::AreEqual(std::wstring(L"5/14"), notes.GetResultCount());
+        AssertRow(notes, 0, 0x0030, L"0x0030", L"Item 1 Quantity");
+        AssertRow(notes, 4, 0x0034, L"0x0034", L"Item 5 Quantity");
+
+        // no note contains the complete filter
+        notes.SetFilterValue(L"tity item");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 0U }, notes.Notes().Count());
+        Assert::AreEqual(std::wstring(L"0/14"), notes.GetResultCount());
+
+        notes.ResetFilter();
+        notes.SetFilterValue(L"current");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 1U }, notes.Notes().Count());
+        AssertRow(notes, 0, 0x0022, L"0x0022", L"[16-bit] Current HP");
+
+        // trigram that doesn't exist in any note
+        notes.ResetFilter();
+        notes.SetFilterValue(L"xyz");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 0U }, notes.Notes().Count());
+        Assert::AreEqual(std::wstring(L"0/14"), notes.GetResultCount());
+    }
+
+    TEST_METHOD(TestApplyFilterIndexUpdatedByNoteChanges)
+    {
+        CodeNotesViewModelHarness notes;
+        notes.PopulateNotes();
+        notes.SetIsVisible(true);
+        Assert::AreEqual({ 14U }, notes.Notes().Count());
+
+        notes.mockGameContext.SetCodeNote(0x0031, L"Item 2 Count");
+        notes.mockGameContext.SetCodeNote(0x0050, L"[4 bytes] Bonus Quantity");
+        notes.mockGameContext.DeleteCodeNote(0x0033);
+        Assert::AreEqual({ 14U }, notes.Notes().Count());
+        AssertRow(notes, 13, 0x0050, L"0x0050", L"[4 bytes] Bonus Quantity");
+
+        notes.SetFilterValue(L"quantity");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 4U }, notes.Notes().Count());
+        Assert::AreEqual(std::wstring(L"4/14"), notes.GetResultCount());
+        AssertRow(notes, 0, 0x0030, L"0x0030", L"Item 1 Quantity");
+        AssertRow(notes, 1, 0x0032, L"0x0032", L"Item 3 Quantity");
+        AssertRow(notes, 2, 0x0034, L"0x0034", L"Item 5 Quantity");
+        AssertRow(notes, 3, 0x0050, L"0x0050", L"[4 bytes] Bonus Quantity");
+
+        notes.ResetFilter();
+        notes.SetFilterValue(L"count");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 1U }, notes.Notes().Count());
+        AssertRow(notes, 0, 0x0031, L"0x0031", L"Item 2 Count");
+    }
+
+    TEST_METHOD(TestApplyFilterKeepsSelection)
+    {
+        CodeNotesViewModelHarness notes;
+        notes.PopulateNotes();
+        notes.SetIsVisible(true);
+        Assert::AreEqual({ 14U }, notes.Notes().Count());
+
+        notes.Notes().GetItemAt(0)->SetSelected(true);  // 0x0010 Score X000
+        notes.Notes().GetItemAt(4)->SetSelected(true);  // 0x0016 [32-bit] Score
+        notes.Notes().GetItemAt(5)->SetSelected(true);  // 0x001A Gender
+
+        notes.SetFilterValue(L"score");
+        notes.ApplyFilter();
+        Assert::AreEqual({ 5U }, notes.Notes().Count());
+        Assert::IsTrue(notes.Notes().GetItemAt(0)->IsSelected());
+        Assert::IsFalse(notes.Notes().GetItemAt(1)->IsSelected());
+        Assert::IsFalse(notes.Notes().GetItemAt(2)->IsSelected());
+        Assert::IsFalse(notes.Notes().GetItemAt(3)->IsSelected());
+        Assert::IsTrue(notes.Notes().GetItemAt(4)->IsSelected());
+
+        notes.ResetFilter();
+        Assert::AreEqual({ 14U }, notes.Notes().Count());
+        Assert::IsFalse(notes.Notes().GetItemAt(0)->IsSelected());
+        Assert::IsFalse(notes.Notes().GetItemAt(5)->IsSelected());
+    }
+
     TEST_METHOD(TestAddNoteUnfiltered)
     {
         CodeNotesViewModelHarness notes;
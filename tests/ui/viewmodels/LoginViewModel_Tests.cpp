@@ -8,12 +8,14 @@
 #include "tests\mocks\MockEmulatorContext.hh"
 #include "tests\mocks\MockServer.hh"
 #include "tests\mocks\MockSessionTracker.hh"
+#include "tests\mocks\MockSubmissionQueue.hh"
 #include "tests\mocks\MockUserContext.hh"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using ra::api::mocks::MockServer;
 using ra::data::mocks::MockEmulatorContext;
 using ra::data::mocks::MockSessionTracker;
+using ra::data::mocks::MockSubmissionQueue;
 using ra::data::mocks::MockUserContext;
 using ra::services::mocks::MockConfiguration;
 using ra::ui::mocks::MockDesktop;
@@ -37,6 +39,7 @@ private:
         MockUserContext mockUserContext;
         MockEmulatorContext mockEmulatorContext;
         MockSessionTracker mockSessionTracker;
+        MockSubmissionQueue mockSubmissionQueue;
     };
 
 public:
@@ -131,6 +134,9 @@ public:
         // session tracker should know user name
         Assert::AreEqual(std::wstring(L"User"), vmLogin.mockSessionTracker.GetUsername());
 
+        // submission queue should know user name
+        Assert::AreEqual(std::wstring(L"User"), vmLogin.mockSubmissionQueue.GetUsername());
+
         // emulator should have been notified to rebuild the RetroAchievements menu
         Assert::IsTrue(bWasMenuRebuilt);
     }
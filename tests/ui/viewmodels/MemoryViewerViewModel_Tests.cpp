@@ -4,9 +4,13 @@
 
 #include "services\ServiceLocator.hh"
 
+#include "ui\EditorTheme.hh"
+
 #include "tests\RA_UnitTestHelpers.h"
+#include "tests\mocks\MockConfiguration.hh"
 #include "tests\mocks\MockEmulatorContext.hh"
 #include "tests\mocks\MockGameContext.hh"
+#include "tests\mocks\MockSurface.hh"
 #include "tests\mocks\MockWindowManager.hh"
 
 #undef GetMessage
@@ -20,6 +24,9 @@ namespace tests {
 
 constexpr unsigned char COLOR_RED = gsl::narrow_cast<unsigned char>(ra::etoi(MemoryViewerViewModel::TextColor::Selected));
 constexpr unsigned char COLOR_BLACK = gsl::narrow_cast<unsigned char>(ra::etoi(MemoryViewerViewModel::TextColor::Default));
+constexpr unsigned char COLOR_NOTE = gsl::narrow_cast<unsigned char>(ra::etoi(MemoryViewerViewModel::TextColor::HasNote));
+constexpr unsigned char COLOR_BOOKMARK = gsl::narrow_cast<unsigned char>(ra::etoi(MemoryViewerViewModel::TextColor::HasBookmark));
+constexpr unsigned char COLOR_FROZEN = gsl::narrow_cast<unsigned char>(ra::etoi(MemoryViewerViewModel::TextColor::Frozen));
 constexpr unsigned char COLOR_REDRAW = 0x80;
 
 constexpr int CHAR_WIDTH = 8;
@@ -31,11 +38,14 @@ private:
     class MemoryViewerViewModelHarness : public MemoryViewerViewModel
     {
     public:
+        ra::services::mocks::MockConfiguration mockConfiguration;
         ra::data::mocks::MockEmulatorContext mockEmulatorContext;
         ra::data::mocks::MockGameContext mockGameContext;
         ra::ui::viewmodels::mocks::MockWindowManager mockWindowManager;
+        ra::ui::drawing::mocks::MockSurfaceFactory mockSurfaceFactory;
+        ra::ui::EditorTheme editorTheme;
 
-        GSL_SUPPRESS_F6 MemoryViewerViewModelHarness() : MemoryViewerViewModel()
+        GSL_SUPPRESS_F6 MemoryViewerViewModelHarness() : MemoryViewerViewModel(), m_overrideEditorTheme(&editorTheme)
         {
             InitializeNotifyTargets();
 
@@ -72,6 +82,18 @@ private:
             DoFrame(); // populates m_pMemory and m_pColor
         }
 
+        void SetByte(ra::ByteAddress nAddress, unsigned char nValue) noexcept
+        {
+            m_pBytes.get()[nAddress] = nValue;
+        }
+
+        int GetDrawSurfaceCount() const
+        {
+            const auto* pSurface = dynamic_cast<const ra::ui::drawing::mocks::MockSurface*>(&GetRenderImage());
+            Expects(pSurface != nullptr);
+            return pSurface->GetDrawSurfaceCount();
+        }
+
         void MockRender() noexcept
         {
             for (size_t i = 0; i < m_nTotalMemorySize; ++i)
@@ -82,6 +104,7 @@ private:
 
     private:
         std::unique_ptr<unsigned char[]> m_pBytes;
+        ra::services::ServiceLocator::ServiceOverride<ra::ui::EditorTheme> m_overrideEditorTheme;
     };
 
 public:
@@ -1694,6 +1717,129 @@ public:
         Assert::AreEqual({ 2U }, viewer.GetAddress());
         Assert::AreEqual({ 0U }, viewer.GetSelectedNibble());
     }
+
+    TEST_METHOD(TestDoFrameMarksChangedBytes)
+    {
+        MemoryViewerViewModelHarness viewer;
+        viewer.InitializeMemory(256);
+        viewer.MockRender();
+
+        // no changes, nothing to redraw
+        viewer.DoFrame();
+        Assert::IsFalse(viewer.NeedsRedraw());
+
+        // changes in the first and last visible rows, and at both ends of a row
+        viewer.SetByte(3U, 0x55);
+        viewer.SetByte(16U, 0x66);
+        viewer.SetByte(31U, 0x77);
+        viewer.SetByte(127U, 0x88);
+        viewer.DoFrame();
+        Assert::IsTrue(viewer.NeedsRedraw());
+
+        for (ra::ByteAddress i = 0; i < 128; ++i)
+        {
+            const bool bChanged = (i == 3 || i == 16 || i == 31 || i == 127);
+            const unsigned char nColor = (i == 0) ? COLOR_RED : COLOR_BLACK;
+            Assert::AreEqual(gsl::narrow_cast<unsigned char>(bChanged ? (nColor | COLOR_REDRAW) : nColor), viewer.GetColor(i));
+        }
+
+        Assert::AreEqual({ 0x55 }, viewer.GetByte(3U));
+        Assert::AreEqual({ 0x66 }, viewer.GetByte(16U));
+        Assert::AreEqual({ 0x77 }, viewer.GetByte(31U));
+        Assert::AreEqual({ 0x88 }, viewer.GetByte(127U));
+        Assert::AreEqual({ 4 }, viewer.GetByte(4U));
+
+        // bytes below the visible area are not monitored
+        viewer.MockRender();
+        viewer.SetByte(128U, 0x99);
+        viewer.DoFrame();
+        Assert::IsFalse(viewer.NeedsRedraw());
+    }
+
+    TEST_METHOD(TestRenderOnlyDrawsChangedBytes)
+    {
+        MemoryViewerViewModelHarness viewer;
+        viewer.InitializeMemory(256);
+
+        // first render draws every visible byte with a single copy each
+        viewer.UpdateRenderImage();
+        Assert::AreEqual(128, viewer.GetDrawSurfaceCount());
+        Assert::IsFalse(viewer.NeedsRedraw());
+
+        viewer.SetByte(3U, 0x55);
+        viewer.SetByte(100U, 0x66);
+        viewer.DoFrame();
+        viewer.UpdateRenderImage();
+        Assert::AreEqual(130, viewer.GetDrawSurfaceCount());
+        Assert::AreEqual(COLOR_BLACK, viewer.GetColor(3U));
+        Assert::AreEqual(COLOR_BLACK, viewer.GetColor(100U));
+
+        // nothing changed, nothing drawn
+        viewer.DoFrame();
+        viewer.UpdateRenderImage();
+        Assert::AreEqual(130, viewer.GetDrawSurfaceCount());
+    }
+
+    TEST_METHOD(TestCodeNoteColors)
+    {
+        MemoryViewerViewModelHarness viewer;
+        viewer.InitializeMemory(256);
+        viewer.MockRender();
+
+        viewer.mockGameContext.SetCodeNote(0x10, L"Note");
+        Assert::AreEqual({ COLOR_NOTE | COLOR_REDRAW }, viewer.GetColor(0x10));
+        Assert::AreEqual(COLOR_BLACK, viewer.GetColor(0x11));
+
+        // note added for an address that isn't visible should be shown when scrolled into view
+        viewer.mockGameContext.SetCodeNote(0xC4, L"Note2");
+        viewer.SetFirstAddress(0x80);
+        Assert::AreEqual({ COLOR_NOTE | COLOR_REDRAW }, viewer.GetColor(0xC4));
+        Assert::AreEqual({ COLOR_BLACK | COLOR_REDRAW }, viewer.GetColor(0xC5));
+        viewer.MockRender();
+
+        // note removed for an address that isn't visible should not be shown when scrolled into view
+        viewer.mockGameContext.DeleteCodeNote(0x10);
+        viewer.mockGameContext.DeleteCodeNote(0xC4);
+        Assert::AreEqual({ COLOR_BLACK | COLOR_REDRAW }, viewer.GetColor(0xC4));
+
+        viewer.SetFirstAddress(0);
+        Assert::AreEqual({ COLOR_BLACK | COLOR_REDRAW }, viewer.GetColor(0x10));
+    }
+
+    TEST_METHOD(TestBookmarkColors)
+    {
+        MemoryViewerViewModelHarness viewer;
+        viewer.InitializeMemory(256);
+        viewer.mockGameContext.SetCodeNote(0x20, L"Note");
+        viewer.MockRender();
+
+        // bookmark takes precedence over note
+        auto& pBookmarks = viewer.mockWindowManager.MemoryBookmarks;
+        pBookmarks.AddBookmark(0x20, MemSize::EightBit);
+        Assert::AreEqual({ COLOR_BOOKMARK | COLOR_REDRAW }, viewer.GetColor(0x20));
+
+        // frozen bookmark
+        viewer.MockRender();
+        auto* pBookmark = pBookmarks.Bookmarks().GetItemAt(0);
+        Expects(pBookmark != nullptr);
+        pBookmark->SetBehavior(MemoryBookmarksViewModel::BookmarkBehavior::Frozen);
+        Assert::AreEqual({ COLOR_FROZEN | COLOR_REDRAW }, viewer.GetColor(0x20));
+
+        // bookmark for an address that isn't visible should be shown when scrolled into view
+        pBookmarks.AddBookmark(0xE0, MemSize::EightBit);
+        viewer.SetFirstAddress(0x80);
+        Assert::AreEqual({ COLOR_BOOKMARK | COLOR_REDRAW }, viewer.GetColor(0xE0));
+
+        // removing the bookmark reveals the note
+        viewer.SetFirstAddress(0);
+        viewer.MockRender();
+        pBookmarks.Bookmarks().RemoveAt(0);
+        Assert::AreEqual({ COLOR_NOTE | COLOR_REDRAW }, viewer.GetColor(0x20));
+
+        pBookmarks.Bookmarks().RemoveAt(0);
+        viewer.SetFirstAddress(0x80);
+        Assert::AreEqual({ COLOR_BLACK | COLOR_REDRAW }, viewer.GetColor(0xE0));
+    }
 };
 
 } // namespace tests
@@ -6,8 +6,10 @@
 #include "tests\mocks\MockGameContext.hh"
 #include "tests\mocks\MockImageRepository.hh"
 #include "tests\mocks\MockOverlayManager.hh"
+#include "tests\mocks\MockOverlayTheme.hh"
 #include "tests\mocks\MockServer.hh"
 #include "tests\mocks\MockSessionTracker.hh"
+#include "tests\mocks\MockSurface.hh"
 #include "tests\mocks\MockThreadPool.hh"
 #include "tests\mocks\MockUserContext.hh"
 #include "tests\RA_UnitTestHelpers.h"
@@ -32,10 +34,14 @@ private:
         ra::services::mocks::MockAchievementRuntime mockAchievementRuntime;
         ra::services::mocks::MockThreadPool mockThreadPool;
         ra::ui::mocks::MockImageRepository mockImageRepository;
+        ra::ui::mocks::MockOverlayTheme mockTheme;
+        ra::ui::drawing::mocks::MockSurfaceFactory mockSurfaceFactory;
         ra::ui::viewmodels::mocks::MockOverlayManager mockOverlayManager;
 
         ItemViewModel* GetItem(gsl::index nIndex) { return m_vItems.GetItemAt(nIndex); }
 
+        const ra::ui::drawing::ImageAtlas* GetImageAtlas() const noexcept { return m_pImageAtlas.get(); }
+
         void TestFetchItemDetail(gsl::index nIndex)
         {
             auto* pItem = GetItem(nIndex);
@@ -239,6 +245,52 @@ public:
         Assert::AreEqual(std::string("BADGE_URI"), pItem->Image.Name());
     }
 
+    TEST_METHOD(TestRefreshBuildsImageAtlas)
+    {
+        OverlayAchievementsPageViewModelHarness achievementsPage;
+        achievementsPage.mockGameContext.SetGameId(1U);
+        auto& pAch1 = achievementsPage.mockGameContext.NewAchievement(Achievement::Category::Core);
+        pAch1.SetID(1);
+        pAch1.SetBadgeImage("BADGE1");
+        pAch1.SetActive(true);
+        auto& pAch2 = achievementsPage.mockGameContext.NewAchievement(Achievement::Category::Core);
+        pAch2.SetID(2);
+        pAch2.SetBadgeImage("BADGE2");
+        auto& pAch3 = achievementsPage.mockGameContext.NewAchievement(Achievement::Category::Local);
+        pAch3.SetID(3);
+        pAch3.SetBadgeImage("BADGE3");
+        achievementsPage.Refresh();
+
+        // core achievements have both the unlocked and locked badges. local achievements are never locked.
+        const auto* pAtlas = achievementsPage.GetImageAtlas();
+        Expects(pAtlas != nullptr);
+        Assert::AreEqual({ 5U }, pAtlas->Count());
+        Assert::AreEqual({ 1U }, pAtlas->SurfaceCount());
+        Assert::IsTrue(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE1"));
+        Assert::IsTrue(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE1_lock"));
+        Assert::IsTrue(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE2"));
+        Assert::IsTrue(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE2_lock"));
+        Assert::IsTrue(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE3"));
+        Assert::IsFalse(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE3_lock"));
+
+        // unlocking an achievement doesn't change the atlas
+        pAch1.SetActive(false);
+        achievementsPage.Refresh();
+        Assert::IsTrue(pAtlas == achievementsPage.GetImageAtlas());
+        Assert::AreEqual({ 5U }, pAtlas->Count());
+        Assert::AreEqual({ 1U }, pAtlas->SurfaceCount());
+
+        // loading another game discards the atlas
+        achievementsPage.mockGameContext.SetGameId(2U);
+        pAch1.SetBadgeImage("BADGE4");
+        achievementsPage.Refresh();
+        pAtlas = achievementsPage.GetImageAtlas();
+        Expects(pAtlas != nullptr);
+        Assert::AreEqual({ 5U }, pAtlas->Count());
+        Assert::IsFalse(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE1"));
+        Assert::IsTrue(pAtlas->Contains(ra::ui::ImageType::Badge, "BADGE4_lock"));
+    }
+
     TEST_METHOD(TestRefreshProgressAchievements)
     {
         OverlayAchievementsPageViewModelHarness achievementsPage;
@@ -8,6 +8,7 @@
 #include "tests\mocks\MockConfiguration.hh"
 #include "tests\mocks\MockDesktop.hh"
 #include "tests\mocks\MockEmulatorContext.hh"
+#include "tests\mocks\MockFileSystem.hh"
 #include "tests\mocks\MockGameContext.hh"
 #include "tests\mocks\MockImageRepository.hh"
 #include "tests\mocks\MockOverlayTheme.hh"
@@ -36,6 +37,7 @@ private:
         ra::data::mocks::MockUserContext mockUserContext;
         ra::services::mocks::MockClock mockClock;
         ra::services::mocks::MockConfiguration mockConfiguration;
+        ra::services::mocks::MockFileSystem mockFileSystem;
         ra::services::mocks::MockThreadPool mockThreadPool;
         ra::ui::mocks::MockDesktop mockDesktop;
         ra::ui::mocks::MockImageRepository mockImageRepository;
@@ -75,6 +77,12 @@ private:
 
         int GetOverlayRenderX() const { return m_vmOverlay.GetRenderLocationX(); }
 
+        bool IsPng(const std::wstring& sPath)
+        {
+            const auto& sContents = mockFileSystem.GetFileContents(sPath);
+            return (sContents.length() > 8 && sContents.compare(1, 3, "PNG") == 0);
+        }
+
     private:
         bool m_bRenderRequested = false;
         bool m_bShowRequested = false;
@@ -290,6 +298,49 @@ public:
         Assert::IsNull(overlay.GetScoreTracker(3)); // render should erase and destroy
     }
 
+    TEST_METHOD(TestRenderOnlyChangedPopups)
+    {
+        OverlayManagerHarness overlay;
+        overlay.mockConfiguration.SetFeatureEnabled(ra::services::Feature::LeaderboardCounters, true);
+
+        const auto nTracker1Y = overlay.AddScoreTracker(3).GetRenderLocationY();
+        auto& vmScoreTracker2 = overlay.AddScoreTracker(4);
+        const auto nTracker2Y = vmScoreTracker2.GetRenderLocationY();
+
+        // second tracker is moved above the first one. the first one overlaps the area where the second one used
+        // to be, so it has to be redrawn too.
+        ra::ui::drawing::mocks::MockSurface mockSurface(800, 600);
+        overlay.Render(mockSurface, false);
+        Assert::AreNotEqual(nTracker2Y, vmScoreTracker2.GetRenderLocationY());
+        Assert::AreEqual(2, mockSurface.GetDrawSurfaceCount());
+
+        // nothing changed, nothing should be drawn
+        mockSurface.ResetDrawSurfaceCount();
+        overlay.mockClock.AdvanceTime(std::chrono::milliseconds(100));
+        overlay.Render(mockSurface, false);
+        Assert::AreEqual(0, mockSurface.GetDrawSurfaceCount());
+
+        // only the tracker that changed should be drawn
+        vmScoreTracker2.SetDisplayText(L"12345");
+        overlay.mockClock.AdvanceTime(std::chrono::milliseconds(100));
+        overlay.Render(mockSurface, false);
+        Assert::AreEqual(1, mockSurface.GetDrawSurfaceCount());
+
+        // redraw all should draw everything
+        mockSurface.ResetDrawSurfaceCount();
+        overlay.Render(mockSurface, true);
+        Assert::AreEqual(2, mockSurface.GetDrawSurfaceCount());
+
+        // removing the first tracker moves the second tracker into its place. both areas have to be redrawn,
+        // but only the second tracker is still visible
+        mockSurface.ResetDrawSurfaceCount();
+        overlay.RemoveScoreTracker(3);
+        overlay.Render(mockSurface, false);
+        Assert::IsNull(overlay.GetScoreTracker(3));
+        Assert::AreEqual(1, mockSurface.GetDrawSurfaceCount());
+        Assert::AreEqual(nTracker1Y, vmScoreTracker2.GetRenderLocationY());
+    }
+
     TEST_METHOD(TestQueueScoreboard)
     {
         OverlayManagerHarness overlay;
@@ -393,6 +444,48 @@ public:
         Assert::IsNull(overlay.GetScoreboard(3));
     }
 
+    TEST_METHOD(TestCaptureScreenshot)
+    {
+        OverlayManagerHarness overlay;
+        overlay.mockSurfaceFactory.SetCanCopyPixels(true);
+        overlay.mockImageRepository.SetImageAvailable(ra::ui::ImageType::Badge, "BadgeURI");
+        const auto nId = overlay.QueueMessage(L"Title", L"Description", ra::ui::ImageType::Badge, "BadgeURI");
+
+        overlay.CaptureScreenshot(nId, L"screenshot.png");
+        Assert::AreEqual({ 1U }, overlay.mockThreadPool.PendingTasks());
+
+        // first task renders the screenshot and hands the pixels to the writer
+        overlay.mockThreadPool.ExecuteNextTask();
+        Assert::IsFalse(overlay.IsPng(L"screenshot.png"));
+        Assert::AreEqual({ 1U }, overlay.mockThreadPool.PendingTasks());
+
+        // second task writes the file
+        overlay.mockThreadPool.ExecuteNextTask();
+        Assert::IsTrue(overlay.IsPng(L"screenshot.png"));
+        Assert::AreEqual({ 0U }, overlay.mockThreadPool.PendingTasks());
+    }
+
+    TEST_METHOD(TestCaptureScreenshotBurst)
+    {
+        OverlayManagerHarness overlay;
+        overlay.mockSurfaceFactory.SetCanCopyPixels(true);
+        overlay.mockImageRepository.SetImageAvailable(ra::ui::ImageType::Badge, "BadgeURI");
+
+        // more screenshots than the writer will queue. none of them should be discarded.
+        constexpr int nScreenshots = gsl::narrow_cast<int>(ra::ui::drawing::PngWriter::DEFAULT_MAX_QUEUED) + 2;
+        for (int i = 0; i < nScreenshots; ++i)
+        {
+            const auto nId = overlay.QueueMessage(L"Title", L"Description", ra::ui::ImageType::Badge, "BadgeURI");
+            overlay.CaptureScreenshot(nId, ra::StringPrintf(L"screenshot%d.png", i));
+        }
+
+        while (overlay.mockThreadPool.PendingTasks() > 0)
+            overlay.mockThreadPool.ExecuteNextTask();
+
+        for (int i = 0; i < nScreenshots; ++i)
+            Assert::IsTrue(overlay.IsPng(ra::StringPrintf(L"screenshot%d.png", i)));
+    }
+
     TEST_METHOD(TestShowHideOverlay)
     {
         OverlayManagerHarness overlay;
@@ -122,10 +122,9 @@ TEST_CLASS(RichPresenceMonitorViewModel_Tests)
         Assert::AreEqual(std::wstring(L"Hello, world!"), vmRichPresence.GetDisplayString());
         Assert::AreEqual({ 1U }, vmRichPresence.mockThreadPool.PendingTasks());
 
-        // when monitoring stops, updated message should be ignored. callback will still be
-        // called once, but won't reschedule itself
+        // when monitoring stops, updated message should be ignored. callback should be unscheduled
         vmRichPresence.SetIsVisible(false);
-        Assert::AreEqual({ 1U }, vmRichPresence.mockThreadPool.PendingTasks());
+        Assert::AreEqual({ 0U }, vmRichPresence.mockThreadPool.PendingTasks());
 
         vmRichPresence.mockGameContext.SetRichPresenceDisplayString(L"Hello, world 2!");
         vmRichPresence.mockThreadPool.AdvanceTime(std::chrono::seconds(1));